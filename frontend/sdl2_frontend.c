@@ -13,6 +13,8 @@ struct Sdl2Frontend
     SDL_Renderer* ren;
     SDL_Texture* tex;
     SDL_GameController* gc;   // NEW: optional gamepad
+    int locked;               // tex is locked and the core draws into it
+    int kept;                 // headless frame: tex keeps the last drawn one
     int running;
     int integer_scale;
 };
@@ -133,13 +135,39 @@ int sdl2_frontend_pump(Sdl2Frontend* fe)
     return fe->running;
 }
 
+void sdl2_frontend_begin_frame(Sdl2Frontend* fe)
+{
+    if (!fe || fe->locked) return;
+
+    // A skipped frame draws nothing, and a locked texture's memory is
+    // undefined: leave the texture with the last drawn frame instead
+    fe->kept = nes_get_skip_render();
+    if (fe->kept) return;
+
+    // The core writes each line straight into the texture memory
+    void* pixels = NULL;
+    int pitch_bytes = 0;
+    if (SDL_LockTexture(fe->tex, NULL, &pixels, &pitch_bytes) != 0) return;
+    nes_set_render_target((uint32_t*)pixels, pitch_bytes);
+    fe->locked = 1;
+}
+
 void sdl2_frontend_present(Sdl2Frontend* fe)
 {
     if (!fe) return;
 
-    int pitch_bytes = 0;
-    const uint32_t* fb = nes_framebuffer_argb8888(&pitch_bytes);
-    if (fb) SDL_UpdateTexture(fe->tex, NULL, fb, pitch_bytes);
+    if (fe->locked) {
+        nes_set_render_target(NULL, 0);
+        SDL_UnlockTexture(fe->tex);
+        fe->locked = 0;
+    } else if (fe->kept) {
+        fe->kept = 0;
+    } else {
+        // No begin_frame (or the lock failed): upload the core's buffer
+        int pitch_bytes = 0;
+        const uint32_t* fb = nes_framebuffer_argb8888(&pitch_bytes);
+        if (fb) SDL_UpdateTexture(fe->tex, NULL, fb, pitch_bytes);
+    }
 
     SDL_RenderClear(fe->ren);
     SDL_RenderCopy(fe->ren, fe->tex, NULL, NULL);
@@ -159,6 +187,7 @@ void sdl2_frontend_destroy(Sdl2Frontend* fe)
     sdl2_audio_shutdown();
     if (!fe) { SDL_Quit(); return; }
     if (fe->gc)  { SDL_GameControllerClose(fe->gc); fe->gc = NULL; }
+    if (fe->locked) { nes_set_render_target(NULL, 0); SDL_UnlockTexture(fe->tex); }
     if (fe->tex) SDL_DestroyTexture(fe->tex);
     if (fe->ren) SDL_DestroyRenderer(fe->ren);
     if (fe->win) SDL_DestroyWindow(fe->win);
@@ -52,7 +52,15 @@ Hotkeys handled internally:
 */
 int sdl2_frontend_pump(Sdl2Frontend* fe);
 
-/* Upload the current core framebuffer and present the frame. */
+/* Lock the streaming texture and have the core draw the coming frame
+straight into it (nes_set_render_target()); call before nes_step_frame().
+With nes_set_skip_render() on, the texture is left as it is and present()
+shows the last drawn frame again. Optional: without it present() uploads
+the core's buffer instead. */
+void sdl2_frontend_begin_frame(Sdl2Frontend* fe);
+
+/* Unlock the texture (or upload the current core framebuffer) and present
+the frame. */
 void sdl2_frontend_present(Sdl2Frontend* fe);
 
 /* Toggle fullscreen desktop mode. */
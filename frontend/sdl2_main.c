@@ -4,6 +4,7 @@
 #include <SDL.h>               // <-- add this
 #include "nes.h"              // nes_load_rom_file, nes_reset, nes_step_frame, ...
 #include "sdl2_frontend.h"    // Sdl2Frontend API
+#include "nes_palette.h"      // nes_palette_load
 
 // NTSC NES runs ~60.0988 fps => ~16.639 ms per frame
 static inline void throttle_60hz(uint64_t frame_start_ticks) {
@@ -26,12 +27,16 @@ static inline void throttle_60hz(uint64_t frame_start_ticks) {
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        fprintf(stderr, "usage: %s rom.nes [-scale N]\n", argv[0]);
+        fprintf(stderr, "usage: %s rom.nes [-scale N] [-palette file.pal] [-render-thread]\n", argv[0]);
         return 1;
     }
     int scale = 3;
-    for (int i=2;i<argc;i++)
+    for (int i=2;i<argc;i++) {
         if (!strcmp(argv[i], "-scale") && i+1<argc) scale = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-palette") && i+1<argc && !nes_palette_load(argv[++i])) return 1;
+        else if (!strcmp(argv[i], "-render-thread") && !nes_set_render_thread(1))
+            fprintf(stderr, "render thread not available, drawing inline\n");
+    }
 
     if (!nes_load_rom_file(argv[1])) {       // loader: 1 on success
         fprintf(stderr, "nes_load_rom_file failed: %s\n", argv[1]);
@@ -51,12 +56,14 @@ int main(int argc, char** argv) {
     while (sdl2_frontend_pump(fe)) {
         uint64_t t0 = SDL_GetPerformanceCounter();  // timestamp frame start
 
+        sdl2_frontend_begin_frame(fe);  // core draws into the locked texture
         nes_step_frame();               // advance exactly one NES frame
-        sdl2_frontend_present(fe);      // upload + present framebuffer
+        sdl2_frontend_present(fe);      // unlock + present framebuffer
 
         throttle_60hz(t0);              // <-- throttle to ~16.639 ms per frame
     }
 
     sdl2_frontend_destroy(fe);
+    nes_shutdown();
     return 0;
 }
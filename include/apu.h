@@ -57,6 +57,13 @@ void apu_write(uint16_t addr, uint8_t v); // Writes to $4000–$4017 control cha
 // Call this alongside your CPU stepping so the sequencer and channel timers run in lockstep.
 void apu_step(int cpu_cycles);
 
+// Steps of any size give the same output as many small ones.
+
+// Look-ahead for callers that schedule around the APU: CPU cycles until the
+// next frame-sequencer step and until the next output sample (both >= 1).
+int apu_cycles_to_frame_step(void);
+int apu_cycles_to_sample(void);
+
 // ---- Audio output (mono) ----
 //
 // The APU mixes pulse1, pulse2, triangle, noise, and DMC into a single mono stream.
@@ -6,6 +6,7 @@
 #define NES_BUS_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 // ---- CPU-visible bus API ----
 uint8_t cpu_read(uint16_t addr);
@@ -14,6 +15,31 @@ void cpu_write(uint16_t addr, uint8_t data);
 void bus_reset(void);
 void bus_set_prg_size(size_t sz_bytes);
 
+// ---- Page-table mapping (mappers call this on init / bank switch) ----
+// Publish host memory for CPU reads of [cpu_addr, cpu_addr+len). Both values
+// must be multiples of 256 and the range must lie in $8000-$FFFF. Pass
+// mem=NULL to route the range back through mapper_cpu_read(). Writes to
+// cartridge space always go to mapper_cpu_write().
+void bus_map_prg(uint16_t cpu_addr, size_t len, const uint8_t* mem);
+
+// Declare the mapper's whole PRG-ROM image (call before bus_map_prg()). The
+// CPU's decoded instruction cache and block translator key ROM code by its
+// offset in here, so every window that maps the same bank shares one set of
+// decoded entries and translated blocks.
+void bus_set_prg_rom(const uint8_t* mem, size_t len);
+
+// Called by the CPU's decoded instruction cache: on=1 sends writes to every
+// CPU page mapped onto the 256-byte host page `page` through cpu_write()'s
+// handler path (which invalidates the decoded code); on=0 restores direct
+// writes.
+void bus_trap_code_writes(const uint8_t* page, int on);
+
+// Page tables for the CPU fast path: entry [addr >> 8] points at the start of
+// that page in host memory, or is NULL when the access must go through
+// cpu_read()/cpu_write() (I/O, mapper registers).
+const uint8_t* const* bus_read_pages(void);
+uint8_t* const*       bus_write_pages(void);
+
 // Useful constants for the CPU memory map
 enum
 {
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"{
@@ -29,6 +30,153 @@ enum
 void cpu_reset(void); // power-on/reset: reads reset vector, initializes registers
 void cpu_step(void); // execute one opcode (including all implied memory cycles)
 
+// Run whole instructions until at least `cycles` CPU cycles have elapsed.
+// Returns the cycles actually run (may overshoot by the last instruction,
+// an interrupt entry or an OAM DMA stall). Ends early, after at least one
+// instruction, when cpu_yield() is called during the batch.
+int cpu_run(int cycles);
+
+// Ask the running cpu_run() batch to return at the next instruction boundary.
+// The bus calls this when a register write moves the scheduler's next event
+// before the end of the current batch (see nes_sched.h).
+void cpu_yield(void);
+
+// Core selection. The reference core (cpu_ops.c, one function per opcode) is
+// the default; the fast core (cpu_fast.c) keeps registers in locals and runs
+// a batch per call. The JIT core (cpu_jit.c, x86-64 only) runs translated
+// PRG-ROM blocks and interprets the rest; it only starts a block that fits the
+// cpu_run() budget, so it needs batches larger than one instruction to help.
+// All are cycle-for-cycle identical. Build with -DCPU_FAST_CORE=ON to make
+// the fast core the default. cpu_step() always runs the reference core;
+// cpu_run(1) steps the selected one.
+typedef enum
+{
+    CPU_CORE_REFERENCE = 0,
+    CPU_CORE_FAST      = 1,
+    CPU_CORE_JIT       = 2,
+} cpu_core_t;
+
+void cpu_set_core(cpu_core_t core);
+cpu_core_t cpu_get_core(void);
+
+// -----------------------------------------------------------------------------
+// Decoded instruction cache (reference core)
+// cpu_step() keeps handler, operand, base cycles and length per instruction,
+// keyed by the host memory behind the CPU page, so a PRG bank switch only
+// changes which decoded page is used. ROM pages are never invalidated; pages
+// of registered RAM are dropped on the first write after they were decoded
+// (the bus routes those writes through cpu_icache_invalidate()).
+// -----------------------------------------------------------------------------
+void cpu_icache_add_rom(const uint8_t* mem, size_t len); // replaces the previous ROM
+void cpu_icache_add_ram(const uint8_t* mem, size_t len); // re-adding a region empties it
+void cpu_icache_invalidate(const uint8_t* mem, size_t len);
+void cpu_icache_flush(void);
+void cpu_icache_set_enabled(int on); // default on
+
+typedef struct
+{
+    uint64_t hits;          // instructions run from a decoded entry
+    uint64_t misses;        // instructions decoded (first run or after a write)
+    uint64_t bypassed;      // fetched from I/O/mapper pages or across a page edge
+    uint64_t invalidations; // decoded RAM pages dropped by writes
+} cpu_icache_stats_t;
+
+void cpu_icache_get_stats(cpu_icache_stats_t* out);
+void cpu_icache_reset_stats(void);
+
+// -----------------------------------------------------------------------------
+// Block translator (CPU_CORE_JIT)
+// Straight-line PRG-ROM code is translated to x86-64, keyed like the decoded
+// instruction cache. Blocks leave to the interpreter before any I/O access and
+// are only entered with no interrupt pending. Elsewhere (or when executable
+// memory is unavailable) the JIT core is a plain interpreter loop.
+// -----------------------------------------------------------------------------
+void cpu_jit_add_rom(const uint8_t* mem, size_t len); // replaces the previous ROM
+void cpu_jit_flush(void);
+int  cpu_jit_available(void); // 1 when blocks can actually be translated
+
+typedef struct
+{
+    uint64_t blocks;       // blocks translated
+    uint64_t block_runs;   // translated blocks entered
+    uint64_t bailouts;     // blocks left early at an I/O access
+    uint64_t flushes;      // code buffer recycled
+    uint64_t jit_cycles;   // CPU cycles spent in translated code
+    uint64_t total_cycles; // CPU cycles run by the JIT core
+} cpu_jit_stats_t;
+
+void cpu_jit_get_stats(cpu_jit_stats_t* out);
+void cpu_jit_reset_stats(void);
+
+// -----------------------------------------------------------------------------
+// Binary trace (cpu_trace.c)
+// While started, every core records one fixed-size record per instruction
+// into a ring buffer (the JIT core interprets instead of entering blocks
+// while the trace or the profiler is on).
+// When stopped, the cost is one branch per instruction. Dumps hold the ring
+// oldest first; nes-trace-decode (tools/) prints them as nestest lines.
+// -----------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t cycles; // CPU cycle count before the instruction
+    uint16_t pc;
+    uint16_t ea;     // effective address / branch target; 0 for modes without one
+    uint8_t  op, op1, op2; // instruction bytes (op1/op2 are 0 past its length)
+    uint8_t  a, x, y, p, sp;
+} cpu_trace_rec_t;
+
+// File layout: CPU_TRACE_MAGIC, then CPU_TRACE_REC_BYTES per record, all
+// fields little-endian in struct order.
+#define CPU_TRACE_MAGIC     "NESTRC01"
+#define CPU_TRACE_REC_BYTES 20
+
+int    cpu_trace_start(size_t records); // (re)allocate, rounded up to a power of two; 0 on failure
+void   cpu_trace_stop(void);            // stop recording; the ring is kept for dumps
+int    cpu_trace_active(void);
+size_t cpu_trace_count(void);           // records held (at most the ring size)
+int    cpu_trace_get(size_t i, cpu_trace_rec_t* out); // i = 0 is the oldest
+
+// Write the ring to `path` (NULL = the path set below, default
+// "cpu_trace.bin"). Returns the records written or -1.
+long   cpu_trace_dump(const char* path);
+void   cpu_trace_set_dump_path(const char* path);
+
+void   cpu_trace_unpack(const uint8_t bytes[CPU_TRACE_REC_BYTES], cpu_trace_rec_t* out);
+// One nestest-style line, e.g.
+//   C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:7
+void   cpu_trace_format(const cpu_trace_rec_t* r, char* buf, size_t buflen);
+
+// -----------------------------------------------------------------------------
+// Profiler (cpu_prof.c)
+// Instructions and cycles per instruction address (PRG-ROM per bank, like
+// the decoded instruction cache), penalties and OAM DMA stalls included, plus
+// cycles per JSR/interrupt call path. Shares the per-instruction hook with
+// the trace, so the JIT core interprets while it runs.
+// -----------------------------------------------------------------------------
+void cpu_prof_add_rom(const uint8_t* mem, size_t len); // replaces the previous ROM
+int  cpu_prof_start(void); // clears all counts; 0 on failure
+void cpu_prof_stop(void);
+int  cpu_prof_active(void);
+
+typedef struct
+{
+    uint64_t insns;
+    uint64_t cycles;     // everything up to the next instruction
+    uint64_t dma_cycles; // part of `cycles` spent in DMA stalls
+} cpu_prof_counts_t;
+
+// Counts for the code currently mapped at `pc`.
+int  cpu_prof_counts(uint16_t pc, cpu_prof_counts_t* out);
+
+// Labels for reports, by CPU address: ca65 .dbg files (sym ... type=lab) or
+// plain "C0A3 name" lines. Returns the labels read or -1.
+int  cpu_prof_load_labels(const char* path);
+
+// Per-address report sorted by cycles (max_rows <= 0: all rows), and a
+// flamegraph.pl folded-stack file. Return the rows/lines written or -1.
+int  cpu_prof_write_report(const char* path, int max_rows);
+int  cpu_prof_write_folded(const char* path);
+
 // Asynchronous interrupts (triggered by PPU/APU/mapper/etc.)
 void cpu_irq(void); // maskable IRQ (respects I flag)
 void cpu_nmi(void); // non-maskable interrupt
@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include "cpu_table.h"
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -39,6 +41,63 @@ void set_zn(uint8_t v);  // sets Z and N from value
 // ----------------------------
 void interrupt_enter(uint16_t vec, int set_break);
 
+// ----------------------------
+// Shared with the fast core (cpu_fast.c)
+// ----------------------------
+void cpu_set_cycles(uint64_t cycles); // write back a locally tracked counter
+int  cpu_nmi_take(void);              // 1 if an NMI was latched (and clears it)
+int  cpu_nmi_pending(void);           // same, without clearing it
+int  cpu_irq_line_asserted(void);     // level of the shared IRQ line
+int  cpu_yield_take(void);            // 1 if cpu_yield() was called (and clears it)
+
+// Run instructions until at least `budget` cycles have elapsed; returns the
+// number of cycles actually run. Same semantics as repeated cpu_step().
+int  cpu_fast_run(int budget);
+
+// Same contract for the JIT core (cpu_jit.c).
+int  cpu_jit_run(int budget);
+
+// ----------------------------
+// Decoded instruction cache (cpu_icache.c)
+// ----------------------------
+typedef struct
+{
+    cpu_op_t handler; // cpu_dispatch[op]
+    uint16_t operand; // operand bytes, little-endian
+    uint8_t  op;      // opcode byte
+    uint8_t  cycles;  // cpu_base_cycles[op]
+    uint8_t  len;     // bytes the handler fetches, opcode included; 0 = empty slot
+} cpu_decoded_t;
+
+// Decoded entry for the instruction at `pc`, or NULL when it must be fetched
+// through the bus (I/O or mapper pages, page-straddling instructions, cache
+// disabled). The pointer is only valid until the next CPU write.
+const cpu_decoded_t* cpu_icache_lookup(uint16_t pc);
+
+// While armed, fetch8()/fetch16() return the `len` bytes following `pc` from
+// `operand` instead of reading the bus. len = 0 disarms it.
+void cpu_operand_latch(uint16_t pc, uint16_t operand, uint8_t len);
+
+// ----------------------------
+// Per-instruction hooks: binary trace (cpu_trace.c) and profiler
+// (cpu_prof.c). Every core runs CPU_INSN_HOOK() once per instruction, after
+// interrupt entry and before the opcode fetch, and CPU_IRQ_HOOK() just before
+// it enters an NMI/IRQ handler. With nothing enabled each is one branch.
+// ----------------------------
+enum { CPU_HOOK_TRACE = 1, CPU_HOOK_PROF = 2 };
+extern unsigned g_cpu_hooks;
+
+void cpu_hooks_insn(uint64_t cycles, uint16_t pc, uint8_t a, uint8_t x, uint8_t y, uint8_t p, uint8_t sp);
+void cpu_trace_log(uint64_t cycles, uint16_t pc, uint8_t a, uint8_t x, uint8_t y, uint8_t p, uint8_t sp);
+void cpu_prof_log(uint64_t cycles, uint16_t pc, uint8_t sp);
+void cpu_prof_interrupt(uint64_t cycles, int nmi);
+void cpu_prof_dma(int cycles);
+
+#define CPU_INSN_HOOK(cyc, pc, a, x, y, p, sp) \
+    do { if (g_cpu_hooks) cpu_hooks_insn((cyc), (pc), (a), (x), (y), (p), (sp)); } while (0)
+#define CPU_IRQ_HOOK(cyc, nmi) \
+    do { if (g_cpu_hooks & CPU_HOOK_PROF) cpu_prof_interrupt((cyc), (nmi)); } while (0)
+
 #ifdef __cplusplus
 }
 #endif
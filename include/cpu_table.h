@@ -31,6 +31,15 @@ extern const uint8_t cpu_base_cycles[256];
 extern const char* const cpu_mnemonic[256];
 extern const char* const cpu_addrmode[256];
 
+// cpu_addrmode as values to switch on, for code that decodes operands
+// (trace, JIT, idle-loop analysis). "impl" and the unused "-" are CPU_AM_IMP.
+typedef enum
+{
+    CPU_AM_IMP, CPU_AM_ACC, CPU_AM_IMM, CPU_AM_ZP,  CPU_AM_ZPX, CPU_AM_ZPY, CPU_AM_ABS,
+    CPU_AM_ABX, CPU_AM_ABY, CPU_AM_INX, CPU_AM_INY, CPU_AM_REL, CPU_AM_IND,
+} cpu_am_t;
+extern const uint8_t cpu_addrmode_id[256];   // cpu_am_t per opcode
+
 // Optional byte-length per opcode (1 = opcode only, 2 = +1 byte operand, 3 = +2 bytes).
 // Useful for stepping/tracing when you don't execute the opcode.
 extern const uint8_t cpu_instr_len[256];
@@ -7,7 +7,7 @@ struct MapperOps
 {
     uint8_t (*cpu_read)(uint16_t addr);
     void (*cpu_write)(uint16_t addr, uint8_t val);
-    uint8_t (*chr_read)(uint16_t addr);
+    uint8_t (*chr_read)(uint16_t addr);  // CHR slots not mapped with ppu_mem_map_chr()
     void (*chr_write)(uint16_t addr, uint8_t val);
 };
 
@@ -19,6 +19,11 @@ int mapper_init(int mapper_id, const uint8_t* prg, size_t prg_size, const uint8_
 // mapper 4 init
 const struct MapperOps* mapper_mmc3_init(const uint8_t* prg, size_t prg_size,
                                          const uint8_t* chr, size_t chr_size);
+// PPU scanline ticks until the MMC3 asserts its IRQ (-1 = IRQ disabled)
+int mapper_mmc3_ticks_until_irq(void);
+// Clock the MMC3 IRQ counter from A12 rises in CHR reads (on) or from the
+// PPU's once-per-line tick (off, the default)
+void mapper_mmc3_set_a12_from_reads(int on);
 
 
 void mapper_reset(void);
@@ -27,7 +32,8 @@ void mapper_reset(void);
 uint8_t mapper_cpu_read(uint16_t addr);
 void mapper_cpu_write(uint16_t addr, uint8_t data);
 
-// PPU <-> CHR (pattern tables)
+// PPU <-> CHR (pattern tables). Mappers publish their CHR banking to
+// ppu_mem_map_chr() instead; these only serve slots left unmapped.
 uint8_t mapper_chr_read(uint16_t addr);
 void mapper_chr_write(uint16_t addr, uint8_t data);
 
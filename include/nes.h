@@ -26,12 +26,60 @@ void nes_step_seconds(double seconds);
 // Optional: expose the running frame count.
 uint64_t nes_frame_count(void);
 
+// CPU cycles the last nes_step_frame() skipped by fast-forwarding idle loops
+// (see nes_idle.h).
+uint64_t nes_idle_cycles_last_frame(void);
+
 // Optional: shutdown hook.
 void nes_shutdown(void);
 
 /* Video: expose a persistent 256x240 ARGB8888 buffer for frontends */
 const uint32_t* nes_framebuffer_argb8888(int* out_pitch_bytes);
 
+/* Video, zero-copy: the frames stepped next are drawn line by line straight
+   into dst (256x240 ARGB8888, pitch_bytes per line), e.g. the pixels of a
+   locked SDL streaming texture, with no copy afterwards. The memory must stay
+   valid until the frame is done (set it before nes_step_frame(), clear it
+   after); nes_framebuffer_argb8888() returns it meanwhile, so read a frame
+   you need to keep through it before clearing. NULL goes back to the core's
+   own buffer, which holds the last frame drawn without a target: frames
+   drawn into dst are not copied back. Frames skipped with
+   nes_set_skip_render() leave dst as it is (filled from the core's buffer
+   only if that has the last drawn frame), so do not hand them memory with
+   undefined contents such as a freshly locked texture; the SDL frontend
+   keeps its texture unlocked for them. With NES_VIDEO_INDEX8 or
+   NES_VIDEO_INDEX16 the frame is converted into dst when it completes. */
+void nes_set_render_target(uint32_t* dst, int pitch_bytes);
+
+/* Video, indexed: with NES_VIDEO_INDEX8 the core writes a 256x240 buffer of
+   colour indexes (one byte per pixel) plus one emphasis byte per line instead
+   of ARGB, a quarter of the size to hash, record or hand to a trainer.
+   nes_palette_convert() (nes_palette.h) makes ARGB8888/RGB565/RGBA pixels
+   of it on demand; nes_framebuffer_argb8888() does that for you in this mode.
+   NES_VIDEO_INDEX16 keeps the emphasis per pixel (uint16_t each), exact
+   where a game changes it mid-line in dot mode; nes_palette_convert16()
+   converts it. Layouts in ppu.h (PPU_OUTPUT_INDEX8/16). */
+enum {NES_VIDEO_ARGB8888 = 0, NES_VIDEO_INDEX8 = 1, NES_VIDEO_INDEX16 = 2};
+void nes_set_video_output(int format);
+const uint8_t*  nes_framebuffer_index8(const uint8_t** out_line_emphasis);
+const uint16_t* nes_framebuffer_index16(void);
+
+/* Headless frames, for batch runs that only need pixels now and then: with
+   skip on, the frames stepped next are emulated without drawing and the
+   framebuffer keeps the last drawn frame. Sprite 0 hit, sprite overflow and
+   MMC3 IRQ timing are unaffected, so the game runs exactly the same, and the
+   frames that are drawn match a run that draws them all. Takes effect from
+   the next frame start: set it before nes_step_frame(). */
+void nes_set_skip_render(int skip);
+int  nes_get_skip_render(void);
+
+/* Render thread: the scanlines are drawn on a worker thread from a log of
+   the PPU state and writes, overlapping the CPU (ppu_set_render_thread()).
+   Frames are identical to drawing inline. Returns 1 if it is on (0 when the
+   build has no thread support). nes_shutdown() stops it. */
+int  nes_set_render_thread(int on);
+int  nes_get_render_thread(void);
+
 /* Input: one byte per pad (A,B,Select,Start,Up,Down,Left,Right) */
 void nes_set_controller_state(int pad_index, uint8_t state);
 
@@ -0,0 +1,29 @@
+// nes_idle.h — idle-loop detection and fast-forward for the frame loop
+#ifndef NES_IDLE_H
+#define NES_IDLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+void nes_idle_reset(void);
+void nes_idle_set_enabled(int on); // default on
+
+// Run part of a CPU batch that must end by cycle `stop` (the scheduler's
+// next stopping event). While probing for an idle loop this is a single
+// instruction, or a skip of whole proven iterations that end before `stop`
+// (the cycle counter only; devices catch up in nes_sched_sync()). Between
+// probes it is a plain cpu_run() batch. Always makes progress; call again
+// until `stop` is reached.
+void nes_idle_run(uint64_t stop);
+
+// CPU cycles skipped since nes_idle_reset()
+uint64_t nes_idle_cycles_skipped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_IDLE_H
@@ -1,8 +1,43 @@
 #ifndef NES_PALETTE_H
 #define NES_PALETTE_H
 #include <stdint.h>
+#include <stddef.h>
 
-// 64-entry ARGB8888 NES palette
+// 64-entry ARGB8888 NES palette (built-in default)
 extern const uint32_t NES_PAL[64];
 
+// Active colours for PPUMASK emphasis bits 5-7 (`emphasis` = mask >> 5):
+// 64 ARGB8888 entries indexed by palette RAM value
+const uint32_t* nes_palette_colors(int emphasis);
+
+// Replace the active colours with .pal data: 64 RGB triplets (192 bytes,
+// emphasis variants derived by dimming the other channels) or 8 x 64 (1536
+// bytes, one block per emphasis value). Returns 1 on success, 0 on a bad
+// size or unreadable file; the palette is left unchanged then.
+int  nes_palette_set_rgb(const uint8_t* rgb, size_t size);
+int  nes_palette_load(const char* path);
+
+// Back to NES_PAL
+void nes_palette_use_default(void);
+
+// Pixel formats for nes_palette_convert(). RGBA8888 is the bytes R, G, B, A
+// in memory (what image libraries and tensors expect), ARGB8888 0xAARRGGBB
+// words like the framebuffer.
+typedef enum
+{
+    NES_PIXFMT_ARGB8888 = 0,
+    NES_PIXFMT_RGB565   = 1,
+    NES_PIXFMT_RGBA8888 = 2,
+} nes_pixfmt_t;
+
+// Indexed frame (ppu.h PPU_OUTPUT_INDEX8: 256 colour indexes per line) to
+// pixels through the active colours. `lines` lines of src, emphasis[y] the
+// emphasis of line y (NULL: none); dst lines are pitch_bytes apart.
+void nes_palette_convert(void* dst, int pitch_bytes, nes_pixfmt_t fmt,
+                         const uint8_t* src, const uint8_t* emphasis, int lines);
+
+// The same for PPU_OUTPUT_INDEX16 frames: emphasis per pixel, in bits 6-8
+void nes_palette_convert16(void* dst, int pitch_bytes, nes_pixfmt_t fmt,
+                           const uint16_t* src, int lines);
+
 #endif
@@ -0,0 +1,67 @@
+// nes_sched.h — event-driven master scheduler for the frame loop
+#ifndef NES_SCHED_H
+#define NES_SCHED_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Pending events, in absolute CPU cycles. The frame loop runs the CPU freely
+// up to the earliest stopping event; PPU and APU are caught up lazily, either
+// there or when the CPU touches one of their registers.
+typedef enum
+{
+    NES_EV_VBLANK,     // PPUSTATUS vblank set or clear (and the NMI it may raise)
+    NES_EV_MMC3_IRQ,   // MMC3 scanline counter reaches zero
+    NES_EV_DMA_DONE,   // CPU resumes after an OAM DMA stall
+    NES_EV_SPRITE0,    // PPUSTATUS sprite 0 hit set
+    NES_EV_SPRITE_OVF, // PPUSTATUS sprite overflow set
+    NES_EV_APU_FRAME,  // APU frame-sequencer step   (catch-up split only)
+    NES_EV_APU_SAMPLE, // APU output sample boundary (catch-up split only)
+    NES_EV_COUNT
+} nes_sched_event_t;
+
+#define NES_SCHED_NEVER UINT64_MAX
+
+// Detach the scheduler (call after resetting CPU/PPU/APU). The next
+// nes_sched_next_stop() attaches it again at the current CPU cycle count.
+// While detached the bus hooks below do nothing, so CPU-only code (tests,
+// tools) never steps the devices.
+void nes_sched_reset(void);
+
+// Earliest stopping event (VBLANK, MMC3_IRQ, DMA_DONE, SPRITE0, SPRITE_OVF), NES_SCHED_NEVER if
+// none. Attaches the scheduler if needed.
+uint64_t nes_sched_next_stop(void);
+
+// Cycle when `ev` is due, or NES_SCHED_NEVER.
+uint64_t nes_sched_event_at(nes_sched_event_t ev);
+
+// The CPU batch about to run ends at `stop`; register writes that move a
+// stopping event before it make the CPU yield (cpu_yield()).
+void nes_sched_begin(uint64_t stop);
+
+// End of a CPU batch: bring the PPU up to the CPU's cycle count, and the
+// APU too if a frame-sequencer step is due. Re-arms the events that depend
+// on their state.
+void nes_sched_sync(void);
+
+// PPU only. The bus calls this before PPU register, OAM DMA and mapper
+// accesses (banking and the MMC3 counter are PPU-side state).
+void nes_sched_sync_ppu(void);
+
+// APU only, split at its own events: before $4000-$4017 access, and at frame
+// end so the audio consumer gets every sample up to now.
+void nes_sched_sync_apu(void);
+
+// After a PPU/APU/mapper register write: re-arm, and yield the CPU if the
+// next stop moved before the end of the running batch. `dma_stall` is the
+// OAM DMA stall the write just added to the CPU (0 for other writes).
+void nes_sched_io_written(int dma_stall);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_SCHED_H
@@ -28,6 +28,11 @@ extern "C"{
     // True while PPUSTATUS bit 7 (VBlank) is set
     bool     ppu_in_vblank(void);
 
+    // True from the vblank set (scanline 241, dot 1) to its clear (261, dot 1),
+    // even after a $2002 read cleared the flag. The frame loop uses this, so
+    // where it stops does not depend on when the game polls PPUSTATUS.
+    bool     ppu_in_vblank_lines(void);
+
     // Optional: advance PPU timing; call with CPU cycles elapsed (if used)
     void     ppu_step(int cpu_cycles);
 
@@ -35,7 +40,103 @@ extern "C"{
     void     ppu_timing_reset(void);
     uint64_t ppu_frame_count(void);
 
-    // Renderer — writes a full ARGB8888 frame (256x240)
+    // Look-ahead in PPU dots (for the scheduler, nes_sched.c): until the next
+    // PPUSTATUS vblank set/clear, until the n-th MMC3 scanline tick (0 while
+    // rendering is off), and until sprite 0 hit / sprite overflow is set
+    // this frame (0 if it will not be; in dot mode the earliest dot it could
+    // be).
+    uint32_t ppu_dots_to_vblank_edge(void);
+    uint32_t ppu_dots_to_scanline_tick(int n);
+    uint32_t ppu_dots_to_sprite0_hit(void);
+    uint32_t ppu_dots_to_sprite_overflow(void);
+
+    // Scanline renderer. ppu_step() draws each visible line into a persistent
+    // 256x240 ARGB8888 framebuffer at dot 256 of that line; complete once the
+    // PPU reaches vblank.
+    void     ppu_render_scanline(int y);
+    const uint32_t* ppu_framebuffer(void);
+    int      ppu_framebuffer_pitch(void);     // bytes per line
+
+    // Draw the ARGB frame straight into caller memory (256x240, pitch_bytes
+    // per line, at least 1024) instead of the core's buffer, e.g. a locked
+    // streaming texture; ppu_framebuffer() then returns it. NULL goes back to
+    // the core's buffer. Lines are written as the PPU reaches them, so the
+    // memory must stay valid until the frame is done. Nothing is copied back:
+    // once dst is cleared the core's buffer has the last frame drawn without
+    // one. A headless frame (ppu_set_frame_draw()) leaves dst as it is, or
+    // fills it from the core's buffer if that has the last drawn frame.
+    void     ppu_set_render_target(uint32_t* dst, int pitch_bytes);
+
+    // Output format of the emulated frame. PPU_OUTPUT_INDEX8 writes colour
+    // indexes instead of ARGB, a quarter of the size: one byte per pixel
+    // (0..63, the palette RAM value with PPUMASK grayscale applied) and one
+    // per line with its emphasis (PPUMASK bits 5-7 as 0..7). A mid-line
+    // emphasis change, which only dot mode can show, keeps the line's first.
+    // PPU_OUTPUT_INDEX16 is exact there: one uint16_t per pixel, the colour
+    // index in bits 0-5 and that pixel's emphasis in bits 6-8, half the size
+    // of ARGB. nes_palette_convert() and nes_palette_convert16() turn them
+    // into pixels. ppu_framebuffer() is not written meanwhile. Switch between
+    // frames.
+    typedef enum
+    {
+        PPU_OUTPUT_ARGB8888 = 0,
+        PPU_OUTPUT_INDEX8   = 1,
+        PPU_OUTPUT_INDEX16  = 2,
+    } ppu_output_t;
+
+    void            ppu_set_output(ppu_output_t format);
+    ppu_output_t    ppu_get_output(void);
+    const uint8_t*  ppu_framebuffer_index8(const uint8_t** line_emphasis);
+    const uint16_t* ppu_framebuffer_index16(void);
+
+    // Rendering model. PPU_MODE_SCANLINE draws each line in one go at dot 256
+    // (ppu_render.c); PPU_MODE_DOT runs the real fetch/shift pipeline every
+    // dot (ppu_dot.c), with sprite 0 hit, sprite overflow and MMC3 A12
+    // clocking from its CHR reads. Dot mode is several times slower; use it
+    // as the reference when checking the fast path. Build with
+    // -DPPU_DOT_DEFAULT=ON to make it the default. Switch between frames.
+    typedef enum
+    {
+        PPU_MODE_SCANLINE = 0,
+        PPU_MODE_DOT      = 1,
+    } ppu_mode_t;
+
+    void       ppu_set_mode(ppu_mode_t mode);
+    ppu_mode_t ppu_get_mode(void);
+
+    // Sprites per line in the scanline renderer: at most 8 like the hardware
+    // (default; games rely on the resulting flicker), or every in-range one
+    // when off. PPUSTATUS sprite overflow is set the same way either way.
+    void       ppu_set_sprite_limit(bool on);
+    bool       ppu_get_sprite_limit(void);
+
+    // Background lines out of the decoded nametable plane (default), or
+    // fetched tile by tile through the tile cache when off. Both draw the
+    // same; off is the reference for checking the plane's invalidation.
+    void       ppu_set_bg_plane(bool on);
+    bool       ppu_get_bg_plane(void);
+
+    // Headless frames: with drawing off, frames run without writing the
+    // framebuffer (it keeps the last drawn frame) in either mode. Sprite 0
+    // hit, sprite overflow and MMC3 clocking come out exactly as when
+    // drawing, from the opacity of the pixels they need. Taken at the start
+    // of each frame (line 0, dot 0), so a frame is drawn whole or not at all;
+    // drawn frames are identical to those of a run that draws every frame.
+    void       ppu_set_frame_draw(bool on);
+    bool       ppu_get_frame_draw(void);
+
+    // Render thread: in PPU_MODE_SCANLINE the lines are drawn by a worker
+    // thread instead, from a log of the line state and of every write that
+    // affects drawing (ppu_defer.c), while the CPU runs on. The frame is
+    // identical to inline drawing; sprite 0 hit and overflow stay on the
+    // calling thread. ppu_framebuffer() and ppu_framebuffer_index8() wait for
+    // the lines drawn so far. Returns whether it is on: false when built
+    // without it (-DPPU_RENDER_THREAD=OFF) or if the thread failed to start.
+    bool       ppu_set_render_thread(bool on);
+    bool       ppu_get_render_thread(void);
+
+    // Whole frame from the current registers (no mid-frame changes), for
+    // tests and tools
     void     ppu_render_argb8888(uint32_t* dst, int pitch_bytes);
 
     // ----------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+// ppu_bg_plane.h — decoded background of all four nametables, kept up to date
+#ifndef NES_PPU_BG_PLANE_H
+#define NES_PPU_BG_PLANE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ppu_mem.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// The four nametables as one 512x480 pixel plane (64x60 tiles), each pixel
+// already a palette RAM offset like the renderer's line buffers (ppu_simd.h).
+// A tile is decoded again only when it is marked dirty (nametable or
+// attribute write, mirroring or nametable mapping change) or its pattern
+// moved or changed (BG pattern table switch, CHR bank switch, CHR-RAM write);
+// a background line is otherwise a scrolled copy out of the plane. Palette
+// writes do not touch it: the colours are looked up at compose time.
+
+// Background line drawn from VRAM address v (fine X, PPUCTRL) into out[256],
+// out of the nametables and banking of `mv`. False, with nothing written, for
+// coarse Y 30/31 (attribute bytes read as tiles), which is outside the plane.
+// Needs ppu_tile_cache_map_banks(mv).
+bool ppu_bg_plane_line(const ppu_view_t* mv, uint8_t* out, uint16_t v, uint8_t fine_x, uint8_t ctrl);
+
+// Invalidation hooks (ppu_mem.c, or ppu_defer.c's replay): byte `off` of
+// nametable n ($2000 + n*$400) was written, the nametable mapping changed, a
+// byte of CHR page `page` was written
+void ppu_bg_plane_nt_written(int n, uint16_t off);
+void ppu_bg_plane_invalidate(void);
+void ppu_bg_plane_chr_written(int page);
+
+// Tiles looked up by background lines and how many of those had to be
+// decoded first, for the last complete frame (the counts roll over at
+// ppu_bg_plane_frame_start(), which the renderer calls when it draws line 0)
+typedef struct
+{
+    uint32_t lookups;
+    uint32_t decoded;
+} ppu_bg_plane_stats_t;
+
+void ppu_bg_plane_frame_start(void);
+ppu_bg_plane_stats_t ppu_bg_plane_frame_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_PPU_BG_PLANE_H
@@ -0,0 +1,49 @@
+// ppu_defer.h — scanline drawing on a worker thread (ppu_set_render_thread())
+#ifndef NES_PPU_DEFER_H
+#define NES_PPU_DEFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ppu_mem.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Line y of the frame, in the output format, from explicit state: the
+// nametables, CHR, palette and OAM of `mv`, VRAM address v, fine X,
+// PPUCTRL/PPUMASK and the sprites evaluated for it (OAM entries, ascending).
+// ppu_render.c's one way of drawing a line, called on the emulation thread
+// (ppu_mem_view()) or on the worker (its copy).
+void ppu_render_draw_line(const ppu_view_t* mv, int y, uint16_t v, uint8_t fine_x, uint8_t ctrl,
+                          uint8_t mask, const uint8_t* sprites, int count);
+
+// The worker draws the lines, the emulation thread only logs (ppu_mem.c
+// then hands it the nametable/CHR-RAM writes below instead of invalidating
+// the tile cache and the background plane, which the worker owns).
+bool ppu_defer_active(void);
+
+// Line y is the worker's: logged with everything it reads that changed
+// since the previous line. False if the caller has to draw it itself.
+bool ppu_defer_line(int y, uint16_t v, uint8_t fine_x, uint8_t ctrl, uint8_t mask,
+                    const uint8_t* sprites, int count);
+
+// A byte at PPU address `addr` of the nametable page / CHR-RAM page at
+// `page` was written (live memory already updated)
+void ppu_defer_nt_written(const uint8_t* page, uint16_t addr, uint8_t value);
+void ppu_defer_chr_written(const uint8_t* page, uint16_t addr, uint8_t value);
+
+// Wait until every logged line is drawn. For readers of the frame and for
+// changes to what the worker reads (output format and target).
+void ppu_defer_sync(void);
+
+// Sync, and start over from the live memory: for changes that bypass the
+// write hooks (cartridge, PPU memory reset, PPU mode)
+void ppu_defer_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_PPU_DEFER_H
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 // Cartridge-controlled nametable mirroring
 typedef enum
@@ -8,7 +9,7 @@ typedef enum
     MIRROR_VERTICAL = 1, // [A B A B]
     MIRROR_SINGLE_LO = 2,  // all -> NT0 ($2000)
     MIRROR_SINGLE_HI = 3, // all -> NT1 ($2400)
-    MIRROR_FOUR = 4 // true 4-screen (cart VRAM); we’ll fall back to V
+    MIRROR_FOUR = 4 // 4-screen: 2KB of cartridge VRAM behind $2800/$2C00
 }mirroring_t;
 
 // Initialize/clear backing storage and set mirroring.
@@ -18,9 +19,67 @@ void ppu_mem_init(mirroring_t m);
 void ppu_mem_set_mirroring(mirroring_t m);
 mirroring_t ppu_mem_get_mirroring(void);
 
+// Nametable n ($2000 + n*$400) from mapper memory (CHR-ROM or ExRAM
+// nametables): 1KB at `mem`, read-only unless `writable`. It stays there
+// across mirroring changes; mem=NULL hands the slot back to VRAM.
+void ppu_mem_map_nametable(int n, uint8_t* mem, bool writable);
+
+// The four 1KB pages $2000/$2400/$2800/$2C00 currently show, for renderers
+// indexing nametables directly. The array is updated in place.
+uint8_t* const* ppu_mem_nametables(void);
+
+// CHR banking, published by the mapper whenever it changes (like
+// bus_map_prg() for PRG): PPU slot n ($0000 + n*$400) shows the 1KB at
+// `mem`, physical page `page` of the cartridge's CHR (the tile cache's key;
+// equal only for slots showing the same bytes). Writes land there only if
+// `writable` (CHR-RAM). mem=NULL routes the slot back through
+// mapper_chr_read()/mapper_chr_write().
+void ppu_mem_map_chr(int slot, uint8_t* mem, int page, bool writable);
+int  ppu_mem_chr_page(int slot);   // -1 if unmapped
+
+// Mappers that watch the PPU's pattern fetches (MMC3 A12, MMC2/MMC4 latches)
+// opt in here: `watch` sees the address of every CHR read through
+// ppu_mem_read(). NULL (the default) for none.
+void ppu_mem_set_chr_watch(void (*watch)(uint16_t addr));
+
+// CHR byte without notifying the watch: look-ups that are not PPU fetches
+// (tile decoding, sprite 0 hit)
+uint8_t ppu_mem_chr_peek(uint16_t addr);
+
 // Raw PPU memory space ($0000-$3FFF) — used by PPU registers ($2007).
-//  - $0000-$1FFF : CHR (ROM/RAM) via mapper
-//  - $2000-$3EFF : Nametables (2KB VRAM, mirrored per 'm')
+//  - $0000-$1FFF : CHR (ROM/RAM) through the mapped pages
+//  - $2000-$3EFF : Nametables (VRAM per the mirroring, or mapper pages)
 //  - $3F00-$3FFF : Palettes (mirrors every 32; with $3F10 alias fixups)
 uint8_t ppu_mem_read(uint16_t addr);
-void ppu_mem_write(uint16_t addr, uint8_t data);
\ No newline at end of file
+void ppu_mem_write(uint16_t addr, uint8_t data);
+// Palette RAM resolved to ARGB8888 through the active colours
+// (nes_palette.h), with PPUMASK grayscale and emphasis applied: 32 entries,
+// $3F10/$14/$18/$1C already aliased. Kept current by palette writes,
+// ppu_mem_set_color_mask() and ppu_mem_palette_refresh(), so renderers
+// index it directly.
+const uint32_t* ppu_mem_palette_argb(void);
+
+// The same as colour indexes (0..63, grayscale applied) for indexed output;
+// emphasis is kept apart, per line
+const uint8_t* ppu_mem_palette_index(void);
+
+// PPUMASK written; only bits 0 and 5-7 matter, the table is rebuilt when they change
+void ppu_mem_set_color_mask(uint8_t mask);
+
+// The active colours changed (nes_palette_set_rgb() and friends)
+void ppu_mem_palette_refresh(void);
+
+// Everything the scanline renderer reads, as pointers: the live memory above
+// (ppu_mem_view()), or the copy ppu_defer.c's worker thread replays it into
+typedef struct
+{
+    uint8_t* const*       nt;          // ppu_mem_nametables()
+    const uint8_t* const* chr;         // 1KB per slot; NULL: mapper_chr_read() (live only)
+    const int*            chr_page;    // ppu_mem_chr_page() per slot
+    const uint32_t*       pal_argb;    // ppu_mem_palette_argb()
+    const uint8_t*        pal_index;   // ppu_mem_palette_index()
+    const uint8_t*        oam;         // ppu_oam_data()
+} ppu_view_t;
+
+const ppu_view_t* ppu_mem_view(void);
+bool ppu_mem_chr_writable(int slot);
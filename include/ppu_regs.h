@@ -57,6 +57,62 @@ uint8_t const* ppu_oam_data(void);         // read-only pointer for debug/tests
 // Expose scroll/toggle state to renderer
 void     ppu_regs_get_scroll(uint16_t* t_out, uint8_t* fine_x_out);
 
+// ----------------------------------------------------------------------------
+// Rendering-time VRAM address. The scanline renderer moves `v` once per line
+// instead of per tile fetch (called from ppu_timing.c, rendering enabled only).
+// ----------------------------------------------------------------------------
+void     ppu_regs_get_vram_addr(uint16_t* v_out, uint8_t* fine_x_out);
+void     ppu_regs_line_advance(void);  // dots 256/257: Y increment, v.x <- t.x
+void     ppu_regs_frame_reload(void);  // pre-render dots 280-304: v.y <- t.y
+
+// The same steps one at a time, for the dot-accurate pipeline (ppu_dot.c)
+void     ppu_regs_inc_coarse_x(void);  // every 8th fetch dot
+void     ppu_regs_inc_y(void);         // dot 256
+void     ppu_regs_copy_x(void);        // dot 257: v.x <- t.x
+
+// Renderer internals: a line of the core's framebuffer, and the per-dot
+// pipeline used in PPU_MODE_DOT (ppu_dot.c)
+uint32_t* ppu_render_line_ptr(int y);
+void      ppu_render_frame_start(bool drawn);  // line 0 dot 0, drawing latched
+uint8_t*  ppu_render_index_line_ptr(int y);    // NULL unless PPU_OUTPUT_INDEX8
+uint16_t* ppu_render_index16_line_ptr(int y);  // NULL unless PPU_OUTPUT_INDEX16
+void      ppu_render_set_emphasis(int y, uint8_t mask);
+bool     ppu_frame_drawn(void);      // this frame draws (ppu_set_frame_draw())
+void     ppu_dot_reset(void);
+void     ppu_dot_tick(int scanline, int dot);
+
+// Sprite 0 hit on visible line y from the current OAM, PPUCTRL/PPUMASK and
+// banking: the first pixel x >= `from` where an opaque sprite 0 pixel meets
+// opaque background, -1 if none. The line is drawn from VRAM address *v;
+// with v NULL the background counts as opaque everywhere (an earliest
+// possible hit). Whether sprite 0 made the line's evaluation is up to the
+// caller: ppu_render_sprite0_listed() tells for the line the scanline
+// renderer draws next.
+int      ppu_render_sprite0_hit(int y, const uint16_t* v, int from);
+bool     ppu_render_sprite0_listed(void);
+
+// Whether the sprite evaluation on visible line y (for line y + 1) sets
+// sprite overflow, from the current OAM and PPUCTRL
+bool     ppu_render_sprite_overflow(int y);
+
+// PPUSTATUS bits the rendering pipeline sets (sprite 0 hit 0x40, sprite
+// overflow 0x20); both are cleared at dot 1 of the pre-render line
+void     ppu_regs_status_set(uint8_t bits);
+void     ppu_regs_status_clear(uint8_t bits);
+
+// Fine/coarse Y increment of a VRAM address. Coarse Y 29 wraps into the
+// vertical neighbour nametable; 30/31 (attribute rows) wrap without it.
+static inline uint16_t ppu_vram_inc_y(uint16_t v)
+{
+    if ((v & 0x7000u) != 0x7000u) return (uint16_t)(v + 0x1000u);
+    v &= (uint16_t)~0x7000u;
+    unsigned y = (v >> 5) & 0x1Fu;
+    if (y == 29)      { y = 0; v ^= 0x0800u; }
+    else if (y == 31) { y = 0; }
+    else              { y++; }
+    return (uint16_t)((v & ~0x03E0u) | (y << 5));
+}
+
 // ----------------------------------------------------------------------------
 // Optional debug counters (implemented in ppu_regs.c)
 // ----------------------------------------------------------------------------
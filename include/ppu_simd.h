@@ -0,0 +1,68 @@
+// ppu_simd.h — pixel kernels of the scanline renderer, with SSE2/AVX2 paths
+#ifndef NES_PPU_SIMD_H
+#define NES_PPU_SIMD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+typedef enum
+{
+    PPU_SIMD_SCALAR = 0,
+    PPU_SIMD_SSE2   = 1,   // baseline on x86-64
+    PPU_SIMD_AVX2   = 2,
+} ppu_simd_t;
+
+// Pixel values below are palette RAM offsets as ppu_render.c uses them:
+// 0 = transparent, 1..15 background, 0x10..0x1F sprites, optionally with
+// PPU_SPR_BEHIND set (sprite pixel is behind opaque background).
+#define PPU_SPR_BEHIND 0x80
+
+typedef struct
+{
+    // Two CHR bitplanes (16 bytes, lo then hi) -> 8x8 2-bit pixels, plain
+    // and horizontally flipped
+    void (*tile_decode)(uint8_t plain[64], uint8_t flipped[64], const uint8_t chr[16]);
+
+    // n tile rows of 8 pixels side by side: out[8i+c] = rows[i][c] ? pal[i] | rows[i][c] : 0
+    void (*bg_tiles)(uint8_t* out, const uint8_t* const* rows, const uint8_t* pal, int n);
+
+    // One sprite row into a line where lower OAM indexes already drew:
+    // out[c] = bits | px[c] where out[c] == 0 and px[c] != 0
+    void (*spr_row)(uint8_t* out, const uint8_t* px, uint8_t bits);
+
+    // 256 pixels: sprite vs background priority, left-8 clipping (clip_bg /
+    // clip_spr non-zero hide that layer on x < 8), then pal[] colours
+    void (*compose)(uint32_t* dst, const uint8_t* bg, const uint8_t* spr,
+                    const uint32_t pal[32], int clip_bg, int clip_spr);
+
+    // The same into colour indexes: pal[] holds the palette RAM values
+    void (*compose_index)(uint8_t* dst, const uint8_t* bg, const uint8_t* spr,
+                          const uint8_t pal[32], int clip_bg, int clip_spr);
+
+    // n colour indexes (0..63) through a colour table: dst[i] = lut[src[i]]
+    void (*expand32)(uint32_t* dst, const uint8_t* src, const uint32_t lut[64], int n);
+    void (*expand16)(uint16_t* dst, const uint8_t* src, const uint16_t lut[64], int n);
+} ppu_kernels_t;
+
+// Best level this CPU supports (CPUID, plus OS support for AVX state)
+ppu_simd_t ppu_simd_best(void);
+
+// Kernels of `level`, or NULL if the CPU or the build does not have it
+const ppu_kernels_t* ppu_simd_kernels(ppu_simd_t level);
+
+// Kernels the renderer uses; ppu_simd_best() until ppu_simd_select()
+const ppu_kernels_t* ppu_simd_active(void);
+
+// Use `level`, or the best supported one below it. Returns the level chosen.
+ppu_simd_t ppu_simd_select(ppu_simd_t level);
+
+const char* ppu_simd_name(ppu_simd_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_PPU_SIMD_H
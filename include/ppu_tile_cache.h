@@ -0,0 +1,47 @@
+// ppu_tile_cache.h — decoded CHR tiles for the scanline renderer
+#ifndef NES_PPU_TILE_CACHE_H
+#define NES_PPU_TILE_CACHE_H
+
+#include <stdint.h>
+
+#include "ppu_mem.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// One 8x8 tile expanded to 2-bit pixel values (0 = transparent), row-major.
+// px[1] is the horizontally flipped copy; vertical flip just picks row 7-r.
+typedef struct
+{
+    uint8_t px[2][8][8];
+} ppu_tile_t;
+
+// Tiles are cached per physical 1KB CHR page (ppu_mem_chr_page()), so a bank
+// switch only changes which page a PPU slot points at. Call this before a
+// batch of ppu_tile_get() calls whenever the banking may have changed (the
+// renderer does it once per line); tiles are decoded from `mv`'s CHR, which
+// must stay valid until the next call.
+void ppu_tile_cache_map_banks(const ppu_view_t* mv);
+
+// Decoded tile at PPU pattern address `addr` ($0000-$1FFF, low 4 bits
+// ignored) under the banking of the last ppu_tile_cache_map_banks(). A tile
+// of a page outside the cache is decoded into `spill` and that is returned,
+// so a caller keeping several tiles at once gives each its own.
+const ppu_tile_t* ppu_tile_get(uint16_t addr, ppu_tile_t* spill);
+
+// A CHR byte of physical page `page` changed (CHR-RAM write at PPU address
+// `addr` of a slot showing it): only the tile holding it is decoded again.
+void ppu_tile_cache_invalidate(int page, uint16_t addr);
+
+// Drop every decoded tile (new cartridge)
+void ppu_tile_cache_flush(void);
+
+// Lookups served from the cache / decoded since the last flush
+void ppu_tile_cache_stats(uint64_t* hits, uint64_t* misses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_PPU_TILE_CACHE_H
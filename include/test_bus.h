@@ -23,6 +23,9 @@ extern "C" {
     void     tb_set_reset_vector(uint16_t addr);
     void     tb_set_nmi_vector(uint16_t addr);
     void     tb_set_irq_vector(uint16_t addr);
+    // Point the 256-byte CPU page at `addr` to read-only host memory (a fake
+    // PRG bank) until the next tb_reset_memory().
+    void     tb_map_rom(uint16_t addr, const uint8_t* page);
 
 #ifdef __cplusplus
 }
@@ -74,9 +74,11 @@ static struct {
     // Registers latch ($4000–$4017)
     uint8_t regs[0x18];
 
-    // Resampling
-    double cycles_per_sample;
-    double cycle_accum;
+    // Resampling: a sample every cpu_hz / sample_rate CPU cycles, tracked
+    // exactly as cycles * sample_rate so how apu_step() calls are split
+    // never moves a sample
+    uint64_t sample_acc;    // < cpu_hz
+    uint32_t acc_rate;      // sample_rate that sample_acc is scaled for
 
     // Output ring buffer (mono int16)
     #define APU_RING_CAP 8192u  // must be power of two
@@ -121,7 +123,11 @@ static inline uint32_t ring_pop(int16_t* out, uint32_t maxn) {
 static void recompute_timing(void) {
     g.cpu_hz = (g.region == APU_MODE_PAL) ? PAL_CPU_HZ : NTSC_CPU_HZ;
     if (g.sample_rate == 0) g.sample_rate = 48000;
-    g.cycles_per_sample = (double)g.cpu_hz / (double)g.sample_rate;
+    if (g.acc_rate && g.acc_rate != g.sample_rate) {
+        g.sample_acc = g.sample_acc * g.sample_rate / g.acc_rate;
+    }
+    g.acc_rate = g.sample_rate;
+    if (g.sample_acc >= g.cpu_hz) g.sample_acc = 0;
     g.seq_end_ntsc = g.five_step ? NTSC_5STEP_END : NTSC_4STEP_3;
 }
 
@@ -300,8 +306,16 @@ void apu_write(uint16_t addr, uint8_t v) {
     // Otherwise ignored
 }
 
-void apu_step(int cpu_cycles) {
-    if (cpu_cycles <= 0) return;
+// Up to the next sequencer step or sample, at most (apu_step() splits)
+static void advance(int cpu_cycles) {
+    // Advance channel timers (per-CPU-cycle resolution accepted by stubs).
+    // Before the sequencer: a sweep clocked at a mark must not change the
+    // period of the cycles leading up to it.
+    apu_pulse_step_timer(&g.pulse1_impl, cpu_cycles);
+    apu_pulse_step_timer(&g.pulse2_impl, cpu_cycles);
+    apu_triangle_step_timer(&g.tri_impl, cpu_cycles);
+    apu_noise_step_timer(&g.noise_impl, cpu_cycles);
+    apu_dmc_step_timer(&g.dmc_impl, cpu_cycles);
 
     // Frame sequencer crossings
     uint32_t before = g.seq_cycle;
@@ -314,17 +328,10 @@ void apu_step(int cpu_cycles) {
         g.seq_cycle -= end;
     }
 
-    // Advance channel timers (per-CPU-cycle resolution accepted by stubs)
-    apu_pulse_step_timer(&g.pulse1_impl, cpu_cycles);
-    apu_pulse_step_timer(&g.pulse2_impl, cpu_cycles);
-    apu_triangle_step_timer(&g.tri_impl, cpu_cycles);
-    apu_noise_step_timer(&g.noise_impl, cpu_cycles);
-    apu_dmc_step_timer(&g.dmc_impl, cpu_cycles);
-
     // Produce output samples at configured rate
-    g.cycle_accum += (double)cpu_cycles;
-    while (g.cycle_accum >= g.cycles_per_sample) {
-        g.cycle_accum -= g.cycles_per_sample;
+    g.sample_acc += (uint64_t)cpu_cycles * g.sample_rate;
+    while (g.sample_acc >= g.cpu_hz) {
+        g.sample_acc -= g.cpu_hz;
 
         int16_t s = mix_sample();
         ring_push(s);
@@ -335,6 +342,33 @@ void apu_step(int cpu_cycles) {
     }
 }
 
+int apu_cycles_to_frame_step(void) {
+    const uint32_t marks[5] = {NTSC_4STEP_0, NTSC_4STEP_1, NTSC_4STEP_2, NTSC_4STEP_3, g.seq_end_ntsc};
+    for (int i = 0; i < 5; ++i) {
+        if (marks[i] > g.seq_cycle) return (int)(marks[i] - g.seq_cycle);
+    }
+    return 1;
+}
+
+int apu_cycles_to_sample(void) {
+    const uint64_t left = g.cpu_hz - g.sample_acc;
+    const int n = (int)((left + g.sample_rate - 1) / g.sample_rate);
+    return n > 0 ? n : 1;
+}
+
+// In pieces that end on sequencer steps and samples: a longer piece would
+// clock the sequencer late and mix a sample from a later channel state, so
+// the output would depend on how the caller splits its steps
+void apu_step(int cpu_cycles) {
+    while (cpu_cycles > 0) {
+        const int f = apu_cycles_to_frame_step(), s = apu_cycles_to_sample();
+        int n = f < s ? f : s;
+        if (n > cpu_cycles) n = cpu_cycles;
+        advance(n);
+        cpu_cycles -= n;
+    }
+}
+
 size_t apu_read_samples(int16_t* out, size_t max_frames) {
     if (!out || max_frames == 0) return 0;
     return (size_t)ring_pop(out, (uint32_t)max_frames);
@@ -172,18 +172,19 @@ void apu_pulse_clock_half(apu_pulse_t* p) {
 
 // Timer: advance sequencer with CPU-cycle resolution.
 // Each time timer_cnt reaches zero, reload with (timer+1) and step the duty.
+// The period is fixed between calls (register writes and sweep clocks happen
+// outside), so all reloads of a long advance are counted in one division.
 void apu_pulse_step_timer(apu_pulse_t* p, int cpu_cycles) {
     if (cpu_cycles <= 0) return;
 
     // If disabled or length is zero, we still tick timer to keep hardware-like behavior,
     // but output will be silenced by apu_pulse_output.
     p->timer_cnt -= cpu_cycles;
-    while (p->timer_cnt <= 0) {
-        int32_t reload = (int32_t)(p->timer + 1);
-        // guard against zero reloads
-        if (reload <= 0) reload = 1;
-        p->timer_cnt += reload;
-        p->seq_step = (uint8_t)((p->seq_step + 1) & 7);
+    if (p->timer_cnt <= 0) {
+        const int32_t reload = (int32_t)p->timer + 1;   // >= 1
+        const int32_t n = -p->timer_cnt / reload + 1;   // reloads until the count is positive
+        p->timer_cnt += n * reload;
+        p->seq_step = (uint8_t)((p->seq_step + n) & 7);
     }
 }
 
@@ -4,6 +4,10 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "mapper.h"
+#include "bus.h"
+#include "ppu_mem.h"
+#include "ppu_tile_cache.h"
+#include "ppu_defer.h"
 
 // Single active mapper
 static const struct MapperOps* ops = NULL;
@@ -12,6 +16,17 @@ int mapper_init(int mapper_id,
                 const uint8_t* prg, size_t prg_size,
                 const uint8_t* chr, size_t chr_size)
 {
+    // Drop the previous cartridge's PRG windows, CHR pages and nametables;
+    // the new mapper publishes its own. The render thread finishes with
+    // them first: the mapper frees them below.
+    ppu_defer_reset();
+    bus_map_prg(0x8000, 0x8000, NULL);
+    for (int slot = 0; slot < 8; ++slot) ppu_mem_map_chr(slot, NULL, -1, false);
+    for (int n = 0; n < 4; ++n) ppu_mem_map_nametable(n, NULL, false);
+    ppu_mem_set_chr_watch(NULL);
+    // Decoded tiles belong to the old CHR
+    ppu_tile_cache_flush();
+
     switch (mapper_id) {
     case 0: // NROM
         ops = mapper_nrom_init(prg, prg_size, chr, chr_size);
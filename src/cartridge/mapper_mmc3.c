@@ -23,7 +23,7 @@ void cpu_irq_clear(void);
 // ---------------------
 // ROM / RAM storage
 // ---------------------
-static const uint8_t* g_prg = NULL; // PRG ROM (external)
+static uint8_t* g_prg = NULL;       // PRG ROM (copied; the loader frees its buffer)
 static size_t g_prg_len = 0;        // multiple of 0x2000 (8KB)
 
 static uint8_t* g_chr = NULL;       // CHR ROM/RAM (copied/allocated)
@@ -55,6 +55,7 @@ static uint8_t irq_pending     = 0;    // latched until $E000 ack
 // A12 edge detector + simple low-time filter
 static uint8_t last_a12    = 0;
 static uint8_t a12_low_run = 0;
+static int     a12_from_reads = 0; // 0: clocked by the PPU's scanline tick instead
 
 // ---------------------
 // Helpers
@@ -100,6 +101,12 @@ static void update_prg_map(void)
         prg_bank[2] = clamp_prg8(r6);
         prg_bank[3] = clamp_prg8(last);
     }
+
+    // Publish the 8KB windows to the CPU page table
+    for (int slot = 0; slot < 4; ++slot) {
+        bus_map_prg((uint16_t)(0x8000 + slot * 0x2000), 0x2000,
+                    g_prg + (size_t)prg_bank[slot] * 0x2000);
+    }
 }
 
 // ---- FIXED CHR MAP: NO "*2" FOR 2KB WINDOWS ----
@@ -149,6 +156,16 @@ static inline int chr_map_1k(uint16_t ppu_addr)
     }
 }
 
+// Publish the eight 1KB CHR windows to the PPU; on bank select and
+// regs[0..5] writes only, so pattern fetches never go through the above
+static void update_chr_map(void)
+{
+    for (int slot = 0; slot < 8; ++slot) {
+        const int page = chr_map_1k((uint16_t)(slot << 10));
+        ppu_mem_map_chr(slot, g_chr + (size_t)page * 0x0400, page, g_chr_is_ram);
+    }
+}
+
 // ---- IRQ: correct “reload then decrement; trigger when becomes 0” ----
 static void mmc3_on_valid_a12_rise(void)
 {
@@ -206,16 +223,20 @@ static void mmc3_cpu_write(uint16_t addr, uint8_t v)
         case 0x8000: // even: bank select
             bank_select = v;
             update_prg_map();
+            update_chr_map();
             return;
 
         case 0x8001: { // odd: bank data
             const uint8_t target = bank_select & 0x07;
             regs[target] = v;
             if (target >= 6) update_prg_map(); // PRG banks changed
+            else             update_chr_map(); // CHR banks changed
             return;
         }
 
         case 0xA000: // even: mirroring (0=vertical, 1=horizontal)
+            // Four-screen boards wire the nametables to their own VRAM
+            if (ppu_mem_get_mirroring() == MIRROR_FOUR) return;
             ppu_mem_set_mirroring((v & 1) ? MIRROR_HORIZONTAL : MIRROR_VERTICAL);
             return;
 
@@ -257,11 +278,24 @@ static void mmc3_cpu_write(uint16_t addr, uint8_t v)
 // ---------------------
 static uint8_t mmc3_chr_read(uint16_t addr)
 {
-    // A12 edge clock via CHR reads (works if your PPU fetches CHR during rendering)
-    const uint8_t a12 = (addr & 0x1000) ? 1 : 0;
+    return g_chr[(size_t)chr_map_1k(addr) * 0x0400 + (addr & 0x03FF)];
+}
 
-    // A12 low-time filter: only clock on a rising edge after A12 has been low long enough.
-    if (a12) {
+static void mmc3_chr_write(uint16_t addr, uint8_t v)
+{
+    if (g_chr_is_ram) {
+        g_chr[(size_t)chr_map_1k(addr) * 0x0400 + (addr & 0x03FF)] = v;
+    }
+}
+
+// A12 edge clock from the PPU's CHR fetches (ppu_mem_set_chr_watch()),
+// with a simple low-time filter: only a rising edge after A12 has been low
+// long enough counts. Off for the scanline renderer, which reads CHR in its
+// own order; the counter then runs from mapper_mmc3_on_ppu_scanline_tick().
+static void mmc3_chr_watch(uint16_t addr)
+{
+    if (!a12_from_reads) return;
+    if (addr & 0x1000) {
         if (!last_a12 && a12_low_run >= 8) {
             mmc3_on_valid_a12_rise();
         }
@@ -271,31 +305,40 @@ static uint8_t mmc3_chr_read(uint16_t addr)
         last_a12 = 0;
         if (a12_low_run < 32) a12_low_run++; // saturate
     }
-
-    int b1k = chr_map_1k(addr);
-    size_t base = (size_t)b1k * 0x0400;
-    return g_chr[base + (addr & 0x03FF)];
-}
-
-static void mmc3_chr_write(uint16_t addr, uint8_t v)
-{
-    if (g_chr_is_ram) {
-        int b1k = chr_map_1k(addr);
-        size_t base = (size_t)b1k * 0x0400;
-        g_chr[base + (addr & 0x03FF)] = v;
-    }
-    (void)addr; (void)v;
 }
 
 // ---------------------
-// Optional public scanline hook
+// Call once per rendering line (visible and pre-render) at dot ~260 if your PPU isn't cycle-accurate.
 // Call once per visible scanline at dot ~260 if your PPU isn't cycle-accurate.
-//   if (scanline>=0 && scanline<240 && dot==260 && (ppumask&0x18)) mapper_mmc3_on_ppu_scanline_tick();
+//   if ((scanline < 240 || scanline == 261) && dot == 260 && (ppumask & 0x18)) mapper_mmc3_on_ppu_scanline_tick();
 void mapper_mmc3_on_ppu_scanline_tick(void)
 {
     mmc3_on_valid_a12_rise();
 }
 
+void mapper_mmc3_set_a12_from_reads(int on)
+{
+    a12_from_reads = on != 0;
+    last_a12 = 0;
+    a12_low_run = 0;
+}
+
+// Scanline ticks until the IRQ line is asserted, or -1 while the IRQ is
+// disabled. Used by the scheduler (nes_sched.c) to arm the IRQ event.
+int mapper_mmc3_ticks_until_irq(void)
+{
+    if (!irq_enable) return -1;
+    uint8_t counter = irq_counter;
+    int     reload  = irq_reload_next;
+    for (int n = 1; n <= 257; ++n) {
+        if (reload)            { counter = irq_latch; reload = 0; }
+        else if (counter == 0) { counter = irq_latch; }
+        else                   { counter--; }
+        if (counter == 0) return n;
+    }
+    return -1;
+}
+
 // ---------------------
 // Ops table + factory
 // ---------------------
@@ -312,9 +355,15 @@ const struct MapperOps* mapper_mmc3_init(const uint8_t* prg_data, size_t prg_len
     // PRG must be multiple of 8KB, >= 32KB
     if ((prg_len % 0x2000) != 0 || prg_len < 0x8000) return NULL;
 
-    g_prg     = prg_data;
+    free(g_prg);
+    g_prg     = (uint8_t*)malloc(prg_len);
+    if (!g_prg) return NULL;
+    memcpy(g_prg, prg_data, prg_len);
     g_prg_len = prg_len;
+    bus_set_prg_rom(g_prg, g_prg_len);
 
+    free(g_chr);
+    g_chr = NULL;
     if (chr_len == 0) {
         // CHR-RAM 8KB default
         g_chr_is_ram = 1;
@@ -345,6 +394,8 @@ const struct MapperOps* mapper_mmc3_init(const uint8_t* prg_data, size_t prg_len
     a12_low_run = 0;
 
     update_prg_map();
+    update_chr_map();
+    ppu_mem_set_chr_watch(mmc3_chr_watch);
     memset(g_prg_ram, 0, sizeof(g_prg_ram));
     g_prg_ram_enable = 1;
 
@@ -2,6 +2,7 @@
 #include <string.h>
 #include "mapper.h"
 #include "bus.h"
+#include "ppu_mem.h"
 
 // --- PRG (CPU space $8000-$FFFF) ---
 static uint8_t prg[0x8000];   // up to 32KB
@@ -63,13 +64,16 @@ const struct MapperOps* mapper_nrom_init(const uint8_t* prg_data, size_t prg_len
     // PRG must be 16KB or 32KB
     if (prg_len != 0x4000 && prg_len != 0x8000) return NULL;
 
-    // Load PRG; mirror if 16KB
+    // Load PRG
     memcpy(prg, prg_data, prg_len);
-    if (prg_len == 0x4000) {
-        memcpy(prg + 0x4000, prg, 0x4000);
-    }
     prg_size = prg_len;
 
+    // PRG never switches: map it once. NROM-128 maps the same 16KB at $8000
+    // and $C000, so both mirrors share one set of decoded instructions.
+    bus_set_prg_rom(prg, prg_size);
+    bus_map_prg(0x8000, 0x4000, prg);
+    bus_map_prg(0xC000, 0x4000, prg + (prg_size - 0x4000));
+
     // CHR: 0 => CHR-RAM 8KB, 0x2000 => CHR-ROM 8KB
     if (chr_len == 0) {
         memset(chr, 0, sizeof chr);
@@ -83,5 +87,10 @@ const struct MapperOps* mapper_nrom_init(const uint8_t* prg_data, size_t prg_len
         return NULL; // unsupported CHR size
     }
 
+    // CHR never switches either: 8 fixed pages
+    for (int slot = 0; slot < 8; ++slot) {
+        ppu_mem_map_chr(slot, chr + slot * 0x400, slot, chr_is_ram);
+    }
+
     return &nrom_ops;
 }
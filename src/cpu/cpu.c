@@ -21,6 +21,18 @@ static struct
 // assert this line; CPU services it when I=0. It stays asserted until cleared.
 static int irq_line = 0;
 
+// Set by cpu_yield(); cpu_run() ends its batch at the next instruction boundary.
+static int s_yield = 0;
+
+#if CPU_FAST_CORE
+static cpu_core_t s_core = CPU_CORE_FAST;
+#else
+static cpu_core_t s_core = CPU_CORE_REFERENCE;
+#endif
+
+void cpu_set_core(cpu_core_t core) { s_core = core; }
+cpu_core_t cpu_get_core(void)      { return s_core; }
+
 // -----------------------------------------------------------------------------
 // Cycle counter API
 // -----------------------------------------------------------------------------
@@ -34,6 +46,11 @@ void cpu_cycles_add(int n)
     cpu_ctx.cycles += (uint64_t)n;
 }
 
+void cpu_set_cycles(uint64_t cycles)
+{
+    cpu_ctx.cycles = cycles;
+}
+
 // -----------------------------------------------------------------------------
 // Reset / IRQ / NMI
 // -----------------------------------------------------------------------------
@@ -67,6 +84,28 @@ void cpu_nmi(void)
     cpu_ctx.nmi_pending = 1;
 }
 
+int cpu_nmi_take(void)
+{
+    if (!cpu_ctx.nmi_pending) return 0;
+    cpu_ctx.nmi_pending = 0;
+    return 1;
+}
+
+int cpu_nmi_pending(void) { return cpu_ctx.nmi_pending; }
+
+int cpu_irq_line_asserted(void) { return irq_line; }
+
+// -----------------------------------------------------------------------------
+// Per-instruction hooks (trace / profiler)
+// -----------------------------------------------------------------------------
+unsigned g_cpu_hooks = 0;
+
+void cpu_hooks_insn(uint64_t cycles, uint16_t pc, uint8_t a, uint8_t x, uint8_t y, uint8_t p, uint8_t sp)
+{
+    if (g_cpu_hooks & CPU_HOOK_TRACE) cpu_trace_log(cycles, pc, a, x, y, p, sp);
+    if (g_cpu_hooks & CPU_HOOK_PROF)  cpu_prof_log(cycles, pc, sp);
+}
+
 // -----------------------------------------------------------------------------
 // One instruction step
 // -----------------------------------------------------------------------------
@@ -75,6 +114,7 @@ void cpu_step(void)
     // Service NMI edge if latched
     if (cpu_ctx.nmi_pending) {
         cpu_ctx.nmi_pending = 0;
+        CPU_IRQ_HOOK(cpu_ctx.cycles, 1);
         interrupt_enter(0xFFFA, 0);
         cpu_cycles_add(7);
     }
@@ -82,6 +122,7 @@ void cpu_step(void)
     // Service IRQ on level if asserted and I=0 (do NOT clear irq_line here;
     // mapper must acknowledge/clear via cpu_irq_clear()).
     if (irq_line && !get_flag(FLAG_I)) {
+        CPU_IRQ_HOOK(cpu_ctx.cycles, 0);
         interrupt_enter(0xFFFE, 0);
         cpu_cycles_add(7);
         // irq_line remains asserted until mapper clears it (e.g., MMC3 $E000)
@@ -89,7 +130,11 @@ void cpu_step(void)
 
     const uint64_t cyc0 = cpu_get_cycles();
     const uint16_t pc   = cpu_get_pc();
-    const uint8_t  op   = cpu_read(pc);
+    CPU_INSN_HOOK(cyc0, pc, cpu_get_a(), cpu_get_x(), cpu_get_y(), cpu_get_p(), cpu_get_sp());
+
+    // Decoded ROM/RAM code skips the opcode/operand bus reads and table lookups
+    const cpu_decoded_t* d = cpu_icache_lookup(pc);
+    const uint8_t  op   = d ? d->op : cpu_read(pc);
 
     // trace BEFORE executing the opcode
     TRACE("PRE  C=%llu  PC=%04X  OP=%02X  A=%02X X=%02X Y=%02X P=%02X SP=%02X\n",
@@ -97,11 +142,18 @@ void cpu_step(void)
           cpu_get_a(), cpu_get_x(), cpu_get_y(), cpu_get_p(), cpu_get_sp());
 
     // base cycles + bump PC past opcode
-    cpu_cycles_add(cpu_base_cycles[op]);
     cpu_set_pc((uint16_t)(pc + 1));
-
-    // execute
-    cpu_dispatch[op]();
+    if (d) {
+        // d may be invalidated by the instruction's own writes: copy it out first
+        const cpu_op_t handler = d->handler;
+        cpu_cycles_add(d->cycles);
+        cpu_operand_latch((uint16_t)(pc + 1), d->operand, (uint8_t)(d->len - 1));
+        handler();
+        cpu_operand_latch(0, 0, 0);
+    } else {
+        cpu_cycles_add(cpu_base_cycles[op]);
+        cpu_dispatch[op]();
+    }
 
     // trace AFTER executing the opcode
     const uint64_t cyc1 = cpu_get_cycles();
@@ -110,6 +162,42 @@ void cpu_step(void)
           cpu_get_pc(), cpu_get_a(), cpu_get_x(), cpu_get_y(), cpu_get_p());
 }
 
+// -----------------------------------------------------------------------------
+// Batch execution
+// -----------------------------------------------------------------------------
+void cpu_yield(void) { s_yield = 1; }
+
+int cpu_yield_take(void)
+{
+    const int y = s_yield;
+    s_yield = 0;
+    return y;
+}
+
+static int run_reference(int cycles)
+{
+    if (cycles <= 0) return 0;
+
+    const uint64_t start = cpu_ctx.cycles;
+    do {
+        cpu_step();
+    } while (cpu_ctx.cycles - start < (uint64_t)cycles && !cpu_yield_take());
+    return (int)(cpu_ctx.cycles - start);
+}
+
+int cpu_run(int cycles)
+{
+    s_yield = 0; // a yield only ends the batch it was requested in
+
+    int ran;
+    if (s_core == CPU_CORE_FAST)     ran = cpu_fast_run(cycles);
+    else if (s_core == CPU_CORE_JIT) ran = cpu_jit_run(cycles);
+    else                             ran = run_reference(cycles);
+
+    s_yield = 0;
+    return ran;
+}
+
 // -----------------------------------------------------------------------------
 // Optional disassembler (for debugging / testing)
 // -----------------------------------------------------------------------------
@@ -0,0 +1,489 @@
+// cpu_fast.c — batch 6502 interpreter ("fast" core)
+//
+// Runs a whole batch of instructions inside one function. A/X/Y/P/SP/PC and
+// the cycle counter live in locals; memory goes straight through the bus page
+// tables. State is written back only when the batch ends or an access hits a
+// page without a host pointer (PPU/APU/IO registers, mapper registers), so
+// device handlers always see an up-to-date CPU. Interrupt lines are sampled
+// on entry, after every such I/O access and after instructions that change I.
+//
+// Dispatch uses computed goto on GCC/Clang and a plain switch elsewhere
+// (define CPU_FAST_USE_SWITCH to force the switch build).
+//
+// Behaviour mirrors the reference core in cpu_ops.c exactly: base cycles are
+// added before the instruction runs, page-cross/branch extras after, and the
+// sequence of bus accesses is the same. Undocumented opcodes are 1-byte NOPs.
+
+#include <stdint.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "cpu_internal.h"
+#include "cpu_table.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(CPU_FAST_USE_SWITCH)
+#define CPU_FAST_THREADED 1
+// Labels-as-values is a GNU extension; keep -Wpedantic quiet for this file.
+#pragma GCC diagnostic ignored "-Wpedantic"
+#else
+#define CPU_FAST_THREADED 0
+#endif
+
+// All-NULL table used when the bus does not publish page pointers.
+static const uint8_t* const s_no_rd_pages[256];
+static uint8_t* const       s_no_wr_pages[256];
+
+int cpu_fast_run(int budget)
+{
+    if (budget <= 0) return 0;
+
+    uint8_t  A  = cpu_get_a();
+    uint8_t  X  = cpu_get_x();
+    uint8_t  Y  = cpu_get_y();
+    uint8_t  P  = cpu_get_p();
+    uint8_t  SP = cpu_get_sp();
+    uint16_t PC = cpu_get_pc();
+
+    uint64_t       cyc   = cpu_get_cycles();
+    const uint64_t start = cyc;
+    const uint64_t end   = start + (uint64_t)budget;
+
+    const uint8_t* const* rdp = bus_read_pages();
+    uint8_t* const*       wrp = bus_write_pages();
+    if (!rdp) rdp = s_no_rd_pages;
+    if (!wrp) wrp = s_no_wr_pages;
+
+    int      poll = 1;   // re-sample NMI/IRQ before the next instruction
+    uint8_t  op, m, lo, hi;
+    uint16_t ea, base;
+    int      cross;
+
+    // ---- state write-back around device accesses ----
+#define FLUSH() do { \
+        cpu_set_a(A); cpu_set_x(X); cpu_set_y(Y); cpu_set_p(P); \
+        cpu_set_sp(SP); cpu_set_pc(PC); cpu_set_cycles(cyc); \
+    } while (0)
+    // Devices may add cycles (OAM DMA) or raise interrupts.
+#define RELOAD() do { cyc = cpu_get_cycles(); poll = 1; } while (0)
+
+    // ---- memory ----
+#define READ(addr, dst) do { \
+        uint16_t a_ = (uint16_t)(addr); \
+        const uint8_t* p_ = rdp[a_ >> 8]; \
+        if (p_) (dst) = p_[a_ & 0xFF]; \
+        else { FLUSH(); (dst) = cpu_read(a_); RELOAD(); } \
+    } while (0)
+#define WRITE(addr, val) do { \
+        uint16_t a_ = (uint16_t)(addr); \
+        uint8_t  v_ = (uint8_t)(val); \
+        uint8_t* p_ = wrp[a_ >> 8]; \
+        if (p_) p_[a_ & 0xFF] = v_; \
+        else { FLUSH(); cpu_write(a_, v_); RELOAD(); } \
+    } while (0)
+#define FETCH8(dst)  do { READ(PC, dst); PC = (uint16_t)(PC + 1); } while (0)
+#define PUSH(val)    do { WRITE(0x0100 | SP, val); SP = (uint8_t)(SP - 1); } while (0)
+#define POP(dst)     do { SP = (uint8_t)(SP + 1); READ(0x0100 | SP, dst); } while (0)
+
+    // ---- flags ----
+#define SETF(f, on)  (P = (uint8_t)((on) ? (P | (f)) : (P & ~(f))))
+#define SETZN(v)     (P = (uint8_t)((P & ~(FLAG_Z | FLAG_N)) | ((v) ? 0 : FLAG_Z) | ((v) & FLAG_N)))
+
+    // ---- addressing modes (leave the effective address in ea) ----
+#define AM_ZP()   do { FETCH8(lo); ea = lo; } while (0)
+#define AM_ZPX()  do { FETCH8(lo); ea = (uint8_t)(lo + X); } while (0)
+#define AM_ZPY()  do { FETCH8(lo); ea = (uint8_t)(lo + Y); } while (0)
+#define AM_ABS()  do { FETCH8(lo); FETCH8(hi); ea = (uint16_t)(lo | (hi << 8)); } while (0)
+#define AM_ABX()  do { AM_ABS(); base = ea; ea = (uint16_t)(base + X); \
+                       cross = ((base ^ ea) & 0xFF00) != 0; } while (0)
+#define AM_ABY()  do { AM_ABS(); base = ea; ea = (uint16_t)(base + Y); \
+                       cross = ((base ^ ea) & 0xFF00) != 0; } while (0)
+#define AM_INX()  do { FETCH8(m); m = (uint8_t)(m + X); \
+                       READ(m, lo); READ((uint8_t)(m + 1), hi); \
+                       ea = (uint16_t)(lo | (hi << 8)); } while (0)
+#define AM_INY()  do { FETCH8(m); READ(m, lo); READ((uint8_t)(m + 1), hi); \
+                       base = (uint16_t)(lo | (hi << 8)); ea = (uint16_t)(base + Y); \
+                       cross = ((base ^ ea) & 0xFF00) != 0; } while (0)
+
+    // ---- operations ----
+#define DO_ORA(v)  do { A = (uint8_t)(A | (v)); SETZN(A); } while (0)
+#define DO_AND(v)  do { A = (uint8_t)(A & (v)); SETZN(A); } while (0)
+#define DO_EOR(v)  do { A = (uint8_t)(A ^ (v)); SETZN(A); } while (0)
+#define DO_ADC(v)  do { uint8_t v_ = (uint8_t)(v); \
+                        uint16_t s_ = (uint16_t)(A + v_ + (P & FLAG_C)); \
+                        SETF(FLAG_C, s_ > 0xFF); \
+                        SETF(FLAG_V, (~(A ^ v_) & (A ^ s_) & 0x80) != 0); \
+                        A = (uint8_t)s_; SETZN(A); } while (0)
+#define DO_SBC(v)  DO_ADC((uint8_t)((v) ^ 0xFF))
+#define DO_CMP(r, v) do { uint8_t r_ = (r), v_ = (v); \
+                        SETF(FLAG_C, r_ >= v_); SETZN((uint8_t)(r_ - v_)); } while (0)
+#define DO_BIT(v)  do { SETF(FLAG_Z, (uint8_t)(A & (v)) == 0); \
+                        SETF(FLAG_N, ((v) & 0x80) != 0); \
+                        SETF(FLAG_V, ((v) & 0x40) != 0); } while (0)
+#define DO_LDA(v)  do { A = (v); SETZN(A); } while (0)
+#define DO_LDX(v)  do { X = (v); SETZN(X); } while (0)
+#define DO_LDY(v)  do { Y = (v); SETZN(Y); } while (0)
+
+#define ASL_V(v)   do { SETF(FLAG_C, ((v) & 0x80) != 0); (v) = (uint8_t)((v) << 1); SETZN(v); } while (0)
+#define LSR_V(v)   do { SETF(FLAG_C, ((v) & 0x01) != 0); (v) = (uint8_t)((v) >> 1); SETZN(v); } while (0)
+#define ROL_V(v)   do { uint8_t c_ = (uint8_t)(P & FLAG_C); SETF(FLAG_C, ((v) & 0x80) != 0); \
+                        (v) = (uint8_t)(((v) << 1) | c_); SETZN(v); } while (0)
+#define ROR_V(v)   do { uint8_t c_ = (uint8_t)(P & FLAG_C); SETF(FLAG_C, ((v) & 0x01) != 0); \
+                        (v) = (uint8_t)(((v) >> 1) | (c_ << 7)); SETZN(v); } while (0)
+#define INC_V(v)   do { (v) = (uint8_t)((v) + 1); SETZN(v); } while (0)
+#define DEC_V(v)   do { (v) = (uint8_t)((v) - 1); SETZN(v); } while (0)
+
+    // Read-type instruction: fetch operand via AM, apply OP to it.
+#define RD_OP(AM, OP)    do { AM(); READ(ea, m); OP(m); } while (0)
+    // Same, with the +1 page-cross penalty (abs,X / abs,Y / (ind),Y).
+#define RD_OP_X(AM, OP)  do { AM(); READ(ea, m); OP(m); if (cross) cyc++; } while (0)
+    // Read-modify-write on memory (no dummy write, like the reference core).
+#define RMW(AM, OP)      do { AM(); READ(ea, m); OP(m); WRITE(ea, m); } while (0)
+    // Relative branch: +1 if taken, +1 more on page cross.
+#define BRANCH(cond) do { \
+        FETCH8(m); \
+        if (cond) { \
+            uint16_t t_ = (uint16_t)(PC + (int8_t)m); \
+            cyc += 1 + (((PC ^ t_) & 0xFF00) != 0); \
+            PC = t_; \
+        } \
+    } while (0)
+
+    // ---- dispatch ----
+#define FETCH_OPCODE() do { \
+        CPU_INSN_HOOK(cyc, PC, A, X, Y, P, SP); \
+        READ(PC, op); \
+        cyc += cpu_base_cycles[op]; \
+        PC = (uint16_t)(PC + 1); \
+    } while (0)
+
+#if CPU_FAST_THREADED
+#define L(x) &&op_##x
+#define IL   &&op_ill
+    static const void* const s_labels[256] = {
+        /* 00 */ L(00), L(01), IL   , IL   , IL   , L(05), L(06), IL   , L(08), L(09), L(0A), IL   , IL   , L(0D), L(0E), IL   ,
+        /* 10 */ L(10), L(11), IL   , IL   , IL   , L(15), L(16), IL   , L(18), L(19), IL   , IL   , IL   , L(1D), L(1E), IL   ,
+        /* 20 */ L(20), L(21), IL   , IL   , L(24), L(25), L(26), IL   , L(28), L(29), L(2A), IL   , L(2C), L(2D), L(2E), IL   ,
+        /* 30 */ L(30), L(31), IL   , IL   , IL   , L(35), L(36), IL   , L(38), L(39), IL   , IL   , IL   , L(3D), L(3E), IL   ,
+        /* 40 */ L(40), L(41), IL   , IL   , IL   , L(45), L(46), IL   , L(48), L(49), L(4A), IL   , L(4C), L(4D), L(4E), IL   ,
+        /* 50 */ L(50), L(51), IL   , IL   , IL   , L(55), L(56), IL   , L(58), L(59), IL   , IL   , IL   , L(5D), L(5E), IL   ,
+        /* 60 */ L(60), L(61), IL   , IL   , IL   , L(65), L(66), IL   , L(68), L(69), L(6A), IL   , L(6C), L(6D), L(6E), IL   ,
+        /* 70 */ L(70), L(71), IL   , IL   , IL   , L(75), L(76), IL   , L(78), L(79), IL   , IL   , IL   , L(7D), L(7E), IL   ,
+        /* 80 */ IL   , L(81), IL   , IL   , L(84), L(85), L(86), IL   , L(88), IL   , L(8A), IL   , L(8C), L(8D), L(8E), IL   ,
+        /* 90 */ L(90), L(91), IL   , IL   , L(94), L(95), L(96), IL   , L(98), L(99), L(9A), IL   , IL   , L(9D), IL   , IL   ,
+        /* A0 */ L(A0), L(A1), L(A2), IL   , L(A4), L(A5), L(A6), IL   , L(A8), L(A9), L(AA), IL   , L(AC), L(AD), L(AE), IL   ,
+        /* B0 */ L(B0), L(B1), IL   , IL   , L(B4), L(B5), L(B6), IL   , L(B8), L(B9), L(BA), IL   , L(BC), L(BD), L(BE), IL   ,
+        /* C0 */ L(C0), L(C1), IL   , IL   , L(C4), L(C5), L(C6), IL   , L(C8), L(C9), L(CA), IL   , L(CC), L(CD), L(CE), IL   ,
+        /* D0 */ L(D0), L(D1), IL   , IL   , IL   , L(D5), L(D6), IL   , L(D8), L(D9), IL   , IL   , IL   , L(DD), L(DE), IL   ,
+        /* E0 */ L(E0), L(E1), IL   , IL   , L(E4), L(E5), L(E6), IL   , L(E8), L(E9), L(EA), IL   , L(EC), L(ED), L(EE), IL   ,
+        /* F0 */ L(F0), L(F1), IL   , IL   , IL   , L(F5), L(F6), IL   , L(F8), L(F9), IL   , IL   , IL   , L(FD), L(FE), IL   ,
+    };
+#undef L
+#undef IL
+#define OP(x)           op_##x:
+#define OP_ILLEGAL      op_ill:
+#define DISPATCH_BEGIN  goto *s_labels[op];
+#define DISPATCH_END
+    // Threaded dispatch: every handler jumps straight to the next one.
+#define NEXT do { \
+        if (poll || cyc >= end) goto next; \
+        FETCH_OPCODE(); \
+        goto *s_labels[op]; \
+    } while (0)
+#else
+#define OP(x)           case 0x##x:
+#define OP_ILLEGAL      default:
+#define DISPATCH_BEGIN  switch (op) {
+#define DISPATCH_END    }
+#define NEXT            goto next
+#endif
+
+top:
+    if (poll) {
+        poll = 0;
+        if (cpu_yield_take()) goto out; // a device write moved the next event
+        if (cpu_nmi_take()) {
+            CPU_IRQ_HOOK(cyc, 1);
+            PUSH(PC >> 8); PUSH(PC & 0xFF);
+            PUSH((P | FLAG_U) & ~FLAG_B);
+            P |= FLAG_I;
+            READ(VEC_NMI, lo); READ(VEC_NMI + 1, hi);
+            PC = (uint16_t)(lo | (hi << 8));
+            cyc += 7;
+        }
+        if (cpu_irq_line_asserted() && !(P & FLAG_I)) {
+            CPU_IRQ_HOOK(cyc, 0);
+            PUSH(PC >> 8); PUSH(PC & 0xFF);
+            PUSH((P | FLAG_U) & ~FLAG_B);
+            P |= FLAG_I;
+            READ(VEC_IRQ_BRK, lo); READ(VEC_IRQ_BRK + 1, hi);
+            PC = (uint16_t)(lo | (hi << 8));
+            cyc += 7;
+        }
+        // Any accesses above may have raised poll again; that is harmless,
+        // the lines are only re-sampled before the next instruction.
+    }
+
+    FETCH_OPCODE();
+
+    DISPATCH_BEGIN
+
+    // -------------------------------------------------------------------------
+    // SYSTEM / FLOW
+    // -------------------------------------------------------------------------
+    OP(00) { // BRK
+        FETCH8(m); // padding byte
+        PUSH(PC >> 8); PUSH(PC & 0xFF);
+        PUSH(P | FLAG_U | FLAG_B);
+        P |= FLAG_I;
+        READ(VEC_IRQ_BRK, lo); READ(VEC_IRQ_BRK + 1, hi);
+        PC = (uint16_t)(lo | (hi << 8));
+        NEXT;
+    }
+    OP(40) { // RTI
+        POP(m);
+        P = (uint8_t)((m & ~FLAG_B) | FLAG_U);
+        POP(lo); POP(hi);
+        PC = (uint16_t)(lo | (hi << 8));
+        poll = 1;
+        NEXT;
+    }
+    OP(60) { // RTS
+        POP(lo); POP(hi);
+        PC = (uint16_t)((lo | (hi << 8)) + 1);
+        NEXT;
+    }
+    OP(20) { // JSR abs
+        AM_ABS();
+        uint16_t ret = (uint16_t)(PC - 1);
+        PUSH(ret >> 8); PUSH(ret & 0xFF);
+        PC = ea;
+        NEXT;
+    }
+    OP(4C) { AM_ABS(); PC = ea; NEXT; } // JMP abs
+    OP(6C) { // JMP (ind) with the page-wrap bug
+        AM_ABS();
+        READ(ea, lo);
+        READ((ea & 0xFF00) | ((ea + 1) & 0x00FF), hi);
+        PC = (uint16_t)(lo | (hi << 8));
+        NEXT;
+    }
+
+    // -------------------------------------------------------------------------
+    // BRANCHES
+    // -------------------------------------------------------------------------
+    OP(10) { BRANCH(!(P & FLAG_N)); NEXT; } // BPL
+    OP(30) { BRANCH( (P & FLAG_N)); NEXT; } // BMI
+    OP(50) { BRANCH(!(P & FLAG_V)); NEXT; } // BVC
+    OP(70) { BRANCH( (P & FLAG_V)); NEXT; } // BVS
+    OP(90) { BRANCH(!(P & FLAG_C)); NEXT; } // BCC
+    OP(B0) { BRANCH( (P & FLAG_C)); NEXT; } // BCS
+    OP(D0) { BRANCH(!(P & FLAG_Z)); NEXT; } // BNE
+    OP(F0) { BRANCH( (P & FLAG_Z)); NEXT; } // BEQ
+
+    // -------------------------------------------------------------------------
+    // LOADS
+    // -------------------------------------------------------------------------
+    OP(A9) { FETCH8(m); DO_LDA(m); NEXT; }
+    OP(A5) { RD_OP  (AM_ZP,  DO_LDA); NEXT; }
+    OP(B5) { RD_OP  (AM_ZPX, DO_LDA); NEXT; }
+    OP(AD) { RD_OP  (AM_ABS, DO_LDA); NEXT; }
+    OP(BD) { RD_OP_X(AM_ABX, DO_LDA); NEXT; }
+    OP(B9) { RD_OP_X(AM_ABY, DO_LDA); NEXT; }
+    OP(A1) { RD_OP  (AM_INX, DO_LDA); NEXT; }
+    OP(B1) { RD_OP_X(AM_INY, DO_LDA); NEXT; }
+
+    OP(A2) { FETCH8(m); DO_LDX(m); NEXT; }
+    OP(A6) { RD_OP  (AM_ZP,  DO_LDX); NEXT; }
+    OP(B6) { RD_OP  (AM_ZPY, DO_LDX); NEXT; }
+    OP(AE) { RD_OP  (AM_ABS, DO_LDX); NEXT; }
+    OP(BE) { RD_OP_X(AM_ABY, DO_LDX); NEXT; }
+
+    OP(A0) { FETCH8(m); DO_LDY(m); NEXT; }
+    OP(A4) { RD_OP  (AM_ZP,  DO_LDY); NEXT; }
+    OP(B4) { RD_OP  (AM_ZPX, DO_LDY); NEXT; }
+    OP(AC) { RD_OP  (AM_ABS, DO_LDY); NEXT; }
+    OP(BC) { RD_OP_X(AM_ABX, DO_LDY); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // STORES (no page-cross penalty)
+    // -------------------------------------------------------------------------
+    OP(85) { AM_ZP();  WRITE(ea, A); NEXT; }
+    OP(95) { AM_ZPX(); WRITE(ea, A); NEXT; }
+    OP(8D) { AM_ABS(); WRITE(ea, A); NEXT; }
+    OP(9D) { AM_ABX(); WRITE(ea, A); NEXT; }
+    OP(99) { AM_ABY(); WRITE(ea, A); NEXT; }
+    OP(81) { AM_INX(); WRITE(ea, A); NEXT; }
+    OP(91) { AM_INY(); WRITE(ea, A); NEXT; }
+
+    OP(86) { AM_ZP();  WRITE(ea, X); NEXT; }
+    OP(96) { AM_ZPY(); WRITE(ea, X); NEXT; }
+    OP(8E) { AM_ABS(); WRITE(ea, X); NEXT; }
+
+    OP(84) { AM_ZP();  WRITE(ea, Y); NEXT; }
+    OP(94) { AM_ZPX(); WRITE(ea, Y); NEXT; }
+    OP(8C) { AM_ABS(); WRITE(ea, Y); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // LOGICAL (ORA/AND/EOR)
+    // -------------------------------------------------------------------------
+    OP(09) { FETCH8(m); DO_ORA(m); NEXT; }
+    OP(05) { RD_OP  (AM_ZP,  DO_ORA); NEXT; }
+    OP(15) { RD_OP  (AM_ZPX, DO_ORA); NEXT; }
+    OP(0D) { RD_OP  (AM_ABS, DO_ORA); NEXT; }
+    OP(1D) { RD_OP_X(AM_ABX, DO_ORA); NEXT; }
+    OP(19) { RD_OP_X(AM_ABY, DO_ORA); NEXT; }
+    OP(01) { RD_OP  (AM_INX, DO_ORA); NEXT; }
+    OP(11) { RD_OP_X(AM_INY, DO_ORA); NEXT; }
+
+    OP(29) { FETCH8(m); DO_AND(m); NEXT; }
+    OP(25) { RD_OP  (AM_ZP,  DO_AND); NEXT; }
+    OP(35) { RD_OP  (AM_ZPX, DO_AND); NEXT; }
+    OP(2D) { RD_OP  (AM_ABS, DO_AND); NEXT; }
+    OP(3D) { RD_OP_X(AM_ABX, DO_AND); NEXT; }
+    OP(39) { RD_OP_X(AM_ABY, DO_AND); NEXT; }
+    OP(21) { RD_OP  (AM_INX, DO_AND); NEXT; }
+    OP(31) { RD_OP_X(AM_INY, DO_AND); NEXT; }
+
+    OP(49) { FETCH8(m); DO_EOR(m); NEXT; }
+    OP(45) { RD_OP  (AM_ZP,  DO_EOR); NEXT; }
+    OP(55) { RD_OP  (AM_ZPX, DO_EOR); NEXT; }
+    OP(4D) { RD_OP  (AM_ABS, DO_EOR); NEXT; }
+    OP(5D) { RD_OP_X(AM_ABX, DO_EOR); NEXT; }
+    OP(59) { RD_OP_X(AM_ABY, DO_EOR); NEXT; }
+    OP(41) { RD_OP  (AM_INX, DO_EOR); NEXT; }
+    OP(51) { RD_OP_X(AM_INY, DO_EOR); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // ADC / SBC
+    // -------------------------------------------------------------------------
+    OP(69) { FETCH8(m); DO_ADC(m); NEXT; }
+    OP(65) { RD_OP  (AM_ZP,  DO_ADC); NEXT; }
+    OP(75) { RD_OP  (AM_ZPX, DO_ADC); NEXT; }
+    OP(6D) { RD_OP  (AM_ABS, DO_ADC); NEXT; }
+    OP(7D) { RD_OP_X(AM_ABX, DO_ADC); NEXT; }
+    OP(79) { RD_OP_X(AM_ABY, DO_ADC); NEXT; }
+    OP(61) { RD_OP  (AM_INX, DO_ADC); NEXT; }
+    OP(71) { RD_OP_X(AM_INY, DO_ADC); NEXT; }
+
+    OP(E9) { FETCH8(m); DO_SBC(m); NEXT; }
+    OP(E5) { RD_OP  (AM_ZP,  DO_SBC); NEXT; }
+    OP(F5) { RD_OP  (AM_ZPX, DO_SBC); NEXT; }
+    OP(ED) { RD_OP  (AM_ABS, DO_SBC); NEXT; }
+    OP(FD) { RD_OP_X(AM_ABX, DO_SBC); NEXT; }
+    OP(F9) { RD_OP_X(AM_ABY, DO_SBC); NEXT; }
+    OP(E1) { RD_OP  (AM_INX, DO_SBC); NEXT; }
+    OP(F1) { RD_OP_X(AM_INY, DO_SBC); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // COMPARES
+    // -------------------------------------------------------------------------
+#define CMP_A(v) DO_CMP(A, v)
+#define CMP_X(v) DO_CMP(X, v)
+#define CMP_Y(v) DO_CMP(Y, v)
+    OP(C9) { FETCH8(m); CMP_A(m); NEXT; }
+    OP(C5) { RD_OP  (AM_ZP,  CMP_A); NEXT; }
+    OP(D5) { RD_OP  (AM_ZPX, CMP_A); NEXT; }
+    OP(CD) { RD_OP  (AM_ABS, CMP_A); NEXT; }
+    OP(DD) { RD_OP_X(AM_ABX, CMP_A); NEXT; }
+    OP(D9) { RD_OP_X(AM_ABY, CMP_A); NEXT; }
+    OP(C1) { RD_OP  (AM_INX, CMP_A); NEXT; }
+    OP(D1) { RD_OP_X(AM_INY, CMP_A); NEXT; }
+
+    OP(E0) { FETCH8(m); CMP_X(m); NEXT; }
+    OP(E4) { RD_OP  (AM_ZP,  CMP_X); NEXT; }
+    OP(EC) { RD_OP  (AM_ABS, CMP_X); NEXT; }
+
+    OP(C0) { FETCH8(m); CMP_Y(m); NEXT; }
+    OP(C4) { RD_OP  (AM_ZP,  CMP_Y); NEXT; }
+    OP(CC) { RD_OP  (AM_ABS, CMP_Y); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // BIT
+    // -------------------------------------------------------------------------
+    OP(24) { RD_OP(AM_ZP,  DO_BIT); NEXT; }
+    OP(2C) { RD_OP(AM_ABS, DO_BIT); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // SHIFTS / ROTATES
+    // -------------------------------------------------------------------------
+    OP(0A) { ASL_V(A); NEXT; }
+    OP(06) { RMW(AM_ZP,  ASL_V); NEXT; }
+    OP(16) { RMW(AM_ZPX, ASL_V); NEXT; }
+    OP(0E) { RMW(AM_ABS, ASL_V); NEXT; }
+    OP(1E) { RMW(AM_ABX, ASL_V); NEXT; }
+
+    OP(4A) { LSR_V(A); NEXT; }
+    OP(46) { RMW(AM_ZP,  LSR_V); NEXT; }
+    OP(56) { RMW(AM_ZPX, LSR_V); NEXT; }
+    OP(4E) { RMW(AM_ABS, LSR_V); NEXT; }
+    OP(5E) { RMW(AM_ABX, LSR_V); NEXT; }
+
+    OP(2A) { ROL_V(A); NEXT; }
+    OP(26) { RMW(AM_ZP,  ROL_V); NEXT; }
+    OP(36) { RMW(AM_ZPX, ROL_V); NEXT; }
+    OP(2E) { RMW(AM_ABS, ROL_V); NEXT; }
+    OP(3E) { RMW(AM_ABX, ROL_V); NEXT; }
+
+    OP(6A) { ROR_V(A); NEXT; }
+    OP(66) { RMW(AM_ZP,  ROR_V); NEXT; }
+    OP(76) { RMW(AM_ZPX, ROR_V); NEXT; }
+    OP(6E) { RMW(AM_ABS, ROR_V); NEXT; }
+    OP(7E) { RMW(AM_ABX, ROR_V); NEXT; }
+
+    // -------------------------------------------------------------------------
+    // INC / DEC
+    // -------------------------------------------------------------------------
+    OP(E6) { RMW(AM_ZP,  INC_V); NEXT; }
+    OP(F6) { RMW(AM_ZPX, INC_V); NEXT; }
+    OP(EE) { RMW(AM_ABS, INC_V); NEXT; }
+    OP(FE) { RMW(AM_ABX, INC_V); NEXT; }
+
+    OP(C6) { RMW(AM_ZP,  DEC_V); NEXT; }
+    OP(D6) { RMW(AM_ZPX, DEC_V); NEXT; }
+    OP(CE) { RMW(AM_ABS, DEC_V); NEXT; }
+    OP(DE) { RMW(AM_ABX, DEC_V); NEXT; }
+
+    OP(E8) { INC_V(X); NEXT; } // INX
+    OP(CA) { DEC_V(X); NEXT; } // DEX
+    OP(C8) { INC_V(Y); NEXT; } // INY
+    OP(88) { DEC_V(Y); NEXT; } // DEY
+
+    // -------------------------------------------------------------------------
+    // STACK / TRANSFERS
+    // -------------------------------------------------------------------------
+    OP(48) { PUSH(A); NEXT; }                          // PHA
+    OP(08) { PUSH(P | FLAG_B | FLAG_U); NEXT; }        // PHP
+    OP(68) { POP(A); SETZN(A); NEXT; }                 // PLA
+    OP(28) { POP(m); P = (uint8_t)(m | FLAG_U); poll = 1; NEXT; } // PLP
+
+    OP(AA) { X = A;  SETZN(X); NEXT; } // TAX
+    OP(8A) { A = X;  SETZN(A); NEXT; } // TXA
+    OP(A8) { Y = A;  SETZN(Y); NEXT; } // TAY
+    OP(98) { A = Y;  SETZN(A); NEXT; } // TYA
+    OP(BA) { X = SP; SETZN(X); NEXT; } // TSX
+    OP(9A) { SP = X; NEXT; }           // TXS
+
+    // -------------------------------------------------------------------------
+    // FLAGS / NOP
+    // -------------------------------------------------------------------------
+    OP(18) { P &= (uint8_t)~FLAG_C; NEXT; }            // CLC
+    OP(38) { P |= FLAG_C; NEXT; }                      // SEC
+    OP(58) { P &= (uint8_t)~FLAG_I; poll = 1; NEXT; }  // CLI
+    OP(78) { P |= FLAG_I; NEXT; }                      // SEI
+    OP(D8) { P &= (uint8_t)~FLAG_D; NEXT; }            // CLD
+    OP(F8) { P |= FLAG_D; NEXT; }                      // SED
+    OP(B8) { P &= (uint8_t)~FLAG_V; NEXT; }            // CLV
+    OP(EA) { NEXT; }                                   // NOP
+
+    // Undocumented opcodes: 1-byte NOP, same as op_illegal()
+    OP_ILLEGAL { NEXT; }
+
+    DISPATCH_END
+
+next:
+    if (cyc < end) goto top;
+
+out:
+    FLUSH();
+    return (int)(cyc - start);
+}
@@ -0,0 +1,215 @@
+// cpu_icache.c — decoded instruction cache for the reference core
+//
+// Decoded entries live in 256-entry blocks, one block per 256-byte page of
+// host memory (a page of PRG-ROM, internal RAM or PRG-RAM). A CPU page is
+// tied to its block through the host pointer the bus publishes for it, so
+// the cache is keyed by physical bank: when a mapper switches banks, the page
+// table points somewhere else and the next lookup simply picks up the block
+// for that bank. Blocks are kept for the lifetime of the region.
+//
+// RAM blocks are the only ones that can go stale. The first decode in a RAM
+// page asks the bus to trap writes to it; the trapped write lands in
+// cpu_icache_invalidate(), which empties the block and lifts the trap.
+//
+// Instructions that straddle a page edge are never cached: the two pages may
+// belong to different banks.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "cpu_internal.h"
+#include "cpu_table.h"
+#include "cpu_ops.h"
+
+#define ICACHE_PAGE 256
+
+typedef struct
+{
+    cpu_decoded_t e[ICACHE_PAGE];
+    int live; // has decoded entries (and, for RAM, the bus traps its writes)
+} icache_block_t;
+
+typedef struct
+{
+    const uint8_t*   base;
+    size_t           pages;
+    int              writable;
+    icache_block_t** blocks; // [pages], allocated on first decode
+} icache_region_t;
+
+// [0] is PRG-ROM; the rest are RAM regions.
+#define ICACHE_MAX_REGIONS 4
+static icache_region_t s_regions[ICACHE_MAX_REGIONS];
+
+// Per CPU page: host pointer last seen in the bus page table and the block it
+// resolved to (NULL = not cacheable).
+static const uint8_t*  s_page_host[256];
+static icache_block_t* s_page_block[256];
+static icache_region_t* s_page_region[256];
+
+static const uint8_t* const* s_rdp;
+static int s_enabled = 1;
+static cpu_icache_stats_t s_stats;
+
+// -----------------------------------------------------------------------------
+// Regions
+// -----------------------------------------------------------------------------
+static void forget_pages(void)
+{
+    memset(s_page_host, 0, sizeof s_page_host);
+    memset(s_page_block, 0, sizeof s_page_block);
+    memset(s_page_region, 0, sizeof s_page_region);
+}
+
+static void region_free(icache_region_t* r)
+{
+    if (r->blocks) {
+        for (size_t i = 0; i < r->pages; ++i) free(r->blocks[i]);
+        free(r->blocks);
+    }
+    memset(r, 0, sizeof *r);
+}
+
+static void region_set(icache_region_t* r, const uint8_t* mem, size_t len, int writable)
+{
+    region_free(r);
+    if (!mem || len < ICACHE_PAGE) return;
+    r->blocks = (icache_block_t**)calloc(len / ICACHE_PAGE, sizeof *r->blocks);
+    if (!r->blocks) return;
+    r->base     = mem;
+    r->pages    = len / ICACHE_PAGE;
+    r->writable = writable;
+}
+
+static icache_region_t* region_of(const uint8_t* p)
+{
+    for (int i = 0; i < ICACHE_MAX_REGIONS; ++i) {
+        icache_region_t* r = &s_regions[i];
+        if (r->blocks && p >= r->base && p < r->base + r->pages * ICACHE_PAGE) return r;
+    }
+    return NULL;
+}
+
+void cpu_icache_add_rom(const uint8_t* mem, size_t len)
+{
+    region_set(&s_regions[0], mem, len, 0);
+    forget_pages();
+}
+
+void cpu_icache_add_ram(const uint8_t* mem, size_t len)
+{
+    icache_region_t* slot = NULL;
+    for (int i = 1; i < ICACHE_MAX_REGIONS; ++i) {
+        if (s_regions[i].blocks && s_regions[i].base == mem) { slot = &s_regions[i]; break; }
+        if (!slot && !s_regions[i].blocks) slot = &s_regions[i];
+    }
+    if (!slot) return; // out of slots: that RAM simply stays uncached
+    region_set(slot, mem, len, 1);
+    forget_pages();
+}
+
+void cpu_icache_flush(void)
+{
+    for (int i = 0; i < ICACHE_MAX_REGIONS; ++i) {
+        icache_region_t* r = &s_regions[i];
+        if (!r->blocks) continue;
+        for (size_t p = 0; p < r->pages; ++p) {
+            icache_block_t* b = r->blocks[p];
+            if (!b || !b->live) continue;
+            if (r->writable) bus_trap_code_writes(r->base + p * ICACHE_PAGE, 0);
+            memset(b, 0, sizeof *b);
+        }
+    }
+}
+
+void cpu_icache_invalidate(const uint8_t* mem, size_t len)
+{
+    if (!len) return;
+    icache_region_t* r = region_of(mem);
+    if (!r) return;
+
+    const size_t first = (size_t)(mem - r->base) / ICACHE_PAGE;
+    size_t last = (size_t)(mem + len - 1 - r->base) / ICACHE_PAGE;
+    if (last >= r->pages) last = r->pages - 1;
+
+    for (size_t p = first; p <= last; ++p) {
+        icache_block_t* b = r->blocks[p];
+        if (!b || !b->live) continue;
+        if (r->writable) bus_trap_code_writes(r->base + p * ICACHE_PAGE, 0);
+        memset(b, 0, sizeof *b);
+        s_stats.invalidations++;
+    }
+}
+
+void cpu_icache_set_enabled(int on) { s_enabled = on != 0; }
+
+void cpu_icache_get_stats(cpu_icache_stats_t* out)
+{
+    if (out) *out = s_stats;
+}
+
+void cpu_icache_reset_stats(void)
+{
+    memset(&s_stats, 0, sizeof s_stats);
+}
+
+// -----------------------------------------------------------------------------
+// Lookup / decode
+// -----------------------------------------------------------------------------
+static icache_block_t* resolve_page(uint8_t page, const uint8_t* host)
+{
+    s_page_host[page]   = host;
+    s_page_block[page]  = NULL;
+    s_page_region[page] = NULL;
+
+    icache_region_t* r = host ? region_of(host) : NULL;
+    if (!r) return NULL;
+    const size_t off = (size_t)(host - r->base);
+    if (off % ICACHE_PAGE) return NULL; // window not page-aligned in the region
+
+    icache_block_t** slot = &r->blocks[off / ICACHE_PAGE];
+    if (!*slot) {
+        *slot = (icache_block_t*)calloc(1, sizeof **slot);
+        if (!*slot) return NULL;
+    }
+    s_page_region[page] = r;
+    s_page_block[page]  = *slot;
+    return *slot;
+}
+
+const cpu_decoded_t* cpu_icache_lookup(uint16_t pc)
+{
+    if (!s_enabled) return NULL;
+    if (!s_rdp) s_rdp = bus_read_pages();
+
+    const uint8_t  page = (uint8_t)(pc >> 8);
+    const uint8_t* host = s_rdp ? s_rdp[page] : NULL;
+
+    icache_block_t* b = s_page_block[page];
+    if (host != s_page_host[page]) b = resolve_page(page, host);
+    if (!b) { s_stats.bypassed++; return NULL; }
+
+    cpu_decoded_t* d = &b->e[pc & 0xFF];
+    if (d->len) { s_stats.hits++; return d; }
+
+    // Miss: decode from host memory. Undocumented opcodes run as 1-byte NOPs.
+    const unsigned off = pc & 0xFF;
+    const uint8_t  op  = host[off];
+    const uint8_t  len = cpu_dispatch[op] == op_illegal ? 1 : cpu_instr_len[op];
+    if (off + len > ICACHE_PAGE) { s_stats.bypassed++; return NULL; }
+
+    if (!b->live) {
+        b->live = 1;
+        if (s_page_region[page]->writable) bus_trap_code_writes(host, 1);
+    }
+    d->handler = cpu_dispatch[op];
+    d->op      = op;
+    d->cycles  = cpu_base_cycles[op];
+    d->operand = (uint16_t)((len > 1 ? host[off + 1] : 0) | (len > 2 ? host[off + 2] << 8 : 0));
+    d->len     = len;
+    s_stats.misses++;
+    return d;
+}
@@ -12,13 +12,34 @@ typedef struct
     uint8_t A; // Accumulator
     uint8_t X; // Index X
     uint8_t Y; // Index Y
-    uint8_t P; // Status
+    uint8_t P; // Status (N and Z live in z_src/n_src below; their bits here are stale)
     uint8_t SP; // Stack Pointer
     uint16_t PC; // Program Counter
+
+    // Lazy N/Z: most results overwrite both before anything looks at P, so
+    // set_zn() only records the byte and P is assembled when observed
+    // (cpu_get_p(), get_flag(), PHP and interrupt pushes go through those).
+    // Z = (z_src == 0), N = bit 7 of n_src. Two sources because BIT sets N
+    // and Z independently.
+    uint8_t z_src;
+    uint8_t n_src;
 }cpu_state_t;
 
 static cpu_state_t s;
 
+// Operand latch armed by cpu_step() for a decoded instruction: fetch8() serves
+// the bytes at [latch_pc, latch_pc + latch_len) from here instead of the bus.
+static uint16_t latch_pc;
+static uint16_t latch_operand;
+static uint8_t  latch_len;
+
+void cpu_operand_latch(uint16_t pc, uint16_t operand, uint8_t len)
+{
+    latch_pc = pc;
+    latch_operand = operand;
+    latch_len = len;
+}
+
 // -----------------------------------------------------------------------------
 // Public accessors (cpu.h)
 // -----------------------------------------------------------------------------
@@ -28,8 +49,17 @@ void cpu_set_pc(uint16_t pc) { s.PC = pc; }
 uint8_t cpu_get_sp(void) { return s.SP; }
 void cpu_set_sp(uint8_t sp) { s.SP = sp; }
 
-uint8_t cpu_get_p(void) { return s.P; }
-void cpu_set_p(uint8_t p) { s.P = (uint8_t)(p | FLAG_U); }
+uint8_t cpu_get_p(void)
+{
+    return (uint8_t)((s.P & ~(FLAG_N | FLAG_Z)) | (s.n_src & FLAG_N) | (s.z_src ? 0 : FLAG_Z));
+}
+
+void cpu_set_p(uint8_t p)
+{
+    s.P = (uint8_t)(p | FLAG_U);
+    s.n_src = p;
+    s.z_src = (uint8_t)((p & FLAG_Z) ? 0 : 1);
+}
 
 uint8_t cpu_get_a(void) { return s.A; }
 void cpu_set_a(uint8_t a) { s.A = a; }
@@ -46,7 +76,8 @@ void cpu_set_y(uint8_t y) { s.Y = y; }
 uint8_t fetch8(void)
 {
     uint16_t pc = cpu_get_pc();
-    uint8_t v = cpu_read(pc);
+    uint16_t i = (uint16_t)(pc - latch_pc);
+    uint8_t v = (i < latch_len) ? (uint8_t)(latch_operand >> (i * 8)) : cpu_read(pc);
     cpu_set_pc((uint16_t)(pc + 1));
     return v;
 }
@@ -93,23 +124,25 @@ uint16_t pop16(void)
 // ----------------------------
 void set_flag(uint8_t flag_mask, int on)
 {
-    uint8_t p = cpu_get_p();
-    if (on) p |= flag_mask;
-    else p &= (uint8_t)~flag_mask;
+    if (flag_mask & FLAG_Z) s.z_src = (uint8_t)(on ? 0 : 1);
+    if (flag_mask & FLAG_N) s.n_src = (uint8_t)(on ? FLAG_N : 0);
+    if (on) s.P |= flag_mask;
+    else s.P &= (uint8_t)~flag_mask;
     // Keep the unused bit set internally when writing P
-    p |= FLAG_U;
-    cpu_set_p(p);
+    s.P |= FLAG_U;
 }
 
 uint8_t get_flag(uint8_t flag_mask)
 {
+    if (flag_mask == FLAG_Z) return s.z_src == 0;
+    if (flag_mask == FLAG_N) return (s.n_src & FLAG_N) != 0;
     return (uint8_t)((cpu_get_p()) & flag_mask) ? 1 : 0;
 }
 
 void set_zn(uint8_t v)
 {
-    set_flag(FLAG_Z, v == 0);
-    set_flag(FLAG_N, (v & 0x80) != 0);
+    s.z_src = v;
+    s.n_src = v;
 }
 
 // ----------------------------
@@ -0,0 +1,844 @@
+// cpu_jit.c — x86-64 translator for straight-line 6502 code in PRG-ROM
+//
+// The JIT core (CPU_CORE_JIT) runs translated blocks between calls into the
+// reference core. A block is a run of up to JIT_MAX_INSNS instructions from
+// one 256-byte page of PRG-ROM, ended by a jump, JSR, RTS, branch or by the
+// first instruction the translator leaves to the interpreter (BRK, RTI, PLP,
+// CLI, JMP (ind), absolute accesses to $2000-$5FFF).
+//
+// Translated code works on a jit_ctx_t (registers, PC, cycle counter and the
+// bus page tables). Every memory access goes through the page tables; when a
+// page has no host pointer (I/O, mapper registers, trapped code pages) the
+// block stops *before* that instruction and the interpreter runs it. Nothing
+// inside a block can raise an interrupt or switch a bank, so interrupts are
+// only sampled between blocks, exactly where the reference core would.
+//
+// Cycles are exact: base cycles are summed at translation time, page-cross
+// and branch extras are added as they happen. A block only starts when its
+// worst case still fits the cpu_run() budget, so batches stop on the same
+// instruction boundary as the reference core.
+//
+// Blocks are keyed by offset into the PRG-ROM image, like the decoded
+// instruction cache, so a PRG bank switch simply selects other blocks. Code
+// in RAM is never translated. Without x86-64 + mmap (or with -DCPU_JIT=OFF)
+// the core falls back to the interpreter.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "cpu_internal.h"
+#include "cpu_table.h"
+#include "cpu_ops.h"
+
+#if defined(CPU_JIT) && CPU_JIT && defined(__x86_64__) && !defined(_WIN32)
+#define CPU_JIT_NATIVE 1
+#include <sys/mman.h>
+#else
+#define CPU_JIT_NATIVE 0
+#endif
+
+static cpu_jit_stats_t s_stats;
+
+void cpu_jit_get_stats(cpu_jit_stats_t* out)
+{
+    if (out) *out = s_stats;
+}
+
+void cpu_jit_reset_stats(void)
+{
+    memset(&s_stats, 0, sizeof s_stats);
+}
+
+#if !CPU_JIT_NATIVE
+
+int  cpu_jit_available(void) { return 0; }
+void cpu_jit_add_rom(const uint8_t* mem, size_t len) { (void)mem; (void)len; }
+void cpu_jit_flush(void) {}
+
+int cpu_jit_run(int budget)
+{
+    if (budget <= 0) return 0;
+    const uint64_t start = cpu_get_cycles();
+    do {
+        cpu_step();
+    } while (cpu_get_cycles() - start < (uint64_t)budget);
+    const uint64_t ran = cpu_get_cycles() - start;
+    s_stats.total_cycles += ran;
+    return (int)ran;
+}
+
+#else
+
+// -----------------------------------------------------------------------------
+// Translated code state. Generated code keeps the pointer in RDI.
+// -----------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t              cycles;
+    const uint8_t* const* rdp;
+    uint8_t* const*       wrp;
+    uint16_t              pc;
+    uint8_t               a, x, y, p, sp;
+    uint8_t               bail; // set when the block stopped before an I/O access
+} jit_ctx_t;
+
+#define CTX(f) ((uint8_t)offsetof(jit_ctx_t, f))
+_Static_assert(offsetof(jit_ctx_t, bail) < 128, "context fields need 8-bit displacements");
+
+typedef void (*jit_fn_t)(jit_ctx_t* ctx);
+
+typedef struct
+{
+    jit_fn_t fn;
+    uint16_t max_cycles; // worst case, for the cpu_run() budget check
+    uint8_t  state;      // JIT_UNTRIED / JIT_READY / JIT_NONE
+} jit_block_t;
+
+enum { JIT_UNTRIED = 0, JIT_READY, JIT_NONE };
+
+#define JIT_PAGE       256
+#define JIT_MAX_INSNS  48
+#define JIT_CODE_SIZE  (4u << 20)
+#define JIT_BLOCK_ROOM (16u << 10) // worst case for one block
+
+static uint8_t*      s_code;       // RWX buffer, NULL until first use
+static size_t        s_code_used;
+static int           s_code_failed;
+
+static const uint8_t* s_rom;
+static size_t         s_rom_pages;
+static jit_block_t**  s_blocks;    // [s_rom_pages], allocated on first translation
+
+// -----------------------------------------------------------------------------
+// Opcode classes (built once from cpu_mnemonic; modes from cpu_addrmode_id)
+// -----------------------------------------------------------------------------
+typedef enum
+{
+    K_NONE = 0, // left to the interpreter
+    K_NOP,
+    K_LDA, K_LDX, K_LDY, K_STA, K_STX, K_STY,
+    K_ORA, K_AND, K_EOR, K_ADC, K_SBC, K_CMP, K_CPX, K_CPY, K_BIT,
+    K_ASL, K_LSR, K_ROL, K_ROR, K_INC, K_DEC,
+    K_INX, K_INY, K_DEX, K_DEY,
+    K_TAX, K_TAY, K_TXA, K_TYA, K_TSX, K_TXS,
+    K_CLC, K_SEC, K_CLD, K_SED, K_CLV, K_SEI,
+    K_PHA, K_PHP, K_PLA,
+    K_JMP, K_JSR, K_RTS, K_BRANCH,
+} jit_kind_t;
+
+typedef struct
+{
+    uint8_t kind, mode, len;
+} jit_insn_t;
+
+static jit_insn_t s_insn[256];
+static int        s_insn_built;
+
+static void build_insn_table(void)
+{
+    static const struct { const char* mn; uint8_t kind; } names[] = {
+        {"NOP", K_NOP}, {"LDA", K_LDA}, {"LDX", K_LDX}, {"LDY", K_LDY},
+        {"STA", K_STA}, {"STX", K_STX}, {"STY", K_STY},
+        {"ORA", K_ORA}, {"AND", K_AND}, {"EOR", K_EOR}, {"ADC", K_ADC}, {"SBC", K_SBC},
+        {"CMP", K_CMP}, {"CPX", K_CPX}, {"CPY", K_CPY}, {"BIT", K_BIT},
+        {"ASL", K_ASL}, {"LSR", K_LSR}, {"ROL", K_ROL}, {"ROR", K_ROR},
+        {"INC", K_INC}, {"DEC", K_DEC}, {"INX", K_INX}, {"INY", K_INY},
+        {"DEX", K_DEX}, {"DEY", K_DEY},
+        {"TAX", K_TAX}, {"TAY", K_TAY}, {"TXA", K_TXA}, {"TYA", K_TYA},
+        {"TSX", K_TSX}, {"TXS", K_TXS},
+        {"CLC", K_CLC}, {"SEC", K_SEC}, {"CLD", K_CLD}, {"SED", K_SED},
+        {"CLV", K_CLV}, {"SEI", K_SEI},
+        {"PHA", K_PHA}, {"PHP", K_PHP}, {"PLA", K_PLA},
+        {"JMP", K_JMP}, {"JSR", K_JSR}, {"RTS", K_RTS},
+        {"BPL", K_BRANCH}, {"BMI", K_BRANCH}, {"BVC", K_BRANCH}, {"BVS", K_BRANCH},
+        {"BCC", K_BRANCH}, {"BCS", K_BRANCH}, {"BNE", K_BRANCH}, {"BEQ", K_BRANCH},
+    };
+
+    for (int op = 0; op < 256; ++op) {
+        jit_insn_t* d = &s_insn[op];
+        memset(d, 0, sizeof *d);
+        if (cpu_dispatch[op] == op_illegal) { // 1-byte NOP, as in the other cores
+            d->kind = K_NOP;
+            d->mode = CPU_AM_IMP;
+            d->len  = 1;
+            continue;
+        }
+        for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i) {
+            if (strcmp(cpu_mnemonic[op], names[i].mn) == 0) { d->kind = names[i].kind; break; }
+        }
+        d->mode = cpu_addrmode_id[op];
+        d->len = cpu_instr_len[op];
+        if (d->kind == K_JMP && d->mode == CPU_AM_IND) d->kind = K_NONE;
+    }
+    s_insn_built = 1;
+}
+
+// -----------------------------------------------------------------------------
+// Emitter
+//
+// Register use inside a block: RDI = ctx, ECX = effective address, RSI/R9 =
+// host page for reads/writes, EDX = offset in page, EAX = operand byte,
+// R8D = un-indexed base (page-cross test), R10B/R11D = carry scratch.
+// All are caller-saved, and blocks call nothing, so there is no prologue.
+// -----------------------------------------------------------------------------
+static uint8_t* s_e;
+
+static void emit_bytes(const uint8_t* b, size_t n)
+{
+    memcpy(s_e, b, n);
+    s_e += n;
+}
+#define EMIT(...) emit_bytes((const uint8_t[]){ __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ }))
+
+static void emit32(uint32_t v) { EMIT((uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)); }
+
+// Where an early exit resumes: the instruction being translated and the base
+// cycles of the instructions before it.
+static uint16_t s_at_pc;
+static uint32_t s_at_cycles;
+
+// ctx->pc = pc; ctx->cycles += cycles; return
+static void emit_exit(uint16_t pc, uint32_t cycles)
+{
+    EMIT(0x66, 0xC7, 0x47, CTX(pc), (uint8_t)pc, (uint8_t)(pc >> 8)); // mov word [rdi+pc], imm16
+    if (cycles) {
+        EMIT(0x48, 0x81, 0x47, CTX(cycles));                         // add qword [rdi+cycles], imm32
+        emit32(cycles);
+    }
+    EMIT(0xC3);                                                      // ret
+}
+
+// After a `test reg, reg`: leave the block before the current instruction
+// when the page pointer was NULL.
+static void emit_bail_if_zero(void)
+{
+    EMIT(0x75, 0x00);                        // jnz over
+    uint8_t* patch = s_e - 1;
+    EMIT(0xC6, 0x47, CTX(bail), 0x01);       // mov byte [rdi+bail], 1
+    emit_exit(s_at_pc, s_at_cycles);
+    *patch = (uint8_t)(s_e - patch - 1);
+}
+
+// Fold the x86 flags of the last ALU op into P under `mask` (6502 bits).
+// RFLAGS: CF bit 0, ZF bit 6, SF bit 7, OF bit 11.
+static void emit_capture_flags(uint8_t mask)
+{
+    EMIT(0x9C,                               // pushfq
+         0x58,                               // pop rax
+         0x89, 0xC1,                         // mov ecx, eax
+         0x81, 0xE1, 0x81, 0x00, 0x00, 0x00, // and ecx, 0x81       (N, C)
+         0xC1, 0xE8, 0x05,                   // shr eax, 5
+         0x83, 0xE0, 0x42,                   // and eax, 0x42       (V, Z)
+         0x09, 0xC8,                         // or eax, ecx
+         0x8A, 0x57, CTX(p),                 // mov dl, [rdi+p]
+         0x80, 0xE2, (uint8_t)~mask,         // and dl, ~mask
+         0x24, mask,                         // and al, mask
+         0x08, 0xC2,                         // or dl, al
+         0x88, 0x57, CTX(p));                // mov [rdi+p], dl
+}
+
+// Carry kept in R10B by ROL/ROR (their rcl/rcr leaves SF/ZF untouched).
+static void emit_fix_carry(void)
+{
+    EMIT(0x80, 0x67, CTX(p), 0xFE,           // and byte [rdi+p], ~C
+         0x44, 0x08, 0x57, CTX(p));          // or [rdi+p], r10b
+}
+
+// ECX = (zp[ptr] | zp[ptr+1] << 8), ptr in AL (wraps in page zero).
+static void emit_zp_pointer(void)
+{
+    EMIT(0x48, 0x8B, 0x77, CTX(rdp),         // mov rsi, [rdi+rdp]
+         0x48, 0x8B, 0x36,                   // mov rsi, [rsi]
+         0x48, 0x85, 0xF6);                  // test rsi, rsi
+    emit_bail_if_zero();
+    EMIT(0x0F, 0xB6, 0x0C, 0x06,             // movzx ecx, byte [rsi+rax]
+         0xFE, 0xC0,                         // inc al
+         0x0F, 0xB6, 0x14, 0x06,             // movzx edx, byte [rsi+rax]
+         0xC1, 0xE2, 0x08,                   // shl edx, 8
+         0x09, 0xD1);                        // or ecx, edx
+}
+
+// Effective address into ECX; indexed modes that can cross a page leave the
+// un-indexed base in R8D.
+static void emit_ea(uint8_t mode, uint16_t operand)
+{
+    const uint8_t lo = (uint8_t)operand;
+    switch (mode) {
+        case CPU_AM_ZP:
+        case CPU_AM_ABS:
+            EMIT(0xB9); emit32(operand);                      // mov ecx, imm32
+            break;
+        case CPU_AM_ZPX:
+        case CPU_AM_ZPY:
+            EMIT(0x0F, 0xB6, 0x4F, mode == CPU_AM_ZPX ? CTX(x) : CTX(y), // movzx ecx, byte [rdi+x/y]
+                 0x80, 0xC1, lo);                                   // add cl, imm8
+            break;
+        case CPU_AM_ABX:
+        case CPU_AM_ABY:
+            EMIT(0x41, 0xB8); emit32(operand);                      // mov r8d, base
+            EMIT(0x0F, 0xB6, 0x4F, mode == CPU_AM_ABX ? CTX(x) : CTX(y)); // movzx ecx, byte [rdi+x/y]
+            EMIT(0x81, 0xC1); emit32(operand);                      // add ecx, base
+            EMIT(0x81, 0xE1, 0xFF, 0xFF, 0x00, 0x00);               // and ecx, 0xFFFF
+            break;
+        case CPU_AM_INX:
+            EMIT(0x0F, 0xB6, 0x47, CTX(x),                          // movzx eax, byte [rdi+x]
+                 0x04, lo);                                         // add al, imm8
+            emit_zp_pointer();
+            break;
+        case CPU_AM_INY:
+            EMIT(0xB8); emit32(lo);                                 // mov eax, imm32
+            emit_zp_pointer();
+            EMIT(0x41, 0x89, 0xC8,                                  // mov r8d, ecx
+                 0x0F, 0xB6, 0x47, CTX(y),                          // movzx eax, byte [rdi+y]
+                 0x01, 0xC1,                                        // add ecx, eax
+                 0x81, 0xE1, 0xFF, 0xFF, 0x00, 0x00);               // and ecx, 0xFFFF
+            break;
+        default:
+            break;
+    }
+}
+
+// RSI = read page for ECX (bails when NULL), EDX = offset in page.
+static void emit_read_page(void)
+{
+    EMIT(0x89, 0xCA,                         // mov edx, ecx
+         0xC1, 0xEA, 0x08,                   // shr edx, 8
+         0x48, 0x8B, 0x77, CTX(rdp),         // mov rsi, [rdi+rdp]
+         0x48, 0x8B, 0x34, 0xD6,             // mov rsi, [rsi+rdx*8]
+         0x48, 0x85, 0xF6);                  // test rsi, rsi
+    emit_bail_if_zero();
+    EMIT(0x0F, 0xB6, 0xD1);                  // movzx edx, cl
+}
+
+// R9 = write page for ECX (bails when NULL), EDX = offset in page.
+static void emit_write_page(void)
+{
+    EMIT(0x89, 0xCA,                         // mov edx, ecx
+         0xC1, 0xEA, 0x08,                   // shr edx, 8
+         0x4C, 0x8B, 0x4F, CTX(wrp),         // mov r9, [rdi+wrp]
+         0x4D, 0x8B, 0x0C, 0xD1,             // mov r9, [r9+rdx*8]
+         0x4D, 0x85, 0xC9);                  // test r9, r9
+    emit_bail_if_zero();
+    EMIT(0x0F, 0xB6, 0xD1);                  // movzx edx, cl
+}
+
+// Both pages, checked before anything is modified.
+static void emit_rmw_pages(void)
+{
+    EMIT(0x89, 0xCA,                         // mov edx, ecx
+         0xC1, 0xEA, 0x08,                   // shr edx, 8
+         0x48, 0x8B, 0x77, CTX(rdp),         // mov rsi, [rdi+rdp]
+         0x48, 0x8B, 0x34, 0xD6,             // mov rsi, [rsi+rdx*8]
+         0x4C, 0x8B, 0x4F, CTX(wrp),         // mov r9, [rdi+wrp]
+         0x4D, 0x8B, 0x0C, 0xD1,             // mov r9, [r9+rdx*8]
+         0x48, 0x85, 0xF6);                  // test rsi, rsi
+    emit_bail_if_zero();
+    EMIT(0x4D, 0x85, 0xC9);                  // test r9, r9
+    emit_bail_if_zero();
+    EMIT(0x0F, 0xB6, 0xD1);                  // movzx edx, cl
+}
+
+#define EMIT_LOAD_BYTE()  EMIT(0x0F, 0xB6, 0x04, 0x16)   // movzx eax, byte [rsi+rdx]
+#define EMIT_STORE_BYTE() EMIT(0x41, 0x88, 0x04, 0x11)   // mov [r9+rdx], al
+
+// +1 cycle when the indexed address left the base's page.
+static void emit_cross_penalty(void)
+{
+    EMIT(0x41, 0x31, 0xC8,                                // xor r8d, ecx
+         0x41, 0xF7, 0xC0, 0x00, 0xFF, 0x00, 0x00,        // test r8d, 0xFF00
+         0x0F, 0x95, 0xC2,                                // setnz dl
+         0x0F, 0xB6, 0xD2,                                // movzx edx, dl
+         0x48, 0x01, 0x57, CTX(cycles));                  // add [rdi+cycles], rdx
+}
+
+// Stack page pointers (page 1).
+static void emit_stack_write_page(void)
+{
+    EMIT(0x4C, 0x8B, 0x4F, CTX(wrp),         // mov r9, [rdi+wrp]
+         0x4D, 0x8B, 0x49, 0x08,             // mov r9, [r9+8]
+         0x4D, 0x85, 0xC9);                  // test r9, r9
+    emit_bail_if_zero();
+    EMIT(0x0F, 0xB6, 0x57, CTX(sp));         // movzx edx, byte [rdi+sp]
+}
+
+static void emit_stack_read_page(void)
+{
+    EMIT(0x48, 0x8B, 0x77, CTX(rdp),         // mov rsi, [rdi+rdp]
+         0x48, 0x8B, 0x76, 0x08,             // mov rsi, [rsi+8]
+         0x48, 0x85, 0xF6);                  // test rsi, rsi
+    emit_bail_if_zero();
+    EMIT(0x0F, 0xB6, 0x57, CTX(sp));         // movzx edx, byte [rdi+sp]
+}
+
+static uint8_t reg_field(uint8_t kind)
+{
+    switch (kind) {
+        case K_LDX: case K_STX: case K_CPX: return CTX(x);
+        case K_LDY: case K_STY: case K_CPY: return CTX(y);
+        default:                            return CTX(a);
+    }
+}
+
+// Operation on the operand byte in AL (read-type instructions).
+static void emit_read_op(uint8_t kind)
+{
+    const uint8_t r = reg_field(kind);
+    switch (kind) {
+        case K_LDA: case K_LDX: case K_LDY:
+            EMIT(0x88, 0x47, r,                  // mov [rdi+r], al
+                 0x84, 0xC0);                    // test al, al
+            emit_capture_flags(FLAG_N | FLAG_Z);
+            break;
+        case K_ORA: case K_AND: case K_EOR:
+            EMIT(kind == K_ORA ? 0x0A : kind == K_AND ? 0x22 : 0x32, 0x47, CTX(a), // op al, [rdi+a]
+                 0x88, 0x47, CTX(a));                                           // mov [rdi+a], al
+            emit_capture_flags(FLAG_N | FLAG_Z);
+            break;
+        case K_ADC:
+            EMIT(0x0F, 0xB6, 0x57, CTX(p),       // movzx edx, byte [rdi+p]
+                 0xD1, 0xEA,                     // shr edx, 1        (CF = C)
+                 0x8A, 0x57, CTX(a),             // mov dl, [rdi+a]
+                 0x10, 0xC2,                     // adc dl, al
+                 0x88, 0x57, CTX(a));            // mov [rdi+a], dl
+            emit_capture_flags(FLAG_N | FLAG_V | FLAG_Z | FLAG_C);
+            break;
+        case K_SBC:
+            EMIT(0x0F, 0xB6, 0x57, CTX(p),       // movzx edx, byte [rdi+p]
+                 0xD1, 0xEA,                     // shr edx, 1
+                 0xF5,                           // cmc              (CF = borrow)
+                 0x8A, 0x57, CTX(a),             // mov dl, [rdi+a]
+                 0x18, 0xC2,                     // sbb dl, al
+                 0x88, 0x57, CTX(a),             // mov [rdi+a], dl
+                 0xF5);                          // cmc              (C = !borrow)
+            emit_capture_flags(FLAG_N | FLAG_V | FLAG_Z | FLAG_C);
+            break;
+        case K_CMP: case K_CPX: case K_CPY:
+            EMIT(0x8A, 0x57, r,                  // mov dl, [rdi+r]
+                 0x38, 0xC2,                     // cmp dl, al
+                 0xF5);                          // cmc
+            emit_capture_flags(FLAG_N | FLAG_Z | FLAG_C);
+            break;
+        case K_BIT:
+            EMIT(0x8A, 0x57, CTX(a),             // mov dl, [rdi+a]
+                 0x84, 0xC2,                     // test dl, al
+                 0x0F, 0x94, 0xC2,               // setz dl
+                 0x00, 0xD2,                     // add dl, dl       (Z)
+                 0x24, 0xC0,                     // and al, 0xC0     (N, V)
+                 0x08, 0xD0,                     // or al, dl
+                 0x8A, 0x57, CTX(p),             // mov dl, [rdi+p]
+                 0x80, 0xE2, (uint8_t)~(FLAG_N | FLAG_V | FLAG_Z),
+                 0x08, 0xC2,                     // or dl, al
+                 0x88, 0x57, CTX(p));            // mov [rdi+p], dl
+            break;
+        default:
+            break;
+    }
+}
+
+// Shift/rotate/inc/dec of AL; leaves x86 flags ready for the capture.
+// ROL/ROR additionally leave the new carry in R10B.
+static void emit_modify(uint8_t kind)
+{
+    switch (kind) {
+        case K_ASL: EMIT(0xD0, 0xE0); break;     // shl al, 1
+        case K_LSR: EMIT(0xD0, 0xE8); break;     // shr al, 1
+        case K_INC: EMIT(0xFE, 0xC0); break;     // inc al
+        case K_DEC: EMIT(0xFE, 0xC8); break;     // dec al
+        case K_ROL:
+        case K_ROR:
+            EMIT(0x44, 0x0F, 0xB6, 0x5F, CTX(p), // movzx r11d, byte [rdi+p]
+                 0x41, 0xD1, 0xEB,               // shr r11d, 1      (CF = C)
+                 0xD0, kind == K_ROL ? 0xD0 : 0xD8, // rcl/rcr al, 1
+                 0x41, 0x0F, 0x92, 0xC2);        // setc r10b
+            break;
+        default:
+            break;
+    }
+}
+
+static void emit_modify_flags(uint8_t kind)
+{
+    if (kind == K_ROL || kind == K_ROR) {
+        EMIT(0x84, 0xC0);                        // test al, al
+        emit_capture_flags(FLAG_N | FLAG_Z);
+        emit_fix_carry();
+    } else if (kind == K_ASL || kind == K_LSR) {
+        emit_capture_flags(FLAG_N | FLAG_Z | FLAG_C);
+    } else {
+        emit_capture_flags(FLAG_N | FLAG_Z);
+    }
+}
+
+// Register transfers: dst = src, N/Z from the value (except TXS).
+static void emit_transfer(uint8_t src, uint8_t dst, int flags)
+{
+    EMIT(0x8A, 0x47, src,                        // mov al, [rdi+src]
+         0x88, 0x47, dst);                       // mov [rdi+dst], al
+    if (flags) {
+        EMIT(0x84, 0xC0);                        // test al, al
+        emit_capture_flags(FLAG_N | FLAG_Z);
+    }
+}
+
+static void emit_flag_op(uint8_t mask, int set)
+{
+    if (set) EMIT(0x80, 0x4F, CTX(p), mask);                 // or byte [rdi+p], mask
+    else     EMIT(0x80, 0x67, CTX(p), (uint8_t)~mask);       // and byte [rdi+p], ~mask
+}
+
+// Absolute operands the interpreter should take: PPU/APU/IO and expansion.
+static int static_io(uint8_t mode, uint16_t operand)
+{
+    if (mode != CPU_AM_ABS && mode != CPU_AM_ABX && mode != CPU_AM_ABY) return 0;
+    return operand >= 0x2000 && operand < 0x6000;
+}
+
+static int is_read_kind(uint8_t kind)
+{
+    switch (kind) {
+        case K_LDA: case K_LDX: case K_LDY: case K_ORA: case K_AND: case K_EOR:
+        case K_ADC: case K_SBC: case K_CMP: case K_CPX: case K_CPY: case K_BIT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Translate the block starting at `pc` (host page `page`). Returns 0 when its
+// first instruction already has to be interpreted.
+static int translate(uint16_t pc, const uint8_t* page, jit_block_t* blk)
+{
+    uint8_t* const start = s_e;
+    uint32_t cycles = 0, extra = 0;
+    unsigned off = pc & 0xFF;
+    uint16_t end_pc = pc;
+    int n = 0;
+
+    for (;;) {
+        if (off >= JIT_PAGE || n == JIT_MAX_INSNS) break;
+
+        const uint8_t     op = page[off];
+        const jit_insn_t* d  = &s_insn[op];
+        if (d->kind == K_NONE || off + d->len > JIT_PAGE) break;
+
+        const uint16_t at      = (uint16_t)((pc & 0xFF00) | off);
+        const uint16_t next    = (uint16_t)(at + d->len);
+        const uint16_t operand = (uint16_t)((d->len > 1 ? page[off + 1] : 0) |
+                                            (d->len > 2 ? page[off + 2] << 8 : 0));
+        if (static_io(d->mode, operand)) break;
+
+        s_at_pc     = at;
+        s_at_cycles = cycles;
+        cycles += cpu_base_cycles[op];
+        ++n;
+        off += d->len;
+        end_pc = next;
+
+        const uint8_t kind = d->kind;
+        if (is_read_kind(kind)) {
+            if (d->mode == CPU_AM_IMM) {
+                EMIT(0xB8); emit32(operand);      // mov eax, imm32
+            } else {
+                emit_ea(d->mode, operand);
+                emit_read_page();
+                EMIT_LOAD_BYTE();
+                if (d->mode == CPU_AM_ABX || d->mode == CPU_AM_ABY || d->mode == CPU_AM_INY) {
+                    emit_cross_penalty();
+                    extra += 1;
+                }
+            }
+            emit_read_op(kind);
+            continue;
+        }
+
+        switch (kind) {
+            case K_NOP:
+                break;
+
+            case K_STA: case K_STX: case K_STY:
+                emit_ea(d->mode, operand);
+                emit_write_page();
+                EMIT(0x8A, 0x47, reg_field(kind)); // mov al, [rdi+r]
+                EMIT_STORE_BYTE();
+                break;
+
+            case K_ASL: case K_LSR: case K_ROL: case K_ROR: case K_INC: case K_DEC:
+                if (d->mode == CPU_AM_ACC) {
+                    EMIT(0x8A, 0x47, CTX(a));     // mov al, [rdi+a]
+                    emit_modify(kind);
+                    EMIT(0x88, 0x47, CTX(a));     // mov [rdi+a], al
+                } else {
+                    emit_ea(d->mode, operand);
+                    emit_rmw_pages();
+                    EMIT_LOAD_BYTE();
+                    emit_modify(kind);
+                    EMIT_STORE_BYTE();
+                }
+                emit_modify_flags(kind);
+                break;
+
+            case K_INX: case K_DEX: case K_INY: case K_DEY:
+                EMIT(0xFE, (kind == K_INX || kind == K_INY) ? 0x47 : 0x4F, // inc/dec byte [rdi+r]
+                     (kind == K_INX || kind == K_DEX) ? CTX(x) : CTX(y));
+                emit_capture_flags(FLAG_N | FLAG_Z);
+                break;
+
+            case K_TAX: emit_transfer(CTX(a),  CTX(x),  1); break;
+            case K_TAY: emit_transfer(CTX(a),  CTX(y),  1); break;
+            case K_TXA: emit_transfer(CTX(x),  CTX(a),  1); break;
+            case K_TYA: emit_transfer(CTX(y),  CTX(a),  1); break;
+            case K_TSX: emit_transfer(CTX(sp), CTX(x),  1); break;
+            case K_TXS: emit_transfer(CTX(x),  CTX(sp), 0); break;
+
+            case K_CLC: emit_flag_op(FLAG_C, 0); break;
+            case K_SEC: emit_flag_op(FLAG_C, 1); break;
+            case K_CLD: emit_flag_op(FLAG_D, 0); break;
+            case K_SED: emit_flag_op(FLAG_D, 1); break;
+            case K_CLV: emit_flag_op(FLAG_V, 0); break;
+            case K_SEI: emit_flag_op(FLAG_I, 1); break;
+
+            case K_PHA:
+            case K_PHP:
+                emit_stack_write_page();
+                if (kind == K_PHA) EMIT(0x8A, 0x47, CTX(a));             // mov al, [rdi+a]
+                else               EMIT(0x8A, 0x47, CTX(p),              // mov al, [rdi+p]
+                                        0x0C, FLAG_B | FLAG_U);          // or al, B|U
+                EMIT_STORE_BYTE();
+                EMIT(0xFE, 0xCA,                                         // dec dl
+                     0x88, 0x57, CTX(sp));                               // mov [rdi+sp], dl
+                break;
+
+            case K_PLA:
+                emit_stack_read_page();
+                EMIT(0xFE, 0xC2,                                         // inc dl
+                     0x0F, 0xB6, 0x04, 0x16,                             // movzx eax, byte [rsi+rdx]
+                     0x88, 0x57, CTX(sp),                                // mov [rdi+sp], dl
+                     0x88, 0x47, CTX(a),                                 // mov [rdi+a], al
+                     0x84, 0xC0);                                        // test al, al
+                emit_capture_flags(FLAG_N | FLAG_Z);
+                break;
+
+            case K_JMP:
+                emit_exit(operand, cycles);
+                goto done;
+
+            case K_JSR: {
+                const uint16_t ret = (uint16_t)(next - 1);
+                emit_stack_write_page();
+                EMIT(0x41, 0xC6, 0x04, 0x11, (uint8_t)(ret >> 8),       // mov byte [r9+rdx], hi
+                     0xFE, 0xCA,                                         // dec dl
+                     0x41, 0xC6, 0x04, 0x11, (uint8_t)ret,               // mov byte [r9+rdx], lo
+                     0xFE, 0xCA,                                         // dec dl
+                     0x88, 0x57, CTX(sp));                               // mov [rdi+sp], dl
+                emit_exit(operand, cycles);
+                goto done;
+            }
+
+            case K_RTS:
+                emit_stack_read_page();
+                EMIT(0xFE, 0xC2,                                         // inc dl
+                     0x0F, 0xB6, 0x04, 0x16,                             // movzx eax, byte [rsi+rdx]
+                     0xFE, 0xC2,                                         // inc dl
+                     0x0F, 0xB6, 0x0C, 0x16,                             // movzx ecx, byte [rsi+rdx]
+                     0x88, 0x57, CTX(sp),                                // mov [rdi+sp], dl
+                     0xC1, 0xE1, 0x08,                                   // shl ecx, 8
+                     0x09, 0xC8,                                         // or eax, ecx
+                     0xFF, 0xC0,                                         // inc eax
+                     0x66, 0x89, 0x47, CTX(pc),                          // mov [rdi+pc], ax
+                     0x48, 0x81, 0x47, CTX(cycles));                     // add qword [rdi+cycles], imm32
+                emit32(cycles);
+                EMIT(0xC3);                                              // ret
+                goto done;
+
+            case K_BRANCH: {
+                static const uint8_t flag_of[4] = { FLAG_N, FLAG_V, FLAG_C, FLAG_Z };
+                const uint8_t  flag   = flag_of[op >> 6];
+                const int      if_set = (op & 0x20) != 0;
+                const uint16_t target = (uint16_t)(next + (int8_t)operand);
+                const uint32_t taken  = 1u + (((next ^ target) & 0xFF00) != 0);
+
+                EMIT(0xF6, 0x47, CTX(p), flag,                           // test byte [rdi+p], flag
+                     if_set ? 0x74 : 0x75, 0x00);                        // jz/jnz not_taken
+                uint8_t* patch = s_e - 1;
+                emit_exit(target, cycles + taken);
+                *patch = (uint8_t)(s_e - patch - 1);
+                emit_exit(next, cycles);
+                extra += taken;
+                goto done;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (n == 0) {
+        s_e = start;
+        return 0;
+    }
+    emit_exit(end_pc, cycles);
+
+done:
+    {
+        void* entry = start;
+        memcpy(&blk->fn, &entry, sizeof blk->fn);
+    }
+    blk->max_cycles = (uint16_t)(cycles + extra);
+    blk->state      = JIT_READY;
+    s_stats.blocks++;
+    return 1;
+}
+
+// -----------------------------------------------------------------------------
+// Code buffer / block tables
+// -----------------------------------------------------------------------------
+static int code_init(void)
+{
+    if (s_code) return 1;
+    if (s_code_failed) return 0;
+    void* p = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) { s_code_failed = 1; return 0; } // W^X system: interpret
+    s_code = (uint8_t*)p;
+    s_code_used = 0;
+    return 1;
+}
+
+void cpu_jit_flush(void)
+{
+    if (s_blocks) {
+        for (size_t i = 0; i < s_rom_pages; ++i) {
+            if (s_blocks[i]) memset(s_blocks[i], 0, JIT_PAGE * sizeof **s_blocks);
+        }
+    }
+    s_code_used = 0;
+}
+
+void cpu_jit_add_rom(const uint8_t* mem, size_t len)
+{
+    if (s_blocks) {
+        for (size_t i = 0; i < s_rom_pages; ++i) free(s_blocks[i]);
+        free(s_blocks);
+    }
+    s_blocks    = NULL;
+    s_rom       = NULL;
+    s_rom_pages = 0;
+    s_code_used = 0;
+    if (!mem || len < JIT_PAGE) return;
+    s_blocks = (jit_block_t**)calloc(len / JIT_PAGE, sizeof *s_blocks);
+    if (!s_blocks) return;
+    s_rom       = mem;
+    s_rom_pages = len / JIT_PAGE;
+}
+
+int cpu_jit_available(void)
+{
+    return code_init();
+}
+
+// Block for `pc`, translating it on first use; NULL when the code there is
+// not in PRG-ROM or starts with an instruction the interpreter must run.
+static const jit_block_t* block_for(uint16_t pc, const uint8_t* const* rdp)
+{
+    const uint8_t* host = rdp[pc >> 8];
+    if (!host || !s_blocks || host < s_rom || host >= s_rom + s_rom_pages * JIT_PAGE) return NULL;
+    const size_t rel = (size_t)(host - s_rom);
+    if (rel % JIT_PAGE) return NULL;
+
+    jit_block_t** slot = &s_blocks[rel / JIT_PAGE];
+    if (!*slot) {
+        *slot = (jit_block_t*)calloc(JIT_PAGE, sizeof **slot);
+        if (!*slot) return NULL;
+    }
+    jit_block_t* b = &(*slot)[pc & 0xFF];
+    if (b->state == JIT_READY) return b;
+    if (b->state == JIT_NONE) return NULL;
+
+    if (!code_init()) return NULL;
+    if (!s_insn_built) build_insn_table();
+    if (JIT_CODE_SIZE - s_code_used < JIT_BLOCK_ROOM) {
+        cpu_jit_flush();     // drops `b` too; it is still the slot to fill
+        s_stats.flushes++;
+    }
+    s_e = s_code + s_code_used;
+    if (!translate(pc, host, b)) {
+        b->state = JIT_NONE;
+        return NULL;
+    }
+    s_code_used = (size_t)(s_e - s_code);
+    return b;
+}
+
+// -----------------------------------------------------------------------------
+// Execution
+// -----------------------------------------------------------------------------
+static void ctx_load(jit_ctx_t* c)
+{
+    c->cycles = cpu_get_cycles();
+    c->pc = cpu_get_pc();
+    c->a  = cpu_get_a();
+    c->x  = cpu_get_x();
+    c->y  = cpu_get_y();
+    c->p  = cpu_get_p();
+    c->sp = cpu_get_sp();
+}
+
+static void ctx_store(const jit_ctx_t* c)
+{
+    cpu_set_cycles(c->cycles);
+    cpu_set_pc(c->pc);
+    cpu_set_a(c->a);
+    cpu_set_x(c->x);
+    cpu_set_y(c->y);
+    cpu_set_p(c->p);
+    cpu_set_sp(c->sp);
+}
+
+int cpu_jit_run(int budget)
+{
+    if (budget <= 0) return 0;
+
+    jit_ctx_t c;
+    c.rdp = bus_read_pages();
+    c.wrp = bus_write_pages();
+    ctx_load(&c);
+    const uint64_t start = c.cycles;
+    const uint64_t end   = start + (uint64_t)budget;
+    int loaded = 1;
+
+    for (;;) {
+        if (!loaded) { ctx_load(&c); loaded = 1; }
+        if (c.cycles >= end || cpu_yield_take()) break;
+
+        const jit_block_t* b = NULL;
+        if (c.rdp && c.wrp && !g_cpu_hooks && !cpu_nmi_pending() &&
+            !(cpu_irq_line_asserted() && !(c.p & FLAG_I))) {
+            b = block_for(c.pc, c.rdp);
+        }
+        if (b && c.cycles + b->max_cycles <= end) {
+            const uint64_t c0 = c.cycles;
+            c.bail = 0;
+            b->fn(&c);
+            s_stats.block_runs++;
+            s_stats.jit_cycles += c.cycles - c0;
+            if (!c.bail) continue;
+            s_stats.bailouts++;
+        }
+
+        // Interrupt entry, I/O access, untranslatable code or a block that
+        // would overrun the budget: one instruction on the reference core.
+        ctx_store(&c);
+        loaded = 0;
+        cpu_step();
+    }
+    if (loaded) ctx_store(&c);
+
+    s_stats.total_cycles += c.cycles - start;
+    return (int)(c.cycles - start);
+}
+
+#endif // CPU_JIT_NATIVE
@@ -0,0 +1,457 @@
+// cpu_prof.c — per-PC execution profiler
+//
+// Counts instructions and cycles per instruction address. The instruction
+// hook runs before each opcode fetch, so the cycles between two hooks belong
+// to the earlier instruction: base cycles, page-cross and branch penalties,
+// and any stall it caused (OAM DMA, also counted separately). Interrupt entry
+// (7 cycles) gets a row of its own.
+//
+// PRG-ROM code is keyed by its offset in the ROM image, like the decoded
+// instruction cache, so two banks that run at the same CPU address are kept
+// apart; everything else (RAM, PRG-RAM) is keyed by CPU address.
+//
+// A shadow call stack follows JSR, BRK and interrupts, and pops frames when
+// RTS/RTI leaves the stack pointer above the frame's entry SP. That keeps the
+// stack right across the usual "push address, RTS" jump tables. Cycles are
+// also summed per call path, for a flamegraph.pl compatible folded file.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "cpu_internal.h"
+
+#define PROF_BANK_SIZE 0x2000 // banks are reported in 8 KB units
+#define PROF_MAX_DEPTH 64
+#define PROF_ROOT      0u
+
+typedef struct
+{
+    uint64_t insns, cycles, dma;
+    uint16_t pc; // CPU address it last ran at
+} prof_slot_t;
+
+typedef struct
+{
+    uint32_t parent;
+    uint32_t func;   // ROM offset | PROF_ROM_KEY, or CPU address
+    uint16_t pc;     // entry address, for names
+    uint64_t cycles; // self cycles on this call path
+} prof_node_t;
+
+#define PROF_ROM_KEY 0x80000000u
+
+typedef struct
+{
+    uint32_t node;
+    uint8_t  sp; // SP at entry; the frame is gone once SP rises above it
+} prof_frame_t;
+
+enum { PUSH_NONE = 0, PUSH_CALL, PUSH_INTERRUPT };
+
+static const uint8_t* s_rom;
+static size_t         s_rom_len;
+
+static prof_slot_t* s_rom_slots;  // [s_rom_len]
+static prof_slot_t* s_cpu_slots;  // [0x10000]
+static prof_slot_t  s_irq_slots[2]; // interrupt entry: [0] IRQ, [1] NMI
+
+static prof_node_t* s_nodes;
+static uint32_t     s_n_nodes, s_cap_nodes;
+static uint32_t*    s_child_map; // open addressing: node ids, 0 = empty
+static uint32_t     s_map_mask;
+
+static prof_frame_t s_stack[PROF_MAX_DEPTH];
+static int          s_depth;
+
+static prof_slot_t* s_cur;      // instruction whose cycles are being counted
+static uint64_t     s_last_cyc;
+static int          s_pending;  // PUSH_*: enter a frame at the next instruction
+static uint8_t      s_prev_op;
+
+static char**       s_labels;   // [0x10000], NULL until a label file loads
+
+// -----------------------------------------------------------------------------
+// Call-path nodes
+// -----------------------------------------------------------------------------
+static uint32_t child_hash(uint32_t parent, uint32_t func)
+{
+    uint32_t h = parent * 0x9E3779B1u ^ func * 0x85EBCA77u;
+    return h ^ (h >> 15);
+}
+
+static int map_grow(void)
+{
+    const uint32_t cap = s_map_mask ? (s_map_mask + 1) * 2 : 1024;
+    uint32_t* map = (uint32_t*)calloc(cap, sizeof *map);
+    if (!map) return 0;
+    for (uint32_t i = 1; i < s_n_nodes; ++i) {
+        uint32_t h = child_hash(s_nodes[i].parent, s_nodes[i].func) & (cap - 1);
+        while (map[h]) h = (h + 1) & (cap - 1);
+        map[h] = i;
+    }
+    free(s_child_map);
+    s_child_map = map;
+    s_map_mask  = cap - 1;
+    return 1;
+}
+
+// Node for `func` called from `parent`; the parent itself if out of memory.
+static uint32_t node_child(uint32_t parent, uint32_t func, uint16_t pc)
+{
+    uint32_t h = child_hash(parent, func) & s_map_mask;
+    for (uint32_t id; (id = s_child_map[h]) != 0; h = (h + 1) & s_map_mask) {
+        if (s_nodes[id].parent == parent && s_nodes[id].func == func) return id;
+    }
+
+    if (s_n_nodes > s_map_mask) return parent; // map full and could not grow
+    if (s_n_nodes == s_cap_nodes) {
+        const uint32_t cap = s_cap_nodes * 2;
+        prof_node_t* nodes = (prof_node_t*)realloc(s_nodes, cap * sizeof *nodes);
+        if (!nodes) return parent;
+        s_nodes = nodes;
+        s_cap_nodes = cap;
+    }
+    const uint32_t id = s_n_nodes++;
+    s_nodes[id] = (prof_node_t){ parent, func, pc, 0 };
+    s_child_map[h] = id;
+    if (s_n_nodes * 2 > s_map_mask + 1) map_grow(); // on failure the old map just fills up
+    return id;
+}
+
+static uint32_t cur_node(void) { return s_depth ? s_stack[s_depth - 1].node : PROF_ROOT; }
+
+// -----------------------------------------------------------------------------
+// Lifecycle
+// -----------------------------------------------------------------------------
+static void free_counters(void)
+{
+    free(s_rom_slots); s_rom_slots = NULL;
+    free(s_cpu_slots); s_cpu_slots = NULL;
+    free(s_nodes);     s_nodes = NULL;
+    free(s_child_map); s_child_map = NULL;
+    s_n_nodes = s_cap_nodes = s_map_mask = 0;
+}
+
+void cpu_prof_add_rom(const uint8_t* mem, size_t len)
+{
+    const int was_on = cpu_prof_active();
+    cpu_prof_stop();
+    s_rom     = mem;
+    s_rom_len = mem ? len : 0;
+    free_counters();
+    if (was_on) cpu_prof_start();
+}
+
+int cpu_prof_start(void)
+{
+    free_counters();
+    s_cpu_slots = (prof_slot_t*)calloc(0x10000, sizeof *s_cpu_slots);
+    s_rom_slots = s_rom_len ? (prof_slot_t*)calloc(s_rom_len, sizeof *s_rom_slots) : NULL;
+    s_cap_nodes = 256;
+    s_nodes     = (prof_node_t*)malloc(s_cap_nodes * sizeof *s_nodes);
+    if (!s_cpu_slots || (s_rom_len && !s_rom_slots) || !s_nodes || !map_grow()) {
+        free_counters();
+        g_cpu_hooks &= ~CPU_HOOK_PROF;
+        return 0;
+    }
+    s_nodes[PROF_ROOT] = (prof_node_t){ PROF_ROOT, 0, 0, 0 };
+    s_n_nodes = 1;
+    memset(s_irq_slots, 0, sizeof s_irq_slots);
+    s_depth   = 0;
+    s_cur     = NULL;
+    s_pending = PUSH_NONE;
+    s_prev_op = 0;
+    g_cpu_hooks |= CPU_HOOK_PROF;
+    return 1;
+}
+
+static void close_current(uint64_t cycles)
+{
+    if (!s_cur) return;
+    const uint64_t d = cycles - s_last_cyc;
+    s_cur->cycles += d;
+    s_nodes[cur_node()].cycles += d;
+    s_cur = NULL;
+}
+
+// Bring the running instruction's count up to date without ending it.
+static void flush_current(void)
+{
+    if (!cpu_prof_active() || !s_cur) return;
+    prof_slot_t* cur = s_cur;
+    const uint64_t now = cpu_get_cycles();
+    close_current(now);
+    s_cur      = cur;
+    s_last_cyc = now;
+}
+
+void cpu_prof_stop(void)
+{
+    if (!cpu_prof_active()) return;
+    close_current(cpu_get_cycles());
+    g_cpu_hooks &= ~CPU_HOOK_PROF;
+}
+
+int cpu_prof_active(void) { return (g_cpu_hooks & CPU_HOOK_PROF) != 0; }
+
+// -----------------------------------------------------------------------------
+// Hooks
+// -----------------------------------------------------------------------------
+static const uint8_t* host_of(uint16_t pc)
+{
+    const uint8_t* const* rdp = bus_read_pages();
+    const uint8_t* page = rdp ? rdp[pc >> 8] : NULL;
+    return page ? page + (pc & 0xFF) : NULL;
+}
+
+static int rom_offset(const uint8_t* host, size_t* off)
+{
+    if (!host || !s_rom || host < s_rom || host >= s_rom + s_rom_len) return 0;
+    *off = (size_t)(host - s_rom);
+    return 1;
+}
+
+static void push_frame(uint16_t pc, uint8_t sp)
+{
+    if (s_depth == PROF_MAX_DEPTH) return;
+    size_t off;
+    const uint32_t func = rom_offset(host_of(pc), &off) ? (uint32_t)off | PROF_ROM_KEY : pc;
+    s_stack[s_depth].node = node_child(cur_node(), func, pc);
+    s_stack[s_depth].sp   = sp;
+    s_depth++;
+}
+
+void cpu_prof_log(uint64_t cycles, uint16_t pc, uint8_t sp)
+{
+    // Interrupt entry is charged to the handler, a JSR to its caller.
+    if (s_pending == PUSH_INTERRUPT) push_frame(pc, sp);
+    close_current(cycles);
+    if (s_pending == PUSH_CALL) push_frame(pc, sp);
+    else if (s_pending == PUSH_NONE && (s_prev_op == 0x60 || s_prev_op == 0x40)) { // RTS, RTI
+        while (s_depth && s_stack[s_depth - 1].sp < sp) s_depth--;
+    }
+    s_pending = PUSH_NONE;
+
+    const uint8_t* host = host_of(pc);
+    size_t off;
+    prof_slot_t* slot = rom_offset(host, &off) ? &s_rom_slots[off] : &s_cpu_slots[pc];
+    slot->insns++;
+    slot->pc = pc;
+
+    s_prev_op = host ? *host : 0;
+    if (s_prev_op == 0x20 || s_prev_op == 0x00) s_pending = PUSH_CALL; // JSR, BRK
+    s_cur      = slot;
+    s_last_cyc = cycles;
+}
+
+void cpu_prof_interrupt(uint64_t cycles, int nmi)
+{
+    close_current(cycles);
+    s_cur = &s_irq_slots[nmi ? 1 : 0];
+    s_cur->insns++;
+    s_last_cyc = cycles;
+    s_pending  = PUSH_INTERRUPT; // a JSR interrupted before its target ran loses its frame
+    s_prev_op  = 0;
+}
+
+void cpu_prof_dma(int cycles)
+{
+    if (s_cur && cycles > 0) s_cur->dma += (uint64_t)cycles;
+}
+
+int cpu_prof_counts(uint16_t pc, cpu_prof_counts_t* out)
+{
+    if (!out || !s_cpu_slots) return 0;
+    size_t off;
+    const prof_slot_t* slot = rom_offset(host_of(pc), &off) ? &s_rom_slots[off] : &s_cpu_slots[pc];
+    out->insns      = slot->insns;
+    out->cycles     = slot->cycles;
+    out->dma_cycles = slot->dma;
+    return 1;
+}
+
+// -----------------------------------------------------------------------------
+// Labels
+// -----------------------------------------------------------------------------
+static void set_label(unsigned addr, const char* name, size_t len)
+{
+    if (addr > 0xFFFF || len == 0) return;
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return;
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    free(s_labels[addr]);
+    s_labels[addr] = copy;
+}
+
+// ca65 debug info: sym id=3,name="nmi",addrsize=absolute,...,val=0xC0A3,...,type=lab
+static int parse_dbg_sym(const char* line)
+{
+    const char* name = strstr(line, "name=\"");
+    const char* val  = strstr(line, "val=0x");
+    if (!name || !val || !strstr(line, "type=lab")) return 0;
+    name += 6;
+    const char* end = strchr(name, '"');
+    if (!end) return 0;
+    set_label((unsigned)strtoul(val + 6, NULL, 16), name, (size_t)(end - name));
+    return 1;
+}
+
+// Plain "C0A3 nmi" / "$C0A3 nmi" / "0xC0A3 nmi"
+static int parse_plain(const char* line)
+{
+    while (isspace((unsigned char)*line)) line++;
+    if (*line == '$') line++;
+    else if (line[0] == '0' && (line[1] == 'x' || line[1] == 'X')) line += 2;
+    char* rest;
+    const unsigned long addr = strtoul(line, &rest, 16);
+    if (rest == line || !isspace((unsigned char)*rest)) return 0;
+    while (isspace((unsigned char)*rest)) rest++;
+    size_t len = 0;
+    while (rest[len] && !isspace((unsigned char)rest[len])) len++;
+    if (!len) return 0;
+    set_label((unsigned)addr, rest, len);
+    return 1;
+}
+
+int cpu_prof_load_labels(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+    if (!s_labels) {
+        s_labels = (char**)calloc(0x10000, sizeof *s_labels);
+        if (!s_labels) { fclose(f); return -1; }
+    }
+    int n = 0;
+    char line[1024];
+    while (fgets(line, sizeof line, f)) {
+        if (line[0] == '#' || line[0] == ';') continue;
+        if (strncmp(line, "sym", 3) == 0 && isspace((unsigned char)line[3])) n += parse_dbg_sym(line);
+        else if (strchr(line, '=') == NULL) n += parse_plain(line);
+    }
+    fclose(f);
+    return n;
+}
+
+// Label for `pc`: exact, else "nearest+$off" within 1 KB, else NULL.
+static const char* label_for(uint16_t pc, char* buf, size_t n)
+{
+    if (!s_labels) return NULL;
+    for (unsigned d = 0; d < 0x400 && d <= pc; ++d) {
+        const char* l = s_labels[pc - d];
+        if (!l) continue;
+        if (d == 0) return l;
+        snprintf(buf, n, "%s+$%X", l, d);
+        return buf;
+    }
+    return NULL;
+}
+
+// Label, "03:C0A3" (ROM bank:address) or "$07F0" (RAM, PRG-RAM)
+static void func_name(uint32_t func, uint16_t pc, char* buf, size_t n)
+{
+    char tmp[80];
+    const char* l = label_for(pc, tmp, sizeof tmp);
+    if (l) snprintf(buf, n, "%s", l);
+    else if (func & PROF_ROM_KEY) snprintf(buf, n, "%02X:%04X", (unsigned)((func & ~PROF_ROM_KEY) / PROF_BANK_SIZE), pc);
+    else snprintf(buf, n, "$%04X", pc);
+}
+
+// -----------------------------------------------------------------------------
+// Reports
+// -----------------------------------------------------------------------------
+typedef struct
+{
+    const prof_slot_t* slot;
+    int bank; // -1 = not PRG-ROM, -2 = interrupt entry
+} prof_row_t;
+
+static int row_cmp(const void* a, const void* b)
+{
+    const uint64_t x = ((const prof_row_t*)a)->slot->cycles;
+    const uint64_t y = ((const prof_row_t*)b)->slot->cycles;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+int cpu_prof_write_report(const char* path, int max_rows)
+{
+    if (!s_cpu_slots) return -1;
+    flush_current();
+
+    size_t n = 0, cap = 1024;
+    prof_row_t* rows = (prof_row_t*)malloc(cap * sizeof *rows);
+    if (!rows) return -1;
+    uint64_t total = 0, insns = 0;
+#define ADD_ROW(s, b) do { \
+        if ((s)->insns || (s)->cycles) { \
+            if (n == cap) { \
+                prof_row_t* r_ = (prof_row_t*)realloc(rows, (cap *= 2) * sizeof *rows); \
+                if (!r_) { free(rows); return -1; } \
+                rows = r_; \
+            } \
+            rows[n].slot = (s); rows[n].bank = (b); n++; \
+            total += (s)->cycles; insns += (s)->insns; \
+        } \
+    } while (0)
+    for (size_t i = 0; i < s_rom_len; ++i) ADD_ROW(&s_rom_slots[i], (int)(i / PROF_BANK_SIZE));
+    for (size_t i = 0; i < 0x10000; ++i)   ADD_ROW(&s_cpu_slots[i], -1);
+    for (int i = 0; i < 2; ++i)            ADD_ROW(&s_irq_slots[i], -2);
+#undef ADD_ROW
+    qsort(rows, n, sizeof *rows, row_cmp);
+
+    FILE* f = fopen(path, "w");
+    if (!f) { perror(path); free(rows); return -1; }
+    fprintf(f, "# %llu cycles, %llu instructions at %zu addresses\n",
+            (unsigned long long)total, (unsigned long long)insns, n);
+    fprintf(f, "# %12s %7s %12s %10s  %-8s %s\n", "cycles", "%", "insns", "dma", "where", "label");
+    for (size_t i = 0; i < n && (max_rows <= 0 || (int)i < max_rows); ++i) {
+        const prof_slot_t* s = rows[i].slot;
+        char where[16], tmp[80];
+        const char* l = NULL;
+        if (rows[i].bank == -2) {
+            snprintf(where, sizeof where, "%s", s == &s_irq_slots[1] ? "[NMI]" : "[IRQ]");
+        } else {
+            if (rows[i].bank >= 0) snprintf(where, sizeof where, "%02X:%04X", rows[i].bank, s->pc);
+            else                   snprintf(where, sizeof where, "$%04X", s->pc);
+            l = label_for(s->pc, tmp, sizeof tmp);
+        }
+        fprintf(f, "  %12llu %6.2f%% %12llu %10llu  %-8s %s\n",
+                (unsigned long long)s->cycles, total ? 100.0 * (double)s->cycles / (double)total : 0.0,
+                (unsigned long long)s->insns, (unsigned long long)s->dma, where, l ? l : "");
+    }
+    free(rows);
+    if (fclose(f) != 0) return -1;
+    return (int)n;
+}
+
+int cpu_prof_write_folded(const char* path)
+{
+    if (!s_nodes) return -1;
+    flush_current();
+
+    FILE* f = fopen(path, "w");
+    if (!f) { perror(path); return -1; }
+    int lines = 0;
+    uint32_t chain[PROF_MAX_DEPTH + 1];
+    for (uint32_t id = 0; id < s_n_nodes; ++id) {
+        if (!s_nodes[id].cycles) continue;
+        int depth = 0;
+        for (uint32_t at = id; at != PROF_ROOT && depth < PROF_MAX_DEPTH; at = s_nodes[at].parent) chain[depth++] = at;
+
+        fputs("reset", f);
+        while (depth--) {
+            char name[96];
+            func_name(s_nodes[chain[depth]].func, s_nodes[chain[depth]].pc, name, sizeof name);
+            fprintf(f, ";%s", name);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)s_nodes[id].cycles);
+        lines++;
+    }
+    if (fclose(f) != 0) return -1;
+    return lines;
+}
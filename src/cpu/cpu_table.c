@@ -1,5 +1,6 @@
 // src/cpu/cpu_table.c
-// Complete 6502 opcode tables: dispatch, base cycles, lengths, mnemonics, addrmodes.
+// Complete 6502 opcode tables: dispatch, base cycles, lengths, mnemonics, addrmodes
+// (as strings and as cpu_am_t).
 // Illegal/undocumented opcodes are routed to op_illegal().
 
 #include <stdint.h>
@@ -465,3 +466,88 @@ const char* const cpu_addrmode[256] = {
 /*F8*/AM("impl"), /*F9*/AM("abs,Y"),  /*FA*/AM("impl"), /*FB*/AM("-"),
 /*FC*/AM("abs,X"),/*FD*/AM("abs,X"),  /*FE*/AM("abs,X"),/*FF*/AM("-"),
 };
+
+// -----------------------------------------------------------------------------
+// Addressing modes as cpu_am_t (the strings above, for decoders)
+// -----------------------------------------------------------------------------
+const uint8_t cpu_addrmode_id[256] = {
+/*00*/CPU_AM_IMP,  /*01*/CPU_AM_INX,  /*02*/CPU_AM_IMP,  /*03*/CPU_AM_IMP,
+/*04*/CPU_AM_ZP,   /*05*/CPU_AM_ZP,   /*06*/CPU_AM_ZP,   /*07*/CPU_AM_IMP,
+/*08*/CPU_AM_IMP,  /*09*/CPU_AM_IMM,  /*0A*/CPU_AM_ACC,  /*0B*/CPU_AM_IMP,
+/*0C*/CPU_AM_ABS,  /*0D*/CPU_AM_ABS,  /*0E*/CPU_AM_ABS,  /*0F*/CPU_AM_IMP,
+
+/*10*/CPU_AM_REL,  /*11*/CPU_AM_INY,  /*12*/CPU_AM_IMP,  /*13*/CPU_AM_IMP,
+/*14*/CPU_AM_ZPX,  /*15*/CPU_AM_ZPX,  /*16*/CPU_AM_ZPX,  /*17*/CPU_AM_IMP,
+/*18*/CPU_AM_IMP,  /*19*/CPU_AM_ABY,  /*1A*/CPU_AM_IMP,  /*1B*/CPU_AM_IMP,
+/*1C*/CPU_AM_ABX,  /*1D*/CPU_AM_ABX,  /*1E*/CPU_AM_ABX,  /*1F*/CPU_AM_IMP,
+
+/*20*/CPU_AM_ABS,  /*21*/CPU_AM_INX,  /*22*/CPU_AM_IMP,  /*23*/CPU_AM_IMP,
+/*24*/CPU_AM_ZP,   /*25*/CPU_AM_ZP,   /*26*/CPU_AM_ZP,   /*27*/CPU_AM_IMP,
+/*28*/CPU_AM_IMP,  /*29*/CPU_AM_IMM,  /*2A*/CPU_AM_ACC,  /*2B*/CPU_AM_IMP,
+/*2C*/CPU_AM_ABS,  /*2D*/CPU_AM_ABS,  /*2E*/CPU_AM_ABS,  /*2F*/CPU_AM_IMP,
+
+/*30*/CPU_AM_REL,  /*31*/CPU_AM_INY,  /*32*/CPU_AM_IMP,  /*33*/CPU_AM_IMP,
+/*34*/CPU_AM_ZPX,  /*35*/CPU_AM_ZPX,  /*36*/CPU_AM_ZPX,  /*37*/CPU_AM_IMP,
+/*38*/CPU_AM_IMP,  /*39*/CPU_AM_ABY,  /*3A*/CPU_AM_IMP,  /*3B*/CPU_AM_IMP,
+/*3C*/CPU_AM_ABX,  /*3D*/CPU_AM_ABX,  /*3E*/CPU_AM_ABX,  /*3F*/CPU_AM_IMP,
+
+/*40*/CPU_AM_IMP,  /*41*/CPU_AM_INX,  /*42*/CPU_AM_IMP,  /*43*/CPU_AM_IMP,
+/*44*/CPU_AM_ZP,   /*45*/CPU_AM_ZP,   /*46*/CPU_AM_ZP,   /*47*/CPU_AM_IMP,
+/*48*/CPU_AM_IMP,  /*49*/CPU_AM_IMM,  /*4A*/CPU_AM_ACC,  /*4B*/CPU_AM_IMP,
+/*4C*/CPU_AM_ABS,  /*4D*/CPU_AM_ABS,  /*4E*/CPU_AM_ABS,  /*4F*/CPU_AM_IMP,
+
+/*50*/CPU_AM_REL,  /*51*/CPU_AM_INY,  /*52*/CPU_AM_IMP,  /*53*/CPU_AM_IMP,
+/*54*/CPU_AM_ZPX,  /*55*/CPU_AM_ZPX,  /*56*/CPU_AM_ZPX,  /*57*/CPU_AM_IMP,
+/*58*/CPU_AM_IMP,  /*59*/CPU_AM_ABY,  /*5A*/CPU_AM_IMP,  /*5B*/CPU_AM_IMP,
+/*5C*/CPU_AM_ABX,  /*5D*/CPU_AM_ABX,  /*5E*/CPU_AM_ABX,  /*5F*/CPU_AM_IMP,
+
+/*60*/CPU_AM_IMP,  /*61*/CPU_AM_INX,  /*62*/CPU_AM_IMP,  /*63*/CPU_AM_IMP,
+/*64*/CPU_AM_ZP,   /*65*/CPU_AM_ZP,   /*66*/CPU_AM_ZP,   /*67*/CPU_AM_IMP,
+/*68*/CPU_AM_IMP,  /*69*/CPU_AM_IMM,  /*6A*/CPU_AM_ACC,  /*6B*/CPU_AM_IMP,
+/*6C*/CPU_AM_IND,  /*6D*/CPU_AM_ABS,  /*6E*/CPU_AM_ABS,  /*6F*/CPU_AM_IMP,
+
+/*70*/CPU_AM_REL,  /*71*/CPU_AM_INY,  /*72*/CPU_AM_IMP,  /*73*/CPU_AM_IMP,
+/*74*/CPU_AM_ZPX,  /*75*/CPU_AM_ZPX,  /*76*/CPU_AM_ZPX,  /*77*/CPU_AM_IMP,
+/*78*/CPU_AM_IMP,  /*79*/CPU_AM_ABY,  /*7A*/CPU_AM_IMP,  /*7B*/CPU_AM_IMP,
+/*7C*/CPU_AM_ABX,  /*7D*/CPU_AM_ABX,  /*7E*/CPU_AM_ABX,  /*7F*/CPU_AM_IMP,
+
+/*80*/CPU_AM_IMM,  /*81*/CPU_AM_INX,  /*82*/CPU_AM_IMM,  /*83*/CPU_AM_IMP,
+/*84*/CPU_AM_ZP,   /*85*/CPU_AM_ZP,   /*86*/CPU_AM_ZP,   /*87*/CPU_AM_IMP,
+/*88*/CPU_AM_IMP,  /*89*/CPU_AM_IMM,  /*8A*/CPU_AM_IMP,  /*8B*/CPU_AM_IMP,
+/*8C*/CPU_AM_ABS,  /*8D*/CPU_AM_ABS,  /*8E*/CPU_AM_ABS,  /*8F*/CPU_AM_IMP,
+
+/*90*/CPU_AM_REL,  /*91*/CPU_AM_INY,  /*92*/CPU_AM_IMP,  /*93*/CPU_AM_IMP,
+/*94*/CPU_AM_ZPX,  /*95*/CPU_AM_ZPX,  /*96*/CPU_AM_ZPY,  /*97*/CPU_AM_IMP,
+/*98*/CPU_AM_IMP,  /*99*/CPU_AM_ABY,  /*9A*/CPU_AM_IMP,  /*9B*/CPU_AM_IMP,
+/*9C*/CPU_AM_ABS,  /*9D*/CPU_AM_ABX,  /*9E*/CPU_AM_ABS,  /*9F*/CPU_AM_IMP,
+
+/*A0*/CPU_AM_IMM,  /*A1*/CPU_AM_INX,  /*A2*/CPU_AM_IMM,  /*A3*/CPU_AM_IMP,
+/*A4*/CPU_AM_ZP,   /*A5*/CPU_AM_ZP,   /*A6*/CPU_AM_ZP,   /*A7*/CPU_AM_IMP,
+/*A8*/CPU_AM_IMP,  /*A9*/CPU_AM_IMM,  /*AA*/CPU_AM_IMP,  /*AB*/CPU_AM_IMP,
+/*AC*/CPU_AM_ABS,  /*AD*/CPU_AM_ABS,  /*AE*/CPU_AM_ABS,  /*AF*/CPU_AM_IMP,
+
+/*B0*/CPU_AM_REL,  /*B1*/CPU_AM_INY,  /*B2*/CPU_AM_IMP,  /*B3*/CPU_AM_IMP,
+/*B4*/CPU_AM_ZPX,  /*B5*/CPU_AM_ZPX,  /*B6*/CPU_AM_ZPY,  /*B7*/CPU_AM_IMP,
+/*B8*/CPU_AM_IMP,  /*B9*/CPU_AM_ABY,  /*BA*/CPU_AM_IMP,  /*BB*/CPU_AM_IMP,
+/*BC*/CPU_AM_ABX,  /*BD*/CPU_AM_ABX,  /*BE*/CPU_AM_ABY,  /*BF*/CPU_AM_IMP,
+
+/*C0*/CPU_AM_IMM,  /*C1*/CPU_AM_INX,  /*C2*/CPU_AM_IMP,  /*C3*/CPU_AM_IMP,
+/*C4*/CPU_AM_ZP,   /*C5*/CPU_AM_ZP,   /*C6*/CPU_AM_ZP,   /*C7*/CPU_AM_IMP,
+/*C8*/CPU_AM_IMP,  /*C9*/CPU_AM_IMM,  /*CA*/CPU_AM_IMP,  /*CB*/CPU_AM_IMP,
+/*CC*/CPU_AM_ABS,  /*CD*/CPU_AM_ABS,  /*CE*/CPU_AM_ABS,  /*CF*/CPU_AM_IMP,
+
+/*D0*/CPU_AM_REL,  /*D1*/CPU_AM_INY,  /*D2*/CPU_AM_IMP,  /*D3*/CPU_AM_IMP,
+/*D4*/CPU_AM_ZPX,  /*D5*/CPU_AM_ZPX,  /*D6*/CPU_AM_ZPX,  /*D7*/CPU_AM_IMP,
+/*D8*/CPU_AM_IMP,  /*D9*/CPU_AM_ABY,  /*DA*/CPU_AM_IMP,  /*DB*/CPU_AM_IMP,
+/*DC*/CPU_AM_ABX,  /*DD*/CPU_AM_ABX,  /*DE*/CPU_AM_ABX,  /*DF*/CPU_AM_IMP,
+
+/*E0*/CPU_AM_IMM,  /*E1*/CPU_AM_INX,  /*E2*/CPU_AM_IMP,  /*E3*/CPU_AM_IMP,
+/*E4*/CPU_AM_ZP,   /*E5*/CPU_AM_ZP,   /*E6*/CPU_AM_ZP,   /*E7*/CPU_AM_IMP,
+/*E8*/CPU_AM_IMP,  /*E9*/CPU_AM_IMM,  /*EA*/CPU_AM_IMP,  /*EB*/CPU_AM_IMP,
+/*EC*/CPU_AM_ABS,  /*ED*/CPU_AM_ABS,  /*EE*/CPU_AM_ABS,  /*EF*/CPU_AM_IMP,
+
+/*F0*/CPU_AM_REL,  /*F1*/CPU_AM_INY,  /*F2*/CPU_AM_IMP,  /*F3*/CPU_AM_IMP,
+/*F4*/CPU_AM_ZPX,  /*F5*/CPU_AM_ZPX,  /*F6*/CPU_AM_ZPX,  /*F7*/CPU_AM_IMP,
+/*F8*/CPU_AM_IMP,  /*F9*/CPU_AM_ABY,  /*FA*/CPU_AM_IMP,  /*FB*/CPU_AM_IMP,
+/*FC*/CPU_AM_ABX,  /*FD*/CPU_AM_ABX,  /*FE*/CPU_AM_ABX,  /*FF*/CPU_AM_IMP,
+};
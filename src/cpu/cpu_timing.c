@@ -1,6 +1,7 @@
 #include <stdint.h>
 
 #include "cpu.h"
+#include "cpu_internal.h"
 
 
 
@@ -9,6 +10,7 @@ void cpu_dma_stall(int cycles)
 {
     if (cycles > 0)
     {
+        if (g_cpu_hooks & CPU_HOOK_PROF) cpu_prof_dma(cycles);
         cpu_cycles_add(cycles);
     }
 }
@@ -0,0 +1,193 @@
+// cpu_trace.c — binary per-instruction trace ring
+//
+// Records are taken before the opcode fetch, so registers and cycles match a
+// nestest log line. Instruction bytes and the effective address are read
+// through the bus page tables only: tracing never touches I/O registers.
+// Bytes on unmapped pages (code running from mapper registers, pointers in
+// I/O space) are recorded as 0.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "cpu_internal.h"
+#include "cpu_table.h"
+#include "cpu_ops.h"
+
+#define CPU_TRACE_DEFAULT_PATH "cpu_trace.bin"
+
+static cpu_trace_rec_t* s_ring;
+static size_t           s_mask;  // ring size - 1
+static uint64_t         s_total; // records ever written since start
+static char             s_dump_path[260] = CPU_TRACE_DEFAULT_PATH;
+
+// -----------------------------------------------------------------------------
+// Control
+// -----------------------------------------------------------------------------
+int cpu_trace_start(size_t records)
+{
+    size_t n = 1;
+    while (n < records) n <<= 1;
+
+    if (!s_ring || s_mask + 1 != n) {
+        cpu_trace_rec_t* ring = (cpu_trace_rec_t*)realloc(s_ring, n * sizeof *ring);
+        if (!ring) { g_cpu_hooks &= ~CPU_HOOK_TRACE; return 0; }
+        s_ring = ring;
+        s_mask = n - 1;
+    }
+    s_total = 0;
+    g_cpu_hooks |= CPU_HOOK_TRACE;
+    return 1;
+}
+
+void cpu_trace_stop(void) { g_cpu_hooks &= ~CPU_HOOK_TRACE; }
+
+int cpu_trace_active(void) { return (g_cpu_hooks & CPU_HOOK_TRACE) != 0; }
+
+size_t cpu_trace_count(void)
+{
+    if (!s_ring) return 0;
+    return s_total > s_mask ? s_mask + 1 : (size_t)s_total;
+}
+
+int cpu_trace_get(size_t i, cpu_trace_rec_t* out)
+{
+    const size_t n = cpu_trace_count();
+    if (i >= n || !out) return 0;
+    *out = s_ring[(size_t)(s_total - n + i) & s_mask];
+    return 1;
+}
+
+void cpu_trace_set_dump_path(const char* path)
+{
+    snprintf(s_dump_path, sizeof s_dump_path, "%s", path ? path : CPU_TRACE_DEFAULT_PATH);
+}
+
+// -----------------------------------------------------------------------------
+// Recording
+// -----------------------------------------------------------------------------
+static uint8_t peek(const uint8_t* const* rdp, uint16_t addr)
+{
+    const uint8_t* page = rdp ? rdp[addr >> 8] : NULL;
+    return page ? page[addr & 0xFF] : 0;
+}
+
+static uint16_t peek16_zp(const uint8_t* const* rdp, uint8_t zp)
+{
+    return (uint16_t)(peek(rdp, zp) | (peek(rdp, (uint8_t)(zp + 1)) << 8));
+}
+
+void cpu_trace_log(uint64_t cycles, uint16_t pc, uint8_t a, uint8_t x, uint8_t y, uint8_t p, uint8_t sp)
+{
+    const uint8_t* const* rdp = bus_read_pages();
+    cpu_trace_rec_t* r = &s_ring[(size_t)s_total++ & s_mask];
+
+    const uint8_t op  = peek(rdp, pc);
+    const uint8_t len = cpu_dispatch[op] == op_illegal ? 1 : cpu_instr_len[op];
+    const uint8_t b1  = len > 1 ? peek(rdp, (uint16_t)(pc + 1)) : 0;
+    const uint8_t b2  = len > 2 ? peek(rdp, (uint16_t)(pc + 2)) : 0;
+    const uint16_t abs = (uint16_t)(b1 | (b2 << 8));
+
+    uint16_t ea = 0;
+    switch (cpu_addrmode_id[op]) {
+    case CPU_AM_ZP:  ea = b1; break;
+    case CPU_AM_ZPX: ea = (uint8_t)(b1 + x); break;
+    case CPU_AM_ZPY: ea = (uint8_t)(b1 + y); break;
+    case CPU_AM_ABS: ea = abs; break;
+    case CPU_AM_ABX: ea = (uint16_t)(abs + x); break;
+    case CPU_AM_ABY: ea = (uint16_t)(abs + y); break;
+    case CPU_AM_INX: ea = peek16_zp(rdp, (uint8_t)(b1 + x)); break;
+    case CPU_AM_INY: ea = (uint16_t)(peek16_zp(rdp, b1) + y); break;
+    case CPU_AM_REL: ea = (uint16_t)(pc + 2 + (int8_t)b1); break;
+    case CPU_AM_IND: // JMP ($xxFF) wraps within the page
+        ea = (uint16_t)(peek(rdp, abs) | (peek(rdp, (uint16_t)((abs & 0xFF00) | ((abs + 1) & 0xFF))) << 8));
+        break;
+    default: break;
+    }
+
+    r->cycles = cycles;
+    r->pc  = pc;
+    r->ea  = ea;
+    r->op  = op; r->op1 = b1; r->op2 = b2;
+    r->a   = a;  r->x   = x;  r->y   = y; r->p = p; r->sp = sp;
+}
+
+// -----------------------------------------------------------------------------
+// File format
+// -----------------------------------------------------------------------------
+static void pack(const cpu_trace_rec_t* r, uint8_t* b)
+{
+    for (int i = 0; i < 8; ++i) b[i] = (uint8_t)(r->cycles >> (8 * i));
+    b[8]  = (uint8_t)r->pc; b[9]  = (uint8_t)(r->pc >> 8);
+    b[10] = (uint8_t)r->ea; b[11] = (uint8_t)(r->ea >> 8);
+    b[12] = r->op; b[13] = r->op1; b[14] = r->op2;
+    b[15] = r->a;  b[16] = r->x;   b[17] = r->y; b[18] = r->p; b[19] = r->sp;
+}
+
+void cpu_trace_unpack(const uint8_t b[CPU_TRACE_REC_BYTES], cpu_trace_rec_t* r)
+{
+    r->cycles = 0;
+    for (int i = 7; i >= 0; --i) r->cycles = (r->cycles << 8) | b[i];
+    r->pc = (uint16_t)(b[8] | (b[9] << 8));
+    r->ea = (uint16_t)(b[10] | (b[11] << 8));
+    r->op = b[12]; r->op1 = b[13]; r->op2 = b[14];
+    r->a  = b[15]; r->x   = b[16]; r->y   = b[17]; r->p = b[18]; r->sp = b[19];
+}
+
+long cpu_trace_dump(const char* path)
+{
+    if (!path) path = s_dump_path;
+    FILE* f = fopen(path, "wb");
+    if (!f) { perror(path); return -1; }
+
+    const size_t n = cpu_trace_count();
+    int ok = fwrite(CPU_TRACE_MAGIC, 1, 8, f) == 8;
+    for (size_t i = 0; ok && i < n; ++i) {
+        uint8_t b[CPU_TRACE_REC_BYTES];
+        pack(&s_ring[(size_t)(s_total - n + i) & s_mask], b);
+        ok = fwrite(b, 1, sizeof b, f) == sizeof b;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) { fprintf(stderr, "cpu_trace_dump: write to %s failed\n", path); return -1; }
+    return (long)n;
+}
+
+// -----------------------------------------------------------------------------
+// Text
+// -----------------------------------------------------------------------------
+void cpu_trace_format(const cpu_trace_rec_t* r, char* buf, size_t buflen)
+{
+    if (!buf || buflen == 0) return;
+    const uint8_t op = r->op, b1 = r->op1, b2 = r->op2;
+    const uint8_t len = cpu_dispatch[op] == op_illegal ? 1 : cpu_instr_len[op];
+    const unsigned abs = (unsigned)(b1 | (b2 << 8));
+    const unsigned ea  = r->ea;
+
+    char bytes[12], operand[24], text[40];
+    if (len == 1)      snprintf(bytes, sizeof bytes, "%02X", op);
+    else if (len == 2) snprintf(bytes, sizeof bytes, "%02X %02X", op, b1);
+    else               snprintf(bytes, sizeof bytes, "%02X %02X %02X", op, b1, b2);
+
+    switch (cpu_addrmode_id[op]) {
+    case CPU_AM_IMM: snprintf(operand, sizeof operand, "#$%02X", b1); break;
+    case CPU_AM_ZP:  snprintf(operand, sizeof operand, "$%02X", b1); break;
+    case CPU_AM_ZPX: snprintf(operand, sizeof operand, "$%02X,X @ %02X", b1, ea); break;
+    case CPU_AM_ZPY: snprintf(operand, sizeof operand, "$%02X,Y @ %02X", b1, ea); break;
+    case CPU_AM_ABS: snprintf(operand, sizeof operand, "$%04X", abs); break;
+    case CPU_AM_ABX: snprintf(operand, sizeof operand, "$%04X,X @ %04X", abs, ea); break;
+    case CPU_AM_ABY: snprintf(operand, sizeof operand, "$%04X,Y @ %04X", abs, ea); break;
+    case CPU_AM_IND: snprintf(operand, sizeof operand, "($%04X) = %04X", abs, ea); break;
+    case CPU_AM_INX: snprintf(operand, sizeof operand, "($%02X,X) @ %04X", b1, ea); break;
+    case CPU_AM_INY: snprintf(operand, sizeof operand, "($%02X),Y @ %04X", b1, ea); break;
+    case CPU_AM_REL: snprintf(operand, sizeof operand, "$%04X", ea); break;
+    case CPU_AM_ACC: snprintf(operand, sizeof operand, "A"); break;
+    default:         operand[0] = '\0'; break;
+    }
+    snprintf(text, sizeof text, " %s %s", cpu_mnemonic[op], operand);
+
+    snprintf(buf, buflen, "%04X  %-8s %-33s A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu",
+             r->pc, bytes, text, r->a, r->x, r->y, r->p, r->sp,
+             (unsigned long long)r->cycles);
+}
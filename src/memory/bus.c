@@ -10,6 +10,7 @@
 #include "controller.h"
 #include "ppu_regs.h"
 #include "apu.h"
+#include "nes_sched.h"
 
 // -------------------------
 // Internal memory
@@ -20,6 +21,79 @@ static uint8_t s_cpu_ram[CPU_RAM_SIZE];
 #define PRG_RAM_SIZE 0x2000  // 8KB PRG-RAM at $6000-$7FFF (optional on real carts)
 static uint8_t s_prg_ram[PRG_RAM_SIZE];
 
+// -------------------------
+// CPU page table
+// -------------------------
+// One entry per 256-byte CPU page. Plain memory (internal RAM mirrors, PRG-RAM
+// and the PRG-ROM windows published by the mapper) gets a host pointer to the
+// start of the page, so the hot path is a single indexed load/store. A NULL
+// entry sends the access through the I/O handlers below, which keep the full
+// address decode. Zero-initialised tables are therefore always correct, just
+// slow, until bus_reset()/bus_map_prg() fill them in.
+#define BUS_PAGES 256
+static const uint8_t* s_rd_page[BUS_PAGES];
+static uint8_t*       s_wr_page[BUS_PAGES];
+// Write pointers as mapped, before the decoded instruction cache trapped any
+// page holding code (see bus_trap_code_writes()).
+static uint8_t*       s_wr_map[BUS_PAGES];
+
+static inline void map_pages(uint16_t cpu_addr, size_t len,
+                             const uint8_t* rd, uint8_t* wr)
+{
+    size_t first = (size_t)(cpu_addr >> 8);
+    size_t count = len >> 8;
+    for (size_t i = 0; i < count && first + i < BUS_PAGES; ++i) {
+        s_rd_page[first + i] = rd ? rd + (i << 8) : NULL;
+        s_wr_page[first + i] = wr ? wr + (i << 8) : NULL;
+        s_wr_map[first + i]  = s_wr_page[first + i];
+    }
+}
+
+// Fixed (non-cartridge) regions. Cartridge pages ($8000-$FFFF) belong to the
+// mapper and are left alone so a mapper initialised before bus_reset() keeps
+// its PRG windows.
+static void map_fixed_regions(void)
+{
+    // $0000-$1FFF: 2KB RAM, mirrored every $0800
+    for (uint16_t base = 0; base <= CPU_RAM_END; base = (uint16_t)(base + CPU_RAM_SIZE)) {
+        map_pages(base, CPU_RAM_SIZE, s_cpu_ram, s_cpu_ram);
+    }
+    // $0200-$02FF stays on the handler path for writes so the sprite-buffer
+    // instrumentation below keeps counting.
+    s_wr_page[0x02] = NULL;
+    s_wr_map[0x02]  = NULL;
+
+    // $2000-$5FFF: PPU/APU/IO/expansion are always handlers
+    map_pages(PPU_REG_START, 0x4000, NULL, NULL);
+
+    // $6000-$7FFF: PRG-RAM
+    map_pages(0x6000, PRG_RAM_SIZE, s_prg_ram, s_prg_ram);
+}
+
+const uint8_t* const* bus_read_pages(void) { return s_rd_page; }
+uint8_t* const*       bus_write_pages(void) { return s_wr_page; }
+
+void bus_map_prg(uint16_t cpu_addr, size_t len, const uint8_t* mem)
+{
+    if (cpu_addr < 0x8000) return; // only the cartridge ROM window is mapper-owned
+    // PRG-ROM writes always reach the mapper (bank registers live there).
+    map_pages(cpu_addr, len, mem, NULL);
+}
+
+void bus_set_prg_rom(const uint8_t* mem, size_t len)
+{
+    cpu_icache_add_rom(mem, len);
+    cpu_jit_add_rom(mem, len);
+    cpu_prof_add_rom(mem, len);
+}
+
+void bus_trap_code_writes(const uint8_t* page, int on)
+{
+    for (size_t i = 0; i < BUS_PAGES; ++i) {
+        if (s_wr_map[i] == page) s_wr_page[i] = on ? NULL : s_wr_map[i];
+    }
+}
+
 // -------------------------
 // Instrumentation
 // -------------------------
@@ -37,6 +111,9 @@ void bus_reset(void) {
     memset(s_prg_ram, 0, sizeof s_prg_ram);
     g_io_4014_w_count = 0;
     g_wram_0200_02FF_w_count = 0;
+    map_fixed_regions();
+    cpu_icache_add_ram(s_cpu_ram, sizeof s_cpu_ram);
+    cpu_icache_add_ram(s_prg_ram, sizeof s_prg_ram);
 }
 
 // Optional API (kept to satisfy header; not required for mapper 0)
@@ -45,9 +122,9 @@ void bus_set_prg_size(size_t sz_bytes) {
 }
 
 // -------------------------
-// CPU reads
+// I/O read handler (pages without a direct pointer)
 // -------------------------
-uint8_t cpu_read(uint16_t addr) {
+static uint8_t bus_read_io(uint16_t addr) {
     // $0000-$1FFF: 2KB RAM, mirrored every $0800
     if (addr <= CPU_RAM_END) {
         return s_cpu_ram[addr & (CPU_RAM_SIZE - 1)];
@@ -56,12 +133,13 @@ uint8_t cpu_read(uint16_t addr) {
     // $2000-$3FFF: PPU registers, mirrored every 8 bytes
     if (addr >= PPU_REG_START && addr <= PPU_REG_END) {
         uint16_t lo3 = (uint16_t)((addr - 0x2000u) & 7u);
+        nes_sched_sync_ppu();       // PPU catches up to this instruction
         return ppu_regs_read(lo3);  // call regs directly
     }
 
     // $4000-$4017: APU + I/O
     if (addr >= APU_IO_START && addr <= APU_IO_END) {
-        if (addr == 0x4015) { return apu_read(addr); }
+        if (addr == 0x4015) { nes_sched_sync_apu(); return apu_read(addr); }
         if (addr == 0x4016 || addr == 0x4017) {
             return controller_read(addr);
         }
@@ -85,12 +163,13 @@ uint8_t cpu_read(uint16_t addr) {
 }
 
 // -------------------------
-// CPU writes
+// I/O write handler (pages without a direct pointer)
 // -------------------------
-void cpu_write(uint16_t addr, uint8_t data) {
+static void bus_write_io(uint16_t addr, uint8_t data) {
     // $0000-$1FFF: 2KB RAM, mirrored
     if (addr <= CPU_RAM_END) {
         s_cpu_ram[addr & (CPU_RAM_SIZE - 1)] = data;
+        cpu_icache_invalidate(&s_cpu_ram[addr & (CPU_RAM_SIZE - 1)], 1);
 
         // Instrument sprite buffer writes ($0200-$02FF)
         if (addr >= 0x0200 && addr <= 0x02FF) {
@@ -102,7 +181,9 @@ void cpu_write(uint16_t addr, uint8_t data) {
     // $2000-$3FFF: PPU registers, mirrored every 8 bytes
     if (addr >= PPU_REG_START && addr <= PPU_REG_END) {
         uint16_t lo3 = (uint16_t)((addr - 0x2000u) & 7u);
+        nes_sched_sync_ppu();
         ppu_regs_write(lo3, data);  // call regs directly
+        nes_sched_io_written(0);
         return;
     }
 
@@ -110,12 +191,13 @@ void cpu_write(uint16_t addr, uint8_t data) {
     if (addr >= APU_IO_START && addr <= APU_IO_END) {
         if (addr == 0x4014) {                 // OAM DMA
             g_io_4014_w_count++;
+            nes_sched_sync_ppu();
             ppu_oam_dma(data);
-            // Stall the CPU ~513/514 cycles. Your current implementation
-            // only adds CPU cycles (doesn't tick PPU/APU), which is fine short-term.
-            // We can improve this later if needed.
+            // Stall the CPU ~513/514 cycles. Only the CPU counter moves here;
+            // the scheduler catches PPU/APU up across the stall (DMA_DONE).
             int add = 513 + (cpu_cycles_parity() & 1);
-            cpu_dma_stall(add);               // currently just cpu_cycles_add(...)
+            cpu_dma_stall(add);
+            nes_sched_io_written(add);
             return;
         }
         if (addr == 0x4016 || addr == 0x4017) {
@@ -123,7 +205,9 @@ void cpu_write(uint16_t addr, uint8_t data) {
             return;
         }
         if (addr >= 0x4000 && addr <= 0x4017) {
+            nes_sched_sync_apu();
             apu_write(addr, data);
+            nes_sched_io_written(0);
             return;
         }
         return;
@@ -137,9 +221,28 @@ void cpu_write(uint16_t addr, uint8_t data) {
     // $6000-$7FFF: PRG-RAM
     if (addr >= 0x6000 && addr <= 0x7FFF) {
         s_prg_ram[addr - 0x6000] = data;
+        cpu_icache_invalidate(&s_prg_ram[addr - 0x6000], 1);
         return;
     }
 
-    // $8000-$FFFF: cartridge space via active mapper
+    // $8000-$FFFF: cartridge space via active mapper (banks, mirroring and
+    // the MMC3 IRQ counter affect the PPU, so it catches up first)
+    nes_sched_sync_ppu();
     mapper_cpu_write(addr, data);
+    nes_sched_io_written(0);
+}
+
+// -------------------------
+// CPU reads / writes
+// -------------------------
+uint8_t cpu_read(uint16_t addr) {
+    const uint8_t* p = s_rd_page[addr >> 8];
+    if (p) return p[addr & 0xFF];
+    return bus_read_io(addr);
+}
+
+void cpu_write(uint16_t addr, uint8_t data) {
+    uint8_t* p = s_wr_page[addr >> 8];
+    if (p) { p[addr & 0xFF] = data; return; }
+    bus_write_io(addr, data);
 }
@@ -11,6 +11,9 @@
 #include "nes.h"
 #include "controller.h"
 #include "apu.h"
+#include "nes_idle.h"
+#include "nes_sched.h"
+#include "nes_palette.h"
 
 #include "debug_checks.h"
 
@@ -21,26 +24,42 @@
 #define WATCHDOG_BUDGET (CPU_CYCLES_PER_FRAME * WATCHDOG_MULTIPLIER)
 
 static uint64_t s_frame_counter = 0;
+static uint64_t s_idle_frame_start = 0; // nes_idle_cycles_skipped() when the frame began
+static uint64_t s_idle_last_frame = 0;
 
-static uint32_t g_fb[NES_W * NES_H];
+static uint32_t g_fb[NES_W * NES_H];     // ARGB of an indexed frame
+static uint32_t* s_target = NULL;        // nes_set_render_target()
+static int s_target_pitch = 0;
 static int g_test_frame = 0;
 
 // --- Helpers ---------------------------------------------------------------
 
 
-// Step exactly one CPU instruction and advance PPU accordingly.
-static inline void step_one_instruction_and_tick_all(void)
+// Run the CPU toward the scheduler's next event (never past CPU cycle
+// `limit`), then let PPU and APU catch up. The batch may end early when the
+// CPU writes a register that moves an event; idle loops are skipped on the way.
+static void run_slice(uint64_t limit)
 {
-    DBG_WRAP_STEP(cpu_step());
-    // uint64_t c0 = cpu_get_cycles();
-    // cpu_step();
-    // uint64_t c1 = cpu_get_cycles();
-    // uint64_t delta_cpu = c1 - c0;
-    // if (delta_cpu)
-    // {
-    //     ppu_step((int)delta_cpu);
-    //     apu_step((int)delta_cpu);
-    // }
+    const uint64_t c0 = cpu_get_cycles();
+    uint64_t stop = nes_sched_next_stop();
+    if (stop > limit) stop = limit;
+    if (stop <= c0)   stop = c0 + 1;
+
+    nes_sched_begin(stop);
+    DBG_CHECK_PROGRESS(nes_idle_run(stop), c0);
+    nes_sched_sync();
+}
+
+// An indexed frame (NES_VIDEO_INDEX8/16) as ARGB pixels
+static void convert_index_frame(uint32_t* dst, int pitch_bytes)
+{
+    if (ppu_get_output() == PPU_OUTPUT_INDEX16) {
+        nes_palette_convert16(dst, pitch_bytes, NES_PIXFMT_ARGB8888, ppu_framebuffer_index16(), NES_H);
+        return;
+    }
+    const uint8_t* emphasis;
+    const uint8_t* idx = ppu_framebuffer_index8(&emphasis);
+    nes_palette_convert(dst, pitch_bytes, NES_PIXFMT_ARGB8888, idx, emphasis, NES_H);
 }
 
 static inline int watchdog_tripped(uint64_t start)
@@ -94,7 +113,10 @@ void nes_init(void)
     bus_reset();
     ppu_reset();
     cpu_reset();
+    nes_idle_reset();
+    nes_sched_reset();
     s_frame_counter = 0;
+    s_idle_frame_start = s_idle_last_frame = 0;
 }
 
 void nes_reset(void)
@@ -106,7 +128,9 @@ void nes_reset(void)
     bus_reset();
     ppu_reset();
     cpu_reset();
-
+    nes_idle_reset();
+    nes_sched_reset();
+    s_idle_frame_start = s_idle_last_frame = 0;
 }
 
 // Run until we see the NEXT vblank rising edge from the current point.
@@ -114,10 +138,10 @@ void nes_reset(void)
 uint64_t nes_step_frame(void)
 {
     // 1) Wait for the very next *rising* edge (entering vblank)
-    bool prev = ppu_in_vblank();
+    bool prev = ppu_in_vblank_lines();
     uint64_t guard = cpu_get_cycles() + 60000; // ~2 CPU frames
-    while (ppu_in_vblank() == prev) {
-        step_one_instruction_and_tick_all();
+    while (ppu_in_vblank_lines() == prev) {
+        run_slice(guard);
         if (cpu_get_cycles() > guard) goto bailout;
     }
 
@@ -125,16 +149,27 @@ uint64_t nes_step_frame(void)
     bool saw_clear = false;
     guard = cpu_get_cycles() + 180000; // ~6 CPU frames
     for (;;) {
-        bool v = ppu_in_vblank();
+        bool v = ppu_in_vblank_lines();
         if (!v) saw_clear = true;
         if (saw_clear && v) break;           // back to *rising* edge → inside vblank
-        step_one_instruction_and_tick_all();
+        run_slice(guard);
         if (cpu_get_cycles() > guard) goto bailout;
     }
-    return ++s_frame_counter;
+    goto done;
 
     bailout:
         fprintf(stderr, "[WATCHDOG] nes_step_frame bailed; vblank=%d\n", (int)ppu_in_vblank());
+        if (cpu_trace_active()) {
+            const long n = cpu_trace_dump(NULL);
+            if (n >= 0) fprintf(stderr, "[WATCHDOG] dumped %ld CPU trace records\n", n);
+        }
+    done:
+        nes_sched_sync_apu(); // the audio consumer reads after each frame
+        // The PPU drew into the caller's target itself, unless indexed
+        if (s_target && ppu_get_output() != PPU_OUTPUT_ARGB8888) convert_index_frame(s_target, s_target_pitch);
+        else if (s_target) (void)ppu_framebuffer();   // render thread done with it
+        s_idle_last_frame  = nes_idle_cycles_skipped() - s_idle_frame_start;
+        s_idle_frame_start = nes_idle_cycles_skipped();
     return ++s_frame_counter;
 }
 
@@ -156,8 +191,9 @@ void nes_step_seconds(double seconds)
 
     while ((cpu_get_cycles() - start) < budget)
     {
-        step_one_instruction_and_tick_all();
+        run_slice(start + budget);
     }
+    nes_sched_sync_apu();
 }
 
 uint64_t nes_frame_count(void)
@@ -165,15 +201,72 @@ uint64_t nes_frame_count(void)
     return s_frame_counter;
 }
 
+uint64_t nes_idle_cycles_last_frame(void)
+{
+    return s_idle_last_frame;
+}
+
 const uint32_t* nes_framebuffer_argb8888(int* out_pitch_bytes)
 {
+    /* The PPU draws each scanline as it reaches it; this is the last frame */
+    if (ppu_get_output() == PPU_OUTPUT_ARGB8888) {
+        if (out_pitch_bytes) *out_pitch_bytes = ppu_framebuffer_pitch();
+        return ppu_framebuffer();
+    }
+
+    if (s_target) {
+        if (out_pitch_bytes) *out_pitch_bytes = s_target_pitch;
+        return s_target;   // converted at the end of the frame
+    }
     if (out_pitch_bytes) *out_pitch_bytes = NES_W * 4;
-    /* Render the current PPU state into our persistent buffer */
-    static uint32_t g_fb[NES_W * NES_H];
-    ppu_render_argb8888(g_fb, NES_W * 4);
+    convert_index_frame(g_fb, NES_W * 4);
     return g_fb;
 }
 
+void nes_set_render_target(uint32_t* dst, int pitch_bytes)
+{
+    ppu_set_render_target(dst, pitch_bytes);
+    const int ok = dst && pitch_bytes >= NES_W * 4;
+    s_target       = ok ? dst : NULL;
+    s_target_pitch = ok ? pitch_bytes : 0;
+}
+
+void nes_set_video_output(int format)
+{
+    ppu_set_output(format == NES_VIDEO_INDEX8  ? PPU_OUTPUT_INDEX8 :
+                   format == NES_VIDEO_INDEX16 ? PPU_OUTPUT_INDEX16 : PPU_OUTPUT_ARGB8888);
+}
+
+const uint8_t* nes_framebuffer_index8(const uint8_t** out_line_emphasis)
+{
+    return ppu_framebuffer_index8(out_line_emphasis);
+}
+
+const uint16_t* nes_framebuffer_index16(void)
+{
+    return ppu_framebuffer_index16();
+}
+
+void nes_set_skip_render(int skip)
+{
+    ppu_set_frame_draw(!skip);
+}
+
+int nes_get_skip_render(void)
+{
+    return !ppu_get_frame_draw();
+}
+
+int nes_set_render_thread(int on)
+{
+    return ppu_set_render_thread(on != 0);
+}
+
+int nes_get_render_thread(void)
+{
+    return ppu_get_render_thread();
+}
+
 void nes_set_controller_state(int pad_index, uint8_t state)
 {
     if (pad_index < 0) pad_index = 0;
@@ -184,7 +277,7 @@ void nes_set_controller_state(int pad_index, uint8_t state)
 void nes_shutdown(void)
 {
     // Placeholder for future resource cleanup (e.g., SDL shutdown).
-    // Nothing required for pure core.
+    ppu_set_render_thread(false);
 }
 
 
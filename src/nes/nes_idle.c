@@ -0,0 +1,281 @@
+// nes_idle.c — idle-loop detection and fast-forward
+//
+// Games park the CPU in loops like `LDA $2002 / BPL` or `LDA flag / BEQ` until
+// vblank or the NMI handler changes something. Such a loop is skipped when:
+//
+//   1. statically, its body (at most IDLE_MAX_BYTES, ending in a backward
+//      branch or JMP) writes nothing, touches no stack, and only reads fixed
+//      addresses in RAM/ROM or PPUSTATUS;
+//   2. dynamically, the CPU arrived at the loop head twice in a row with the
+//      same registers and the same values at every address the loop reads,
+//      having executed only loop instructions in between.
+//
+// Then every further iteration is identical until some outside event changes
+// an input: a vblank edge (PPUSTATUS, and the NMI it may raise), sprite 0
+// hit or sprite overflow (PPUSTATUS again) or an MMC3 IRQ. Those are exactly
+// the scheduler's stopping events (nes_sched.h), so whole iterations that
+// end before the batch's stop are skipped by moving the cycle counter alone;
+// PPU and APU catch up with the rest of the batch. A `BIT $2002 / BVC` split
+// wait thus lands on the hit dot, and `LDA $2002 / AND #$20 / BEQ` on the
+// line that sets overflow. The APU frame IRQ is not wired to the CPU, so it
+// is no event.
+//
+// Detection needs every instruction, so the CPU is single-stepped while
+// probing for a loop; a probe that proves nothing is followed by a free
+// batch before the next one.
+//
+// Side effect of skipped PPUSTATUS reads: the read counter used by the debug
+// stats is not bumped; the register itself is unchanged (VBL was clear and
+// the write toggle already reset by the iterations that did run).
+
+#include <stdint.h>
+#include <string.h>
+
+#include "nes_idle.h"
+#include "nes_sched.h"
+#include "cpu.h"
+#include "cpu_internal.h"
+#include "cpu_table.h"
+#include "cpu_ops.h"
+#include "bus.h"
+#include "ppu.h"
+
+#define IDLE_MAX_BYTES  32
+#define IDLE_MAX_INSNS  16
+#define IDLE_MAX_INPUTS 8
+
+#define IDLE_PROBE_INSNS  32   // single steps per probe
+#define IDLE_FREE_CYCLES  2048 // batch between probes that found nothing
+
+typedef struct
+{
+    uint8_t  a, x, y, p, sp;
+    uint8_t  in[IDLE_MAX_INPUTS];
+    uint64_t cycles;
+} idle_snap_t;
+
+static struct
+{
+    int      enabled;
+    int      tracking;               // head/end describe a statically clean loop
+    uint16_t head, end;              // body is [head, end)
+    uint64_t starts;                 // bit i: an instruction starts at head+i
+    uint16_t inputs[IDLE_MAX_INPUTS];
+    int      n_inputs;
+
+    int         have_last;
+    idle_snap_t last;                // state at the last arrival at head
+    int         n_chunk;             // instructions since that arrival
+
+    int      proven;                 // at head, and the last iteration was a fixed point
+    uint32_t period;                 // CPU cycles per iteration
+
+    int      probed;                 // single steps since the last skip or free batch
+    int      free_left;              // cycles left in the current free batch
+
+    uint64_t skipped;
+} I = { .enabled = 1 };
+
+void nes_idle_reset(void)
+{
+    const int enabled = I.enabled;
+    memset(&I, 0, sizeof I);
+    I.enabled = enabled;
+}
+
+static void forget_loop(void) { I.tracking = 0; I.have_last = 0; I.proven = 0; }
+
+void nes_idle_set_enabled(int on) { I.enabled = on != 0; forget_loop(); }
+
+uint64_t nes_idle_cycles_skipped(void) { return I.skipped; }
+
+// -----------------------------------------------------------------------------
+// Static check
+// -----------------------------------------------------------------------------
+static int is_ppustatus(uint16_t addr)
+{
+    return addr >= 0x2000 && addr <= 0x3FFF && (addr & 7) == 2;
+}
+
+static int code_byte(uint16_t addr, uint8_t* out)
+{
+    const uint8_t* const* rdp = bus_read_pages();
+    const uint8_t* page = rdp ? rdp[addr >> 8] : NULL;
+    if (!page) return 0;
+    *out = page[addr & 0xFF];
+    return 1;
+}
+
+// Reads the loop may do: fixed RAM/ROM addresses (mapped pages) or PPUSTATUS.
+static int add_input(uint16_t addr)
+{
+    const uint8_t* const* rdp = bus_read_pages();
+    if (!is_ppustatus(addr) && !(rdp && rdp[addr >> 8])) return 0;
+    for (int i = 0; i < I.n_inputs; ++i) if (I.inputs[i] == addr) return 1;
+    if (I.n_inputs == IDLE_MAX_INPUTS) return 0;
+    I.inputs[I.n_inputs++] = addr;
+    return 1;
+}
+
+// Stores, stack and subroutine opcodes, and read-modify-write on memory (the
+// accumulator forms of ASL/LSR/ROL/ROR are fine)
+static int writes_or_stacks(uint8_t op)
+{
+    switch (op) {
+    case 0x85: case 0x95: case 0x8D: case 0x9D: case 0x99: case 0x81: case 0x91: // STA
+    case 0x86: case 0x96: case 0x8E:                                             // STX
+    case 0x84: case 0x94: case 0x8C:                                             // STY
+    case 0x48: case 0x08: case 0x68: case 0x28:                                  // PHA PHP PLA PLP
+    case 0x20: case 0x60: case 0x40: case 0x00:                                  // JSR RTS RTI BRK
+    case 0x06: case 0x16: case 0x0E: case 0x1E:                                  // ASL
+    case 0x46: case 0x56: case 0x4E: case 0x5E:                                  // LSR
+    case 0x26: case 0x36: case 0x2E: case 0x3E:                                  // ROL
+    case 0x66: case 0x76: case 0x6E: case 0x7E:                                  // ROR
+    case 0xE6: case 0xF6: case 0xEE: case 0xFE:                                  // INC
+    case 0xC6: case 0xD6: case 0xCE: case 0xDE:                                  // DEC
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Decode [head, tail] (tail = the backward jump) and collect its inputs.
+static int analyze(uint16_t head, uint16_t tail)
+{
+    I.n_inputs = 0;
+    I.starts   = 0;
+    uint16_t pc = head;
+    while (pc <= tail) {
+        uint8_t op, lo = 0, hi = 0;
+        if (!code_byte(pc, &op)) return 0;
+        I.starts |= 1ull << (pc - head);
+        if (cpu_dispatch[op] == op_illegal) { pc++; continue; } // 1-byte NOP
+
+        const uint8_t len = cpu_instr_len[op];
+        if (len > 1 && !code_byte((uint16_t)(pc + 1), &lo)) return 0;
+        if (len > 2 && !code_byte((uint16_t)(pc + 2), &hi)) return 0;
+
+        if (writes_or_stacks(op)) return 0;
+        // JMP abs reads nothing; JMP (ind) is an indirect read like any other
+        switch (op == 0x4C ? CPU_AM_IMP : cpu_addrmode_id[op]) {
+        case CPU_AM_ZP:
+            if (!add_input(lo)) return 0;
+            break;
+        case CPU_AM_ABS:
+            if (!add_input((uint16_t)(lo | hi << 8))) return 0;
+            break;
+        case CPU_AM_IMP: case CPU_AM_ACC: case CPU_AM_IMM: case CPU_AM_REL:
+            break;
+        default:
+            return 0; // indexed/indirect reads: address not fixed
+        }
+        if (pc == tail) return 1;
+        pc = (uint16_t)(pc + len);
+    }
+    return 0; // an instruction straddles the tail
+}
+
+// -----------------------------------------------------------------------------
+// Dynamic check
+// -----------------------------------------------------------------------------
+static uint8_t peek_input(uint16_t addr)
+{
+    if (is_ppustatus(addr)) return ppu_ppustatus_get();
+    return bus_read_pages()[addr >> 8][addr & 0xFF];
+}
+
+static void arrive(void)
+{
+    nes_sched_sync_ppu(); // PPUSTATUS inputs must be current
+    idle_snap_t s;
+    memset(&s, 0, sizeof s);
+    s.a = cpu_get_a(); s.x = cpu_get_x(); s.y = cpu_get_y();
+    s.p = cpu_get_p(); s.sp = cpu_get_sp();
+    for (int i = 0; i < I.n_inputs; ++i) s.in[i] = peek_input(I.inputs[i]);
+    s.cycles = cpu_get_cycles();
+
+    I.proven = I.have_last && I.n_chunk > 0 &&
+               s.a == I.last.a && s.x == I.last.x && s.y == I.last.y &&
+               s.p == I.last.p && s.sp == I.last.sp &&
+               memcmp(s.in, I.last.in, sizeof s.in) == 0;
+    if (I.proven) I.period = (uint32_t)(s.cycles - I.last.cycles);
+    I.last      = s;
+    I.have_last = 1;
+    I.n_chunk   = 0;
+}
+
+// `pc` is where the instruction just stepped started
+static void observe(uint16_t pc)
+{
+    const uint16_t now = cpu_get_pc();
+    I.proven = 0;
+
+    if (I.tracking && pc >= I.head && pc < I.end && now >= I.head && now < I.end &&
+        ((I.starts >> (now - I.head)) & 1) && I.n_chunk < IDLE_MAX_INSNS) {
+        I.n_chunk++;
+        if (now == I.head) arrive();
+        return;
+    }
+
+    // Left the loop (or never in one): look for a new short backward jump.
+    I.tracking  = 0;
+    I.have_last = 0;
+    if (now >= pc || pc - now > IDLE_MAX_BYTES) return;
+
+    uint8_t op;
+    if (!code_byte(pc, &op)) return;
+    const int jump = cpu_addrmode_id[op] == CPU_AM_REL || op == 0x4C;
+    if (!jump || !analyze(now, pc)) return;
+
+    I.tracking = 1;
+    I.head     = now;
+    I.end      = (uint16_t)(pc + cpu_instr_len[op]);
+    I.n_chunk  = 0;
+    arrive();
+}
+
+// -----------------------------------------------------------------------------
+// Fast-forward
+// -----------------------------------------------------------------------------
+static uint64_t fast_forward(uint64_t stop)
+{
+    if (!I.proven || I.period == 0) return 0;
+    if (cpu_get_pc() != I.head) return 0;
+    if (cpu_nmi_pending() || (cpu_irq_line_asserted() && !(cpu_get_p() & FLAG_I))) return 0;
+
+    // Iterations that end strictly before the stop
+    const uint64_t now = cpu_get_cycles();
+    if (stop <= now + 1) return 0;
+    const uint64_t k = (stop - now - 1) / I.period;
+    if (k == 0) return 0;
+
+    const uint64_t total = k * I.period;
+    cpu_cycles_add((int)total);
+    I.last.cycles = cpu_get_cycles();
+    I.skipped += total;
+    return total;
+}
+
+void nes_idle_run(uint64_t stop)
+{
+    const uint64_t now = cpu_get_cycles();
+    const int budget = stop > now ? (int)(stop - now) : 1;
+    if (!I.enabled) { cpu_run(budget); return; }
+
+    if (I.free_left > 0) {
+        I.free_left -= cpu_run(budget < I.free_left ? budget : I.free_left);
+        if (I.free_left < 0) I.free_left = 0;
+        return;
+    }
+
+    if (fast_forward(stop)) { I.probed = 0; return; }
+
+    const uint16_t pc = cpu_get_pc();
+    cpu_run(1);
+    observe(pc);
+    if (++I.probed >= IDLE_PROBE_INSNS) {
+        I.probed    = 0;
+        I.free_left = IDLE_FREE_CYCLES;
+        forget_loop(); // the batch is not observed
+    }
+}
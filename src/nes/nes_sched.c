@@ -0,0 +1,190 @@
+// nes_sched.c — event-driven master scheduler
+//
+// The frame loop used to step PPU and APU after every CPU instruction. Now the
+// CPU runs in batches that end at the earliest pending event, and PPU/APU only
+// catch up (nes_sched_sync()) at the end of a batch or right before the CPU
+// touches one of their registers. Each device keeps its own synced cycle, so
+// an APU register access does not drag the PPU along and vice versa:
+//
+//   - a register read sees the device as of the CPU's cycle count, which
+//     already includes the whole reading instruction (the per-instruction
+//     loop showed the state as of the instruction's first cycle);
+//   - a write may move an event (PPUMASK turning rendering on arms the MMC3
+//     counter, $4017 restarts the frame sequencer, $4014 stalls the CPU), so
+//     events are re-armed after it and the CPU yields if the next stop is now
+//     earlier than the end of its batch.
+//
+// Events live in a small table kept sorted by due cycle. VBLANK, MMC3_IRQ,
+// DMA_DONE, SPRITE0 and SPRITE_OVF stop the CPU: they change what the next instruction
+// sees (NMI/IRQ lines, PPUSTATUS) or hand control back after a stall. The APU
+// events never stop the CPU; they split a catch-up into apu_step() calls
+// that end exactly on sequencer steps and sample boundaries, so the audio
+// does not depend on when the APU is synced. It is synced on $4000-$4017
+// access, at the first batch end after a sequencer step (the step's frame
+// IRQ flag is only visible through $4015, and the CPU IRQ line is not wired
+// to it) and at frame end for the audio consumer; samples are produced in
+// bursts there.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "nes_sched.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "apu.h"
+#include "mapper.h"
+
+static struct
+{
+    int      attached;
+    uint64_t ppu_synced;             // CPU cycle the PPU has reached
+    uint64_t apu_synced;             // same for the APU
+    uint64_t horizon;                // end of the running CPU batch
+    uint64_t at[NES_EV_COUNT];       // due cycle per event, NES_SCHED_NEVER if unarmed
+    uint8_t  order[NES_EV_COUNT];    // event ids sorted by due cycle
+} S;
+
+static int is_stop(int ev)
+{
+    return ev == NES_EV_VBLANK || ev == NES_EV_MMC3_IRQ || ev == NES_EV_DMA_DONE ||
+           ev == NES_EV_SPRITE0 || ev == NES_EV_SPRITE_OVF;
+}
+
+static void arm(nes_sched_event_t ev, uint64_t at)
+{
+    uint8_t o[NES_EV_COUNT];
+    int n = 0;
+    for (int i = 0; i < NES_EV_COUNT; ++i) {
+        if (S.order[i] != ev) o[n++] = S.order[i];
+    }
+    int j = n;
+    while (j > 0 && S.at[o[j - 1]] > at) { o[j] = o[j - 1]; --j; }
+    o[j] = (uint8_t)ev;
+
+    S.at[ev] = at;
+    memcpy(S.order, o, sizeof o);
+}
+
+static uint64_t after_dots(uint32_t dots)
+{
+    return S.ppu_synced + (dots + 2) / 3;
+}
+
+// Events derived from PPU (and MMC3) state, as of S.ppu_synced
+static void arm_ppu(void)
+{
+    arm(NES_EV_VBLANK, after_dots(ppu_dots_to_vblank_edge()));
+
+    const int ticks = mapper_mmc3_ticks_until_irq();
+    const uint32_t dots = ticks > 0 ? ppu_dots_to_scanline_tick(ticks) : 0;
+    arm(NES_EV_MMC3_IRQ, dots ? after_dots(dots) : NES_SCHED_NEVER);
+
+    const uint32_t hit = ppu_dots_to_sprite0_hit();
+    arm(NES_EV_SPRITE0, hit ? after_dots(hit) : NES_SCHED_NEVER);
+
+    const uint32_t ovf = ppu_dots_to_sprite_overflow();
+    arm(NES_EV_SPRITE_OVF, ovf ? after_dots(ovf) : NES_SCHED_NEVER);
+}
+
+// Events derived from APU state, as of S.apu_synced
+static void arm_apu(void)
+{
+    arm(NES_EV_APU_FRAME,  S.apu_synced + (uint64_t)apu_cycles_to_frame_step());
+    arm(NES_EV_APU_SAMPLE, S.apu_synced + (uint64_t)apu_cycles_to_sample());
+}
+
+static void attach(void)
+{
+    S.attached   = 1;
+    S.ppu_synced = S.apu_synced = cpu_get_cycles();
+    S.horizon    = NES_SCHED_NEVER;
+    for (int i = 0; i < NES_EV_COUNT; ++i) {
+        S.at[i]    = NES_SCHED_NEVER;
+        S.order[i] = (uint8_t)i;
+    }
+    arm_ppu();
+    arm_apu();
+}
+
+static void catch_up_ppu(uint64_t now)
+{
+    if (now == S.ppu_synced) return;
+    ppu_step((int)(now - S.ppu_synced));
+    S.ppu_synced = now;
+    arm_ppu();
+}
+
+// In chunks that end on the APU's own events
+static void catch_up_apu(uint64_t now)
+{
+    while (S.apu_synced < now) {
+        const uint64_t f = S.at[NES_EV_APU_FRAME], s = S.at[NES_EV_APU_SAMPLE];
+        uint64_t to = f < s ? f : s;
+        if (to > now) to = now;
+        apu_step((int)(to - S.apu_synced));
+        S.apu_synced = to;
+        if (to == f || to == s) arm_apu();
+    }
+}
+
+// 0 when detached or after re-attaching (the CPU was reset)
+static int attached_at(uint64_t now)
+{
+    if (!S.attached) return 0;
+    if (now < S.ppu_synced || now < S.apu_synced) { attach(); return 0; }
+    return 1;
+}
+
+// -----------------------------------------------------------------------------
+// Public API
+// -----------------------------------------------------------------------------
+void nes_sched_reset(void) { S.attached = 0; }
+
+uint64_t nes_sched_next_stop(void)
+{
+    if (!S.attached) attach();
+    for (int i = 0; i < NES_EV_COUNT; ++i) {
+        const int ev = S.order[i];
+        if (is_stop(ev)) return S.at[ev];
+    }
+    return NES_SCHED_NEVER;
+}
+
+uint64_t nes_sched_event_at(nes_sched_event_t ev)
+{
+    return S.attached && ev < NES_EV_COUNT ? S.at[ev] : NES_SCHED_NEVER;
+}
+
+void nes_sched_begin(uint64_t stop) { S.horizon = stop; }
+
+void nes_sched_sync(void)
+{
+    const uint64_t now = cpu_get_cycles();
+    if (!attached_at(now)) return;
+    catch_up_ppu(now);
+    if (S.at[NES_EV_APU_FRAME] <= now) catch_up_apu(now);
+    if (S.at[NES_EV_DMA_DONE] <= now) arm(NES_EV_DMA_DONE, NES_SCHED_NEVER);
+}
+
+void nes_sched_sync_ppu(void)
+{
+    const uint64_t now = cpu_get_cycles();
+    if (attached_at(now)) catch_up_ppu(now);
+}
+
+void nes_sched_sync_apu(void)
+{
+    const uint64_t now = cpu_get_cycles();
+    if (attached_at(now)) catch_up_apu(now);
+}
+
+void nes_sched_io_written(int dma_stall)
+{
+    if (!S.attached) return;
+    // The bus synced the written device right before the write and the other
+    // one's state has not changed, so both re-arm exactly from their cycle.
+    arm_ppu();
+    arm_apu();
+    if (dma_stall > 0) arm(NES_EV_DMA_DONE, cpu_get_cycles());
+    if (nes_sched_next_stop() < S.horizon) cpu_yield();
+}
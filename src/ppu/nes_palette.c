@@ -1,5 +1,11 @@
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include "nes_palette.h"
+#include "ppu_mem.h"
+#include "ppu_simd.h"
+
+#define LINE_W 256
 
 // Common “NTSC-like” palette. Values are ARGB8888 (0xAARRGGBB).
 const uint32_t NES_PAL[64] = {
@@ -12,3 +18,145 @@ const uint32_t NES_PAL[64] = {
     0xFFFFFEFF,0xFFC0DFFF,0xFFD3D2FF,0xFFE8C8FF,0xFFFBC2FF,0xFFFFC4EA,0xFFFFCCCB,0xFFF7D8A5,
     0xFFE4E594,0xFFCFEF96,0xFFBDF4AB,0xFFB3F3CC,0xFFB5EBF2,0xFFB8B8B8,0xFF000000,0xFF000000
   };
+
+// Active colours, one block of 64 per emphasis value (bit 0 red, 1 green,
+// 2 blue on NTSC)
+static uint32_t s_colors[8][64];
+static int      s_ready = 0;
+
+static uint32_t argb(unsigned r, unsigned g, unsigned b)
+{
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// Each emphasis bit darkens the other two channels (once, however many
+// bits are set)
+static void derive_emphasis(void)
+{
+    for (int e = 1; e < 8; ++e) {
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t c = s_colors[0][i];
+            unsigned r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+            if (e & 6) r = r * 13 / 16;   // green or blue emphasized
+            if (e & 5) g = g * 13 / 16;   // red or blue
+            if (e & 3) b = b * 13 / 16;   // red or green
+            s_colors[e][i] = argb(r, g, b);
+        }
+    }
+}
+
+static void changed(void)
+{
+    s_ready = 1;
+    ppu_mem_palette_refresh();
+}
+
+void nes_palette_use_default(void)
+{
+    for (int i = 0; i < 64; ++i) s_colors[0][i] = NES_PAL[i];
+    derive_emphasis();
+    changed();
+}
+
+const uint32_t* nes_palette_colors(int emphasis)
+{
+    if (!s_ready) nes_palette_use_default();
+    return s_colors[emphasis & 7];
+}
+
+int nes_palette_set_rgb(const uint8_t* rgb, size_t size)
+{
+    if (!rgb || (size != 64 * 3 && size != 8 * 64 * 3)) return 0;
+    const int blocks = size == 64 * 3 ? 1 : 8;
+    for (int e = 0; e < blocks; ++e) {
+        for (int i = 0; i < 64; ++i) {
+            const uint8_t* p = rgb + (e * 64 + i) * 3;
+            s_colors[e][i] = argb(p[0], p[1], p[2]);
+        }
+    }
+    if (blocks == 1) derive_emphasis();
+    changed();
+    return 1;
+}
+
+int nes_palette_load(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "palette: failed to open %s\n", path);
+        return 0;
+    }
+    uint8_t buf[8 * 64 * 3 + 1];
+    const size_t n = fread(buf, 1, sizeof buf, f);
+    fclose(f);
+
+    if (!nes_palette_set_rgb(buf, n)) {
+        fprintf(stderr, "palette: %s is %zu bytes, expected 192 or 1536\n", path, n);
+        return 0;
+    }
+    return 1;
+}
+
+// One emphasis block of the active colours in format `fmt`
+static void build_lut(nes_pixfmt_t fmt, int emphasis, uint32_t lut32[64], uint16_t lut16[64])
+{
+    const uint32_t* c = nes_palette_colors(emphasis);
+    for (int i = 0; i < 64; ++i) {
+        const uint32_t r = (c[i] >> 16) & 0xFF, g = (c[i] >> 8) & 0xFF, b = c[i] & 0xFF;
+        switch (fmt) {
+        case NES_PIXFMT_RGB565:   lut16[i] = (uint16_t)((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3)); break;
+        case NES_PIXFMT_RGBA8888: {
+            const uint8_t px[4] = { (uint8_t)r, (uint8_t)g, (uint8_t)b, 0xFF };
+            memcpy(&lut32[i], px, 4);
+            break;
+        }
+        default:                  lut32[i] = c[i]; break;
+        }
+    }
+}
+
+void nes_palette_convert(void* dst, int pitch_bytes, nes_pixfmt_t fmt,
+                         const uint8_t* src, const uint8_t* emphasis, int lines)
+{
+    if (!dst || !src || lines <= 0) return;
+
+    // Tables built as the emphasis values show up (usually just one)
+    uint32_t lut32[8][64];
+    uint16_t lut16[8][64];
+    unsigned built = 0;
+
+    const ppu_kernels_t* k = ppu_simd_active();
+    uint8_t* out = (uint8_t*)dst;
+    for (int y = 0; y < lines; ++y, out += pitch_bytes, src += LINE_W) {
+        const int e = emphasis ? emphasis[y] & 7 : 0;
+        if (!(built & (1u << e))) {
+            build_lut(fmt, e, lut32[e], lut16[e]);
+            built |= 1u << e;
+        }
+        if (fmt == NES_PIXFMT_RGB565) k->expand16((uint16_t*)(void*)out, src, lut16[e], LINE_W);
+        else                          k->expand32((uint32_t*)(void*)out, src, lut32[e], LINE_W);
+    }
+}
+
+void nes_palette_convert16(void* dst, int pitch_bytes, nes_pixfmt_t fmt,
+                           const uint16_t* src, int lines)
+{
+    if (!dst || !src || lines <= 0) return;
+
+    uint32_t lut32[8][64];
+    uint16_t lut16[8][64];
+    unsigned built = 0;
+
+    uint8_t* out = (uint8_t*)dst;
+    for (int y = 0; y < lines; ++y, out += pitch_bytes, src += LINE_W) {
+        for (int x = 0; x < LINE_W; ++x) {
+            const int e = (src[x] >> 6) & 7, i = src[x] & 63;
+            if (!(built & (1u << e))) {
+                build_lut(fmt, e, lut32[e], lut16[e]);
+                built |= 1u << e;
+            }
+            if (fmt == NES_PIXFMT_RGB565) ((uint16_t*)(void*)out)[x] = lut16[e][i];
+            else                          ((uint32_t*)(void*)out)[x] = lut32[e][i];
+        }
+    }
+}
@@ -0,0 +1,140 @@
+// src/ppu/ppu_bg_plane.c
+// The background of all four nametables, decoded once into a 512x480 plane
+// of palette RAM offsets and patched as the game changes it. Most frames
+// touch a handful of tiles and the scroll; the lines then only copy.
+//
+// Staleness is tracked two ways. Nametable/attribute writes and mapping
+// changes set per-tile dirty bits (ppu_mem.c calls the hooks below, or the
+// render thread's replay of its writes, ppu_defer.c). Pattern
+// changes are caught on use instead: every tile remembers the CHR page its
+// pattern came from and that page's write generation, so a bank switch only
+// re-decodes the tiles it actually moved, whenever they are next shown.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ppu_bg_plane.h"
+#include "ppu_mem.h"
+#include "ppu_tile_cache.h"
+#include "ppu_simd.h"
+
+#define PLANE_W   512
+#define PLANE_H   480
+#define TILES_X   64
+#define TILES_Y   60
+#define CHR_PAGES 256          // pages tracked; tiles from higher ones never stay valid
+
+typedef struct
+{
+    int16_t  page;             // CHR page of the pattern (-1: none yet)
+    uint8_t  slot;             // 1KB slot within the BG pattern table (tile index / 64)
+    uint32_t gen;              // s_page_gen[page] at decode time
+} tile_src_t;
+
+static uint8_t    s_px[PLANE_H][PLANE_W];
+static uint64_t   s_dirty[TILES_Y];           // bit tx: decode before use
+static tile_src_t s_src[TILES_Y][TILES_X];
+static bool       s_ready;                    // s_dirty set up (all dirty at first)
+static uint32_t   s_page_gen[CHR_PAGES];      // bumped by CHR-RAM writes
+static ppu_bg_plane_stats_t s_cur, s_last;
+
+static void decode(const ppu_view_t* mv, int tx, int ty, uint16_t base, const int pages[4])
+{
+    // Quadrant = nametable; rows 30-59 are the lower pair
+    const int n  = (ty >= 30) * 2 + (tx >= 32);
+    const int cx = tx & 31, cy = ty >= 30 ? ty - 30 : ty;
+    const uint8_t* nt = mv->nt[n];
+    const uint8_t tile = nt[cy * 32 + cx];
+    const uint8_t attr = nt[0x3C0 + (cy >> 2) * 8 + (cx >> 2)];
+    const uint8_t pal  = (uint8_t)(((attr >> (((cy & 2) << 1) | (cx & 2))) & 3) << 2);
+    ppu_tile_t spill;
+    const ppu_tile_t* t = ppu_tile_get((uint16_t)(base + (uint16_t)tile * 16u), &spill);
+
+    // The line kernel does a column of 8 rows as 8 tiles side by side
+    const uint8_t* rows[8];
+    uint8_t pals[8], px[64];
+    for (int r = 0; r < 8; ++r) { rows[r] = t->px[0][r]; pals[r] = pal; }
+    ppu_simd_active()->bg_tiles(px, rows, pals, 8);
+    for (int r = 0; r < 8; ++r) memcpy(&s_px[ty * 8 + r][tx * 8], px + r * 8, 8);
+
+    const int slot = tile >> 6, page = pages[slot];
+    s_src[ty][tx].page = (int16_t)page;
+    s_src[ty][tx].slot = (uint8_t)slot;
+    s_src[ty][tx].gen  = (unsigned)page < CHR_PAGES ? s_page_gen[page] : 0;
+    s_dirty[ty] &= ~(1ull << tx);
+    s_cur.decoded++;
+}
+
+static inline bool tile_valid(int tx, int ty, const int pages[4])
+{
+    const tile_src_t* src = &s_src[ty][tx];
+    return !((s_dirty[ty] >> tx) & 1u)
+        && src->page == pages[src->slot]
+        && (unsigned)src->page < CHR_PAGES
+        && src->gen == s_page_gen[src->page];
+}
+
+bool ppu_bg_plane_line(const ppu_view_t* mv, uint8_t* out, uint16_t v, uint8_t fine_x, uint8_t ctrl)
+{
+    const int cy = (v >> 5) & 31;
+    if (cy >= 30) return false;
+    if (!s_ready) ppu_bg_plane_invalidate();
+
+    // A PPUCTRL pattern table switch needs nothing special: the other
+    // table's slots show other pages, so the page check catches it
+    const uint16_t base = (ctrl & 0x10) ? 0x1000u : 0x0000u;
+    int pages[4];
+    for (int i = 0; i < 4; ++i) pages[i] = mv->chr_page[(base >> 10) + i];
+
+    // 33 tiles from v's, wrapping around the plane like v does
+    const int ty  = ((v >> 11) & 1) * 30 + cy;
+    const int tx0 = ((v >> 10) & 1) * 32 + (v & 31);
+    for (int i = 0; i < 33; ++i) {
+        const int tx = (tx0 + i) & (TILES_X - 1);
+        if (!tile_valid(tx, ty, pages)) decode(mv, tx, ty, base, pages);
+    }
+    s_cur.lookups += 33;
+
+    const uint8_t* row = s_px[ty * 8 + ((v >> 12) & 7)];
+    const int x = tx0 * 8 + fine_x;
+    const int first = PLANE_W - x < 256 ? PLANE_W - x : 256;
+    memcpy(out, row + x, (size_t)first);
+    memcpy(out + first, row, (size_t)(256 - first));
+    return true;
+}
+
+void ppu_bg_plane_nt_written(int n, uint16_t off)
+{
+    const int qx = (n & 1) * 32, qy = (n >> 1) * 30;
+    off &= 0x03FF;
+    if (off < 0x3C0) {
+        s_dirty[qy + (off >> 5)] |= 1ull << (qx + (off & 31));
+        return;
+    }
+    // Attribute byte: a 4x4 tile block (the last row only half on screen)
+    const int a = off - 0x3C0, ax = (a & 7) * 4, ay = (a >> 3) * 4;
+    for (int y = ay; y < ay + 4 && y < 30; ++y) s_dirty[qy + y] |= 0xFull << (qx + ax);
+}
+
+void ppu_bg_plane_invalidate(void)
+{
+    memset(s_dirty, 0xFF, sizeof s_dirty);
+    s_ready = true;
+}
+
+void ppu_bg_plane_chr_written(int page)
+{
+    if ((unsigned)page < CHR_PAGES) s_page_gen[page]++;
+}
+
+void ppu_bg_plane_frame_start(void)
+{
+    s_last = s_cur;
+    memset(&s_cur, 0, sizeof s_cur);
+}
+
+ppu_bg_plane_stats_t ppu_bg_plane_frame_stats(void)
+{
+    return s_last;
+}
@@ -0,0 +1,453 @@
+// src/ppu/ppu_defer.c
+// Scanline drawing on a worker thread. With it on, the emulation thread does
+// not draw: at dot 256 of each visible line ppu_render_scanline() logs the
+// line (VRAM address, fine X, PPUCTRL/PPUMASK, the sprites evaluated for it)
+// into a ring, after whatever else the line reads that changed since the
+// previous one: the nametable/CHR mapping, the resolved palette, OAM, and
+// every nametable and CHR-RAM byte written meanwhile, in emulation order. The
+// worker replays the ring into its own copy of that memory and draws each
+// line from it through ppu_render_draw_line(), so the frame is the one
+// inline drawing makes, while the CPU runs on into the next lines.
+//
+// The worker owns the tile cache and the background plane meanwhile: the
+// replay calls their invalidation hooks, not ppu_mem.c. Memory is copied
+// lazily, a 1KB page the first time a line shows it (writes to a page before
+// that need no logging); CHR-ROM is shared. Sprite 0 hit and overflow stay
+// on the emulation thread, from live memory (ppu_render.c).
+//
+// CHR slots served by mapper callbacks (no page mapped) cannot be copied:
+// lines showing one are drawn inline, with the worker idle.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ppu.h"
+#include "ppu_defer.h"
+#include "ppu_tile_cache.h"
+#include "ppu_bg_plane.h"
+
+#if PPU_RENDER_THREAD
+
+#include <threads.h>
+#include <stdatomic.h>
+
+#define RING_SIZE  (1u << 20)   // ~15 frames of heavy logging
+#define NT_IDS     8            // nametable page copies (VRAM 4 + mapper 4)
+#define CHR_IDS    32           // CHR-RAM page copies (32KB)
+#define SPIN_YIELDS 256         // worker: yields before it sleeps
+
+enum
+{
+    REC_WRAP,       // rest of the ring unused, go on at the start
+    REC_NT,         // a = nametable copy, b = offset, c = value
+    REC_CHR,        // a = CHR copy, b = offset, c = value
+    REC_NT_PAGE,    // a = nametable copy; 1KB contents
+    REC_CHR_PAGE,   // a = CHR copy, c = physical page; 1KB contents
+    REC_MAP,        // map_rec_t
+    REC_PAL,        // 32 ARGB entries, then 32 colour indexes
+    REC_OAM,        // 256 bytes
+    REC_LINE,       // a = y, b = v, c = fine X | ctrl << 8 | mask << 16 | count << 24; sprites
+};
+
+typedef struct
+{
+    uint8_t  type;
+    uint8_t  a;
+    uint16_t b;
+    uint32_t c;
+} rec_t;
+
+typedef struct
+{
+    const uint8_t* chr_rom[8];   // CHR-ROM slots, shared
+    int32_t        chr_page[8];
+    int8_t         chr_id[8];    // CHR-RAM slots: copy, else -1
+    int8_t         nt_id[4];
+} map_rec_t;
+
+static _Alignas(8) uint8_t s_ring[RING_SIZE];
+static atomic_uint_fast64_t s_head;   // bytes published
+static atomic_uint_fast64_t s_tail;   // bytes replayed
+static atomic_bool s_sleeping, s_quit;
+static mtx_t  s_mtx;
+static cnd_t  s_cnd;
+static thrd_t s_thread;
+static bool   s_on, s_active, s_fallback;
+
+// --- Emulation side: what the worker has ---
+static uint64_t        s_wr;                  // bytes written (published at s_head)
+static const uint8_t*  e_nt_ids[NT_IDS];      // live page of each copy
+static const uint8_t*  e_chr_ids[CHR_IDS];
+static int             e_nt_n, e_chr_n;
+static const uint8_t*  e_nt[4];               // mapping of the last REC_MAP
+static const uint8_t*  e_chr[8];
+static int             e_page[8];
+static uint8_t         e_writable;
+static bool            e_map_ok, e_pal_ok, e_oam_ok;
+static uint32_t        e_argb[32];
+static uint8_t         e_index[32];
+static uint8_t         e_oam[256];
+
+// --- Worker side: the copy it draws from ---
+static uint8_t         w_nt_mem[NT_IDS][0x400];
+static uint8_t         w_chr_mem[CHR_IDS][0x400];
+static int             w_chr_id_page[CHR_IDS];
+static uint8_t*        w_nt[4];
+static const uint8_t*  w_chr[8];
+static int             w_chr_page[8];
+static uint32_t        w_argb[32];
+static uint8_t         w_index[32];
+static uint8_t         w_oam[256];
+static const ppu_view_t w_view = { w_nt, w_chr, w_chr_page, w_argb, w_index, w_oam };
+
+static void update_active(void)
+{
+    s_active = s_on && !s_fallback && ppu_get_mode() == PPU_MODE_SCANLINE;
+}
+
+static void publish(void)
+{
+    atomic_store(&s_head, s_wr);
+    if (atomic_load(&s_sleeping)) {
+        mtx_lock(&s_mtx);
+        cnd_signal(&s_cnd);
+        mtx_unlock(&s_mtx);
+    }
+}
+
+static void wait_room(uint64_t n)
+{
+    if (s_wr + n - atomic_load_explicit(&s_tail, memory_order_acquire) <= RING_SIZE) return;
+    publish();
+    while (s_wr + n - atomic_load_explicit(&s_tail, memory_order_acquire) > RING_SIZE) thrd_yield();
+}
+
+// Appends a record and returns its payload (`len` bytes) to fill in; it is
+// the worker's at the next publish()
+static uint8_t* rec_begin(uint8_t type, uint8_t a, uint16_t b, uint32_t c, size_t len)
+{
+    const size_t need = (sizeof(rec_t) + len + 7) & ~(size_t)7;
+    size_t pos = (size_t)(s_wr % RING_SIZE);
+    if (pos + need > RING_SIZE) {
+        wait_room(RING_SIZE - pos + need);
+        ((rec_t*)(void*)(s_ring + pos))->type = REC_WRAP;
+        s_wr += RING_SIZE - pos;
+        pos = 0;
+    } else {
+        wait_room(need);
+    }
+    rec_t* r = (rec_t*)(void*)(s_ring + pos);
+    *r = (rec_t){ type, a, b, c };
+    s_wr += need;
+    return (uint8_t*)(r + 1);
+}
+
+static void forget(void)
+{
+    e_nt_n = e_chr_n = 0;
+    e_map_ok = e_pal_ok = e_oam_ok = false;
+}
+
+// Copy id of a page, sending it over the first time; -1 if out of ids
+static int nt_id(const uint8_t* page)
+{
+    for (int i = 0; i < e_nt_n; ++i) {
+        if (e_nt_ids[i] == page) return i;
+    }
+    if (e_nt_n == NT_IDS) return -1;
+    memcpy(rec_begin(REC_NT_PAGE, (uint8_t)e_nt_n, 0, 0, 0x400), page, 0x400);
+    e_nt_ids[e_nt_n] = page;
+    return e_nt_n++;
+}
+
+static int chr_id(const uint8_t* page, int phys)
+{
+    for (int i = 0; i < e_chr_n; ++i) {
+        if (e_chr_ids[i] == page) return i;
+    }
+    if (e_chr_n == CHR_IDS) return -1;
+    memcpy(rec_begin(REC_CHR_PAGE, (uint8_t)e_chr_n, 0, (uint32_t)phys, 0x400), page, 0x400);
+    e_chr_ids[e_chr_n] = page;
+    return e_chr_n++;
+}
+
+static void send_map(const ppu_view_t* live)
+{
+    uint8_t writable = 0;
+    for (int s = 0; s < 8; ++s) writable |= (uint8_t)(ppu_mem_chr_writable(s) << s);
+    if (e_map_ok && writable == e_writable
+        && memcmp(e_nt, live->nt, sizeof e_nt) == 0
+        && memcmp(e_chr, live->chr, sizeof e_chr) == 0
+        && memcmp(e_page, live->chr_page, sizeof e_page) == 0) return;
+
+    map_rec_t m;
+    for (;;) {
+        bool ok = true;
+        for (int n = 0; n < 4; ++n) {
+            m.nt_id[n] = (int8_t)nt_id(live->nt[n]);
+            ok &= m.nt_id[n] >= 0;
+        }
+        for (int s = 0; s < 8; ++s) {
+            const bool ram = (writable >> s) & 1u;
+            m.chr_rom[s]  = ram ? NULL : live->chr[s];
+            m.chr_page[s] = live->chr_page[s];
+            m.chr_id[s]   = (int8_t)(ram ? chr_id(live->chr[s], live->chr_page[s]) : -1);
+            ok &= !ram || m.chr_id[s] >= 0;
+        }
+        if (ok) break;
+        // Out of copies: start over, the worker replaces them in order
+        forget();
+    }
+    memcpy(rec_begin(REC_MAP, 0, 0, 0, sizeof m), &m, sizeof m);
+
+    memcpy(e_nt, live->nt, sizeof e_nt);
+    memcpy(e_chr, live->chr, sizeof e_chr);
+    memcpy(e_page, live->chr_page, sizeof e_page);
+    e_writable = writable;
+    e_map_ok   = true;
+}
+
+bool ppu_defer_line(int y, uint16_t v, uint8_t fine_x, uint8_t ctrl, uint8_t mask,
+                    const uint8_t* sprites, int count)
+{
+    if (!s_on) return false;
+
+    const ppu_view_t* live = ppu_mem_view();
+    bool mapped = true;
+    for (int s = 0; s < 8; ++s) mapped &= live->chr[s] != NULL;
+    if (!mapped) {
+        if (!s_fallback) {
+            ppu_defer_reset();
+            s_fallback = true;
+            update_active();
+        }
+        return false;
+    }
+    if (s_fallback) {
+        s_fallback = false;
+        update_active();
+    }
+    if (!s_active) return false;
+
+    send_map(live);
+    if (!e_pal_ok || memcmp(e_argb, live->pal_argb, sizeof e_argb) || memcmp(e_index, live->pal_index, sizeof e_index)) {
+        uint8_t* d = rec_begin(REC_PAL, 0, 0, 0, sizeof e_argb + sizeof e_index);
+        memcpy(e_argb, live->pal_argb, sizeof e_argb);
+        memcpy(e_index, live->pal_index, sizeof e_index);
+        memcpy(d, e_argb, sizeof e_argb);
+        memcpy(d + sizeof e_argb, e_index, sizeof e_index);
+        e_pal_ok = true;
+    }
+    // OAM only matters to lines drawing sprites
+    if ((mask & 0x10) && count > 0 && (!e_oam_ok || memcmp(e_oam, live->oam, sizeof e_oam))) {
+        memcpy(e_oam, live->oam, sizeof e_oam);
+        memcpy(rec_begin(REC_OAM, 0, 0, 0, sizeof e_oam), e_oam, sizeof e_oam);
+        e_oam_ok = true;
+    }
+
+    const uint32_t c = fine_x | (uint32_t)ctrl << 8 | (uint32_t)mask << 16 | (uint32_t)count << 24;
+    memcpy(rec_begin(REC_LINE, (uint8_t)y, v, c, (size_t)count), sprites, (size_t)count);
+    if ((y & 7) == 7) publish();
+    return true;
+}
+
+void ppu_defer_nt_written(const uint8_t* page, uint16_t addr, uint8_t value)
+{
+    for (int i = 0; i < e_nt_n; ++i) {
+        if (e_nt_ids[i] == page) { rec_begin(REC_NT, (uint8_t)i, addr & 0x03FF, value, 0); return; }
+    }
+}
+
+void ppu_defer_chr_written(const uint8_t* page, uint16_t addr, uint8_t value)
+{
+    for (int i = 0; i < e_chr_n; ++i) {
+        if (e_chr_ids[i] == page) { rec_begin(REC_CHR, (uint8_t)i, addr & 0x03FF, value, 0); return; }
+    }
+}
+
+// --- Worker ---
+
+// Applies the record at ring offset pos; returns its size
+static size_t replay(size_t pos)
+{
+    const rec_t* r = (const rec_t*)(const void*)(s_ring + pos);
+    const uint8_t* d = (const uint8_t*)(r + 1);
+    size_t len = 0;
+
+    switch (r->type) {
+    case REC_WRAP:
+        return RING_SIZE - pos;
+    case REC_NT:
+        w_nt_mem[r->a][r->b] = (uint8_t)r->c;
+        for (int m = 0; m < 4; ++m) {
+            if (w_nt[m] == w_nt_mem[r->a]) ppu_bg_plane_nt_written(m, r->b);
+        }
+        break;
+    case REC_CHR:
+        w_chr_mem[r->a][r->b] = (uint8_t)r->c;
+        ppu_tile_cache_invalidate(w_chr_id_page[r->a], r->b);
+        ppu_bg_plane_chr_written(w_chr_id_page[r->a]);
+        break;
+    case REC_NT_PAGE:
+        len = 0x400;
+        memcpy(w_nt_mem[r->a], d, len);
+        ppu_bg_plane_invalidate();
+        break;
+    case REC_CHR_PAGE:
+        // Written unseen since the cache last decoded it, maybe
+        len = 0x400;
+        memcpy(w_chr_mem[r->a], d, len);
+        w_chr_id_page[r->a] = (int)r->c;
+        for (uint16_t off = 0; off < 0x400; off += 16) ppu_tile_cache_invalidate((int)r->c, off);
+        ppu_bg_plane_chr_written((int)r->c);
+        break;
+    case REC_MAP: {
+        map_rec_t m;
+        len = sizeof m;
+        memcpy(&m, d, len);
+        bool moved = false;
+        for (int n = 0; n < 4; ++n) {
+            moved |= w_nt[n] != w_nt_mem[m.nt_id[n]];
+            w_nt[n] = w_nt_mem[m.nt_id[n]];
+        }
+        if (moved) ppu_bg_plane_invalidate();
+        for (int s = 0; s < 8; ++s) {
+            w_chr[s]      = m.chr_id[s] >= 0 ? w_chr_mem[m.chr_id[s]] : m.chr_rom[s];
+            w_chr_page[s] = m.chr_page[s];
+        }
+        break;
+    }
+    case REC_PAL:
+        len = sizeof w_argb + sizeof w_index;
+        memcpy(w_argb, d, sizeof w_argb);
+        memcpy(w_index, d + sizeof w_argb, sizeof w_index);
+        break;
+    case REC_OAM:
+        len = sizeof w_oam;
+        memcpy(w_oam, d, len);
+        break;
+    case REC_LINE:
+        len = r->c >> 24;
+        ppu_render_draw_line(&w_view, r->a, r->b, (uint8_t)r->c, (uint8_t)(r->c >> 8),
+                             (uint8_t)(r->c >> 16), d, (int)len);
+        break;
+    }
+    return (sizeof(rec_t) + len + 7) & ~(size_t)7;
+}
+
+static int worker_main(void* arg)
+{
+    (void)arg;
+    uint64_t rd = 0;
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+        for (int i = 0; head == rd && i < SPIN_YIELDS; ++i) {
+            thrd_yield();
+            head = atomic_load_explicit(&s_head, memory_order_acquire);
+        }
+        if (head == rd) {
+            mtx_lock(&s_mtx);
+            atomic_store(&s_sleeping, true);
+            while ((head = atomic_load(&s_head)) == rd && !atomic_load(&s_quit)) cnd_wait(&s_cnd, &s_mtx);
+            atomic_store(&s_sleeping, false);
+            mtx_unlock(&s_mtx);
+            if (head == rd) return 0;   // quit, with everything drawn
+        }
+        while (rd != head) {
+            rd += replay((size_t)(rd % RING_SIZE));
+            atomic_store_explicit(&s_tail, rd, memory_order_release);
+        }
+    }
+}
+
+bool ppu_defer_active(void)
+{
+    return s_active;
+}
+
+void ppu_defer_sync(void)
+{
+    if (!s_on) return;
+    publish();
+    while (atomic_load_explicit(&s_tail, memory_order_acquire) != s_wr) thrd_yield();
+}
+
+void ppu_defer_reset(void)
+{
+    if (!s_on) return;
+    ppu_defer_sync();
+    if (s_active) {
+        // Writes to pages the worker had no copy of went unlogged
+        ppu_tile_cache_flush();
+        ppu_bg_plane_invalidate();
+    }
+    forget();
+    update_active();
+}
+
+bool ppu_set_render_thread(bool on)
+{
+    if (on == s_on) return s_on;
+
+    if (on) {
+        s_wr = 0;
+        atomic_store(&s_head, 0);
+        atomic_store(&s_tail, 0);
+        atomic_store(&s_quit, false);
+        if (mtx_init(&s_mtx, mtx_plain) != thrd_success) return false;
+        if (cnd_init(&s_cnd) != thrd_success) {
+            mtx_destroy(&s_mtx);
+            return false;
+        }
+        if (thrd_create(&s_thread, worker_main, NULL) != thrd_success) {
+            cnd_destroy(&s_cnd);
+            mtx_destroy(&s_mtx);
+            return false;
+        }
+        s_on = true;
+        s_fallback = false;
+        forget();
+        update_active();
+        return true;
+    }
+
+    // Drained, and the caches handed back to inline drawing
+    ppu_defer_reset();
+    mtx_lock(&s_mtx);
+    atomic_store(&s_quit, true);
+    cnd_signal(&s_cnd);
+    mtx_unlock(&s_mtx);
+    thrd_join(s_thread, NULL);
+    cnd_destroy(&s_cnd);
+    mtx_destroy(&s_mtx);
+    s_on = false;
+    update_active();
+    return false;
+}
+
+bool ppu_get_render_thread(void)
+{
+    return s_on;
+}
+
+#else // !PPU_RENDER_THREAD: always inline
+
+bool ppu_defer_active(void) { return false; }
+
+bool ppu_defer_line(int y, uint16_t v, uint8_t fine_x, uint8_t ctrl, uint8_t mask,
+                    const uint8_t* sprites, int count)
+{
+    (void)y; (void)v; (void)fine_x; (void)ctrl; (void)mask; (void)sprites; (void)count;
+    return false;
+}
+
+void ppu_defer_nt_written(const uint8_t* page, uint16_t addr, uint8_t value)  { (void)page; (void)addr; (void)value; }
+void ppu_defer_chr_written(const uint8_t* page, uint16_t addr, uint8_t value) { (void)page; (void)addr; (void)value; }
+void ppu_defer_sync(void)  {}
+void ppu_defer_reset(void) {}
+
+bool ppu_set_render_thread(bool on) { (void)on; return false; }
+bool ppu_get_render_thread(void)    { return false; }
+
+#endif
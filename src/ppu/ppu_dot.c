@@ -0,0 +1,300 @@
+// src/ppu/ppu_dot.c
+// Dot-accurate rendering pipeline (PPU_MODE_DOT), the reference for the
+// scanline renderer in ppu_render.c. ppu_timing.c calls ppu_dot_tick() for
+// every dot of the visible and pre-render lines and it does what the chip
+// does on that dot:
+//
+//   dots 1-256, 321-336  nametable / attribute / pattern lo / pattern hi
+//                        fetches, two dots each; coarse X +1 after each tile,
+//                        Y +1 at dot 256; 16-bit shifters reloaded every 8
+//   dots 1-64            secondary OAM cleared to $FF
+//   dots 65-256          sprite evaluation for the next line, one OAM byte
+//                        read on odd dots and written on even dots, including
+//                        the overflow search's diagonal OAM walk
+//   dots 257-320         pattern fetches for the 8 sprite slots (tile $FF for
+//                        empty ones); X reloaded from t at 257
+//   pre-render 280-304   Y reloaded from t
+//
+// Pattern fetches go through ppu_mem_read() in that order, whose CHR watch
+// (ppu_mem_set_chr_watch()) lets the MMC3 count A12 rises itself. Pixels are composed as they
+// leave the shifters, with sprite 0 hit and overflow set in PPUSTATUS
+// (ppu_timing.c clears both at the end of vblank); headless frames skip the
+// composing and only look at sprite 0's pixels for the hit.
+// Nametable garbage fetches and the odd-frame skipped dot are not modelled.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ppu.h"
+#include "ppu_regs.h"
+#include "ppu_mem.h"
+
+#define NES_W 256
+#define NES_H 240
+#define PRERENDER_LINE 261
+
+static struct
+{
+    // Background
+    uint8_t  nt, at;                 // latched tile index and its 2-bit palette
+    uint8_t  pt_lo, pt_hi;           // latched pattern bytes
+    uint16_t bg_lo, bg_hi;           // pattern shifters (bit 15 = next pixel)
+    uint16_t at_lo, at_hi;           // palette shifters, 8 copies per tile
+
+    // Sprite evaluation (for the next line)
+    uint8_t  sec[32];                // secondary OAM
+    uint8_t  latch;                  // byte read on the odd dot
+    int      n, m, found;
+    bool     eval_done;
+    bool     spr0_found;             // OAM entry 0 is in `sec`
+
+    // Sprite output (this line)
+    int      spr_count;
+    bool     spr0_line;
+    uint8_t  spr_lo[8], spr_hi[8], spr_attr[8], spr_x[8];
+} D;
+
+void ppu_dot_reset(void)
+{
+    memset(&D, 0, sizeof D);
+}
+
+// -----------------------------------------------------------------------------
+// Background
+// -----------------------------------------------------------------------------
+static void bg_reload(void)
+{
+    D.bg_lo = (uint16_t)((D.bg_lo & 0xFF00u) | D.pt_lo);
+    D.bg_hi = (uint16_t)((D.bg_hi & 0xFF00u) | D.pt_hi);
+    D.at_lo = (uint16_t)((D.at_lo & 0xFF00u) | ((D.at & 1) ? 0xFFu : 0x00u));
+    D.at_hi = (uint16_t)((D.at_hi & 0xFF00u) | ((D.at & 2) ? 0xFFu : 0x00u));
+}
+
+static void bg_fetch(int dot)
+{
+    uint16_t v;
+    ppu_regs_get_vram_addr(&v, NULL);
+    const uint16_t tbl = (ppu_ctrl_reg() & 0x10) ? 0x1000u : 0x0000u;
+    const uint16_t pat = (uint16_t)(tbl + (uint16_t)D.nt * 16u + ((v >> 12) & 7u));
+
+    switch (dot & 7) {
+    case 1: bg_reload(); break;                // new tile enters the shifters
+    case 2: D.nt = ppu_mem_read((uint16_t)(0x2000u | (v & 0x0FFFu))); break;
+    case 4: {
+        const uint8_t attr = ppu_mem_read((uint16_t)(0x23C0u | (v & 0x0C00u) | ((v >> 4) & 0x38u) | ((v >> 2) & 0x07u)));
+        D.at = (uint8_t)((attr >> (((v >> 4) & 4u) | (v & 2u))) & 3u);
+        break;
+    }
+    case 6: D.pt_lo = ppu_mem_read(pat); break;
+    case 0: D.pt_hi = ppu_mem_read((uint16_t)(pat + 8)); ppu_regs_inc_coarse_x(); break;
+    }
+}
+
+static void bg_shift(void)
+{
+    D.bg_lo <<= 1; D.bg_hi <<= 1;
+    D.at_lo <<= 1; D.at_hi <<= 1;
+}
+
+// -----------------------------------------------------------------------------
+// Sprites
+// -----------------------------------------------------------------------------
+static int sprite_height(void)
+{
+    return (ppu_ctrl_reg() & 0x20) ? 16 : 8;
+}
+
+static bool in_range(int line, uint8_t y)
+{
+    return (unsigned)(line - y) < (unsigned)sprite_height();
+}
+
+static void eval_start(void)
+{
+    D.n = D.m = D.found = 0;
+    D.eval_done  = false;
+    D.spr0_found = false;
+}
+
+// Dots 65-256 of a visible line
+static void eval_step(int line, int dot)
+{
+    const uint8_t* oam = ppu_oam_data();
+    if (dot & 1) { D.latch = oam[(D.n * 4 + D.m) & 0xFF]; return; }
+    if (D.eval_done) return;
+
+    if (D.found < 8) {
+        D.sec[D.found * 4 + D.m] = D.latch;
+        if (D.m == 0 && !in_range(line, D.latch)) {
+            D.n++;
+        } else if (++D.m == 4) {
+            if (D.n == 0) D.spr0_found = true;
+            D.m = 0;
+            D.found++;
+            D.n++;
+        }
+    } else if (in_range(line, D.latch)) {
+        ppu_regs_status_set(0x20);             // sprite overflow
+        D.eval_done = true;
+    } else {
+        D.n++;
+        D.m = (D.m + 1) & 3;                   // hardware bug: m advances too
+    }
+    if (D.n >= 64) D.eval_done = true;
+}
+
+// Dots 257-320: slot i fetches its low byte on 257+8i+5, high on +7
+static void sprite_fetch(int line, int dot)
+{
+    const int slot = (dot - 257) >> 3;
+    const int step = (dot - 257) & 7;
+    if (step != 5 && step != 7) return;
+
+    const bool    real = slot < D.found;
+    const uint8_t y    = real ? D.sec[slot * 4 + 0] : 0xFF;
+    const uint8_t tile = real ? D.sec[slot * 4 + 1] : 0xFF;
+    const uint8_t attr = real ? D.sec[slot * 4 + 2] : 0xFF;
+    const int     h    = sprite_height();
+
+    int row = (line - y) & (h - 1);
+    if (attr & 0x80) row = h - 1 - row;
+
+    uint16_t addr;
+    if (h == 8) {
+        addr = (uint16_t)(((ppu_ctrl_reg() & 0x08) ? 0x1000u : 0x0000u) + tile * 16u + row);
+    } else {
+        addr = (uint16_t)(((tile & 1) ? 0x1000u : 0x0000u) + ((tile & 0xFEu) + (row >= 8)) * 16u + (row & 7));
+    }
+
+    if (step == 5) {
+        const uint8_t lo = ppu_mem_read(addr);
+        if (real) D.spr_lo[slot] = lo;
+    } else {
+        const uint8_t hi = ppu_mem_read((uint16_t)(addr + 8));
+        if (real) {
+            D.spr_hi[slot]   = hi;
+            D.spr_attr[slot] = attr;
+            D.spr_x[slot]    = D.sec[slot * 4 + 3];
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Pixel output
+// -----------------------------------------------------------------------------
+// Background pixel x as palette RAM offset (0: transparent or clipped)
+static inline uint8_t bg_pixel(int x, uint8_t mask)
+{
+    if (!(mask & 0x08) || (x < 8 && !(mask & 0x02))) return 0;
+
+    uint8_t fine_x;
+    ppu_regs_get_vram_addr(NULL, &fine_x);
+    const int bit = 15 - fine_x;
+    const uint8_t pix = (uint8_t)(((D.bg_lo >> bit) & 1u) | (((D.bg_hi >> bit) & 1u) << 1));
+    const uint8_t pal = (uint8_t)(((D.at_lo >> bit) & 1u) | (((D.at_hi >> bit) & 1u) << 1));
+    return pix ? (uint8_t)(pal << 2 | pix) : 0;
+}
+
+// 2-bit pixel of sprite slot i at x (0: transparent or not there)
+static inline uint8_t spr_pixel(int i, int x)
+{
+    const int off = x - D.spr_x[i];
+    if ((unsigned)off >= 8) return 0;
+    const int bit = (D.spr_attr[i] & 0x40) ? off : 7 - off;
+    return (uint8_t)(((D.spr_lo[i] >> bit) & 1u) | (((D.spr_hi[i] >> bit) & 1u) << 1));
+}
+
+// Palette RAM offset idx as pixel x, in the frame's output format; INDEX16
+// takes the emphasis of this dot, INDEX8 the line's (ppu_render_set_emphasis())
+static void put_pixel(int line, int x, uint8_t idx, uint8_t mask)
+{
+    uint8_t*  index_line   = ppu_render_index_line_ptr(line);
+    uint16_t* index16_line = ppu_render_index16_line_ptr(line);
+    if (index_line)        index_line[x] = ppu_mem_palette_index()[idx];
+    else if (index16_line) index16_line[x] = (uint16_t)(ppu_mem_palette_index()[idx] | (mask & 0xE0) << 1);
+    else                   ppu_render_line_ptr(line)[x] = ppu_mem_palette_argb()[idx];
+}
+
+static void output_pixel(int line, int x, uint8_t mask)
+{
+    const uint8_t bg = bg_pixel(x, mask);
+
+    uint8_t spr = 0;
+    bool behind = false, spr0 = false;
+    if ((mask & 0x10) && (x >= 8 || (mask & 0x04))) {
+        for (int i = 0; i < D.spr_count; ++i) {
+            const uint8_t pix = spr_pixel(i, x);
+            if (!pix) continue;
+            spr    = (uint8_t)(0x10 | (D.spr_attr[i] & 3) << 2 | pix);
+            behind = (D.spr_attr[i] & 0x20) != 0;
+            spr0   = i == 0 && D.spr0_line;
+            break;
+        }
+    }
+
+    if (spr0 && bg && x != 255) ppu_regs_status_set(0x40);   // sprite 0 hit
+
+    put_pixel(line, x, (spr && (!behind || !bg)) ? spr : bg, mask);
+}
+
+// Headless frames: nothing is composed, only sprite 0 hit is looked for
+// (sprite 0, when on the line, is always slot 0)
+static void sprite0_pixel(int x, uint8_t mask)
+{
+    if (!D.spr0_line || x == 255) return;
+    if (!(mask & 0x10) || (x < 8 && !(mask & 0x04))) return;
+    if (spr_pixel(0, x) && bg_pixel(x, mask)) ppu_regs_status_set(0x40);
+}
+
+// -----------------------------------------------------------------------------
+// One dot of a visible (0-239) or pre-render (261) line
+// -----------------------------------------------------------------------------
+void ppu_dot_tick(int line, int dot)
+{
+    const uint8_t mask = ppu_mask_reg();
+    const bool rendering = (mask & 0x18) != 0;
+    const bool visible = line < NES_H;
+
+    // Pixel x = dot - 2 leaves the shifters on dots 2..257
+    if (visible && dot >= 2 && dot <= 257) {
+        if (!ppu_frame_drawn()) {
+            if (rendering) sprite0_pixel(dot - 2, mask);
+        } else {
+            if (dot == 2) ppu_render_set_emphasis(line, mask);
+            if (rendering) output_pixel(line, dot - 2, mask);
+            else           put_pixel(line, dot - 2, 0, mask);
+        }
+    }
+    if (!rendering) return;
+
+    if ((dot >= 2 && dot <= 257) || (dot >= 322 && dot <= 337)) bg_shift();
+
+    if ((dot >= 1 && dot <= 256) || (dot >= 321 && dot <= 336)) {
+        bg_fetch(dot);
+    } else if (dot == 257 || dot == 337) {
+        bg_reload();
+    }
+
+    if (dot == 256) ppu_regs_inc_y();
+    if (dot == 257) ppu_regs_copy_x();
+    if (line == PRERENDER_LINE && dot >= 280 && dot <= 304) ppu_regs_frame_reload();
+
+    // Sprites: evaluate on visible lines for the next one, fetch on every
+    // rendering line (the pre-render line's fetches clock the MMC3 too)
+    if (visible) {
+        if (dot == 64) memset(D.sec, 0xFF, sizeof D.sec);   // cleared over dots 1-64
+        if (dot == 65) eval_start();
+        if (dot >= 65 && dot <= 256) eval_step(line, dot);
+    } else if (dot == 1) {
+        D.found = 0;   // nothing is drawn on line 0 from pre-render evaluation
+        D.spr0_found = false;
+    }
+    if (dot >= 257 && dot <= 320) {
+        if (dot == 257) {
+            D.spr_count = D.found;
+            D.spr0_line = D.spr0_found;
+        }
+        sprite_fetch(line, dot);
+    }
+}
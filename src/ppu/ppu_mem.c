@@ -3,43 +3,53 @@
 
 #include "ppu_mem.h"
 #include "mapper.h"
-
-// 2KB nametable VRAM: NT0 ($2000-$23FF) + NT1 ($2400-$27FF)
-// NT2/NT3 mirror onto these two based on mirroring mode.
-// NOTE: MIRROR_FOUR fallback maps like vertical here because we only back 2KB.
-// If you add true 4-screen (4KB) VRAM later, give NT2/NT3 distinct pages.
-static uint8_t    s_vram[0x800];
+#include "ppu_tile_cache.h"
+#include "ppu_bg_plane.h"
+#include "ppu_defer.h"
+#include "ppu_regs.h"
+#include "nes_palette.h"
+
+// Nametable VRAM: the console's 2KB (pages 0 and 1), plus 2KB more on
+// four-screen cartridges (pages 2 and 3). $2000/$2400/$2800/$2C00 each point
+// at a page, chosen by the mirroring when it changes, not on every access;
+// a mapper may put its own memory there instead (ppu_mem_map_nametable()).
+static uint8_t    s_vram[0x1000];
 static uint8_t    s_palette[0x20];
 static mirroring_t s_mirr = MIRROR_HORIZONTAL;
-
-static inline uint16_t mirror_nt_addr(uint16_t addr)
+static uint8_t*   s_nt[4] = { s_vram, s_vram, s_vram + 0x400, s_vram + 0x400 }; // at $2000 + n*$400
+static uint8_t*   s_nt_cart[4];         // mapper-supplied page, NULL: VRAM
+static uint8_t    s_nt_readonly;        // bit n: s_nt_cart[n] drops writes
+
+// CHR pages per 1KB slot, set by the mapper (ppu_mem_map_chr())
+static uint8_t*   s_chr[8];             // NULL: through mapper_chr_read/write
+static int        s_chr_page[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+static uint8_t    s_chr_writable;       // bit n: slot n is CHR-RAM
+static void     (*s_chr_watch)(uint16_t addr);
+
+// s_palette resolved to ARGB8888 (index = $3F00-$3F1F offset, aliases
+// included), updated on palette writes and colour-relevant PPUMASK changes;
+// s_index is the same as colour indexes (grayscale applied, no emphasis)
+static uint32_t   s_argb[0x20];
+static uint8_t    s_index[0x20];
+static uint8_t    s_color_mask = 0;     // PPUMASK bits 0 (grayscale) and 5-7 (emphasis)
+static int        s_argb_ready = 0;
+
+static void update_nt_map(void)
 {
-    // Normalize to $2000-$2FFF
-    uint16_t v   = (uint16_t)((addr - 0x2000) & 0x0FFF);
-    uint16_t nt  = (uint16_t)(v >> 10);       // 0..3 (which nametable)
-    uint16_t off = (uint16_t)(v & 0x03FF);    // offset within nametable
-
-    switch (s_mirr)
-    {
-        case MIRROR_HORIZONTAL:
-            // [A A B B]  -> NT0 for 0,1 ; NT1 for 2,3
-            return (uint16_t)((nt <= 1 ? 0x000 : 0x400) + off);
-
-        case MIRROR_VERTICAL:
-            // [A B A B]  -> NT0 for 0,2 ; NT1 for 1,3
-            return (uint16_t)(((nt & 1) ? 0x400 : 0x000) + off);
-
-        case MIRROR_SINGLE_LO:
-            return off;
-
-        case MIRROR_SINGLE_HI:
-            return (uint16_t)(0x400 + off);
-
-        case MIRROR_FOUR:
-            // Fallback: behave like vertical until true 4-screen VRAM is added.
-            return (uint16_t)(((nt & 1) ? 0x400 : 0x000) + off);
+    // VRAM page for $2000/$2400/$2800/$2C00
+    static const uint8_t PAGES[][4] = {
+        [MIRROR_HORIZONTAL] = { 0, 0, 1, 1 },   // [A A B B]
+        [MIRROR_VERTICAL]   = { 0, 1, 0, 1 },   // [A B A B]
+        [MIRROR_SINGLE_LO]  = { 0, 0, 0, 0 },
+        [MIRROR_SINGLE_HI]  = { 1, 1, 1, 1 },
+        [MIRROR_FOUR]       = { 0, 1, 2, 3 },   // cartridge VRAM for 2 and 3
+    };
+    const uint8_t* pages = PAGES[(unsigned)s_mirr <= MIRROR_FOUR ? s_mirr : MIRROR_HORIZONTAL];
+    for (int n = 0; n < 4; ++n) {
+        s_nt[n] = s_nt_cart[n] ? s_nt_cart[n] : s_vram + pages[n] * 0x400;
     }
-    return off;
+    // The render thread notices by itself, at the next line it draws
+    if (!ppu_defer_active()) ppu_bg_plane_invalidate();
 }
 
 static inline uint16_t mirror_palette_addr(uint16_t addr)
@@ -54,9 +64,97 @@ static inline uint16_t mirror_palette_addr(uint16_t addr)
     return a;
 }
 
+static void resolve_color(int i)
+{
+    uint8_t c = s_palette[mirror_palette_addr((uint16_t)(0x3F00 + i)) & 0x1F];
+    if (s_color_mask & 0x01) c &= 0x30;   // grayscale: column 0 of the row
+    s_index[i] = c & 0x3F;
+    s_argb[i]  = nes_palette_colors(s_color_mask >> 5)[c & 0x3F];
+}
+
+void ppu_mem_palette_refresh(void)
+{
+    s_argb_ready = 1;
+    for (int i = 0; i < 0x20; ++i) resolve_color(i);
+}
+
+void ppu_mem_set_color_mask(uint8_t mask)
+{
+    mask &= 0xE1;
+    if (mask == s_color_mask && s_argb_ready) return;
+    s_color_mask = mask;
+    ppu_mem_palette_refresh();
+}
+
+const uint32_t* ppu_mem_palette_argb(void)
+{
+    if (!s_argb_ready) ppu_mem_palette_refresh();
+    return s_argb;
+}
+
+const uint8_t* ppu_mem_palette_index(void)
+{
+    if (!s_argb_ready) ppu_mem_palette_refresh();
+    return s_index;
+}
+
+void ppu_mem_map_chr(int slot, uint8_t* mem, int page, bool writable)
+{
+    if ((unsigned)slot >= 8) return;
+    s_chr[slot]      = mem;
+    s_chr_page[slot] = mem ? page : -1;
+    if (mem && writable) s_chr_writable |= (uint8_t)(1u << slot);
+    else                 s_chr_writable &= (uint8_t)~(1u << slot);
+}
+
+int ppu_mem_chr_page(int slot)
+{
+    return (unsigned)slot < 8 ? s_chr_page[slot] : -1;
+}
+
+bool ppu_mem_chr_writable(int slot)
+{
+    return (unsigned)slot < 8 && (s_chr_writable >> slot) & 1u;
+}
+
+const ppu_view_t* ppu_mem_view(void)
+{
+    static ppu_view_t view;
+    if (!s_argb_ready) ppu_mem_palette_refresh();
+    view = (ppu_view_t){ s_nt, (const uint8_t* const*)s_chr, s_chr_page, s_argb, s_index, ppu_oam_data() };
+    return &view;
+}
+
+void ppu_mem_set_chr_watch(void (*watch)(uint16_t addr))
+{
+    s_chr_watch = watch;
+}
+
+uint8_t ppu_mem_chr_peek(uint16_t addr)
+{
+    addr &= 0x1FFF;
+    const uint8_t* p = s_chr[addr >> 10];
+    return p ? p[addr & 0x03FF] : mapper_chr_read(addr);
+}
+
 void ppu_mem_set_mirroring(mirroring_t m)
 {
     s_mirr = m;
+    update_nt_map();
+}
+
+void ppu_mem_map_nametable(int n, uint8_t* mem, bool writable)
+{
+    if ((unsigned)n >= 4) return;
+    s_nt_cart[n] = mem;
+    if (mem && !writable) s_nt_readonly |= (uint8_t)(1u << n);
+    else                  s_nt_readonly &= (uint8_t)~(1u << n);
+    update_nt_map();
+}
+
+uint8_t* const* ppu_mem_nametables(void)
+{
+    return s_nt;
 }
 
 mirroring_t ppu_mem_get_mirroring(void)
@@ -67,13 +165,16 @@ mirroring_t ppu_mem_get_mirroring(void)
 void ppu_mem_reset(void)
 {
     // Keep current mirroring; zero contents.
+    ppu_defer_reset();
     memset(s_vram,    0, sizeof s_vram);
     memset(s_palette, 0, sizeof s_palette);
+    ppu_mem_palette_refresh();
+    ppu_bg_plane_invalidate();
 }
 
 void ppu_mem_init(mirroring_t m)
 {
-    s_mirr = m;
+    ppu_mem_set_mirroring(m);
     ppu_mem_reset();
 }
 
@@ -82,13 +183,15 @@ uint8_t ppu_mem_read(uint16_t addr)
     addr &= 0x3FFF;
 
     if (addr < 0x2000) {
-        // Pattern tables (CHR) via active mapper
-        return mapper_chr_read(addr);
+        // Pattern tables (CHR): one load through the slot's page
+        const uint8_t* p = s_chr[addr >> 10];
+        if (!p) return mapper_chr_read(addr);
+        if (s_chr_watch) s_chr_watch(addr);
+        return p[addr & 0x03FF];
     }
     else if (addr < 0x3F00) {
-        // Nametables with mirroring
-        uint16_t vr = mirror_nt_addr(addr);
-        return s_vram[vr & 0x07FF];
+        // Nametables ($3000-$3EFF mirrors $2000-$2EFF)
+        return s_nt[(addr >> 10) & 3][addr & 0x03FF];
     }
     else {
         // Palette space (unbuffered reads; aliasing handled)
@@ -102,17 +205,33 @@ void ppu_mem_write(uint16_t addr, uint8_t data)
     addr &= 0x3FFF;
 
     if (addr < 0x2000) {
-        // Pattern tables (CHR) via active mapper
-        mapper_chr_write(addr, data);
+        // Pattern tables (CHR): CHR-ROM slots ignore writes
+        const int slot = addr >> 10;
+        if (!s_chr[slot])                          { mapper_chr_write(addr, data); return; }
+        if (!(s_chr_writable & (1u << slot)))      return;
+        s_chr[slot][addr & 0x03FF] = data;
+        if (ppu_defer_active()) {
+            ppu_defer_chr_written(s_chr[slot], addr, data);
+        } else {
+            ppu_tile_cache_invalidate(s_chr_page[slot], addr);
+            ppu_bg_plane_chr_written(s_chr_page[slot]);
+        }
     }
     else if (addr < 0x3F00) {
-        // Nametables with mirroring
-        uint16_t vr = mirror_nt_addr(addr);
-        s_vram[vr & 0x07FF] = data;
+        // Nametables; CHR-ROM ones ignore writes
+        const int n = (addr >> 10) & 3;
+        if (s_nt_readonly & (1u << n)) return;
+        s_nt[n][addr & 0x03FF] = data;
+        if (ppu_defer_active()) { ppu_defer_nt_written(s_nt[n], addr, data); return; }
+        for (int m = 0; m < 4; ++m) {
+            if (s_nt[m] == s_nt[n]) ppu_bg_plane_nt_written(m, addr);   // every mirror of it
+        }
     }
     else {
         // Palette space (aliasing handled)
         uint16_t a = mirror_palette_addr(addr);
         s_palette[a & 0x001F] = data;
+        resolve_color(a & 0x1F);
+        if ((a & 0x13) == 0) resolve_color((a & 0x1F) | 0x10);   // $3F10/$14/$18/$1C alias
     }
 }
@@ -125,6 +125,36 @@ void ppu_regs_get_scroll(uint16_t* t_out, uint8_t* fine_x_out) {
     if (fine_x_out) *fine_x_out = R.x;
 }
 
+void ppu_regs_get_vram_addr(uint16_t* v_out, uint8_t* fine_x_out) {
+    if (v_out) *v_out = R.v;
+    if (fine_x_out) *fine_x_out = R.x;
+}
+
+void ppu_regs_inc_coarse_x(void) {
+    if ((R.v & 0x1Fu) == 31) R.v = (uint16_t)((R.v & ~0x1Fu) ^ 0x0400u);
+    else                     R.v = (uint16_t)(R.v + 1);
+}
+
+void ppu_regs_inc_y(void) {
+    R.v = ppu_vram_inc_y(R.v);
+}
+
+void ppu_regs_copy_x(void) {
+    R.v = (uint16_t)((R.v & ~0x041Fu) | (R.t & 0x041Fu));
+}
+
+void ppu_regs_line_advance(void) {
+    ppu_regs_inc_y();
+    ppu_regs_copy_x();
+}
+
+void ppu_regs_frame_reload(void) {
+    R.v = (uint16_t)((R.v & ~0x7BE0u) | (R.t & 0x7BE0u));
+}
+
+void ppu_regs_status_set(uint8_t bits)   { R.ppustatus |= bits; }
+void ppu_regs_status_clear(uint8_t bits) { R.ppustatus &= (uint8_t)~bits; }
+
 // Side-effect-free peek of PPUSTATUS (use this in UI/diagnostics instead of $2002)
 uint8_t ppu_regs_status_peek(void) { return R.ppustatus; }
 
@@ -192,6 +222,7 @@ void ppu_regs_reset(void) {
     memset(&R, 0, sizeof R);
     // Power-up-ish: many emus set bit4 from "open bus" power-on pattern
     R.ppustatus = 0x10;
+    ppu_mem_set_color_mask(0);
 
     // reset counters too
     g_dma_count = 0;
@@ -257,6 +288,7 @@ static void write_2000(uint8_t v) {
 
 static void write_2001(uint8_t v) {
     R.ppumask = v;
+    ppu_mem_set_color_mask(v);
     LOG_HI("PPUMASK <= %02X (grayscale=%d, showBG=%d, showSPR=%d, emphRGB=%d%d%d)\n",
            v,
            (v & 0x01) != 0,
@@ -1,6 +1,15 @@
 // src/ppu/ppu_render.c
-// Full background + sprite renderer (ARGB8888), no external helpers required.
-// Uses ppu_mem_read/ppu_regs_get_scroll/ppu_ctrl_reg/ppu_mask_reg/ppu_oam_data.
+// Scanline background + sprite renderer (ARGB8888), no external helpers required.
+// ppu_timing.c draws each visible line into the core's framebuffer at dot 256,
+// from the VRAM address, PPUCTRL/PPUMASK, OAM and CHR banking of that moment,
+// so raster splits land on the right line. The background line is a scrolled
+// copy out of the decoded nametable plane (ppu_bg_plane.c), which only
+// re-decodes changed tiles, from 8-pixel rows of the tile cache
+// (ppu_tile_cache.c) instead of pulling CHR bytes apart bit by bit.
+// The per-pixel work runs in the SSE2/AVX2 kernels of ppu_simd.c.
+// Lines are drawn from a ppu_view_t: the live PPU memory, or the render
+// thread's copy of it (ppu_defer.c), which then draws them instead.
+// Uses ppu_regs_get_vram_addr/ppu_ctrl_reg/ppu_mask_reg/ppu_oam_data.
 //
 // Debug toggles (set to 0 for accuracy):
 #ifndef FORCE_SPRITES_ON_TOP
@@ -20,271 +29,437 @@
 #include "ppu.h"
 #include "ppu_regs.h"
 #include "ppu_mem.h"
-
-// Local 64-entry ARGB8888 palette (Nestopia-ish). Avoids linking issues.
-static const uint32_t PALETTE_ARGB[64] = {
-  0xFF666666,0xFF002A88,0xFF1412A7,0xFF3B00A4,0xFF5C007E,0xFF6E0040,0xFF6C0600,0xFF561D00,
-  0xFF333500,0xFF0B4800,0xFF005200,0xFF004F08,0xFF00404D,0xFF000000,0xFF000000,0xFF000000,
-  0xFFADADAD,0xFF155FD9,0xFF4240FF,0xFF7527FE,0xFFA01ACC,0xFFB71E7B,0xFFB53120,0xFF994E00,
-  0xFF6B6D00,0xFF388700,0xFF0E9300,0xFF008F32,0xFF007C8D,0xFF000000,0xFF000000,0xFF000000,
-  0xFFFFFEFF,0xFF64B0FF,0xFF9290FF,0xFFC676FF,0xFFF36AFF,0xFFFE6ECC,0xFFFE8170,0xFFEA9E22,
-  0xFFBCBE00,0xFF88D800,0xFF5CE430,0xFF45E082,0xFF48CDDE,0xFF4F4F4F,0xFF000000,0xFF000000,
-  0xFFFFFEFF,0xFFC0DFFF,0xFFD3D2FF,0xFFE8C8FF,0xFFFBC2FF,0xFFFFC4EA,0xFFFFCCCB,0xFFF7D8A5,
-  0xFFE4E594,0xFFCFEF96,0xFFBDF4AB,0xFFB3F3CC,0xFFB5EBF2,0xFFB8B8B8,0xFF000000,0xFF000000
-};
+#include "ppu_tile_cache.h"
+#include "ppu_bg_plane.h"
+#include "ppu_defer.h"
+#include "ppu_simd.h"
 
 #define NES_W 256
 #define NES_H 240
 
-// Palette index normalizer for $3F00-$3F1F region with mirroring.
-// Also maps $3F10/$14/$18/$1C -> $3F00/$04/$08/$0C.
-static inline uint16_t pal_index(uint16_t addr)
+// The emulated frame, one line per visible scanline, in the output format.
+// ARGB lines go to s_target, which is s_fb unless the caller gave memory.
+// Nothing is copied back out of caller memory (a locked texture is slow to
+// read), so s_fb misses the frames drawn there.
+static uint32_t     s_fb[NES_W * NES_H];
+static uint32_t*    s_target = s_fb;
+static int          s_target_pitch = NES_W;   // in pixels
+static bool         s_fb_stale;               // the last drawn frame went to caller memory
+static bool         s_target_current;         // caller memory holds the last drawn frame
+static uint8_t      s_idx[NES_W * NES_H];   // PPU_OUTPUT_INDEX8
+static uint8_t      s_emph[NES_H];
+static uint16_t     s_idx16[NES_W * NES_H]; // PPU_OUTPUT_INDEX16
+static ppu_output_t s_output = PPU_OUTPUT_ARGB8888;
+
+// Line pixels below are palette RAM offsets (0..31): 0 = transparent/backdrop,
+// 1..15 background, 16..31 sprites (| PPU_SPR_BEHIND), see ppu_simd.h.
+
+// --- Background: one line from VRAM address v (with scroll) ---
+static bool s_bg_plane = true;
+
+void ppu_set_bg_plane(bool on) { s_bg_plane = on; }
+bool ppu_get_bg_plane(void)    { return s_bg_plane; }
+
+static void draw_background_line(const ppu_kernels_t* k, const ppu_view_t* mv, uint8_t* out,
+                                 uint16_t v, uint8_t fine_x, uint8_t ctrl)
+{
+    // Normally a copy out of the decoded plane (ppu_bg_plane.c); fetched
+    // tile by tile below for coarse Y 30/31, which it does not cover, or
+    // with the plane switched off
+    if (s_bg_plane && ppu_bg_plane_line(mv, out, v, fine_x, ctrl)) return;
+
+    // Background pattern table base: PPUCTRL bit 4 (0x10)
+    const uint16_t bg_tbl_base = (ctrl & 0x10) ? 0x1000u : 0x0000u;
+    const uint16_t fine_y = (uint16_t)((v >> 12) & 7u);
+
+    // 33 tiles: with fine X > 0 the line shows part of a 33rd
+    uint8_t* const* nt = mv->nt;
+    const uint8_t* rows[33];
+    uint8_t pals[33];
+    ppu_tile_t spill[33];   // tiles of uncached CHR pages
+    for (int tx = 0; tx < 33; ++tx)
+    {
+        const uint8_t* page = nt[(v >> 10) & 3u];
+        uint8_t  tile_index = page[v & 0x03FFu];
+        uint8_t  attr = page[0x03C0u | ((v >> 4) & 0x38u) | ((v >> 2) & 0x07u)];
+        int      shift = (int)(((v >> 4) & 4u) | (v & 2u)); // 0,2,4,6
+        pals[tx] = (uint8_t)(((attr >> shift) & 0x03) << 2);
+        rows[tx] = ppu_tile_get((uint16_t)(bg_tbl_base + (uint16_t)tile_index * 16u), &spill[tx])->px[0][fine_y];
+
+        // Coarse X increment, wrapping into the horizontal neighbour nametable
+        if ((v & 0x1Fu) == 31) v = (uint16_t)((v & ~0x1Fu) ^ 0x0400u);
+        else                   v = (uint16_t)(v + 1);
+    }
+    uint8_t row[33 * 8];
+    k->bg_tiles(row, rows, pals, 33);
+    memcpy(out, row + fine_x, NES_W);
+}
+
+// --- Sprite evaluation: which OAM entries line y shows ---
+// As the PPU does it during the previous line: the first 8 in-range entries
+// in OAM order (all of them with the limit off), then the overflow search,
+// which after the 8th hit also steps the byte index m and so compares
+// tile/attribute/X bytes as Y (the hardware bug; false hits and misses).
+typedef struct
+{
+    int     count;
+    uint8_t idx[64];   // OAM entries, ascending
+} line_sprites_t;
+
+static line_sprites_t s_line;             // sprites for the line drawn next
+static bool           s_sprite_limit = true;
+
+void ppu_set_sprite_limit(bool on) { s_sprite_limit = on; }
+bool ppu_get_sprite_limit(void)    { return s_sprite_limit; }
+
+// Entries on line `line` + 1; returns true on sprite overflow
+static bool evaluate_sprites(int line, uint8_t ctrl, line_sprites_t* out)
+{
+    const uint8_t* OAM = ppu_oam_data();
+    const unsigned height = (ctrl & 0x20) ? 16u : 8u;
+
+    out->count = 0;
+    int n = 0;
+    for (; n < 64 && out->count < 8; ++n) {
+        if ((unsigned)(line - OAM[n * 4]) < height) out->idx[out->count++] = (uint8_t)n;
+    }
+
+    // Only reached with 8 found (n < 64)
+    bool overflow = false;
+    for (int i = n, m = 0; i < 64; ++i, m = (m + 1) & 3) {
+        if ((unsigned)(line - OAM[i * 4 + m]) < height) { overflow = true; break; }
+    }
+
+    if (!s_sprite_limit) {
+        for (int i = n; i < 64; ++i) {
+            if ((unsigned)(line - OAM[i * 4]) < height) out->idx[out->count++] = (uint8_t)i;
+        }
+    }
+    return overflow;
+}
+
+// Pattern row of OAM entry i shown on line y: tile address, row in it and
+// H flip; false if the sprite is not on that line
+static bool sprite_pattern(const uint8_t* OAM, int i, int y, uint8_t ctrl,
+                           uint16_t* base_out, int* row_out, bool* hflip_out)
+{
+    const bool mode_8x16 = (ctrl & 0x20) != 0;
+    const int  height    = mode_8x16 ? 16 : 8;
+
+    int row = y - ((int)OAM[i*4 + 0] + 1);   // NES Y+1 rule; height may have changed since
+    if ((unsigned)row >= (unsigned)height) return false;
+
+    const uint8_t tile = OAM[i*4 + 1];
+    const uint8_t attr = OAM[i*4 + 2];
+    const bool vflip = (attr & 0x80) != 0;
+    const bool hflip = (attr & 0x40) != 0;
+
+    int pr = vflip ? (height - 1 - row) : row;
+    uint16_t base;
+    if (!mode_8x16) {
+        // ✅ Correct sprite table bit in 8×8 mode: PPUCTRL bit 3 (0x08)
+        const uint16_t spr_tbl_8x8 = (ctrl & 0x08) ? 0x1000u : 0x0000u;
+        base = (uint16_t)(spr_tbl_8x8 + (uint16_t)tile * 16u);
+    } else {
+        const uint16_t table = (tile & 1) ? 0x1000u : 0x0000u;
+        uint8_t tindex = (uint8_t)((tile & 0xFE) + (pr >= 8));
+        base = (uint16_t)(table + (uint16_t)tindex * 16u);
+        pr &= 7;
+    }
+    *base_out  = base;
+    *row_out   = pr;
+    *hflip_out = hflip;
+    return true;
+}
+
+// Row of OAM entry i shown on line y (8 decoded pixels, flip applied), NULL
+// if the sprite is not on that line. Valid until `spill` is reused.
+static const uint8_t* sprite_row(const ppu_view_t* mv, int i, int y, uint8_t ctrl, ppu_tile_t* spill)
+{
+    uint16_t base;
+    int row;
+    bool hflip;
+    if (!sprite_pattern(mv->oam, i, y, ctrl, &base, &row, &hflip)) return NULL;
+    return ppu_tile_get(base, spill)->px[hflip][row];
+}
+
+// --- Sprites (8x8 & 8x16) of the line's list; lower OAM index wins ---
+// `out` has 8 bytes of slack past the line for sprites at x > 248.
+static void draw_sprites_line(const ppu_kernels_t* k, const ppu_view_t* mv, uint8_t* out, int y,
+                              uint8_t ctrl, const uint8_t* list, int count)
+{
+    const uint8_t* OAM = mv->oam;
+    const bool respect_priority = (FORCE_SPRITES_ON_TOP == 0);
+    ppu_tile_t spill;
+
+    for (int j = 0; j < count; ++j)
+    {
+        const int i = list[j];
+        const uint8_t* px = sprite_row(mv, i, y, ctrl, &spill);
+        if (!px) continue;
+
+        const uint8_t attr = OAM[i*4 + 2];
+        const bool behind_bg = respect_priority && (attr & 0x20) != 0;
+        const uint8_t bits = (uint8_t)(0x10u | (attr & 0x03) << 2 | (behind_bg ? PPU_SPR_BEHIND : 0));
+        k->spr_row(out + OAM[i*4 + 3], px, bits);
+    }
+}
+
+// One scanline into `idx` (colour indexes) if given, else `dst` (ARGB),
+// from explicit state
+static void render_line(const ppu_view_t* mv, uint32_t* dst, uint8_t* idx, int y, uint16_t v,
+                        uint8_t fine_x, uint8_t ctrl, uint8_t mask, const uint8_t* sprites, int count)
 {
-    addr = (uint16_t)(0x3F00u | (addr & 0x1Fu));
-    if ((addr & 0x13u) == 0x10u) addr = (uint16_t)(addr & ~0x10u);
-    return addr;
+    // Palette RAM as ARGB, emphasis and grayscale applied (entry 0 = backdrop)
+    const uint32_t* pal = mv->pal_argb;
+
+    const bool show_bg  = (mask & 0x08) != 0;
+    const bool show_spr = ((mask & 0x10) != 0) || (FORCE_SPRITES_ON_TOP != 0);
+    if (!show_bg && !show_spr) {
+        if (idx) { memset(idx, mv->pal_index[0], NES_W); return; }
+        for (int x = 0; x < NES_W; ++x) dst[x] = pal[0];
+        return;
+    }
+
+    const ppu_kernels_t* k = ppu_simd_active();
+    ppu_tile_cache_map_banks(mv);
+    uint8_t bg[NES_W], spr[NES_W + 8];
+    if (show_bg) draw_background_line(k, mv, bg, v, fine_x, ctrl);
+    else         memset(bg, 0, sizeof bg);
+    memset(spr, 0, sizeof spr);
+    if (show_spr) draw_sprites_line(k, mv, spr, y, ctrl, sprites, count);
+
+    const int clip_bg  = (mask & 0x02) == 0 && IGNORE_LEFT8_BG_CLIP == 0;
+    const int clip_spr = (mask & 0x04) == 0 && IGNORE_LEFT8_SPR_CLIP == 0;
+    if (idx) k->compose_index(idx, bg, spr, mv->pal_index, clip_bg, clip_spr);
+    else     k->compose(dst, bg, spr, pal, clip_bg, clip_spr);
 }
 
-static inline uint8_t bitpair(uint8_t lo, uint8_t hi, int bit /*0..7 left..right*/)
+// --- Sprite 0 hit ---
+// Only sprite 0's 8-pixel span can hit, so the line is checked there alone:
+// the bounding box (on the line, inside the visible columns) and the
+// sprite row's opacity reject most calls before any background is fetched.
+// Pixel x of the line drawn from VRAM address v is tile (fine_x + x) / 8
+// from v's coarse X. Decoded here from live memory, not through the tile
+// cache, which the render thread may own.
+static uint8_t chr_pixel(uint16_t addr, int bit)
 {
-    int s = 7 - bit;
-    return (uint8_t)(((lo >> s) & 1u) | (((hi >> s) & 1u) << 1));
+    return (uint8_t)(((ppu_mem_chr_peek(addr) >> bit) & 1) | ((ppu_mem_chr_peek((uint16_t)(addr + 8)) >> bit) & 1) << 1);
 }
-static inline uint8_t bitpair_flipped(uint8_t lo, uint8_t hi, int bit /*0..7*/, bool hflip)
+
+static uint8_t bg_pixel(uint16_t v, uint8_t fine_x, uint8_t ctrl, int x)
 {
-    int s = hflip ? bit : (7 - bit);
-    return (uint8_t)(((lo >> s) & 1u) | (((hi >> s) & 1u) << 1));
+    const int sx = fine_x + x;
+    unsigned cx = (v & 0x1Fu) + (unsigned)(sx >> 3);
+    if (cx >= 32) { cx -= 32; v ^= 0x0400u; }
+    v = (uint16_t)((v & ~0x1Fu) | cx);
+
+    const uint8_t tile = ppu_mem_nametables()[(v >> 10) & 3u][v & 0x03FFu];
+    const uint16_t base = (uint16_t)(((ctrl & 0x10) ? 0x1000u : 0x0000u) + (uint16_t)tile * 16u);
+    return chr_pixel((uint16_t)(base + ((v >> 12) & 7)), 7 - (sx & 7));
 }
 
-// --- Background renderer (with scroll) ---
-static void draw_background_scrolled(uint32_t* dst, uint8_t* bg_opaque,
-                                     int pitch_px, uint8_t ctrl, uint8_t mask)
+int ppu_render_sprite0_hit(int y, const uint16_t* v, int from)
 {
-    const bool show_bg   = (mask & 0x08) != 0;
-    const bool clip_bg8  = ((mask & 0x02) == 0) && (IGNORE_LEFT8_BG_CLIP == 0);
+    const uint8_t ctrl = ppu_ctrl_reg(), mask = ppu_mask_reg();
+    if ((mask & 0x18) != 0x18 || (unsigned)y >= NES_H) return -1;
 
-    // If BG disabled, nothing to do (backdrop already filled)
-    if (!show_bg) return;
+    const uint8_t* OAM = ppu_oam_data();
+    const int height = (ctrl & 0x20) ? 16 : 8;
+    if ((unsigned)(y - (OAM[0] + 1)) >= (unsigned)height) return -1;
+
+    // x = 255 never hits; with either layer clipped, neither does x < 8
+    const int x0 = OAM[3];
+    int lo = x0 > from ? x0 : from, hi = x0 + 7 < 254 ? x0 + 7 : 254;
+    if ((mask & 0x06) != 0x06 && lo < 8) lo = 8;
+    if (lo > hi) return -1;
+
+    uint16_t base;
+    int row;
+    bool hflip;
+    sprite_pattern(OAM, 0, y, ctrl, &base, &row, &hflip);
+    uint8_t px[8];
+    for (int c = 0; c < 8; ++c) px[c] = chr_pixel((uint16_t)(base + row), hflip ? c : 7 - c);
+    uint64_t opaque;
+    memcpy(&opaque, px, 8);
+    if (!opaque) return -1;
 
-    // Scroll state from registers: t (VRAM temp), fine X
     uint16_t t;
     uint8_t fine_x;
     ppu_regs_get_scroll(&t, &fine_x);
+    for (int x = lo; x <= hi; ++x) {
+        if (px[x - x0] && (!v || bg_pixel(*v, fine_x, ctrl, x))) return x;
+    }
+    return -1;
+}
 
-    const uint8_t  coarse_x0 = (uint8_t)(t & 0x1F);
-    const uint8_t  coarse_y0 = (uint8_t)((t >> 5) & 0x1F);
-    const uint8_t  nt_bits   = (uint8_t)((t >> 10) & 0x03); // base nametable quadrant
-    const uint8_t  fine_y0   = (uint8_t)((t >> 12) & 0x07);
+bool ppu_render_sprite0_listed(void)
+{
+    return s_line.count > 0 && s_line.idx[0] == 0;
+}
 
-    // Background pattern table base: PPUCTRL bit 4 (0x10)
-    const uint16_t bg_tbl_base = (ctrl & 0x10) ? 0x1000u : 0x0000u;
+bool ppu_render_sprite_overflow(int y)
+{
+    line_sprites_t list;
+    return evaluate_sprites(y, ppu_ctrl_reg(), &list);
+}
 
-    // We'll render pixel-by-pixel with scroll wrap across the 2x2 nametable space (512x480).
-    for (int sy = 0; sy < NES_H; ++sy)
-    {
-        uint16_t world_y = (uint16_t)(coarse_y0 * 8u + fine_y0 + sy); // 0..(480-1)
-        uint8_t  nt_y    = (uint8_t)((world_y / 240u) & 1u);
-        uint8_t  tile_y  = (uint8_t)((world_y % 240u) / 8u);
-        uint8_t  fine_y  = (uint8_t)(world_y & 7u);
-
-        // Precompute row pattern bytes for each tile across the line to reduce ppu_mem_read calls
-        int last_tile_x = -1;
-        uint8_t row_lo = 0, row_hi = 0;
-        uint8_t pal_cache[32]; // palette index (0..3) per tile
-
-        // Build palettes for the 32 tile columns (with nametable wrap)
-        for (int tx = 0; tx < 32; ++tx)
-        {
-            uint16_t world_x_for_tile = (uint16_t)(coarse_x0 * 8u + fine_x + tx*8u);
-            uint8_t  nt_x   = (uint8_t)((world_x_for_tile / 256u) & 1u);
-            uint8_t  tile_x = (uint8_t)((world_x_for_tile % 256u) / 8u);
-
-            // Resolve base nametable from nt_bits plus nt_x/nt_y
-            uint8_t nt_quadrant = (uint8_t)(((nt_bits & 1u) ^ nt_x) | (((nt_bits >> 1) ^ nt_y) << 1));
-            uint16_t nt_base = (uint16_t)(0x2000u + (uint16_t)nt_quadrant * 0x400u);
-
-            // Name table tile index
-            uint16_t name_addr = (uint16_t)(nt_base + tile_y * 32u + tile_x);
-            uint8_t  tile_index = ppu_mem_read(name_addr);
-
-            // Attribute table
-            uint16_t attr_addr = (uint16_t)(nt_base + 0x3C0u + (tile_y / 4u) * 8u + (tile_x / 4u));
-            uint8_t  attr = ppu_mem_read(attr_addr);
-            int shift = ((tile_y & 2) << 1) | (tile_x & 2); // 0,2,4,6
-            pal_cache[tx] = (uint8_t)((attr >> shift) & 0x03);
-
-            // Preload row bytes for the first tile; others will be loaded in-column loop
-            if (tx == 0) {
-                uint16_t pat = (uint16_t)(bg_tbl_base + (uint16_t)tile_index * 16u + fine_y);
-                row_lo = ppu_mem_read(pat + 0);
-                row_hi = ppu_mem_read(pat + 8);
-                last_tile_x = 0;
-            }
-        }
+// -----------------------------------------------------------------------------
+// Public entry points
+// -----------------------------------------------------------------------------
 
-        for (int sx = 0; sx < NES_W; ++sx)
-        {
-            uint16_t world_x = (uint16_t)(coarse_x0 * 8u + fine_x + sx);
-            uint8_t  nt_x    = (uint8_t)((world_x / 256u) & 1u);
-            uint8_t  tile_x  = (uint8_t)((world_x % 256u) / 8u);
-            uint8_t  px_in_tile = (uint8_t)(world_x & 7u);
-
-            // Resolve NT quadrant consistent with the cache (same formula)
-            uint8_t nt_quadrant = (uint8_t)(((nt_bits & 1u) ^ nt_x) | (((nt_bits >> 1) ^ ((world_y / 240u) & 1u)) << 1));
-            uint16_t nt_base = (uint16_t)(0x2000u + (uint16_t)nt_quadrant * 0x400u);
-
-            // Load tile row pattern bytes if we crossed into a new tile column
-            if (tile_x != last_tile_x)
-            {
-                uint16_t name_addr = (uint16_t)(nt_base + tile_y * 32u + tile_x);
-                uint8_t tile_index = ppu_mem_read(name_addr);
-                uint16_t pat = (uint16_t)(bg_tbl_base + (uint16_t)tile_index * 16u + fine_y);
-                row_lo = ppu_mem_read(pat + 0);
-                row_hi = ppu_mem_read(pat + 8);
-                last_tile_x = tile_x;
-            }
-
-            uint8_t pix = bitpair(row_lo, row_hi, px_in_tile); // 0..3
-            bool left8 = (sx < 8);
-            if ((clip_bg8 && left8) || pix == 0) {
-                // transparent BG here; leave backdrop pixel and mark not opaque
-                bg_opaque[sy * NES_W + sx] = 0;
-                continue;
-            }
-
-            uint8_t pal = pal_cache[tile_x]; // 0..3
-            uint16_t paddr = (uint16_t)(0x3F00u + pal * 4u + pix); // pix!=0 here
-            uint8_t cidx = ppu_mem_read(pal_index(paddr));
-            dst[sy * pitch_px + sx] = PALETTE_ARGB[cidx & 0x3F];
-            bg_opaque[sy * NES_W + sx] = 1;
-        }
+// Line y from explicit state (inline or on the render thread), in the output format
+void ppu_render_draw_line(const ppu_view_t* mv, int y, uint16_t v, uint8_t fine_x, uint8_t ctrl,
+                          uint8_t mask, const uint8_t* sprites, int count)
+{
+    if (y == 0) ppu_bg_plane_frame_start();
+    if (s_output == PPU_OUTPUT_INDEX8) {
+        render_line(mv, NULL, s_idx + y * NES_W, y, v, fine_x, ctrl, mask, sprites, count);
+        s_emph[y] = (uint8_t)(mask >> 5);
+    } else if (s_output == PPU_OUTPUT_INDEX16) {
+        uint8_t line[NES_W];
+        render_line(mv, NULL, line, y, v, fine_x, ctrl, mask, sprites, count);
+        uint16_t* out = s_idx16 + y * NES_W;
+        const uint16_t emphasis = (uint16_t)((mask & 0xE0) << 1);
+        for (int x = 0; x < NES_W; ++x) out[x] = (uint16_t)(line[x] | emphasis);
+    } else {
+        render_line(mv, ppu_render_line_ptr(y), NULL, y, v, fine_x, ctrl, mask, sprites, count);
     }
 }
 
-// --- Sprite overlay (8x8 & 8x16) ---
-static void draw_sprites(uint32_t* dst, const uint8_t* bg_opaque,
-                         int pitch_px, uint8_t ctrl, uint8_t mask)
+// Called by ppu_timing.c at dot 256 of visible line y (rendering on or off).
+// Sprite evaluation for line y + 1 happens on this line too, and only while
+// rendering is on; the pre-render line's never shows, so line 0 has none.
+// Headless frames skip the drawing only: sprite 0 hit is worked out by
+// ppu_timing.c from sprite 0's span alone, overflow by the evaluation.
+// With the render thread on, the line is logged for it instead (ppu_defer.c).
+void ppu_render_scanline(int y)
 {
-    const bool show_spr  = ((mask & 0x10) != 0) || (FORCE_SPRITES_ON_TOP != 0);
-    if (!show_spr) return;
+    if ((unsigned)y >= NES_H) return;
+    if (y == 0) s_line.count = 0;
 
-    const bool clip_spr8 = ((mask & 0x04) == 0) && (IGNORE_LEFT8_SPR_CLIP == 0);
-    const bool mode_8x16 = (ctrl & 0x20) != 0;
+    uint16_t v;
+    uint8_t fine_x;
+    ppu_regs_get_vram_addr(&v, &fine_x);
+    const uint8_t ctrl = ppu_ctrl_reg(), mask = ppu_mask_reg();
+    if (ppu_frame_drawn() && !ppu_defer_line(y, v, fine_x, ctrl, mask, s_line.idx, s_line.count)) {
+        ppu_render_draw_line(ppu_mem_view(), y, v, fine_x, ctrl, mask, s_line.idx, s_line.count);
+    }
 
-    // ✅ Correct sprite table bit in 8×8 mode: PPUCTRL bit 3 (0x08)
-    const uint16_t spr_tbl_8x8 = (ctrl & 0x08) ? 0x1000u : 0x0000u;
+    if (!(mask & 0x18)) {
+        s_line.count = 0;
+    } else if (evaluate_sprites(y, ctrl, &s_line)) {
+        ppu_regs_status_set(0x20);   // sprite overflow
+    }
+}
 
-    const uint8_t* OAM = ppu_oam_data();
-    const bool respect_priority = (FORCE_SPRITES_ON_TOP == 0);
+const uint32_t* ppu_framebuffer(void)
+{
+    ppu_defer_sync();
+    return s_target;
+}
 
-    for (int i = 0; i < 64; ++i)
-    {
-        uint8_t y    = OAM[i*4 + 0];
-        uint8_t tile = OAM[i*4 + 1];
-        uint8_t attr = OAM[i*4 + 2];
-        uint8_t x    = OAM[i*4 + 3];
-
-        int spr_y = (int)y + 1;             // NES Y+1 rule
-        if (spr_y >= NES_H) continue;       // offscreen (e.g., F8)
-
-        const bool vflip = (attr & 0x80) != 0;
-        const bool hflip = (attr & 0x40) != 0;
-        const bool behind_bg = (attr & 0x20) != 0;
-        const uint8_t palset = (uint8_t)(attr & 0x03);
-
-        if (!mode_8x16)
-        {
-            // ---- 8×8 ----
-            uint16_t base = (uint16_t)(spr_tbl_8x8 + (uint16_t)tile * 16u);
-            for (int row = 0; row < 8; ++row)
-            {
-                int pr = vflip ? (7 - row) : row;
-                uint8_t lo = ppu_mem_read((uint16_t)(base + pr + 0));
-                uint8_t hi = ppu_mem_read((uint16_t)(base + pr + 8));
-                int yy = spr_y + row; if ((unsigned)yy >= NES_H) continue;
-
-                for (int col = 0; col < 8; ++col)
-                {
-                    int xx = (int)x + col;
-                    if ((unsigned)xx >= NES_W) continue;
-                    if (clip_spr8 && xx < 8) continue;
-
-                    uint8_t pix = bitpair_flipped(lo, hi, col, hflip);
-                    if (pix == 0) continue;
-
-                    if (respect_priority && behind_bg) {
-                        if (bg_opaque && bg_opaque[yy * NES_W + xx]) continue;
-                        if (!bg_opaque) continue; // approximate if no mask
-                    }
-
-                    // Sprite palettes at $3F10 + pal*4 + (1..3)
-                    uint16_t paddr = (uint16_t)(0x3F10u + (uint16_t)palset * 4u + pix);
-                    uint8_t  cidx  = ppu_mem_read(pal_index(paddr));
-                    dst[yy * pitch_px + xx] = PALETTE_ARGB[cidx & 0x3F];
-                }
-            }
-        }
-        else
-        {
-            // ---- 8×16 ----
-            const uint16_t table = (tile & 1) ? 0x1000u : 0x0000u;
-            for (int row = 0; row < 16; ++row)
-            {
-                int pr = vflip ? (15 - row) : row;
-                int half = (pr >= 8);
-                uint8_t tindex = (uint8_t)((tile & 0xFE) + half);
-                uint16_t base  = (uint16_t)(table + (uint16_t)tindex * 16u);
-                int subrow     = pr & 7;
-
-                uint8_t lo = ppu_mem_read((uint16_t)(base + subrow + 0));
-                uint8_t hi = ppu_mem_read((uint16_t)(base + subrow + 8));
-                int yy = spr_y + row; if ((unsigned)yy >= NES_H) continue;
-
-                for (int col = 0; col < 8; ++col)
-                {
-                    int xx = (int)x + col;
-                    if ((unsigned)xx >= NES_W) continue;
-                    if (clip_spr8 && xx < 8) continue;
-
-                    uint8_t pix = bitpair_flipped(lo, hi, col, hflip);
-                    if (pix == 0) continue;
-
-                    if (respect_priority && behind_bg) {
-                        if (bg_opaque && bg_opaque[yy * NES_W + xx]) continue;
-                        if (!bg_opaque) continue;
-                    }
-
-                    uint16_t paddr = (uint16_t)(0x3F10u + (uint16_t)palset * 4u + pix);
-                    uint8_t  cidx  = ppu_mem_read(pal_index(paddr));
-                    dst[yy * pitch_px + xx] = PALETTE_ARGB[cidx & 0x3F];
-                }
-            }
-        }
+int ppu_framebuffer_pitch(void)
+{
+    return s_target_pitch * 4;
+}
+
+static void copy_frame(uint32_t* dst, int dst_pitch, const uint32_t* src, int src_pitch)
+{
+    for (int y = 0; y < NES_H; ++y) {
+        memcpy(dst + y * dst_pitch, src + y * src_pitch, NES_W * sizeof *dst);
+    }
+}
+
+void ppu_set_render_target(uint32_t* dst, int pitch_bytes)
+{
+    ppu_defer_sync();
+    s_target_current = false;
+    if (!dst || pitch_bytes < NES_W * 4) {
+        s_target       = s_fb;
+        s_target_pitch = NES_W;
+    } else {
+        s_target       = dst;
+        s_target_pitch = pitch_bytes / 4;
+    }
+}
+
+void ppu_render_frame_start(bool drawn)
+{
+    if (s_output != PPU_OUTPUT_ARGB8888) return;
+    if (drawn) {
+        s_fb_stale       = s_target != s_fb;
+        s_target_current = s_fb_stale;
+    } else if (s_target != s_fb && !s_target_current && !s_fb_stale) {
+        // A headless frame writes nothing: give new caller memory the last
+        // frame if s_fb has it, else leave it as it is
+        ppu_defer_sync();
+        copy_frame(s_target, s_target_pitch, s_fb, NES_W);
+        s_target_current = true;
     }
 }
 
-// --- Public entry point: fill backdrop, draw BG, then sprites ---
+uint32_t* ppu_render_line_ptr(int y)
+{
+    return s_target + y * s_target_pitch;
+}
+
+void ppu_set_output(ppu_output_t format)
+{
+    ppu_defer_sync();
+    s_output = format;
+}
+
+ppu_output_t ppu_get_output(void) { return s_output; }
+
+const uint8_t* ppu_framebuffer_index8(const uint8_t** line_emphasis)
+{
+    ppu_defer_sync();
+    if (line_emphasis) *line_emphasis = s_emph;
+    return s_idx;
+}
+
+const uint16_t* ppu_framebuffer_index16(void)
+{
+    ppu_defer_sync();
+    return s_idx16;
+}
+
+uint8_t* ppu_render_index_line_ptr(int y)
+{
+    return s_output == PPU_OUTPUT_INDEX8 ? s_idx + y * NES_W : NULL;
+}
+
+uint16_t* ppu_render_index16_line_ptr(int y)
+{
+    return s_output == PPU_OUTPUT_INDEX16 ? s_idx16 + y * NES_W : NULL;
+}
+
+void ppu_render_set_emphasis(int y, uint8_t mask)
+{
+    s_emph[y] = (uint8_t)(mask >> 5);
+}
+
+// Whole frame from the current latches and scroll (t), as if nothing changed
+// mid-frame. For tests and tools; the emulated frame is ppu_framebuffer().
 void ppu_render_argb8888(uint32_t* dst, int pitch_bytes)
 {
     if (!dst || pitch_bytes <= 0) return;
     const int pitch_px = pitch_bytes / 4;
-
-    // 1) Fill backdrop with universal background color ($3F00)
-    uint8_t bg_idx = ppu_mem_read(pal_index(0x3F00));
-    uint32_t back_color = PALETTE_ARGB[bg_idx & 0x3F];
-    for (int y = 0; y < NES_H; ++y) {
-        uint32_t* row = dst + y * pitch_px;
-        for (int x = 0; x < NES_W; ++x) row[x] = back_color;
-    }
+    ppu_defer_reset();   // the caches are used from this thread
 
     const uint8_t ctrl = ppu_ctrl_reg();
     const uint8_t mask = ppu_mask_reg();
+    uint16_t t;
+    uint8_t fine_x;
+    ppu_regs_get_scroll(&t, &fine_x);
 
-    // 2) Background (tracks an opacity buffer for sprite priority)
-    static uint8_t bg_opaque[NES_W * NES_H];
-    memset(bg_opaque, 0, sizeof(bg_opaque));
-    draw_background_scrolled(dst, bg_opaque, pitch_px, ctrl, mask);
-
-    // 3) Sprites on top
-    draw_sprites(dst, bg_opaque, pitch_px, ctrl, mask);
+    uint16_t v = t;
+    line_sprites_t sprites = { 0 };
+    const ppu_view_t* mv = ppu_mem_view();
+    for (int y = 0; y < NES_H; ++y) {
+        render_line(mv, dst + y * pitch_px, NULL, y, v, fine_x, ctrl, mask, sprites.idx, sprites.count);
+        evaluate_sprites(y, ctrl, &sprites);
+        v = ppu_vram_inc_y(v);
+    }
 }
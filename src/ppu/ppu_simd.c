@@ -0,0 +1,421 @@
+// src/ppu/ppu_simd.c
+// Pixel kernels of the scanline renderer (ppu_render.c, ppu_tile_cache.c):
+// bitplane expansion, background tile rows, sprite rows and the final
+// priority / clipping / palette pass, plus the colour table lookups that
+// turn indexed frames into pixels (nes_palette.c). Each has a scalar version (the
+// reference, and the only one off x86-64), an SSE2 version and, where it
+// pays, an AVX2 one; the table is picked once at run time from CPUID.
+//
+// AVX2 functions are compiled with a target attribute, so the rest of the
+// build needs no -mavx2 and still runs on any x86-64.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ppu_simd.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define PPU_SIMD_X86 1
+  #include <emmintrin.h>
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define AVX2_FN
+  #else
+    #include <cpuid.h>
+    #define AVX2_FN __attribute__((target("avx2")))
+  #endif
+#else
+  #define PPU_SIMD_X86 0
+#endif
+
+#define NES_W 256
+
+// -----------------------------------------------------------------------------
+// Scalar
+// -----------------------------------------------------------------------------
+static void tile_decode_scalar(uint8_t plain[64], uint8_t flipped[64], const uint8_t chr[16])
+{
+    for (int r = 0; r < 8; ++r) {
+        const uint8_t lo = chr[r], hi = chr[r + 8];
+        for (int c = 0; c < 8; ++c) {
+            const uint8_t p = (uint8_t)(((lo >> (7 - c)) & 1u) | (((hi >> (7 - c)) & 1u) << 1));
+            plain[r * 8 + c]         = p;
+            flipped[r * 8 + (7 - c)] = p;
+        }
+    }
+}
+
+static void bg_tiles_scalar(uint8_t* out, const uint8_t* const* rows, const uint8_t* pal, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < 8; ++c) {
+            const uint8_t p = rows[i][c];
+            out[i * 8 + c] = p ? (uint8_t)(pal[i] | p) : 0;
+        }
+    }
+}
+
+static void spr_row_scalar(uint8_t* out, const uint8_t* px, uint8_t bits)
+{
+    for (int c = 0; c < 8; ++c) {
+        if (!out[c] && px[c]) out[c] = (uint8_t)(bits | px[c]);
+    }
+}
+
+static inline uint8_t compose_px(uint8_t b, uint8_t s)
+{
+    return (s && (!(s & PPU_SPR_BEHIND) || b == 0)) ? (uint8_t)(s & 0x1F) : b;
+}
+
+static void compose_scalar(uint32_t* dst, const uint8_t* bg, const uint8_t* spr,
+                           const uint32_t pal[32], int clip_bg, int clip_spr)
+{
+    for (int x = 0; x < NES_W; ++x) {
+        const uint8_t b = (x < 8 && clip_bg)  ? 0 : bg[x];
+        const uint8_t s = (x < 8 && clip_spr) ? 0 : spr[x];
+        dst[x] = pal[compose_px(b, s)];
+    }
+}
+
+static void compose_index_scalar(uint8_t* dst, const uint8_t* bg, const uint8_t* spr,
+                                 const uint8_t pal[32], int clip_bg, int clip_spr)
+{
+    for (int x = 0; x < NES_W; ++x) {
+        const uint8_t b = (x < 8 && clip_bg)  ? 0 : bg[x];
+        const uint8_t s = (x < 8 && clip_spr) ? 0 : spr[x];
+        dst[x] = pal[compose_px(b, s)];
+    }
+}
+
+static void expand32_scalar(uint32_t* dst, const uint8_t* src, const uint32_t lut[64], int n)
+{
+    for (int i = 0; i < n; ++i) dst[i] = lut[src[i] & 63];
+}
+
+static void expand16_scalar(uint16_t* dst, const uint8_t* src, const uint16_t lut[64], int n)
+{
+    for (int i = 0; i < n; ++i) dst[i] = lut[src[i] & 63];
+}
+
+static const ppu_kernels_t k_scalar = {
+    tile_decode_scalar, bg_tiles_scalar, spr_row_scalar, compose_scalar,
+    compose_index_scalar, expand32_scalar, expand16_scalar,
+};
+
+#if PPU_SIMD_X86
+// -----------------------------------------------------------------------------
+// SSE2
+// -----------------------------------------------------------------------------
+static inline uint64_t load64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+// Both variants of a row in one register: plain in bytes 0-7, flipped in 8-15
+static void tile_decode_sse2(uint8_t plain[64], uint8_t flipped[64], const uint8_t chr[16])
+{
+    const __m128i sel = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                      0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80);
+    const __m128i one = _mm_set1_epi8(1), two = _mm_set1_epi8(2);
+    for (int r = 0; r < 8; ++r) {
+        const __m128i lo = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8((char)chr[r]), sel), sel);
+        const __m128i hi = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8((char)chr[r + 8]), sel), sel);
+        const __m128i p  = _mm_or_si128(_mm_and_si128(lo, one), _mm_and_si128(hi, two));
+        _mm_storel_epi64((__m128i*)(plain + r * 8), p);
+        _mm_storel_epi64((__m128i*)(flipped + r * 8), _mm_unpackhi_epi64(p, p));
+    }
+}
+
+// Two tiles (16 pixels) per step
+static void bg_tiles_sse2(uint8_t* out, const uint8_t* const* rows, const uint8_t* pal, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const uint64_t bcast = 0x0101010101010101ull;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128i p  = _mm_set_epi64x((long long)load64(rows[i + 1]), (long long)load64(rows[i]));
+        const __m128i pv = _mm_set_epi64x((long long)(pal[i + 1] * bcast), (long long)(pal[i] * bcast));
+        const __m128i v  = _mm_or_si128(p, _mm_andnot_si128(_mm_cmpeq_epi8(p, zero), pv));
+        _mm_storeu_si128((__m128i*)(out + i * 8), v);
+    }
+    if (i < n) bg_tiles_scalar(out + i * 8, rows + i, pal + i, n - i);
+}
+
+static void spr_row_sse2(uint8_t* out, const uint8_t* px, uint8_t bits)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i o = _mm_loadl_epi64((const __m128i*)out);
+    const __m128i p = _mm_loadl_epi64((const __m128i*)px);
+    const __m128i m = _mm_andnot_si128(_mm_cmpeq_epi8(p, zero), _mm_cmpeq_epi8(o, zero));
+    const __m128i v = _mm_or_si128(p, _mm_set1_epi8((char)bits));
+    _mm_storel_epi64((__m128i*)out, _mm_or_si128(o, _mm_and_si128(m, v)));   // o is 0 where m is set
+}
+
+// Palette indexes for 16 pixels; `keep_*` zero out a layer (left-8 clip)
+static inline __m128i compose_idx_sse2(__m128i b, __m128i s, __m128i keep_b, __m128i keep_s)
+{
+    const __m128i zero = _mm_setzero_si128();
+    b = _mm_and_si128(b, keep_b);
+    s = _mm_and_si128(s, keep_s);
+    const __m128i s_on   = _mm_andnot_si128(_mm_cmpeq_epi8(s, zero), _mm_set1_epi8(-1));
+    const __m128i front  = _mm_cmpeq_epi8(_mm_and_si128(s, _mm_set1_epi8((char)PPU_SPR_BEHIND)), zero);
+    const __m128i take_s = _mm_and_si128(s_on, _mm_or_si128(front, _mm_cmpeq_epi8(b, zero)));
+    const __m128i s_idx  = _mm_and_si128(s, _mm_set1_epi8(0x1F));
+    return _mm_or_si128(_mm_and_si128(take_s, s_idx), _mm_andnot_si128(take_s, b));
+}
+
+// SSE2 has no variable 32-bit shuffle: indexes in vectors, colours by load
+static void compose_sse2(uint32_t* dst, const uint8_t* bg, const uint8_t* spr,
+                         const uint32_t pal[32], int clip_bg, int clip_spr)
+{
+    const __m128i all  = _mm_set1_epi8(-1);
+    const __m128i left = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+    uint8_t idx[16];
+    for (int x = 0; x < NES_W; x += 16) {
+        const __m128i kb = (x == 0 && clip_bg)  ? left : all;
+        const __m128i ks = (x == 0 && clip_spr) ? left : all;
+        _mm_storeu_si128((__m128i*)idx,
+                         compose_idx_sse2(_mm_loadu_si128((const __m128i*)(bg + x)),
+                                          _mm_loadu_si128((const __m128i*)(spr + x)), kb, ks));
+        for (int i = 0; i < 16; ++i) dst[x + i] = pal[idx[i]];
+    }
+}
+
+static void compose_index_sse2(uint8_t* dst, const uint8_t* bg, const uint8_t* spr,
+                               const uint8_t pal[32], int clip_bg, int clip_spr)
+{
+    const __m128i all  = _mm_set1_epi8(-1);
+    const __m128i left = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+    uint8_t idx[16];
+    for (int x = 0; x < NES_W; x += 16) {
+        const __m128i kb = (x == 0 && clip_bg)  ? left : all;
+        const __m128i ks = (x == 0 && clip_spr) ? left : all;
+        _mm_storeu_si128((__m128i*)idx,
+                         compose_idx_sse2(_mm_loadu_si128((const __m128i*)(bg + x)),
+                                          _mm_loadu_si128((const __m128i*)(spr + x)), kb, ks));
+        for (int i = 0; i < 16; ++i) dst[x + i] = pal[idx[i]];
+    }
+}
+
+// The table lookups stay scalar here: SSE2 has no byte shuffle or gather
+static const ppu_kernels_t k_sse2 = {
+    tile_decode_sse2, bg_tiles_sse2, spr_row_sse2, compose_sse2,
+    compose_index_sse2, expand32_scalar, expand16_scalar,
+};
+
+// -----------------------------------------------------------------------------
+// AVX2
+// -----------------------------------------------------------------------------
+// Four tiles (32 pixels) per step
+AVX2_FN static void bg_tiles_avx2(uint8_t* out, const uint8_t* const* rows, const uint8_t* pal, int n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const uint64_t bcast = 0x0101010101010101ull;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i p  = _mm256_set_epi64x((long long)load64(rows[i + 3]), (long long)load64(rows[i + 2]),
+                                             (long long)load64(rows[i + 1]), (long long)load64(rows[i]));
+        const __m256i pv = _mm256_set_epi64x((long long)(pal[i + 3] * bcast), (long long)(pal[i + 2] * bcast),
+                                             (long long)(pal[i + 1] * bcast), (long long)(pal[i] * bcast));
+        const __m256i v  = _mm256_or_si256(p, _mm256_andnot_si256(_mm256_cmpeq_epi8(p, zero), pv));
+        _mm256_storeu_si256((__m256i*)(out + i * 8), v);
+    }
+    if (i < n) bg_tiles_sse2(out + i * 8, rows + i, pal + i, n - i);
+}
+
+// The 32 colours stay in four registers; each index picks with three
+// 8-entry permutes and two blends on its bits 3 and 4
+AVX2_FN static void compose_avx2(uint32_t* dst, const uint8_t* bg, const uint8_t* spr,
+                                 const uint32_t pal[32], int clip_bg, int clip_spr)
+{
+    const __m256i p0 = _mm256_loadu_si256((const __m256i*)(pal + 0));
+    const __m256i p1 = _mm256_loadu_si256((const __m256i*)(pal + 8));
+    const __m256i p2 = _mm256_loadu_si256((const __m256i*)(pal + 16));
+    const __m256i p3 = _mm256_loadu_si256((const __m256i*)(pal + 24));
+    const __m128i all  = _mm_set1_epi8(-1);
+    const __m128i left = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    for (int x = 0; x < NES_W; x += 16) {
+        const __m128i kb = (x == 0 && clip_bg)  ? left : all;
+        const __m128i ks = (x == 0 && clip_spr) ? left : all;
+        const __m128i idx = compose_idx_sse2(_mm_loadu_si128((const __m128i*)(bg + x)),
+                                             _mm_loadu_si128((const __m128i*)(spr + x)), kb, ks);
+        for (int h = 0; h < 2; ++h) {
+            const __m256i i32 = _mm256_cvtepu8_epi32(h ? _mm_srli_si128(idx, 8) : idx);
+            const __m256 b3 = _mm256_castsi256_ps(_mm256_slli_epi32(i32, 28));
+            const __m256 b4 = _mm256_castsi256_ps(_mm256_slli_epi32(i32, 27));
+            const __m256 c01 = _mm256_blendv_ps(_mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p0, i32)),
+                                                _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p1, i32)), b3);
+            const __m256 c23 = _mm256_blendv_ps(_mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p2, i32)),
+                                                _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(p3, i32)), b3);
+            _mm256_storeu_si256((__m256i*)(dst + x + h * 8), _mm256_castps_si256(_mm256_blendv_ps(c01, c23, b4)));
+        }
+    }
+}
+
+// Both 16-entry halves of the palette as byte shuffles, picked on bit 4
+AVX2_FN static void compose_index_avx2(uint8_t* dst, const uint8_t* bg, const uint8_t* spr,
+                                       const uint8_t pal[32], int clip_bg, int clip_spr)
+{
+    const __m128i lo = _mm_loadu_si128((const __m128i*)pal);
+    const __m128i hi = _mm_loadu_si128((const __m128i*)(pal + 16));
+    const __m128i all  = _mm_set1_epi8(-1);
+    const __m128i left = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    for (int x = 0; x < NES_W; x += 16) {
+        const __m128i kb = (x == 0 && clip_bg)  ? left : all;
+        const __m128i ks = (x == 0 && clip_spr) ? left : all;
+        const __m128i idx = compose_idx_sse2(_mm_loadu_si128((const __m128i*)(bg + x)),
+                                             _mm_loadu_si128((const __m128i*)(spr + x)), kb, ks);
+        const __m128i c = _mm_blendv_epi8(_mm_shuffle_epi8(lo, idx), _mm_shuffle_epi8(hi, idx),
+                                          _mm_slli_epi16(idx, 3));
+        _mm_storeu_si128((__m128i*)(dst + x), c);
+    }
+}
+
+// Eight colours per gather
+AVX2_FN static void expand32_avx2(uint32_t* dst, const uint8_t* src, const uint32_t lut[64], int n)
+{
+    const __m256i m = _mm256_set1_epi32(63);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i idx = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i))), m);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi32((const int*)lut, idx, 4));
+    }
+    if (i < n) expand32_scalar(dst + i, src + i, lut, n - i);
+}
+
+// The table as low and high bytes, four 16-entry shuffles each: every index
+// is looked up in all four and bits 4-5 keep one, 32 pixels per step
+AVX2_FN static void expand16_avx2(uint16_t* dst, const uint8_t* src, const uint16_t lut[64], int n)
+{
+    __m256i lo[4], hi[4];
+    for (int t = 0; t < 4; ++t) {
+        uint8_t l[16], h[16];
+        for (int j = 0; j < 16; ++j) {
+            l[j] = (uint8_t)lut[t * 16 + j];
+            h[j] = (uint8_t)(lut[t * 16 + j] >> 8);
+        }
+        lo[t] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)l));
+        hi[t] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)h));
+    }
+
+    const __m256i low4 = _mm256_set1_epi8(0x0F), three = _mm256_set1_epi8(3);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i src8 = _mm256_loadu_si256((const __m256i*)(src + i));
+        const __m256i idx  = _mm256_and_si256(src8, low4);
+        const __m256i row  = _mm256_and_si256(_mm256_srli_epi16(src8, 4), three);
+        __m256i l = _mm256_setzero_si256(), h = _mm256_setzero_si256();
+        for (int t = 0; t < 4; ++t) {
+            const __m256i sel = _mm256_cmpeq_epi8(row, _mm256_set1_epi8((char)t));
+            l = _mm256_or_si256(l, _mm256_and_si256(sel, _mm256_shuffle_epi8(lo[t], idx)));
+            h = _mm256_or_si256(h, _mm256_and_si256(sel, _mm256_shuffle_epi8(hi[t], idx)));
+        }
+        // Per 128-bit lane: pixels 0-7 / 16-23 and 8-15 / 24-31
+        const __m256i a = _mm256_unpacklo_epi8(l, h), b = _mm256_unpackhi_epi8(l, h);
+        _mm256_storeu_si256((__m256i*)(dst + i),      _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    if (i < n) expand16_scalar(dst + i, src + i, lut, n - i);
+}
+
+static const ppu_kernels_t k_avx2 = {
+    tile_decode_sse2, bg_tiles_avx2, spr_row_sse2, compose_avx2,
+    compose_index_avx2, expand32_avx2, expand16_avx2,
+};
+
+// -----------------------------------------------------------------------------
+// CPUID
+// -----------------------------------------------------------------------------
+static void cpuid(unsigned leaf, unsigned sub, unsigned r[4])
+{
+#if defined(_MSC_VER)
+    int x[4];
+    __cpuidex(x, (int)leaf, (int)sub);
+    for (int i = 0; i < 4; ++i) r[i] = (unsigned)x[i];
+#else
+    if (!__get_cpuid_count(leaf, sub, &r[0], &r[1], &r[2], &r[3])) r[0] = r[1] = r[2] = r[3] = 0;
+#endif
+}
+
+static uint64_t xcr0(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static ppu_simd_t detect(void)
+{
+    unsigned r[4];
+    cpuid(0, 0, r);
+    const unsigned max_leaf = r[0];
+
+    cpuid(1, 0, r);
+    const int osxsave = (r[2] >> 27) & 1, avx = (r[2] >> 28) & 1;
+    // AVX2 needs the OS to save YMM state (XCR0 bits 1-2) as well
+    if (max_leaf < 7 || !osxsave || !avx || (xcr0() & 6) != 6) return PPU_SIMD_SSE2;
+    cpuid(7, 0, r);
+    return ((r[1] >> 5) & 1) ? PPU_SIMD_AVX2 : PPU_SIMD_SSE2;
+}
+#else
+static ppu_simd_t detect(void) { return PPU_SIMD_SCALAR; }
+#endif // PPU_SIMD_X86
+
+// -----------------------------------------------------------------------------
+// Dispatch
+// -----------------------------------------------------------------------------
+static int                  s_best = -1;
+static const ppu_kernels_t* s_active;
+
+ppu_simd_t ppu_simd_best(void)
+{
+    if (s_best < 0) s_best = (int)detect();
+    return (ppu_simd_t)s_best;
+}
+
+const ppu_kernels_t* ppu_simd_kernels(ppu_simd_t level)
+{
+    if ((int)level > (int)ppu_simd_best()) return NULL;
+    switch (level) {
+    case PPU_SIMD_SCALAR: return &k_scalar;
+#if PPU_SIMD_X86
+    case PPU_SIMD_SSE2:   return &k_sse2;
+    case PPU_SIMD_AVX2:   return &k_avx2;
+#endif
+    default:              return NULL;
+    }
+}
+
+ppu_simd_t ppu_simd_select(ppu_simd_t level)
+{
+    int l = (int)level;
+    while (l > 0 && !ppu_simd_kernels((ppu_simd_t)l)) --l;
+    if (l < 0) l = 0;
+    s_active = ppu_simd_kernels((ppu_simd_t)l);
+    return (ppu_simd_t)l;
+}
+
+const ppu_kernels_t* ppu_simd_active(void)
+{
+    if (!s_active) ppu_simd_select(ppu_simd_best());
+    return s_active;
+}
+
+const char* ppu_simd_name(ppu_simd_t level)
+{
+    switch (level) {
+    case PPU_SIMD_SCALAR: return "scalar";
+    case PPU_SIMD_SSE2:   return "sse2";
+    case PPU_SIMD_AVX2:   return "avx2";
+    }
+    return "?";
+}
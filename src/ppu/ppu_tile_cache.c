@@ -0,0 +1,92 @@
+// src/ppu/ppu_tile_cache.c
+// Decoded CHR tiles, keyed by physical 1KB page: 64 tiles per page, each
+// expanded once into 2-bit pixels (plain and H-flipped) and kept until a
+// CHR-RAM write touches it or a new cartridge is loaded. Pages are allocated
+// on first use, so an 8KB NROM costs 64KB and a 256KB MMC3 game only pays
+// for the banks it actually shows.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ppu_tile_cache.h"
+#include "ppu_mem.h"
+#include "ppu_simd.h"
+
+#define TILE_PAGES_MAX 256   // 256KB of CHR
+
+typedef struct
+{
+    uint64_t   valid;        // bit n: tile n decoded
+    ppu_tile_t tile[64];
+} tile_page_t;
+
+static tile_page_t* s_pages[TILE_PAGES_MAX];
+static tile_page_t* s_slot[8];   // page shown at PPU $0000 + n*$400 (NULL: uncached)
+static const ppu_view_t* s_src;  // CHR the slots are decoded from
+static uint64_t     s_hits, s_misses;
+
+static tile_page_t* page_for(int page)
+{
+    if ((unsigned)page >= TILE_PAGES_MAX) return NULL;
+    if (!s_pages[page]) s_pages[page] = (tile_page_t*)calloc(1, sizeof(tile_page_t));
+    return s_pages[page];
+}
+
+static void decode(ppu_tile_t* t, uint16_t addr)
+{
+    uint8_t chr[16];
+    // Not ppu_mem_read(): decoding is not a PPU fetch, so no A12 clocking
+    const uint8_t* p = s_src->chr[addr >> 10];
+    if (p) memcpy(chr, p + (addr & 0x03FF), 16);
+    else   for (int i = 0; i < 16; ++i) chr[i] = ppu_mem_chr_peek((uint16_t)(addr + i));
+    ppu_simd_active()->tile_decode(t->px[0][0], t->px[1][0], chr);
+}
+
+void ppu_tile_cache_map_banks(const ppu_view_t* mv)
+{
+    s_src = mv;
+    for (int i = 0; i < 8; ++i) s_slot[i] = page_for(mv->chr_page[i]);
+}
+
+const ppu_tile_t* ppu_tile_get(uint16_t addr, ppu_tile_t* spill)
+{
+    addr &= 0x1FF0;
+    tile_page_t* p = s_slot[addr >> 10];
+    if (!p) {
+        decode(spill, addr);
+        return spill;
+    }
+
+    const int n = (addr >> 4) & 63;
+    if (p->valid & (1ull << n)) {
+        s_hits++;
+    } else {
+        s_misses++;
+        decode(&p->tile[n], addr);
+        p->valid |= 1ull << n;
+    }
+    return &p->tile[n];
+}
+
+void ppu_tile_cache_invalidate(int page, uint16_t addr)
+{
+    if ((unsigned)page < TILE_PAGES_MAX && s_pages[page]) {
+        s_pages[page]->valid &= ~(1ull << ((addr >> 4) & 63));
+    }
+}
+
+void ppu_tile_cache_flush(void)
+{
+    for (int i = 0; i < TILE_PAGES_MAX; ++i) {
+        if (s_pages[i]) s_pages[i]->valid = 0;
+    }
+    memset(s_slot, 0, sizeof s_slot);
+    s_hits = s_misses = 0;
+}
+
+void ppu_tile_cache_stats(uint64_t* hits, uint64_t* misses)
+{
+    if (hits)   *hits   = s_hits;
+    if (misses) *misses = s_misses;
+}
@@ -1,10 +1,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 
 #include "ppu.h"
 #include "ppu_regs.h"
+#include "ppu_defer.h"
+#include "mapper.h"
 
 // Forward decl from mapper_mmc3.c (level IRQ version).
 // This must be linked in when Mapper 4 is active.
@@ -28,42 +31,163 @@ uint64_t ppu_frame_count(void)
     return ppu_frame_ctr;
 }
 
+#if PPU_DOT_DEFAULT
+static ppu_mode_t s_mode = PPU_MODE_DOT;
+#else
+static ppu_mode_t s_mode = PPU_MODE_SCANLINE;
+#endif
+
+void ppu_set_mode(ppu_mode_t mode)
+{
+    s_mode = mode;
+    ppu_dot_reset();
+    // Dot mode fetches CHR in hardware order, so the MMC3 can watch A12
+    mapper_mmc3_set_a12_from_reads(mode == PPU_MODE_DOT);
+    ppu_defer_reset();   // the render thread only draws scanline mode
+}
+
+ppu_mode_t ppu_get_mode(void) { return s_mode; }
+
+// Drawing as requested, and as latched for the frame in progress
+static bool s_draw = true, s_draw_frame = true;
+
+void ppu_set_frame_draw(bool on) { s_draw = on; }
+bool ppu_get_frame_draw(void)    { return s_draw; }
+bool ppu_frame_drawn(void)       { return s_draw_frame; }
+
 void ppu_timing_reset(void)
 {
     ppu_dot = 0;
     ppu_scanline = 0;
     ppu_frame_ctr = 0;
+    s_draw_frame = s_draw;
+    ppu_render_frame_start(s_draw_frame);
+    ppu_dot_reset();
 }
 
-static inline void ppu_advance_dot(void)
+// Positions where something happens (pos = scanline * 341 + dot)
+#define PPU_DOTS_PER_LINE  341
+#define PPU_DOTS_PER_FRAME (341 * 262)
+#define PPU_POS_VBL_SET    (241 * PPU_DOTS_PER_LINE + 1)
+#define PPU_POS_VBL_CLR    (261 * PPU_DOTS_PER_LINE + 1)
+#define PPU_MMC3_DOT       260
+#define PPU_RENDER_DOT     256   // visible line drawn; Y increment (+ dot 257 X reload)
+#define PPU_RELOAD_DOT     280   // pre-render line: vertical scroll reloaded from t
+#define PPU_PRERENDER_LINE 261
+#define PPU_A12_SPR_DOT    262   // dot mode: first sprite pattern fetch
+#define PPU_A12_BG_DOT     326   // dot mode: first pattern fetch of the next line's prefetch
+
+static inline bool rendering_on(void)
 {
-    // advance one PPU dot
-    ppu_dot++;
-    if (ppu_dot == 341) {
-        ppu_dot = 0;
-        ppu_scanline++;
-        if (ppu_scanline == 262) {
-            ppu_scanline = 0;
-            ppu_frame_ctr++;
-#if PPU_TRACE
-            fprintf(stderr, "[PPU] frame start #%" PRIu64 " (pre-render)\n", ppu_frame_ctr);
-#endif
+    return (ppu_mask_reg() & 0x18) != 0; // BG or SPR enabled
+}
+
+// -----------------------------------------------------------------------------
+// Sprite 0 hit. Scanline mode sets the flag as an event of its own, at dot
+// x + 2 for hit pixel x like the dot pipeline, from the state of that dot:
+// any write syncs the PPU first and the hit is worked out again. The
+// scheduler looks it up ahead (ppu_dots_to_sprite0_hit()) so that a CPU
+// polling PPUSTATUS for it stops exactly there.
+// -----------------------------------------------------------------------------
+
+static bool sprite0_can_hit(void)
+{
+    return !(ppu_regs_status_peek() & 0x40) && (ppu_mask_reg() & 0x18) == 0x18;
+}
+
+// Line the current `v` and sprite list are for: the next visible line drawn
+static int current_v_line(void)
+{
+    return ppu_scanline < 240 ? ppu_scanline + (ppu_dot >= PPU_RENDER_DOT) : 0;
+}
+
+// VRAM address visible line sl (v_line or later) is drawn from if nothing is
+// written before: v stepped as dots 256/257 do, or loaded from t during
+// vblank as the pre-render line does
+static uint16_t line_start_v(int sl, int v_line)
+{
+    uint16_t v, t;
+    uint8_t fine_x;
+    ppu_regs_get_vram_addr(&v, &fine_x);
+    ppu_regs_get_scroll(&t, &fine_x);
+
+    if (ppu_scanline >= 240) {
+        if (ppu_scanline != PPU_PRERENDER_LINE || ppu_dot < PPU_RENDER_DOT) v = t;
+        else if (ppu_dot < PPU_RELOAD_DOT) v = (uint16_t)((v & 0x041Fu) | (t & 0x7BE0u));
+    }
+    for (int line = v_line; line < sl; ++line) {
+        v = (uint16_t)((ppu_vram_inc_y(v) & ~0x041Fu) | (t & 0x041Fu));
+    }
+    return v;
+}
+
+// First dot after `after` on visible line sl where sprite 0 hits, -1 if
+// none. Dot mode only bounds it from below (background taken as opaque):
+// the pipeline sets the flag itself, from what it fetched.
+static int sprite0_dot(int sl, int after, int v_line)
+{
+    const int from = after - 1;   // pixel x shows at dot x + 2
+    if (sl < 1 || sl >= 240 || from > 254 || !sprite0_can_hit()) return -1;
+
+    // Bounding box first: sprite 0 must cover the line
+    const unsigned height = (ppu_ctrl_reg() & 0x20) ? 16u : 8u;
+    if ((unsigned)(sl - ppu_oam_data()[0] - 1) >= height) return -1;
+
+    int x;
+    if (s_mode == PPU_MODE_DOT) {
+        x = ppu_render_sprite0_hit(sl, NULL, from);
+    } else {
+        if (sl == v_line && !ppu_render_sprite0_listed()) return -1;
+        const uint16_t v = line_start_v(sl, v_line);
+        x = ppu_render_sprite0_hit(sl, &v, from);
+    }
+    return x < 0 ? -1 : x + 2;
+}
+
+// Scanline mode: line rendering, `v` updates and the MMC3 tick (dot mode
+// does all of that in ppu_dot_tick())
+static void scanline_events(void)
+{
+    // ---- Sprite 0 hit (ahead of the dot-256 events below) ----
+    if (ppu_scanline < 240 && ppu_dot == sprite0_dot(ppu_scanline, ppu_dot - 1, ppu_scanline)) {
+        ppu_regs_status_set(0x40);
+    }
+
+    // ---- Scanline renderer ----
+    // The whole line is drawn at dot 256 with the state of that moment (any
+    // register or mapper write syncs the PPU first). The dot-256 Y increment
+    // and dot-257 X reload of `v` are applied together right after.
+    if (ppu_dot == PPU_RENDER_DOT && ppu_scanline < 240) {
+        ppu_render_scanline(ppu_scanline);
+    }
+    if (rendering_on()) {
+        if (ppu_dot == PPU_RENDER_DOT && (ppu_scanline < 240 || ppu_scanline == PPU_PRERENDER_LINE)) {
+            ppu_regs_line_advance();
+        }
+        if (ppu_dot == PPU_RELOAD_DOT && ppu_scanline == PPU_PRERENDER_LINE) {
+            ppu_regs_frame_reload();
         }
     }
 
     // ---- MMC3 scanline IRQ hook ----
-    // Call once per visible scanline at dot ~260 when rendering is enabled.
+    // Once per visible scanline and on the pre-render line (which fetches
+    // sprites too) at dot ~260 when rendering is enabled.
     // This approximates a valid A12 rising edge and keeps MMC3 IRQs firing
     // even if CHR fetches aren't modeled per PPU cycle.
-    if (ppu_dot == 260 && ppu_scanline >= 0 && ppu_scanline < 240) {
-        uint8_t mask = ppu_mask_reg();
-        if (mask & 0x18) { // BG or SPR enabled
+    if (ppu_dot == PPU_MMC3_DOT && (ppu_scanline < 240 || ppu_scanline == PPU_PRERENDER_LINE)) {
+        if (rendering_on()) {
             mapper_mmc3_on_ppu_scanline_tick();
 #if PPU_TRACE
-            fprintf(stderr, "[PPU] MMC3 tick sl=%d dot=260 mask=%02X\n", ppu_scanline, mask);
+            fprintf(stderr, "[PPU] MMC3 tick sl=%d dot=260 mask=%02X\n", ppu_scanline, ppu_mask_reg());
 #endif
         }
     }
+}
+
+// Everything the dot just reached triggers
+static void ppu_dot_events(void)
+{
+    if (s_mode == PPU_MODE_SCANLINE) scanline_events();
 
     // vblank transitions at dot 1 of specific scanlines
     if (ppu_dot == 1 && ppu_scanline == 241) {
@@ -74,19 +198,238 @@ static inline void ppu_advance_dot(void)
     }
     if (ppu_dot == 1 && ppu_scanline == 261) {
         ppu_regs_set_vblank(false);
+        ppu_regs_status_clear(0x60);   // sprite 0 hit, sprite overflow
 #if PPU_TRACE
         fprintf(stderr, "[PPU] VBL CLR at frame=%" PRIu64 ", sl=261, dot=1\n", ppu_frame_ctr);
 #endif
     }
 }
 
+// First event dot on line `sl` strictly after `after`, -1 if none
+static int next_event_dot(int sl, int after, bool rendering)
+{
+    if ((sl == 241 || sl == PPU_PRERENDER_LINE) && after < 1) return 1;
+    if (s_mode == PPU_MODE_DOT) return -1;
+    if (sl < 240) {
+        const int hit = sprite0_dot(sl, after, current_v_line());   // never past dot 256
+        if (hit >= 0) return hit;
+        if (after < PPU_RENDER_DOT) return PPU_RENDER_DOT;
+        if (rendering && after < PPU_MMC3_DOT) return PPU_MMC3_DOT;
+    }
+    if (sl == PPU_PRERENDER_LINE && rendering) {
+        if (after < PPU_RENDER_DOT) return PPU_RENDER_DOT;
+        if (after < PPU_MMC3_DOT)   return PPU_MMC3_DOT;
+        if (after < PPU_RELOAD_DOT) return PPU_RELOAD_DOT;
+    }
+    return -1;
+}
+
+// Dots from `pos` to the next position with an event, the frame wrap counted
+// as one (strictly ahead, so at most a frame).
+static int dots_to_next_event(int pos)
+{
+    const bool rendering = rendering_on();
+    int sl  = pos / PPU_DOTS_PER_LINE;
+    int dot = pos % PPU_DOTS_PER_LINE;
+    for (; sl < 262; ++sl, dot = -1) {
+        if (sl > 241 && sl < PPU_PRERENDER_LINE) { sl = PPU_PRERENDER_LINE; dot = -1; } // nothing in vblank
+        const int d = next_event_dot(sl, dot, rendering);
+        if (d >= 0) return sl * PPU_DOTS_PER_LINE + d - pos;
+    }
+    return PPU_DOTS_PER_FRAME - pos;
+}
+
+// -----------------------------------------------------------------------------
+// Vblank position and look-ahead for the scheduler. "Dots until X" counts the
+// dot advances up to and including the one that triggers X.
+// -----------------------------------------------------------------------------
+
+static uint32_t dots_until(int scanline, int dot)
+{
+    const int now    = ppu_scanline * PPU_DOTS_PER_LINE + ppu_dot;
+    const int target = scanline * PPU_DOTS_PER_LINE + dot;
+    const int d      = target - now;
+    return (uint32_t)(d > 0 ? d : d + PPU_DOTS_PER_FRAME);
+}
+
+bool ppu_in_vblank_lines(void)
+{
+    const int pos = ppu_scanline * PPU_DOTS_PER_LINE + ppu_dot;
+    return pos >= PPU_POS_VBL_SET && pos < PPU_POS_VBL_CLR;
+}
+
+uint32_t ppu_dots_to_vblank_edge(void)
+{
+    const uint32_t set = dots_until(241, 1);
+    const uint32_t clr = dots_until(261, 1);
+    return set < clr ? set : clr;
+}
+
+// Dot where the MMC3 counter is clocked on a rendering line, 0 if never.
+// Dot mode: where A12 first rises after being low, for the usual pattern
+// table layouts (8x16 sprites assume slot 0 fetches from $1000).
+static int mmc3_tick_dot(void)
+{
+    if (s_mode == PPU_MODE_SCANLINE) return PPU_MMC3_DOT;
+    const uint8_t ctrl = ppu_ctrl_reg();
+    if (ctrl & 0x20) return PPU_A12_SPR_DOT;
+    switch (ctrl & 0x18) {
+    case 0x08: return PPU_A12_SPR_DOT;  // BG $0000, sprites $1000
+    case 0x10: return PPU_A12_BG_DOT;   // BG $1000, sprites $0000
+    default:   return 0;                // A12 never changes while rendering
+    }
+}
+
+uint32_t ppu_dots_to_scanline_tick(int n)
+{
+    const int tick = mmc3_tick_dot();
+    if (n <= 0 || tick == 0 || !rendering_on()) return 0; // no ticks while rendering is off
+
+    // First tick strictly after now, then one per rendering line: visible
+    // lines and the pre-render line (it fetches sprites too)
+    const int now = ppu_scanline * PPU_DOTS_PER_LINE + ppu_dot;
+    int base = -now;
+    int sl = ppu_scanline + (ppu_dot >= tick);
+    for (;; ++sl) {
+        if (sl == 262) { sl = 0; base += PPU_DOTS_PER_FRAME; }
+        if (sl < 240 || sl == PPU_PRERENDER_LINE) {
+            if (--n == 0) return (uint32_t)(base + sl * PPU_DOTS_PER_LINE + tick);
+        }
+    }
+}
+
+uint32_t ppu_dots_to_sprite0_hit(void)
+{
+    // Nothing until the flag is cleared at the pre-render line (a vblank
+    // edge, so the scheduler re-arms there anyway)
+    if (!sprite0_can_hit()) return 0;
+
+    const unsigned height = (ppu_ctrl_reg() & 0x20) ? 16u : 8u;
+    const int top    = ppu_oam_data()[0] + 1;
+    const int v_line = current_v_line();
+    int sl = ppu_scanline < 240 ? ppu_scanline : 0;
+    if (sl < top) sl = top;
+    for (; sl < top + (int)height && sl < 240; ++sl) {
+        const int after = sl == ppu_scanline ? ppu_dot : -1;
+        const int d = sprite0_dot(sl, after, v_line);
+        if (d >= 0) return dots_until(sl, d);
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Sprite overflow. Scanline mode sets it at dot 256 of the line whose
+// evaluation finds it, dot mode during that line's evaluation (dots 65-256).
+// Looked up ahead like sprite 0 hit, so an idle loop polling PPUSTATUS for
+// it stops there. Which lines overflow depends on OAM and the sprite height
+// alone; the set is worked out again only when one of them changed.
+// -----------------------------------------------------------------------------
+
+#define PPU_EVAL_DOT 65   // dot mode: first dot of the evaluation
+
+static uint8_t  s_ovf_oam[256];
+static int      s_ovf_height = -1;
+static uint64_t s_ovf_lines[4];   // bit y: the evaluation on line y overflows
+
+static void update_overflow_lines(void)
+{
+    const uint8_t* oam = ppu_oam_data();
+    const int height = (ppu_ctrl_reg() & 0x20) ? 16 : 8;
+    if (height == s_ovf_height && memcmp(oam, s_ovf_oam, sizeof s_ovf_oam) == 0) return;
+    memcpy(s_ovf_oam, oam, sizeof s_ovf_oam);
+    s_ovf_height = height;
+    memset(s_ovf_lines, 0, sizeof s_ovf_lines);
+
+    // The overflow search only starts after 8 in-range entries, so only
+    // lines covered by 8 or more need the real evaluation
+    uint8_t count[240] = { 0 };
+    for (int i = 0; i < 64; ++i) {
+        for (int line = oam[i * 4]; line < oam[i * 4] + height && line < 240; ++line) count[line]++;
+    }
+    for (int y = 0; y < 240; ++y) {
+        if (count[y] >= 8 && ppu_render_sprite_overflow(y)) s_ovf_lines[y >> 6] |= 1ull << (y & 63);
+    }
+}
+
+uint32_t ppu_dots_to_sprite_overflow(void)
+{
+    // Nothing until the flag is cleared at the pre-render line (a vblank
+    // edge), and no evaluation while rendering is off (a write turns it on)
+    if ((ppu_regs_status_peek() & 0x20) || !rendering_on()) return 0;
+
+    update_overflow_lines();
+    for (int sl = ppu_scanline < 240 ? ppu_scanline : 0; sl < 240; ++sl) {
+        if (!((s_ovf_lines[sl >> 6] >> (sl & 63)) & 1)) continue;
+        if (sl == ppu_scanline && ppu_dot >= PPU_RENDER_DOT) continue;
+        if (s_mode == PPU_MODE_SCANLINE) return dots_until(sl, PPU_RENDER_DOT);
+        // Dot mode: somewhere in the evaluation; stop at each of its dots
+        const int after = sl == ppu_scanline ? ppu_dot : -1;
+        return dots_until(sl, after >= PPU_EVAL_DOT ? after + 1 : PPU_EVAL_DOT);
+    }
+    return 0;
+}
+
+// Dot mode: every dot of the rendering lines goes through ppu_dot_tick();
+// the vblank lines in between are skipped up to their events.
+static void step_dots(int left)
+{
+    int pos = ppu_scanline * PPU_DOTS_PER_LINE + ppu_dot;
+    while (left > 0) {
+        int next = pos + 1;
+        const int sl = next / PPU_DOTS_PER_LINE;
+        if (sl >= 240 && sl < PPU_PRERENDER_LINE) {
+            next = pos < PPU_POS_VBL_SET ? PPU_POS_VBL_SET : PPU_PRERENDER_LINE * PPU_DOTS_PER_LINE - 1;
+            if (next - pos > left) { pos += left; break; }
+        }
+        left -= next - pos;
+        pos   = next;
+        if (pos == PPU_DOTS_PER_FRAME) {
+            pos = 0;
+            ppu_frame_ctr++;
+            s_draw_frame = s_draw;
+            ppu_render_frame_start(s_draw_frame);
+        }
+        ppu_scanline = pos / PPU_DOTS_PER_LINE;
+        ppu_dot      = pos % PPU_DOTS_PER_LINE;
+        if (ppu_scanline < 240 || ppu_scanline == PPU_PRERENDER_LINE) {
+            ppu_dot_tick(ppu_scanline, ppu_dot);
+        }
+        ppu_dot_events();
+    }
+    ppu_scanline = pos / PPU_DOTS_PER_LINE;
+    ppu_dot      = pos % PPU_DOTS_PER_LINE;
+}
+
+// Jumps from event to event instead of walking every dot; the state after
+// each event position is the same as with a per-dot loop. The PPUMASK
+// rendering bits cannot change in between: register writes sync first.
 void ppu_step(int cpu_cycles)
 {
     // PPU runs 3x CPU speed
-    int ppu_cycles = cpu_cycles * 3;
-    while (ppu_cycles-- > 0)
-    {
-        ppu_advance_dot();
-        // (later: sprite eval, fetch pipeline, sprite 0 hit/overflow, etc.)
+    int left = cpu_cycles * 3;
+    if (left <= 0) return;
+    if (s_mode == PPU_MODE_DOT) { step_dots(left); return; }
+
+    int pos = ppu_scanline * PPU_DOTS_PER_LINE + ppu_dot;
+    for (;;) {
+        const int d = dots_to_next_event(pos);
+        if (d > left) { pos += left; break; }
+        left -= d;
+        pos  += d;
+        if (pos == PPU_DOTS_PER_FRAME) {
+            pos = 0;
+            ppu_frame_ctr++;
+            s_draw_frame = s_draw;
+            ppu_render_frame_start(s_draw_frame);
+#if PPU_TRACE
+            fprintf(stderr, "[PPU] frame start #%" PRIu64 " (pre-render)\n", ppu_frame_ctr);
+#endif
+        }
+        ppu_scanline = pos / PPU_DOTS_PER_LINE;
+        ppu_dot      = pos % PPU_DOTS_PER_LINE;
+        ppu_dot_events();
+        if (left == 0) return;
     }
+    ppu_scanline = pos / PPU_DOTS_PER_LINE;
+    ppu_dot      = pos % PPU_DOTS_PER_LINE;
 }
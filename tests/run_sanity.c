@@ -11,6 +11,7 @@
 #include "apu.h"
 #include "cpu.h"
 #include "nes.h"
+#include "nes_idle.h"
 
 // If your core exposes this; otherwise remove and just loop your own step.
 extern uint64_t nes_step_frame(void);
@@ -79,16 +80,30 @@ static void dump_oam_summary(const char* tag) {
 int main(int argc, char** argv)
 {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <rom.nes> [--frames N] [--budget-frames M]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <rom.nes> [--frames N] [--budget-frames M] [--core ref|fast|jit] [--no-idle-skip] [--trace N] [--profile PREFIX [--labels FILE]]\n", argv[0]);
         return 2;
     }
     const char* rom_path = argv[1];
     int frames_to_run = 2;
     int budget_frames  = 10;
+    size_t trace_records = 0; // --trace N: keep the last N instructions, dump at exit
+    const char* profile_prefix = NULL; // --profile P: write P.txt and P.folded at exit
+    const char* labels_path = NULL;
 
     for (int i = 2; i < argc; ++i) {
         if (argi(argv[i], "--frames") && i+1 < argc)        frames_to_run = atoi(argv[++i]);
         else if (argi(argv[i], "--budget-frames") && i+1<argc) budget_frames = atoi(argv[++i]);
+        else if (argi(argv[i], "--core") && i+1 < argc) {
+            const char* c = argv[++i];
+            if      (argi(c, "ref"))  cpu_set_core(CPU_CORE_REFERENCE);
+            else if (argi(c, "fast")) cpu_set_core(CPU_CORE_FAST);
+            else if (argi(c, "jit"))  cpu_set_core(CPU_CORE_JIT);
+            else fprintf(stderr, "Unknown core: %s\n", c);
+        }
+        else if (argi(argv[i], "--no-idle-skip")) nes_idle_set_enabled(0);
+        else if (argi(argv[i], "--trace") && i+1 < argc) trace_records = (size_t)atol(argv[++i]);
+        else if (argi(argv[i], "--profile") && i+1 < argc) profile_prefix = argv[++i];
+        else if (argi(argv[i], "--labels") && i+1 < argc) labels_path = argv[++i];
         else fprintf(stderr, "Unknown arg: %s\n", argv[i]);
     }
 
@@ -105,6 +120,16 @@ int main(int argc, char** argv)
     ppu_reset();
     apu_reset();
 
+    if (trace_records && !cpu_trace_start(trace_records)) {
+        fprintf(stderr, "Failed to allocate a %zu-record CPU trace\n", trace_records);
+        return 1;
+    }
+
+    if (profile_prefix) {
+        if (labels_path) fprintf(stderr, "[PROF] %d labels from %s\n", cpu_prof_load_labels(labels_path), labels_path);
+        if (!cpu_prof_start()) { fprintf(stderr, "Failed to start the profiler\n"); return 1; }
+    }
+
     int ok = 1;
     for (int f = 0; f < frames_to_run; ++f) {
         uint64_t start_frames = ppu_frame_count();
@@ -171,5 +196,45 @@ int main(int argc, char** argv)
                 f+1, (unsigned long long)ppu_frame_count(), bstr(ppu_in_vblank()));
     }
 
+    cpu_icache_stats_t ic;
+    cpu_icache_get_stats(&ic);
+    const uint64_t fetched = ic.hits + ic.misses + ic.bypassed;
+    fprintf(stderr, "[ICACHE] hits=%llu misses=%llu bypassed=%llu invalidations=%llu hit-rate=%.2f%%\n",
+            (unsigned long long)ic.hits, (unsigned long long)ic.misses,
+            (unsigned long long)ic.bypassed, (unsigned long long)ic.invalidations,
+            fetched ? 100.0 * (double)ic.hits / (double)fetched : 0.0);
+
+    const uint64_t cpu_cycles = cpu_get_cycles();
+    fprintf(stderr, "[IDLE] skipped=%llu (%.2f%% of %llu CPU cycles) last-frame=%llu\n",
+            (unsigned long long)nes_idle_cycles_skipped(),
+            cpu_cycles ? 100.0 * (double)nes_idle_cycles_skipped() / (double)cpu_cycles : 0.0,
+            (unsigned long long)cpu_cycles, (unsigned long long)nes_idle_cycles_last_frame());
+
+    if (cpu_get_core() == CPU_CORE_JIT) {
+        cpu_jit_stats_t js;
+        cpu_jit_get_stats(&js);
+        fprintf(stderr, "[JIT] native=%d blocks=%llu runs=%llu bailouts=%llu flushes=%llu translated-cycles=%.2f%%\n",
+                cpu_jit_available(), (unsigned long long)js.blocks, (unsigned long long)js.block_runs,
+                (unsigned long long)js.bailouts, (unsigned long long)js.flushes,
+                js.total_cycles ? 100.0 * (double)js.jit_cycles / (double)js.total_cycles : 0.0);
+    }
+
+    if (cpu_prof_active()) {
+        cpu_prof_stop();
+        char path[512];
+        snprintf(path, sizeof path, "%s.txt", profile_prefix);
+        const int rows = cpu_prof_write_report(path, 0);
+        snprintf(path, sizeof path, "%s.folded", profile_prefix);
+        const int paths = cpu_prof_write_folded(path);
+        fprintf(stderr, "[PROF] %d addresses -> %s.txt, %d call paths -> %s.folded\n",
+                rows, profile_prefix, paths, profile_prefix);
+    }
+
+    if (cpu_trace_active()) {
+        cpu_trace_stop();
+        const long n = cpu_trace_dump(NULL);
+        if (n >= 0) fprintf(stderr, "[TRACE] %ld records -> cpu_trace.bin\n", n);
+    }
+
     return ok ? 0 : 3;
 }
@@ -2,23 +2,38 @@
 // Minimal mock bus: a flat 64KiB RAM image. No mirroring needed for unit tests.
 
 #include "test_bus.h"
+#include "cpu.h"
 
 static uint8_t s_mem[0x10000];
 
+static const uint8_t* s_rd_pages[256];
+static uint8_t*       s_wr_pages[256];
+static int            s_pages_built;
+
 uint8_t cpu_read(uint16_t addr) {
-    return s_mem[addr];
+    const uint8_t* p = s_rd_pages[addr >> 8]; // differs from s_mem only after tb_map_rom()
+    return p ? p[addr & 0xFF] : s_mem[addr];
 }
 
 void cpu_write(uint16_t addr, uint8_t v) {
     s_mem[addr] = v;
+    cpu_icache_invalidate(&s_mem[addr], 1);
 }
 
+static void tb_build_pages(void);
+
+// The whole image is RAM as far as the decoded instruction cache is concerned;
+// re-adding it drops every decoded page, so rebuild the (untrapped) page tables.
 void tb_reset_memory(void) {
     for (size_t i = 0; i < sizeof(s_mem); ++i) s_mem[i] = 0x00;
+    s_pages_built = 0;
+    tb_build_pages();
+    cpu_icache_add_ram(s_mem, sizeof(s_mem));
 }
 
 void tb_poke(uint16_t addr, uint8_t v) {
     s_mem[addr] = v;
+    cpu_icache_invalidate(&s_mem[addr], 1);
 }
 
 uint8_t tb_peek(uint16_t addr) {
@@ -26,14 +41,44 @@ uint8_t tb_peek(uint16_t addr) {
 }
 
 void tb_load_program(uint16_t addr, const uint8_t* bytes, size_t len) {
-    for (size_t i = 0; i < len; ++i) s_mem[addr + i] = bytes[i];
+    for (size_t i = 0; i < len; ++i) tb_poke((uint16_t)(addr + i), bytes[i]);
 }
 
 static void write_vec(uint16_t vec, uint16_t addr) {
-    s_mem[vec + 0] = (uint8_t)(addr & 0xFF);
-    s_mem[vec + 1] = (uint8_t)(addr >> 8);
+    tb_poke(vec, (uint8_t)(addr & 0xFF));
+    tb_poke((uint16_t)(vec + 1), (uint8_t)(addr >> 8));
 }
 
 void tb_set_reset_vector(uint16_t addr) { write_vec(0xFFFC, addr); }
 void tb_set_nmi_vector(uint16_t addr)   { write_vec(0xFFFA, addr); }
 void tb_set_irq_vector(uint16_t addr)   { write_vec(0xFFFE, addr); }
+
+// Page tables for the CPU fast path: every page maps straight onto s_mem
+// except $2000-$5FFF, which stays NULL so tests also exercise the I/O path.
+static void tb_build_pages(void) {
+    if (s_pages_built) return;
+    s_pages_built = 1;
+    for (int i = 0; i < 256; ++i) {
+        int io = (i >= 0x20 && i < 0x60);
+        s_rd_pages[i] = io ? NULL : &s_mem[i << 8];
+        s_wr_pages[i] = io ? NULL : &s_mem[i << 8];
+    }
+}
+
+const uint8_t* const* bus_read_pages(void)  { tb_build_pages(); return s_rd_pages; }
+uint8_t* const*       bus_write_pages(void) { tb_build_pages(); return s_wr_pages; }
+
+void tb_map_rom(uint16_t addr, const uint8_t* page) {
+    tb_build_pages();
+    s_rd_pages[addr >> 8] = page;
+    s_wr_pages[addr >> 8] = NULL;
+}
+
+// Pages holding decoded code lose their direct write pointer, so the fast
+// core's stores to them come back through cpu_write() above.
+void bus_trap_code_writes(const uint8_t* page, int on) {
+    tb_build_pages();
+    for (int i = 0; i < 256; ++i) {
+        if (s_rd_pages[i] == page) s_wr_pages[i] = on ? NULL : &s_mem[i << 8];
+    }
+}
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "cpu.h"
+#include "cpu_table.h"
 #include "test_bus.h"
 
 #ifndef ASSERT_EQ
@@ -326,9 +327,756 @@ static int test_nmi_irq_paths(void) {
     return 0;
 }
 
-int main(void) {
+// --- Decoded instruction cache ------------------------------------------------
+// Loops decode once and then hit; a write into decoded RAM code drops it; a
+// bank switch only swaps which decoded page is used.
+static int test_icache(void) {
+    cpu_icache_stats_t st;
+
+    // LDX #$00 / loop: INX / BNE loop  -> 1 + 2*256 instructions, 3 distinct
+    tb_reset_memory();
+    tb_set_reset_vector(0x8000);
+    tb_load_program(0x8000, (const uint8_t[]){ 0xA2,0x00, 0xE8, 0xD0,0xFD }, 5);
+    cpu_reset();
+    cpu_icache_reset_stats();
+    step_n(1 + 2 * 256);
+    cpu_icache_get_stats(&st);
+    ASSERT_EQ_U16(0x8005, cpu_get_pc(), "loop fell through");
+    ASSERT_TRUE(st.misses == 3, "one decode per instruction");
+    ASSERT_TRUE(st.hits == 2 * 256 - 2, "loop runs from the cache");
+
+    // Self-modifying code in RAM:
+    //   0300: A9 11     LDA #$11
+    //   0302: A2 77     LDX #$77
+    //   0304: 8E 01 03  STX $0301   ; patch the LDA operand
+    //   0307: 4C 00 03  JMP $0300
+    tb_load_program(0x0300, (const uint8_t[]){ 0xA9,0x11, 0xA2,0x77, 0x8E,0x01,0x03, 0x4C,0x00,0x03 }, 10);
+    cpu_set_pc(0x0300);
+    cpu_icache_reset_stats();
+    step_n(4);
+    ASSERT_EQ_U8(0x11, cpu_get_a(), "LDA before patch");
+    step_n(1);
+    ASSERT_EQ_U8(0x77, cpu_get_a(), "LDA sees the patched operand");
+    cpu_icache_get_stats(&st);
+    ASSERT_TRUE(st.invalidations == 1, "write into decoded RAM invalidates");
+
+    // Two fake PRG banks switched in and out at $8000:
+    //   bank n: A9 0n  LDA #n / EA  NOP / 4C 00 80  JMP $8000
+    static uint8_t rom[2 * 256];
+    for (int b = 0; b < 2; ++b) {
+        const uint8_t code[] = { 0xA9, (uint8_t)(b + 1), 0xEA, 0x4C, 0x00, 0x80 };
+        memcpy(&rom[b * 256], code, sizeof code);
+    }
+    cpu_icache_add_rom(rom, sizeof rom);
+    cpu_icache_reset_stats();
+    tb_map_rom(0x8000, &rom[0]);
+    cpu_set_pc(0x8000);
+    step_n(6);
+    ASSERT_EQ_U8(0x01, cpu_get_a(), "bank 0");
+    tb_map_rom(0x8000, &rom[256]);
+    step_n(3);
+    ASSERT_EQ_U8(0x02, cpu_get_a(), "bank 1");
+    tb_map_rom(0x8000, &rom[0]);
+    step_n(3);
+    ASSERT_EQ_U8(0x01, cpu_get_a(), "bank 0 again");
+    cpu_icache_get_stats(&st);
+    ASSERT_TRUE(st.misses == 6, "switching back keeps bank 0 decoded");
+    ASSERT_TRUE(st.hits == 6, "other instructions hit");
+
+    cpu_icache_add_rom(NULL, 0);
+    tb_reset_memory();
+    return 0;
+}
+
+// --- Fast core vs reference core ---------------------------------------------
+// Random memory hits every opcode and addressing mode (and the $2000-$5FFF
+// "I/O" pages of the mock bus). Both cores run from the same image with the
+// same NMI/IRQ pokes; registers, cycles and memory must match step for step.
+typedef struct { uint16_t pc; uint8_t a, x, y, p, sp; uint64_t cyc; } cpu_snap_t;
+
+static cpu_snap_t snap(void) {
+    cpu_snap_t s = { cpu_get_pc(), cpu_get_a(), cpu_get_x(), cpu_get_y(),
+                     cpu_get_p(), cpu_get_sp(), cpu_get_cycles() };
+    return s;
+}
+
+static int snap_eq(const cpu_snap_t* a, const cpu_snap_t* b) {
+    return a->pc == b->pc && a->a == b->a && a->x == b->x && a->y == b->y &&
+           a->p == b->p && a->sp == b->sp && a->cyc == b->cyc;
+}
+
+static void fill_random(uint32_t seed) {
+    uint32_t r = seed;
+    for (uint32_t a = 0; a < 0x10000; ++a) {
+        r = r * 1664525u + 1013904223u;
+        tb_poke((uint16_t)a, (uint8_t)(r >> 24));
+    }
+    tb_set_reset_vector(0x8000);
+}
+
+static void interrupt_pokes(int step) {
+    if (step % 997 == 0)  cpu_nmi();
+    if (step % 1543 == 0) cpu_irq_assert();
+    if (step % 1543 == 40) cpu_irq_clear();
+}
+
+#define DIFF_STEPS 20000
+static cpu_snap_t s_ref_trace[DIFF_STEPS];
+static uint8_t    s_ref_mem[0x10000];
+
+static int test_fast_core_matches_reference(void) {
+    for (uint32_t seed = 1; seed <= 8; ++seed) {
+        // Reference run
+        fill_random(seed);
+        cpu_set_core(CPU_CORE_REFERENCE);
+        cpu_reset();
+        for (int i = 0; i < DIFF_STEPS; ++i) {
+            interrupt_pokes(i);
+            cpu_step();
+            s_ref_trace[i] = snap();
+        }
+        for (uint32_t a = 0; a < 0x10000; ++a) s_ref_mem[a] = tb_peek((uint16_t)a);
+
+        // Fast core, one instruction per cpu_run(1)
+        fill_random(seed);
+        cpu_set_core(CPU_CORE_FAST);
+        cpu_reset();
+        for (int i = 0; i < DIFF_STEPS; ++i) {
+            interrupt_pokes(i);
+            cpu_run(1);
+            cpu_snap_t s = snap();
+            if (!snap_eq(&s, &s_ref_trace[i])) {
+                fprintf(stderr, "ASSERT FAILED: seed %u step %d: fast PC=%04X A=%02X X=%02X Y=%02X P=%02X SP=%02X C=%llu"
+                        " ref PC=%04X A=%02X X=%02X Y=%02X P=%02X SP=%02X C=%llu\n",
+                        (unsigned)seed, i, s.pc, s.a, s.x, s.y, s.p, s.sp, (unsigned long long)s.cyc,
+                        s_ref_trace[i].pc, s_ref_trace[i].a, s_ref_trace[i].x, s_ref_trace[i].y,
+                        s_ref_trace[i].p, s_ref_trace[i].sp, (unsigned long long)s_ref_trace[i].cyc);
+                cpu_set_core(CPU_CORE_REFERENCE);
+                return 1;
+            }
+        }
+        for (uint32_t a = 0; a < 0x10000; ++a) {
+            if (tb_peek((uint16_t)a) != s_ref_mem[a]) {
+                fprintf(stderr, "ASSERT FAILED: seed %u memory differs at $%04X\n", (unsigned)seed, (unsigned)a);
+                cpu_set_core(CPU_CORE_REFERENCE);
+                return 1;
+            }
+        }
+
+        // Fast core in batches: must land on the same instruction boundaries
+        // as the reference core does with cpu_run().
+        fill_random(seed);
+        cpu_set_core(CPU_CORE_REFERENCE);
+        cpu_reset();
+        for (int i = 0; i < 200; ++i) cpu_run(113);
+        cpu_snap_t ref = snap();
+        for (uint32_t a = 0; a < 0x10000; ++a) s_ref_mem[a] = tb_peek((uint16_t)a);
+
+        fill_random(seed);
+        cpu_set_core(CPU_CORE_FAST);
+        cpu_reset();
+        for (int i = 0; i < 200; ++i) cpu_run(113);
+        cpu_snap_t fast = snap();
+        cpu_set_core(CPU_CORE_REFERENCE);
+        ASSERT_TRUE(snap_eq(&fast, &ref), "cpu_run batch state matches reference");
+        for (uint32_t a = 0; a < 0x10000; ++a) {
+            ASSERT_TRUE(tb_peek((uint16_t)a) == s_ref_mem[a], "cpu_run batch memory matches reference");
+        }
+    }
+    return 0;
+}
+
+// --- Golden trace ------------------------------------------------------------
+// A generated nestest-style program at $8000: every documented opcode, twice,
+// with pseudo-random registers, flags and operands. It covers zero-page wrap,
+// indexed page crosses, taken/untaken branches (one across a page), the
+// JMP ($xxFF) bug, JSR/RTS, RTI and BRK. Stores and read-modify-writes are
+// followed by a load of the effective address so memory shows in the log.
+// tests/data/cpu_golden.log holds one nestest-format line per instruction,
+// recorded from the reference core; both cores must reproduce it exactly.
+// `cpu-core-tests --write-golden <path>` regenerates it.
+#ifndef CPU_GOLDEN_LOG
+#define CPU_GOLDEN_LOG "tests/data/cpu_golden.log"
+#endif
+
+#define GOLDEN_ORG 0x8000
+#define GOLDEN_BRK 0xF000
+#define GOLDEN_MAX_LINES 20000
+
+static uint16_t g_emit;
+static uint32_t g_rng;
+
+static uint8_t rnd8(void) {
+    g_rng = g_rng * 1664525u + 1013904223u;
+    return (uint8_t)(g_rng >> 24);
+}
+
+static void emit(uint8_t b) { tb_poke(g_emit++, b); }
+static void emit2(uint8_t op, uint8_t b) { emit(op); emit(b); }
+static void emit3(uint8_t op, uint16_t w) { emit(op); emit((uint8_t)w); emit((uint8_t)(w >> 8)); }
+
+// LDA #v / STA ea; returns the address of the immediate so it can be patched
+static uint16_t emit_store(uint16_t ea, uint8_t v) {
+    emit2(0xA9, v);
+    const uint16_t imm = (uint16_t)(g_emit - 1);
+    if (ea < 0x100) emit2(0x85, (uint8_t)ea); else emit3(0x8D, ea);
+    return imm;
+}
+
+static void emit_pointer(uint8_t zp, uint16_t target) {
+    emit_store(zp, (uint8_t)target);
+    emit_store((uint8_t)(zp + 1), (uint8_t)(target >> 8));
+}
+
+// A/X/Y/P straight from immediates: LDA #p, PHA, LDX, LDY, LDA #a, PLP
+static void emit_regs(uint8_t a, uint8_t x, uint8_t y, uint8_t p) {
+    emit2(0xA9, p); emit(0x48);
+    emit2(0xA2, x); emit2(0xA0, y);
+    emit2(0xA9, a); emit(0x28);
+}
+
+static uint16_t rnd_ram(void)  { return (uint16_t)(0x0200 + ((rnd8() << 8 | rnd8()) % 0x0600)); }
+static uint8_t  rnd_zp(void)   { return (uint8_t)(0x20 + rnd8() % 0xC0); }
+static uint8_t  rnd_ptr(void)  { return (uint8_t)(0x02 + 2 * (rnd8() % 7)); }
+
+static void emit_case(uint8_t op, int variant) {
+    const char* m = cpu_addrmode[op];
+    uint8_t a = rnd8(), x = rnd8(), y = rnd8(), p = rnd8(), v = rnd8();
+    uint16_t ea = 0;
+    int readback = 1;
+
+    if (!strcmp(m, "rel")) {
+        // Branch over LDX #$EE. Variant 0 is taken and sits at $xxFC so the
+        // target is on the next page; variant 1 falls through.
+        static const uint8_t flag[4] = { FLAG_N, FLAG_V, FLAG_C, FLAG_Z };
+        const uint8_t f = flag[op >> 6];
+        const int taken = variant == 0;
+        const int want = ((op >> 5) & 1) == taken;
+        p = want ? (uint8_t)(p | f) : (uint8_t)(p & ~f);
+        emit_regs(a, x, y, p);
+        if (taken) {
+            const uint16_t at = (uint16_t)(((g_emit + 3 + 4) | 0xFF) - 3);
+            emit3(0x4C, at);
+            while (g_emit < at) emit(0x00);
+        }
+        emit2(op, 0x02);
+        emit2(0xA2, 0xEE);
+        return;
+    }
+
+    switch (op) {
+    case 0x4C: // JMP abs: to the next instruction
+        emit_regs(a, x, y, p);
+        emit3(op, (uint16_t)(g_emit + 3));
+        return;
+    case 0x6C: { // JMP (ind); variant 1 reads its high byte from $0200
+        const uint16_t ptr = variant ? 0x02FF : rnd_ram();
+        const uint16_t hi = (uint16_t)((ptr & 0xFF00) | ((ptr + 1) & 0xFF));
+        if (variant) emit_store(0x0300, 0xEE);
+        const uint16_t lo_imm = emit_store(ptr, 0);
+        const uint16_t hi_imm = emit_store(hi, 0);
+        emit_regs(a, x, y, p);
+        emit3(op, ptr);
+        tb_poke(lo_imm, (uint8_t)g_emit);
+        tb_poke(hi_imm, (uint8_t)(g_emit >> 8));
+        return;
+    }
+    case 0x20: { // JSR to an RTS right behind a JMP over it
+        emit_regs(a, x, y, p);
+        const uint16_t at = g_emit;
+        emit3(op, (uint16_t)(at + 6));
+        emit3(0x4C, (uint16_t)(at + 7));
+        emit(0x60);
+        return;
+    }
+    case 0x60: { // RTS to a pushed return address
+        emit_regs(a, x, y, p);
+        const uint16_t ret = (uint16_t)(g_emit + 6); // address of the RTS
+        emit2(0xA9, (uint8_t)(ret >> 8)); emit(0x48);
+        emit2(0xA9, (uint8_t)ret); emit(0x48);
+        emit(op);
+        return;
+    }
+    case 0x40: { // RTI with pushed return address and flags
+        emit_regs(a, x, y, p);
+        const uint16_t ret = (uint16_t)(g_emit + 10);
+        emit2(0xA9, (uint8_t)(ret >> 8)); emit(0x48);
+        emit2(0xA9, (uint8_t)ret); emit(0x48);
+        emit2(0xA9, v); emit(0x48);
+        emit(op);
+        return;
+    }
+    case 0x00: // BRK into INX / RTI, back behind the padding byte
+        emit_regs(a, x, y, p);
+        emit(op); emit(0xEA);
+        return;
+    case 0x68: case 0x28: // PLA/PLP: something to pull
+        emit2(0xA9, v); emit(0x48);
+        break;
+    default:
+        break;
+    }
+
+    if (!strcmp(m, "#imm")) {
+        emit_regs(a, x, y, p);
+        emit2(op, v);
+        return;
+    }
+    if (!strcmp(m, "zp")) {
+        ea = rnd_zp();
+        emit_store(ea, v);
+        emit_regs(a, x, y, p);
+        emit2(op, (uint8_t)ea);
+    } else if (!strcmp(m, "zp,X") || !strcmp(m, "zp,Y")) {
+        ea = rnd_zp();
+        const uint8_t idx = m[3] == 'X' ? x : y;
+        emit_store(ea, v);
+        emit_regs(a, x, y, p);
+        emit2(op, (uint8_t)(ea - idx)); // base + index wraps in page zero
+    } else if (!strcmp(m, "abs")) {
+        ea = rnd_ram();
+        emit_store(ea, v);
+        emit_regs(a, x, y, p);
+        emit3(op, ea);
+    } else if (!strcmp(m, "abs,X") || !strcmp(m, "abs,Y")) {
+        ea = rnd_ram();
+        const uint8_t idx = m[4] == 'X' ? x : y;
+        emit_store(ea, v);
+        emit_regs(a, x, y, p);
+        emit3(op, (uint16_t)(ea - idx));
+    } else if (!strcmp(m, "(ind,X)")) {
+        ea = rnd_ram();
+        const uint8_t ptr = rnd_ptr();
+        emit_pointer(ptr, ea);
+        emit_store(ea, v);
+        emit_regs(a, x, y, p);
+        emit2(op, (uint8_t)(ptr - x));
+    } else if (!strcmp(m, "(ind),Y")) {
+        ea = rnd_ram();
+        const uint8_t ptr = rnd_ptr();
+        emit_pointer(ptr, (uint16_t)(ea - y));
+        emit_store(ea, v);
+        emit_regs(a, x, y, p);
+        emit2(op, ptr);
+    } else {
+        // implied / accumulator
+        emit_regs(a, x, y, p);
+        emit(op);
+        readback = 0;
+    }
+    if (readback) {
+        if (ea < 0x100) emit2(0xA5, (uint8_t)ea); else emit3(0xAD, ea);
+    }
+}
+
+// Lays the program out in memory; returns the address of its final JMP *.
+static uint16_t build_golden_program(void) {
+    tb_reset_memory();
+    tb_set_reset_vector(GOLDEN_ORG);
+    tb_set_irq_vector(GOLDEN_BRK);
+    tb_load_program(GOLDEN_BRK, (const uint8_t[]){ 0xE8, 0x40 }, 2); // INX, RTI
+
+    g_emit = GOLDEN_ORG;
+    g_rng = 0x6502;
+    for (int variant = 0; variant < 2; ++variant) {
+        for (int op = 0; op < 256; ++op) {
+            if (cpu_mnemonic[op][0] == '?') continue;
+            emit_case((uint8_t)op, variant);
+        }
+    }
+    const uint16_t end = g_emit;
+    emit3(0x4C, end);
+    return end;
+}
+
+static uint16_t golden_ea(uint16_t pc, uint8_t op, uint8_t b1, uint8_t b2, uint8_t x, uint8_t y) {
+    const char* m = cpu_addrmode[op];
+    const uint16_t abs = (uint16_t)(b1 | (b2 << 8));
+    if (!strcmp(m, "zp,X"))    return (uint8_t)(b1 + x);
+    if (!strcmp(m, "zp,Y"))    return (uint8_t)(b1 + y);
+    if (!strcmp(m, "abs,X"))   return (uint16_t)(abs + x);
+    if (!strcmp(m, "abs,Y"))   return (uint16_t)(abs + y);
+    if (!strcmp(m, "(ind)"))
+        return (uint16_t)(tb_peek(abs) | (tb_peek((uint16_t)((abs & 0xFF00) | ((abs + 1) & 0xFF))) << 8));
+    if (!strcmp(m, "(ind,X)"))
+        return (uint16_t)(tb_peek((uint8_t)(b1 + x)) | (tb_peek((uint8_t)(b1 + x + 1)) << 8));
+    if (!strcmp(m, "(ind),Y"))
+        return (uint16_t)((tb_peek(b1) | (tb_peek((uint8_t)(b1 + 1)) << 8)) + y);
+    if (!strcmp(m, "rel"))     return (uint16_t)(pc + 2 + (int8_t)b1);
+    return 0;
+}
+
+// The current CPU state as one nes-trace-decode / nestest line:
+//   C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:7
+static void golden_line(char* out, size_t n) {
+    const uint16_t pc = cpu_get_pc();
+    const uint8_t op = tb_peek(pc), b1 = tb_peek((uint16_t)(pc + 1)), b2 = tb_peek((uint16_t)(pc + 2));
+    const uint8_t x = cpu_get_x(), y = cpu_get_y();
+    const uint16_t ea = golden_ea(pc, op, b1, b2, x, y);
+    const unsigned abs = (unsigned)(b1 | (b2 << 8));
+    const char* m = cpu_addrmode[op];
+
+    char bytes[12], operand[24], text[40];
+    if (cpu_instr_len[op] == 1)      snprintf(bytes, sizeof bytes, "%02X", op);
+    else if (cpu_instr_len[op] == 2) snprintf(bytes, sizeof bytes, "%02X %02X", op, b1);
+    else                             snprintf(bytes, sizeof bytes, "%02X %02X %02X", op, b1, b2);
+
+    if      (!strcmp(m, "#imm"))    snprintf(operand, sizeof operand, "#$%02X", b1);
+    else if (!strcmp(m, "zp"))      snprintf(operand, sizeof operand, "$%02X", b1);
+    else if (!strcmp(m, "zp,X"))    snprintf(operand, sizeof operand, "$%02X,X @ %02X", b1, ea);
+    else if (!strcmp(m, "zp,Y"))    snprintf(operand, sizeof operand, "$%02X,Y @ %02X", b1, ea);
+    else if (!strcmp(m, "abs"))     snprintf(operand, sizeof operand, "$%04X", abs);
+    else if (!strcmp(m, "abs,X"))   snprintf(operand, sizeof operand, "$%04X,X @ %04X", abs, ea);
+    else if (!strcmp(m, "abs,Y"))   snprintf(operand, sizeof operand, "$%04X,Y @ %04X", abs, ea);
+    else if (!strcmp(m, "(ind)"))   snprintf(operand, sizeof operand, "($%04X) = %04X", abs, ea);
+    else if (!strcmp(m, "(ind,X)")) snprintf(operand, sizeof operand, "($%02X,X) @ %04X", b1, ea);
+    else if (!strcmp(m, "(ind),Y")) snprintf(operand, sizeof operand, "($%02X),Y @ %04X", b1, ea);
+    else if (!strcmp(m, "rel"))     snprintf(operand, sizeof operand, "$%04X", ea);
+    else if (!strcmp(m, "A"))       snprintf(operand, sizeof operand, "A");
+    else                            operand[0] = '\0';
+    snprintf(text, sizeof text, " %s %s", cpu_mnemonic[op], operand);
+
+    snprintf(out, n, "%04X  %-8s %-33s A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu",
+             pc, bytes, text, cpu_get_a(), x, y, cpu_get_p(), cpu_get_sp(),
+             (unsigned long long)cpu_get_cycles());
+}
+
+static char* s_golden_text;
+static char* s_golden[GOLDEN_MAX_LINES];
+static int   s_golden_n;
+
+static int load_golden(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return 0; }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    s_golden_text = (char*)malloc((size_t)size + 1);
+    const size_t got = fread(s_golden_text, 1, (size_t)size, f);
+    fclose(f);
+    s_golden_text[got] = '\0';
+
+    s_golden_n = 0;
+    for (char* line = strtok(s_golden_text, "\r\n"); line && s_golden_n < GOLDEN_MAX_LINES;
+         line = strtok(NULL, "\r\n")) {
+        s_golden[s_golden_n++] = line;
+    }
+    return s_golden_n > 0;
+}
+
+// Steps the program to its final JMP *, comparing (or, with `out`, writing)
+// one line per instruction. Returns 0 on a match.
+static int run_golden(cpu_core_t core, FILE* out) {
+    const uint16_t end = build_golden_program();
+    cpu_set_core(core);
+    cpu_reset();
+
+    char line[128];
+    int n = 0;
+    for (;; ++n) {
+        golden_line(line, sizeof line);
+        if (out) {
+            fprintf(out, "%s\n", line);
+        } else if (n >= s_golden_n || strcmp(line, s_golden[n]) != 0) {
+            fprintf(stderr, "ASSERT FAILED: %s core, golden line %d\n  expected: %s\n  got:      %s\n",
+                    core == CPU_CORE_FAST ? "fast" : "reference", n + 1,
+                    n < s_golden_n ? s_golden[n] : "(end of log)", line);
+            cpu_set_core(CPU_CORE_REFERENCE);
+            return 1;
+        }
+        if (cpu_get_pc() == end || n + 1 >= GOLDEN_MAX_LINES) break;
+        if (core == CPU_CORE_REFERENCE) cpu_step();
+        else                            cpu_run(1);
+    }
+    cpu_set_core(CPU_CORE_REFERENCE);
+    if (!out && n + 1 != s_golden_n) {
+        fprintf(stderr, "ASSERT FAILED: program ended after %d lines, log has %d\n", n + 1, s_golden_n);
+        return 1;
+    }
+    return 0;
+}
+
+static int write_golden(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) { perror(path); return 1; }
+    const int rc = run_golden(CPU_CORE_REFERENCE, f);
+    fclose(f);
+    return rc;
+}
+
+static int test_golden_trace(void) {
+    ASSERT_TRUE(load_golden(CPU_GOLDEN_LOG), "golden log loads");
+    if (run_golden(CPU_CORE_REFERENCE, NULL)) return 1;
+    if (run_golden(CPU_CORE_FAST, NULL)) return 1;
+
+    // One batch up to the last logged instruction must land on exactly that
+    // line: cpu_run() stops on the first instruction boundary at or past it.
+    const char* last = s_golden[s_golden_n - 1];
+    const char* cyc = strstr(last, "CYC:");
+    ASSERT_TRUE(cyc != NULL, "golden line has a cycle count");
+    const uint64_t last_cyc = strtoull(cyc + 4, NULL, 10);
+
+    build_golden_program();
+    cpu_set_core(CPU_CORE_FAST);
+    cpu_reset();
+    cpu_run((int)(last_cyc - cpu_get_cycles()));
+    cpu_set_core(CPU_CORE_REFERENCE);
+    char line[128];
+    golden_line(line, sizeof line);
+    if (strcmp(line, last) != 0) {
+        fprintf(stderr, "ASSERT FAILED: batch run\n  expected: %s\n  got:      %s\n", last, line);
+        return 1;
+    }
+    return 0;
+}
+
+// --- Binary trace -------------------------------------------------------------
+// The trace ring, decoded, must reproduce the golden log on both interpreters
+// (the fast core runs real batches here), survive a dump/unpack round trip
+// and keep only the newest records once it wraps.
+static int trace_rec_eq(const cpu_trace_rec_t* a, const cpu_trace_rec_t* b) {
+    return a->cycles == b->cycles && a->pc == b->pc && a->ea == b->ea &&
+           a->op == b->op && a->op1 == b->op1 && a->op2 == b->op2 &&
+           a->a == b->a && a->x == b->x && a->y == b->y && a->p == b->p && a->sp == b->sp;
+}
+
+static int trace_golden(cpu_core_t core, size_t ring) {
+    const uint16_t end = build_golden_program();
+    cpu_set_core(core);
+    cpu_reset();
+    ASSERT_TRUE(cpu_trace_start(ring), "trace ring allocates");
+    while (cpu_get_pc() != end) cpu_run(64);
+    cpu_trace_stop();
+    cpu_set_core(CPU_CORE_REFERENCE);
+    return 0;
+}
+
+static int test_trace_ring(void) {
+    char line[128];
+    for (int core = CPU_CORE_REFERENCE; core <= CPU_CORE_FAST; ++core) {
+        if (trace_golden((cpu_core_t)core, GOLDEN_MAX_LINES)) return 1;
+        ASSERT_TRUE(cpu_trace_count() >= (size_t)s_golden_n, "trace holds the whole program");
+        for (int i = 0; i < s_golden_n; ++i) {
+            cpu_trace_rec_t r;
+            cpu_trace_get((size_t)i, &r);
+            cpu_trace_format(&r, line, sizeof line);
+            if (strcmp(line, s_golden[i]) != 0) {
+                fprintf(stderr, "ASSERT FAILED: %s core trace record %d\n  expected: %s\n  got:      %s\n",
+                        core == CPU_CORE_FAST ? "fast" : "reference", i, s_golden[i], line);
+                return 1;
+            }
+        }
+    }
+
+    // Dump and read back
+    const char* path = "cpu_trace_test.bin";
+    const long n = cpu_trace_dump(path);
+    ASSERT_TRUE(n == (long)cpu_trace_count(), "dump writes every record");
+    FILE* f = fopen(path, "rb");
+    ASSERT_TRUE(f != NULL, "dump can be reopened");
+    char magic[8];
+    ASSERT_TRUE(fread(magic, 1, 8, f) == 8 && memcmp(magic, CPU_TRACE_MAGIC, 8) == 0, "dump magic");
+    for (long i = 0; i < n; ++i) {
+        uint8_t b[CPU_TRACE_REC_BYTES];
+        cpu_trace_rec_t got, want;
+        if (fread(b, 1, sizeof b, f) != sizeof b) { fclose(f); ASSERT_TRUE(0, "dump has every record"); }
+        cpu_trace_unpack(b, &got);
+        cpu_trace_get((size_t)i, &want);
+        if (!trace_rec_eq(&got, &want)) { fclose(f); ASSERT_TRUE(0, "record survives the round trip"); }
+    }
+    fclose(f);
+    remove(path);
+
+    // A small ring keeps the newest records of the same (fast core) run
+    cpu_trace_rec_t oldest, newest, r;
+    cpu_trace_get((size_t)n - 64, &oldest);
+    cpu_trace_get((size_t)n - 1, &newest);
+    if (trace_golden(CPU_CORE_FAST, 60)) return 1;
+    ASSERT_TRUE(cpu_trace_count() == 64, "ring size rounds up to a power of two");
+    cpu_trace_get(0, &r);
+    ASSERT_TRUE(trace_rec_eq(&r, &oldest), "wrapped ring starts 64 records from the end");
+    cpu_trace_get(63, &r);
+    ASSERT_TRUE(trace_rec_eq(&r, &newest), "wrapped ring ends on the newest record");
+
+    tb_reset_memory();
+    return 0;
+}
+
+// --- Profiler -----------------------------------------------------------------
+//   $8000 JSR delay / JSR delay / JMP *      delay: LDX #3 / DEX / BNE * -1 / RTS
+static int file_has_line(const char* path, const char* want) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    while (!found && fgets(line, sizeof line, f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        found = strcmp(line, want) == 0;
+    }
+    fclose(f);
+    return found;
+}
+
+static int test_profiler(void) {
+    tb_reset_memory();
+    tb_set_reset_vector(0x8000);
+    tb_load_program(0x8000, (const uint8_t[]){ 0x20, 0x10, 0x80, 0x20, 0x10, 0x80, 0x4C, 0x06, 0x80 }, 9);
+    tb_load_program(0x8010, (const uint8_t[]){ 0xA2, 0x03, 0xCA, 0xD0, 0xFD, 0x60 }, 6);
+    cpu_reset();
+
+    ASSERT_TRUE(cpu_prof_start(), "profiler starts");
+    const uint64_t c0 = cpu_get_cycles();
+    while (cpu_get_pc() != 0x8003) cpu_step();
+    cpu_dma_stall(513); // charged to the instruction that just ran (RTS)
+    while (cpu_get_pc() != 0x8006) cpu_step();
+    cpu_step(); // JMP *, closes the second RTS
+    cpu_prof_stop();
+
+    cpu_prof_counts_t c;
+    cpu_prof_counts(0x8012, &c);
+    ASSERT_EQ("DEX insns", c.insns, 6);
+    ASSERT_EQ("DEX cycles", c.cycles, 12);
+    cpu_prof_counts(0x8013, &c);
+    ASSERT_EQ("BNE insns", c.insns, 6);
+    ASSERT_EQ("BNE cycles (4 taken, 2 not)", c.cycles, 4 * 3 + 2 * 2);
+    cpu_prof_counts(0x8015, &c);
+    ASSERT_EQ("RTS cycles", c.cycles, 6 + 6 + 513);
+    ASSERT_EQ("RTS dma cycles", c.dma_cycles, 513);
+
+    uint64_t sum = 0;
+    for (uint16_t pc = 0x8000; pc < 0x8020; ++pc) { cpu_prof_counts(pc, &c); sum += c.cycles; }
+    ASSERT_EQ("cycles add up", sum, cpu_get_cycles() - c0);
+
+    const char* labels = "cpu_prof_test.lbl";
+    const char* folded = "cpu_prof_test.folded";
+    FILE* f = fopen(labels, "w");
+    ASSERT_TRUE(f != NULL, "label file writable");
+    fputs("# plain and ca65 .dbg forms\n"
+          "$8010 delay\n"
+          "sym\tid=0,name=\"main\",addrsize=absolute,scope=0,def=1,val=0x8000,seg=0,type=lab\n", f);
+    fclose(f);
+    ASSERT_EQ("labels loaded", cpu_prof_load_labels(labels), 2);
+    ASSERT_TRUE(cpu_prof_write_folded(folded) == 2, "two call paths");
+    ASSERT_TRUE(file_has_line(folded, "reset;delay 557"), "callee self cycles on its own path");
+    ASSERT_TRUE(file_has_line(folded, "reset 15"), "two JSRs and the JMP stay with the caller");
+    remove(labels);
+    remove(folded);
+
+    tb_reset_memory();
+    return 0;
+}
+
+// --- JIT core vs reference core ----------------------------------------------
+// $8000-$FFFF is copied into a fake PRG-ROM so the JIT core can translate it.
+// Both cores run the same uneven cpu_run() batches (random images also get
+// NMI/IRQ pokes in between) and must agree on registers and cycles after every
+// batch, and on memory at the end. Image 0 is the golden program.
+#define JIT_BATCHES 400
+static uint8_t    s_jit_rom[0x8000];
+static cpu_snap_t s_ref_batches[JIT_BATCHES];
+
+static void jit_image(uint32_t seed) {
+    if (seed) { tb_reset_memory(); fill_random(seed); }
+    else      build_golden_program();
+    for (uint32_t a = 0; a < 0x8000; ++a) s_jit_rom[a] = tb_peek((uint16_t)(0x8000 + a));
+    for (uint32_t a = 0; a < 0x8000; a += 0x100) tb_map_rom((uint16_t)(0x8000 + a), &s_jit_rom[a]);
+    cpu_icache_add_rom(s_jit_rom, sizeof s_jit_rom);
+    cpu_jit_add_rom(s_jit_rom, sizeof s_jit_rom);
+}
+
+static void run_batches(cpu_core_t core, uint32_t seed, cpu_snap_t* out) {
+    jit_image(seed);
+    cpu_set_core(core);
+    cpu_reset();
+    for (int i = 0; i < JIT_BATCHES; ++i) {
+        if (seed && i % 37 == 5)  cpu_nmi();
+        if (seed && i % 53 == 10) cpu_irq_assert();
+        if (seed && i % 53 == 20) cpu_irq_clear();
+        cpu_run(1 + (i * 89) % 317);
+        out[i] = snap();
+    }
+    cpu_set_core(CPU_CORE_REFERENCE);
+}
+
+static int test_jit_matches_reference(void) {
+    const int native = cpu_jit_available();
+    if (!native) printf("  (no executable memory here: JIT core runs interpreted)\n");
+
+    for (uint32_t seed = 0; seed <= 8; ++seed) {
+        run_batches(CPU_CORE_REFERENCE, seed, s_ref_batches);
+        for (uint32_t a = 0; a < 0x10000; ++a) s_ref_mem[a] = tb_peek((uint16_t)a);
+
+        cpu_jit_stats_t st;
+        cpu_jit_reset_stats();
+        cpu_snap_t jit[JIT_BATCHES];
+        run_batches(CPU_CORE_JIT, seed, jit);
+        cpu_jit_get_stats(&st);
+
+        for (int i = 0; i < JIT_BATCHES; ++i) {
+            if (!snap_eq(&jit[i], &s_ref_batches[i])) {
+                const cpu_snap_t* r = &s_ref_batches[i];
+                fprintf(stderr, "ASSERT FAILED: image %u batch %d: jit PC=%04X A=%02X X=%02X Y=%02X P=%02X SP=%02X C=%llu"
+                        " ref PC=%04X A=%02X X=%02X Y=%02X P=%02X SP=%02X C=%llu\n",
+                        (unsigned)seed, i, jit[i].pc, jit[i].a, jit[i].x, jit[i].y, jit[i].p, jit[i].sp,
+                        (unsigned long long)jit[i].cyc, r->pc, r->a, r->x, r->y, r->p, r->sp,
+                        (unsigned long long)r->cyc);
+                return 1;
+            }
+        }
+        for (uint32_t a = 0; a < 0x10000; ++a) {
+            if (tb_peek((uint16_t)a) != s_ref_mem[a]) {
+                fprintf(stderr, "ASSERT FAILED: image %u memory differs at $%04X\n", (unsigned)seed, (unsigned)a);
+                return 1;
+            }
+        }
+        if (native) ASSERT_TRUE(st.jit_cycles > 0, "some cycles ran in translated code");
+        if (seed == 0) {
+            printf("  golden program: %.1f%% of cycles translated (%llu blocks, %llu bailouts)\n",
+                   st.total_cycles ? 100.0 * (double)st.jit_cycles / (double)st.total_cycles : 0.0,
+                   (unsigned long long)st.blocks, (unsigned long long)st.bailouts);
+        }
+    }
+
+    cpu_icache_add_rom(NULL, 0);
+    cpu_jit_add_rom(NULL, 0);
+    tb_reset_memory();
+    return 0;
+}
+
+// cpu_addrmode_id against the strings, and each mode against the length
+static int test_addrmode_table(void) {
+    static const char* const NAME[] = {
+        "impl", "A", "#imm", "zp", "zp,X", "zp,Y", "abs", "abs,X", "abs,Y", "(ind,X)", "(ind),Y", "rel", "(ind)",
+    };
+    static const uint8_t LEN[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 2, 2, 2, 3 };
+
+    for (int op = 0; op < 256; ++op) {
+        const uint8_t m = cpu_addrmode_id[op];
+        ASSERT_TRUE(m <= CPU_AM_IND, "mode in range");
+        if (!strcmp(cpu_addrmode[op], "-")) {
+            ASSERT_TRUE(m == CPU_AM_IMP, "unused opcodes are CPU_AM_IMP");
+            continue;
+        }
+        if (strcmp(cpu_addrmode[op], NAME[m]) != 0 || cpu_instr_len[op] != LEN[m]) {
+            fprintf(stderr, "ASSERT FAILED: opcode %02X is %s, %d bytes; cpu_addrmode_id says %s\n",
+                    op, cpu_addrmode[op], cpu_instr_len[op], NAME[m]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
     int rc = 0;
 
+    if (argc > 2 && strcmp(argv[1], "--write-golden") == 0) {
+        return write_golden(argv[2]);
+    }
+
+    printf("CPU test: addressing-mode table...\n");
+    rc = test_addrmode_table();
+    if (rc) return rc; else printf("  OK\n");
+
     printf("CPU test: reset + basic load/store...\n");
     rc = test_reset_vector_and_basic_load_store();
     if (rc) return rc; else printf("  OK\n");
@@ -349,6 +1097,30 @@ int main(void) {
     rc = test_nmi_irq_paths();
     if (rc) return rc; else printf("  OK\n");
 
+    printf("CPU test: fast core matches reference...\n");
+    rc = test_fast_core_matches_reference();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("CPU test: decoded instruction cache...\n");
+    rc = test_icache();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("CPU test: golden trace (reference, fast, batch)...\n");
+    rc = test_golden_trace();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("CPU test: binary trace ring...\n");
+    rc = test_trace_ring();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("CPU test: profiler...\n");
+    rc = test_profiler();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("CPU test: JIT core matches reference...\n");
+    rc = test_jit_matches_reference();
+    if (rc) return rc; else printf("  OK\n");
+
     printf("All CPU tests passed.\n");
     return 0;
 }
@@ -0,0 +1,452 @@
+// tests/test_nes_sched.c
+// The frame loop's event scheduler (nes_sched.c) on generated cartridges
+// (test_rom.c), driven batch by batch like nes.c's run_slice(): stops come
+// in due order, the APU's catch-up-only events never stop the CPU, and a
+// batch ending exactly on a stop sees its event while one ending a cycle
+// short does not; $2002 reads in the middle of a batch see what stepping
+// the PPU after every instruction shows, and the APU's catch-up makes the
+// same samples as apu_step() after every instruction.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nes.h"
+#include "nes_sched.h"
+#include "ppu.h"
+#include "ppu_regs.h"
+#include "ppu_mem.h"
+#include "mapper.h"
+#include "cpu.h"
+#include "bus.h"
+#include "apu.h"
+#include "test_rom.h"
+
+#define ASSERT_TRUE(cond, msg) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "ASSERT FAILED: %s (line %d)\n", msg, __LINE__); \
+        return 1; \
+    } \
+} while (0)
+
+#define FRAME_CYCLES 29781
+
+static uint32_t rng = 0x2545F491u;
+static uint32_t next(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static uint8_t s_prg[0x8000], s_chr[0x2000];
+static uint8_t s_image[16 + sizeof s_prg + sizeof s_chr];
+
+static const nes_sched_event_t STOPS[] = {
+    NES_EV_VBLANK, NES_EV_MMC3_IRQ, NES_EV_DMA_DONE, NES_EV_SPRITE0, NES_EV_SPRITE_OVF,
+};
+static const char* const EV_NAME[NES_EV_COUNT] = {
+    "VBLANK", "MMC3_IRQ", "DMA_DONE", "SPRITE0", "SPRITE_OVF", "APU_FRAME", "APU_SAMPLE",
+};
+
+// --- The sled ---
+// MMC3, 32KB of NOPs behind an LDA $00, so a batch of n >= 2 cycles ends
+// exactly on its budget: entered at SLED_ODD for odd n, SLED_EVEN for even.
+// Interrupts stay off; the PPU renders solid tiles with sprite 0 on line 50,
+// nine sprites on line 120 (from $1000) and the MMC3 counter running.
+#define SLED_ODD  0x8000
+#define SLED_EVEN 0x8002
+#define IRQ_LATCH 20
+
+static int boot_sled(void)
+{
+    memset(s_prg, OP_NOP, sizeof s_prg);
+    s_prg[0] = OP_LDA_ZP;
+    s_prg[1] = 0x00;
+    for (int v = 0x7FFA; v < 0x8000; v += 2) {   // NMI/RESET/IRQ
+        s_prg[v]     = SLED_EVEN & 0xFF;
+        s_prg[v + 1] = SLED_EVEN >> 8;
+    }
+    memset(s_chr, 0, sizeof s_chr);
+    memset(s_chr + 0x0010, 0xFF, 16);            // tile 1 solid in both tables
+    memset(s_chr + 0x1010, 0xFF, 16);
+    const size_t len = test_rom_image(s_image, sizeof s_image, 4, 0, s_prg, sizeof s_prg, s_chr, sizeof s_chr);
+    if (!len || !test_rom_boot(s_image, len)) return 0;
+
+    cpu_write(0x8000, 0x07);                     // R7 = 1: PRG laid out in order
+    cpu_write(0x8001, 0x01);
+    for (uint16_t a = 0x2000; a < 0x3000; ++a) ppu_mem_write(a, 0x01);
+    for (int i = 0; i < 256; ++i) ppu_regs_oam_poke(i, 0xF0);
+    for (int i = 0; i < 10; ++i) {
+        ppu_regs_oam_poke(i * 4 + 0, i ? 119 : 49);
+        ppu_regs_oam_poke(i * 4 + 1, 0x01);
+        ppu_regs_oam_poke(i * 4 + 3, (uint8_t)(100 + i * 8));
+    }
+    cpu_write(0xC000, IRQ_LATCH);
+    cpu_write(0xC001, 0x00);
+    cpu_write(0xE001, 0x00);
+    cpu_write(0x2000, 0x08);                     // sprites from $1000: A12 rises in dot mode too
+    cpu_write(0x2001, 0x18);
+    return 1;
+}
+
+// One batch as run_slice() runs it, toward `stop`, ending on cycle `to`
+static void run_to(uint64_t stop, uint64_t to)
+{
+    const uint64_t n = to - cpu_get_cycles();
+    cpu_set_pc(n & 1 ? SLED_ODD : SLED_EVEN);
+    nes_sched_begin(stop);
+    cpu_run((int)n);
+    nes_sched_sync();
+}
+
+typedef struct
+{
+    int     vblank;    // ppu_in_vblank_lines()
+    uint8_t status;    // PPUSTATUS
+    int     ticks;     // mapper_mmc3_ticks_until_irq()
+} seen_t;
+
+static seen_t seen(void)
+{
+    return (seen_t){ ppu_in_vblank_lines(), ppu_regs_status_peek(), mapper_mmc3_ticks_until_irq() };
+}
+
+// Whether `ev` has just happened: between the two looks for the PPU flags,
+// for the MMC3 counter by its having reached zero (the next IRQ a whole
+// reload away). Batches never span a stop, so nothing else gets between.
+static int happened(nes_sched_event_t ev, seen_t before, seen_t after)
+{
+    switch (ev) {
+    case NES_EV_VBLANK:     return before.vblank != after.vblank;
+    case NES_EV_MMC3_IRQ:   return after.ticks == IRQ_LATCH + 1;
+    case NES_EV_SPRITE0:    return !(before.status & 0x40) && (after.status & 0x40);
+    case NES_EV_SPRITE_OVF: return !(before.status & 0x20) && (after.status & 0x20);
+    default:                return 0;
+    }
+}
+
+static int test_stops(ppu_mode_t mode)
+{
+    const char* const name = mode == PPU_MODE_DOT ? "dot" : "scanline";
+    int exact[NES_EV_COUNT] = { 0 }, short_of[NES_EV_COUNT] = { 0 }, apu_earlier = 0;
+
+    ppu_set_mode(mode);
+    ASSERT_TRUE(boot_sled(), "sled boots");
+    const uint64_t end = cpu_get_cycles() + 8 * FRAME_CYCLES;
+
+    uint64_t last_stop = 0;
+    for (int stops = 0; cpu_get_cycles() < end; ) {
+        const uint64_t now  = cpu_get_cycles();
+        const uint64_t stop = nes_sched_next_stop();
+        stops += stop != last_stop;
+        last_stop = stop;
+
+        // The earliest stopping event, wherever the APU's are
+        uint64_t at[NES_EV_COUNT], first = NES_SCHED_NEVER;
+        for (int ev = 0; ev < NES_EV_COUNT; ++ev) at[ev] = nes_sched_event_at((nes_sched_event_t)ev);
+        for (size_t i = 0; i < sizeof STOPS / sizeof STOPS[0]; ++i) {
+            ASSERT_TRUE(at[STOPS[i]] > now, "pending stops are ahead of the CPU");
+            if (at[STOPS[i]] < first) first = at[STOPS[i]];
+        }
+        ASSERT_TRUE(stop == first && stop != NES_SCHED_NEVER, "next stop is the earliest stopping event");
+        apu_earlier += at[NES_EV_APU_FRAME] < stop || at[NES_EV_APU_SAMPLE] < stop;
+
+        // Every other stop is first run up to a cycle short of, the rest
+        // exactly; the batch after a short one ends a cycle past its stop
+        uint64_t to = (stops & 1) ? stop - 1 : stop;
+        if (to < now + 2) to = now + 2;
+        const seen_t before = seen();
+        run_to(stop, to);
+        const seen_t after = seen();
+        ASSERT_TRUE(cpu_get_cycles() == to, "the batch ends on its budget");
+
+        for (size_t i = 0; i < sizeof STOPS / sizeof STOPS[0]; ++i) {
+            const nes_sched_event_t ev = STOPS[i];
+            if (ev == NES_EV_DMA_DONE) continue;
+            const int due = at[ev] <= to;
+            // Dot mode's sprite 0 and overflow stops are only the earliest
+            // dot the flag could be set
+            const int bound = mode == PPU_MODE_DOT && (ev == NES_EV_SPRITE0 || ev == NES_EV_SPRITE_OVF);
+            if (to < stop && at[ev] == stop) {
+                const int early = ev == NES_EV_MMC3_IRQ ? after.ticks != 1 : happened(ev, before, after);
+                if (early) {
+                    fprintf(stderr, "ASSERT FAILED: %s mode: %s a cycle before its stop\n", name, EV_NAME[ev]);
+                    return 1;
+                }
+                short_of[ev]++;
+            } else if (due && !bound && !happened(ev, before, after)) {
+                fprintf(stderr, "ASSERT FAILED: %s mode: batch on the %s stop missed it\n", name, EV_NAME[ev]);
+                return 1;
+            } else if (!due && ev != NES_EV_MMC3_IRQ && happened(ev, before, after)) {
+                fprintf(stderr, "ASSERT FAILED: %s mode: %s between stops\n", name, EV_NAME[ev]);
+                return 1;
+            }
+            if (due && to == stop) exact[ev]++;
+            ASSERT_TRUE(nes_sched_event_at(ev) > to, "events re-armed past the batch");
+        }
+        if (to < stop) ASSERT_TRUE(nes_sched_next_stop() == stop, "a short batch leaves the stop where it was");
+        // Frame steps are caught up at the batch end, samples can wait
+        ASSERT_TRUE(nes_sched_event_at(NES_EV_APU_FRAME) > to, "APU frame step caught up");
+    }
+
+    ASSERT_TRUE(apu_earlier > 0, "APU events came before stops and did not stop the CPU");
+    ASSERT_TRUE(exact[NES_EV_VBLANK] > 0 && short_of[NES_EV_VBLANK] > 0, "batches on and just short of VBLANK");
+    ASSERT_TRUE(exact[NES_EV_MMC3_IRQ] > 0 && short_of[NES_EV_MMC3_IRQ] > 0, "batches on and just short of MMC3_IRQ");
+    ASSERT_TRUE(exact[NES_EV_SPRITE0] > 0 && exact[NES_EV_SPRITE_OVF] > 0, "batches on the sprite stops");
+    return 0;
+}
+
+// --- PPUSTATUS reads mid-batch ---
+// NROM polling $2002 with NMI off, `pad` NOPs per loop to vary where the
+// reads land; each change of bits $E0 goes to a ring at $0300 (index $02)
+// with a loop counter. Solid tiles, sprite 0 at Y `s0` and nine sprites on
+// line 120, set up from here.
+#define POLL_FRAMES 6
+
+static int boot_poll(int pad, uint8_t s0)
+{
+    ta_t a;
+    memset(s_prg, 0, sizeof s_prg);
+    ta_init(&a, s_prg, 0xC000, 0xC000);
+    const int reset = ta_label(&a);
+    ta_op(&a, OP_SEI);
+    ta_op8(&a, OP_LDX_IMM, 0xFF);
+    ta_op(&a, OP_TXS);
+    const int poll = ta_label(&a);
+    ta_op16(&a, OP_LDA_ABS, 0x2002);
+    ta_op8(&a, OP_AND_IMM, 0xE0);
+    ta_op(&a, OP_INY);
+    for (int i = 0; i < pad; ++i) ta_op(&a, OP_NOP);
+    ta_op8(&a, OP_CMP_ZP, 0x01);
+    ta_branch(&a, OP_BEQ, poll);
+    ta_op8(&a, OP_STA_ZP, 0x01);
+    ta_op8(&a, OP_LDX_ZP, 0x02);
+    ta_op16(&a, OP_STA_ABX, 0x0300);
+    ta_op(&a, OP_INX);
+    ta_op(&a, OP_TYA);
+    ta_op16(&a, OP_STA_ABX, 0x0300);
+    ta_op(&a, OP_INX);
+    ta_op8(&a, OP_STX_ZP, 0x02);
+    ta_jump(&a, OP_JMP, poll);
+    if (!ta_finish(&a, reset, reset, reset)) return 0;
+
+    memset(s_chr, 0, sizeof s_chr);
+    memset(s_chr + 0x0010, 0xFF, 16);
+    const size_t len = test_rom_image(s_image, sizeof s_image, 0, 0, s_prg, 0x4000, s_chr, sizeof s_chr);
+    if (!len || !test_rom_boot(s_image, len)) return 0;
+
+    for (uint16_t addr = 0x2000; addr < 0x2400; ++addr) ppu_mem_write(addr, 0x01);
+    for (int i = 0; i < 256; ++i) ppu_regs_oam_poke(i, 0xF0);
+    for (int i = 0; i < 10; ++i) {
+        ppu_regs_oam_poke(i * 4 + 0, i ? 119 : s0);
+        ppu_regs_oam_poke(i * 4 + 1, 0x01);
+        ppu_regs_oam_poke(i * 4 + 3, (uint8_t)(i ? 60 + i * 8 : s0));
+    }
+    cpu_write(0x2001, 0x1E);
+    return 1;
+}
+
+static uint64_t poll_log(void)
+{
+    uint8_t log[258];
+    for (int i = 0; i < 256; ++i) log[i] = cpu_read((uint16_t)(0x0300 + i));
+    log[256] = cpu_read(0x0001);
+    log[257] = cpu_read(0x0002);
+    return test_hash_bytes(1469598103934665603ull, log, sizeof log);
+}
+
+// The old frame loop: PPU and APU stepped after each instruction, except
+// that an instruction reading $2002 or touching $4000-$4017 has that device
+// caught up through its own cycles first, which is when the scheduler's
+// accesses see it (nes_sched.c). The test programs only do that with
+// absolute LDA/BIT/STA.
+static void step_per_instruction(uint64_t until)
+{
+    while (cpu_get_cycles() < until) {
+        const uint16_t pc = cpu_get_pc();
+        const uint8_t  op = cpu_read(pc);
+        const uint16_t operand = (uint16_t)(cpu_read((uint16_t)(pc + 1)) | cpu_read((uint16_t)(pc + 2)) << 8);
+        const int abs = op == OP_LDA_ABS || op == OP_BIT_ABS || op == OP_STA_ABS;
+        int ppu_ahead = 0, apu_ahead = 0;
+        if (abs && (operand & 0xE007) == 0x2002) {
+            ppu_ahead = 4;
+            ppu_step(ppu_ahead);
+        }
+        if (abs && operand >= 0x4000 && operand <= 0x4017) {
+            apu_ahead = 4;
+            apu_step(apu_ahead);
+        }
+        const uint64_t c0 = cpu_get_cycles();
+        cpu_step();
+        const int n = (int)(cpu_get_cycles() - c0);
+        ppu_step(n - ppu_ahead);
+        apu_step(n - apu_ahead);
+    }
+}
+
+static int test_status_reads(ppu_mode_t mode)
+{
+    uint8_t flags = 0;
+    ppu_set_mode(mode);
+
+    for (int pad = 0; pad < 4; ++pad) {
+        const uint8_t s0 = (uint8_t)(40 + pad * 50);
+        uint64_t cycles[POLL_FRAMES], logs[POLL_FRAMES];
+
+        ASSERT_TRUE(boot_poll(pad, s0), "poll program boots");
+        for (int f = 0; f < POLL_FRAMES; ++f) {
+            nes_step_frame();
+            cycles[f] = cpu_get_cycles();
+            logs[f]   = poll_log();
+        }
+        for (int i = 0; i < 256; i += 2) flags |= cpu_read((uint16_t)(0x0300 + i));
+
+        ASSERT_TRUE(boot_poll(pad, s0), "poll program boots again");
+        for (int f = 0; f < POLL_FRAMES; ++f) {
+            step_per_instruction(cycles[f]);
+            ASSERT_TRUE(cpu_get_cycles() == cycles[f], "same instruction boundaries");
+            if (poll_log() != logs[f]) {
+                fprintf(stderr, "ASSERT FAILED: %s mode, %d NOPs: frame %d $2002 log differs from per-instruction stepping\n",
+                        mode == PPU_MODE_DOT ? "dot" : "scanline", pad, f);
+                return 1;
+            }
+        }
+    }
+    ASSERT_TRUE(flags == 0xE0, "the reads saw vblank, sprite 0 hit and overflow");
+    return 0;
+}
+
+// --- The APU's lazy catch-up ---
+// Straight-line NROM code: pseudo-random writes to the pulse, triangle,
+// noise and DMC registers, $4015 (DMC left off: no DMA) and now and then
+// $4017 in both modes with and without IRQ inhibit, each after a random
+// delay and followed by a $4015 read logged to a ring at $0300 (index $02).
+// The reads clear the frame IRQ flag, so the log holds its edges.
+#define APU_FRAMES 12
+
+static uint64_t s_audio_hash;
+static size_t   s_audio_count;
+
+static void audio_sink(const uint16_t* samples, size_t frames, void* user)
+{
+    (void)user;
+    s_audio_hash  = test_hash_bytes(s_audio_hash, samples, frames * sizeof *samples);
+    s_audio_count += frames;
+}
+
+static int boot_apu(uint32_t seed)
+{
+    ta_t a;
+    rng = seed;
+    memset(s_prg, 0, sizeof s_prg);
+    ta_init(&a, s_prg, 0xC000, 0xC000);
+    const uint16_t delay = a.pc;             // Y * 5 cycles; absolute JSRs
+    const int loop = ta_label(&a);           // stay within TA_FIXUPS
+    ta_op(&a, OP_DEY);
+    ta_branch(&a, OP_BNE, loop);
+    ta_op(&a, OP_RTS);
+    const int reset = ta_label(&a);
+    ta_op(&a, OP_SEI);
+    ta_op8(&a, OP_LDX_IMM, 0xFF);
+    ta_op(&a, OP_TXS);
+    while (a.pc < 0xFF00) {
+        const uint32_t r = next();
+        uint16_t reg = (uint16_t)(0x4000 + r % 0x14);
+        uint8_t  v   = (uint8_t)(r >> 8);
+        if ((r >> 16 & 7) == 0) {
+            reg = 0x4015;
+            v &= 0x0F;
+        } else if ((r >> 16 & 15) == 1) {
+            reg = 0x4017;
+            v &= 0xC0;
+        }
+        ta_poke(&a, reg, v);
+        ta_op8(&a, OP_LDY_IMM, (uint8_t)(r >> 24 | 1));
+        ta_op16(&a, OP_JSR, delay);
+        ta_op16(&a, OP_LDA_ABS, 0x4015);
+        ta_op8(&a, OP_LDX_ZP, 0x02);
+        ta_op16(&a, OP_STA_ABX, 0x0300);
+        ta_op8(&a, OP_INC_ZP, 0x02);
+    }
+    const int end = ta_label(&a);
+    ta_op16(&a, OP_LDA_ABS, 0x4015);
+    ta_jump(&a, OP_JMP, end);
+    if (!ta_finish(&a, reset, reset, reset)) return 0;
+
+    const size_t len = test_rom_image(s_image, sizeof s_image, 0, 0, s_prg, 0x4000, NULL, 0);
+    if (!len || !test_rom_boot(s_image, len)) return 0;
+    s_audio_hash  = 1469598103934665603ull;
+    s_audio_count = 0;
+    apu_set_sink(audio_sink, NULL);
+    return 1;
+}
+
+static uint64_t apu_log(void)
+{
+    uint8_t log[257];
+    for (int i = 0; i < 256; ++i) log[i] = cpu_read((uint16_t)(0x0300 + i));
+    log[256] = cpu_read(0x0002);
+    return test_hash_bytes(s_audio_hash, log, sizeof log);
+}
+
+static int test_apu_catch_up(void)
+{
+    int irq_seen = 0;
+
+    for (uint32_t seed = 1; seed <= 3; ++seed) {
+        uint64_t cycles[APU_FRAMES], hashes[APU_FRAMES];
+        size_t   counts[APU_FRAMES];
+
+        ASSERT_TRUE(boot_apu(seed * 0x9E3779B9u), "APU program boots");
+        for (int f = 0; f < APU_FRAMES; ++f) {
+            nes_step_frame();
+            cycles[f] = cpu_get_cycles();
+            hashes[f] = apu_log();
+            counts[f] = s_audio_count;
+        }
+        for (int i = 0; i < 256; ++i) irq_seen |= (cpu_read((uint16_t)(0x0300 + i)) & 0x40) != 0;
+        ASSERT_TRUE(counts[APU_FRAMES - 1] > (size_t)APU_FRAMES * 700, "samples came out");
+
+        ASSERT_TRUE(boot_apu(seed * 0x9E3779B9u), "APU program boots again");
+        for (int f = 0; f < APU_FRAMES; ++f) {
+            step_per_instruction(cycles[f]);
+            ASSERT_TRUE(cpu_get_cycles() == cycles[f], "same instruction boundaries");
+            if (s_audio_count != counts[f] || apu_log() != hashes[f]) {
+                fprintf(stderr, "ASSERT FAILED: seed %u frame %d: %zu samples, %zu with apu_step() per instruction, or the streams or $4015 logs differ\n",
+                        (unsigned)seed, f, counts[f], s_audio_count);
+                return 1;
+            }
+        }
+    }
+    ASSERT_TRUE(irq_seen, "the $4015 reads saw the frame IRQ flag");
+    return 0;
+}
+
+int main(void)
+{
+    int rc;
+
+    printf("Scheduler: stops in order, a cycle short and exactly on them (scanline mode)...\n");
+    rc = test_stops(PPU_MODE_SCANLINE);
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("Scheduler: stops in order, a cycle short and exactly on them (dot mode)...\n");
+    rc = test_stops(PPU_MODE_DOT);
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("Scheduler: $2002 reads mid-batch against per-instruction stepping (scanline mode)...\n");
+    rc = test_status_reads(PPU_MODE_SCANLINE);
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("Scheduler: $2002 reads mid-batch against per-instruction stepping (dot mode)...\n");
+    rc = test_status_reads(PPU_MODE_DOT);
+    if (rc) return rc; else printf("  OK\n");
+
+    ppu_set_mode(PPU_MODE_SCANLINE);
+    printf("Scheduler: the APU's lazy catch-up against apu_step() per instruction...\n");
+    rc = test_apu_catch_up();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("All scheduler tests passed.\n");
+    return 0;
+}
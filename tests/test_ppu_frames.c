@@ -0,0 +1,571 @@
+// tests/test_ppu_frames.c
+// Whole frames from generated cartridges (test_rom.c), compared between the
+// ways the core can produce them: the render thread against inline drawing,
+// the PPU models against each other, the JIT CPU core against the reference.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nes.h"
+#include "ppu.h"
+#include "cpu.h"
+#include "bus.h"
+#include "nes_palette.h"
+#include "test_rom.h"
+
+#define ASSERT_TRUE(cond, msg) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "ASSERT FAILED: %s (line %d)\n", msg, __LINE__); \
+        return 1; \
+    } \
+} while (0)
+
+#define FRAMES 40
+
+static uint8_t s_prg[0x4000];
+static uint8_t s_image[16 + 0x8000 + 0x2000];
+static size_t  s_image_len;
+
+// --- The scene ---
+// NROM-128 with CHR-RAM. Reset fills CHR-RAM, the nametables, the palette
+// and OAM, then turns on NMI and rendering and idles. Each NMI moves the
+// scroll and PPUCTRL with the frame counter ($10) and then, at delays that
+// put them in the visible lines, writes $2005, $2000 (pattern table and
+// sprite size), $2006, $2007 and a burst of PPUMASK emphasis/grayscale
+// changes a few dots apart mid-frame, and finally turns rendering off for a
+// palette, CHR-RAM and nametable update before turning it back on. Without
+// `mid_frame` all of that happens in vblank, PPUCTRL then also switching the
+// sprite table and size, and reset writes the palette and turns rendering
+// on in vblank too.
+// Scroll and PPUCTRL from the frame counter: nametable and BG pattern
+// table, or unless `mid_frame` the nametable from bits 0-1 and the sprite
+// table, BG table and sprite size from bits 1-3
+static void scroll_from_counter(ta_t* a, int mid_frame)
+{
+    ta_op8(a, OP_LDA_ZP, 0x10);
+    ta_op16(a, OP_STA_ABS, 0x2005);
+    ta_op(a, OP_LSR_A);
+    ta_op16(a, OP_STA_ABS, 0x2005);
+    if (mid_frame) {
+        ta_op8(a, OP_LDA_ZP, 0x10);
+        ta_op8(a, OP_AND_IMM, 0x13);
+    } else {
+        ta_op8(a, OP_LDA_ZP, 0x10);
+        ta_op8(a, OP_AND_IMM, 0x03);
+        ta_op8(a, OP_STA_ZP, 0x00);
+        ta_op8(a, OP_LDA_ZP, 0x10);
+        ta_op(a, OP_ASL_A);
+        ta_op(a, OP_ASL_A);
+        ta_op8(a, OP_AND_IMM, 0x38);
+        ta_op8(a, OP_EOR_ZP, 0x00);
+    }
+    ta_op8(a, OP_ORA_IMM, 0x80);
+    ta_op16(a, OP_STA_ABS, 0x2000);
+}
+
+static int build_scene(int mid_frame)
+{
+    ta_t a;
+    memset(s_prg, 0, sizeof s_prg);
+    ta_init(&a, s_prg, 0xC000, 0xC000);
+
+    static const uint8_t PALETTE[32] = {
+        0x0F, 0x01, 0x21, 0x31, 0x0F, 0x06, 0x16, 0x26, 0x0F, 0x09, 0x19, 0x29, 0x0F, 0x02, 0x12, 0x22,
+        0x0F, 0x14, 0x24, 0x34, 0x0F, 0x07, 0x17, 0x27, 0x0F, 0x0A, 0x1A, 0x2A, 0x0F, 0x05, 0x15, 0x25,
+    };
+    const int pal_table = ta_new(&a);
+
+    const int reset = ta_label(&a);
+    ta_op(&a, OP_SEI);
+    ta_op(&a, OP_CLD);
+    ta_op8(&a, OP_LDX_IMM, 0xFF);
+    ta_op(&a, OP_TXS);
+    ta_poke(&a, 0x2000, 0x00);
+    ta_poke(&a, 0x2001, 0x00);
+    ta_wait_vblank(&a);
+    ta_wait_vblank(&a);
+
+    // CHR-RAM: byte (x << 1) ^ page over 32 pages
+    ta_ppu_addr(&a, 0x0000);
+    ta_op8(&a, OP_LDY_IMM, 0);
+    const int chr_page = ta_label(&a);
+    ta_op8(&a, OP_LDX_IMM, 0);
+    const int chr_byte = ta_label(&a);
+    ta_op(&a, OP_TYA);
+    ta_op8(&a, OP_STA_ZP, 0x00);
+    ta_op(&a, OP_TXA);
+    ta_op(&a, OP_ASL_A);
+    ta_op8(&a, OP_EOR_ZP, 0x00);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op(&a, OP_INX);
+    ta_branch(&a, OP_BNE, chr_byte);
+    ta_op(&a, OP_INY);
+    ta_op8(&a, OP_CPY_IMM, 32);
+    ta_branch(&a, OP_BNE, chr_page);
+
+    // Nametables $2000-$2FFF: byte x ^ page * 7
+    ta_ppu_addr(&a, 0x2000);
+    ta_op8(&a, OP_LDY_IMM, 0);
+    const int nt_page = ta_label(&a);
+    ta_op8(&a, OP_LDX_IMM, 0);
+    const int nt_byte = ta_label(&a);
+    ta_op(&a, OP_TYA);
+    ta_op(&a, OP_ASL_A);
+    ta_op(&a, OP_ASL_A);
+    ta_op(&a, OP_ASL_A);
+    ta_op8(&a, OP_STA_ZP, 0x00);
+    ta_op(&a, OP_TXA);
+    ta_op8(&a, OP_EOR_ZP, 0x00);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op(&a, OP_INX);
+    ta_branch(&a, OP_BNE, nt_byte);
+    ta_op(&a, OP_INY);
+    ta_op8(&a, OP_CPY_IMM, 16);
+    ta_branch(&a, OP_BNE, nt_page);
+
+    // Palette
+    if (!mid_frame) ta_wait_vblank(&a);
+    ta_ppu_addr(&a, 0x3F00);
+    ta_op8(&a, OP_LDX_IMM, 0);
+    const int pal_byte = ta_label(&a);
+    ta_jump(&a, OP_LDA_ABX, pal_table);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op(&a, OP_INX);
+    ta_op8(&a, OP_CPX_IMM, 32);
+    ta_branch(&a, OP_BNE, pal_byte);
+
+    // Sprites at $0200: a running sum, so Y, tile, attributes (flips,
+    // priority) and X all vary and some lines have more than 8
+    ta_op8(&a, OP_LDX_IMM, 0);
+    ta_op8(&a, OP_LDA_IMM, 11);
+    const int oam_byte = ta_label(&a);
+    ta_op16(&a, OP_STA_ABX, 0x0200);
+    ta_op(&a, OP_CLC);
+    ta_op8(&a, OP_ADC_IMM, 37);
+    ta_op(&a, OP_INX);
+    ta_branch(&a, OP_BNE, oam_byte);
+
+    if (!mid_frame) ta_wait_vblank(&a);
+    ta_poke(&a, 0x2000, 0x80);
+    ta_poke(&a, 0x2001, 0x1E);
+    const int idle = ta_label(&a);
+    ta_jump(&a, OP_JMP, idle);
+
+    const int nmi = ta_label(&a);
+    ta_op8(&a, OP_INC_ZP, 0x10);
+    ta_poke(&a, 0x4014, 0x02);
+    scroll_from_counter(&a, mid_frame);
+
+    if (mid_frame) {
+        ta_delay(&a, 5);                         // ~line 35
+        ta_op8(&a, OP_LDA_ZP, 0x10);
+        ta_op(&a, OP_ASL_A);
+        ta_op16(&a, OP_STA_ABS, 0x2005);         // fine X / coarse X now
+        ta_op16(&a, OP_STA_ABS, 0x2005);
+        ta_delay(&a, 3);                         // ~line 70
+        ta_poke(&a, 0x2000, 0xB8);               // BG $1000, sprites 8x16
+        ta_delay(&a, 3);                         // ~line 105
+        ta_poke(&a, 0x2006, 0x21);               // v mid-frame
+        ta_op8(&a, OP_LDA_ZP, 0x10);
+        ta_op16(&a, OP_STA_ABS, 0x2006);
+        ta_delay(&a, 2);                         // ~line 130
+        ta_poke(&a, 0x2007, 0x55);               // $2007 while rendering
+        ta_delay(&a, 2);                         // ~line 155
+        for (int i = 0; i < 24; ++i) {           // 18 dots apart
+            ta_poke(&a, 0x2001, (uint8_t)(0x1E | (i & 7) << 5 | (i >> 3 & 1)));
+        }
+    }
+
+    ta_poke(&a, 0x2001, 0x00);
+    ta_ppu_addr(&a, 0x3F00);
+    ta_op8(&a, OP_LDA_ZP, 0x10);
+    ta_op8(&a, OP_AND_IMM, 0x3F);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_ppu_addr(&a, 0x3F11);
+    ta_op8(&a, OP_LDA_ZP, 0x10);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_ppu_addr(&a, 0x1010);                 // CHR-RAM, BG table $1000 tile 1
+    ta_op8(&a, OP_LDA_ZP, 0x10);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_ppu_addr(&a, 0x2041);
+    ta_op8(&a, OP_LDA_ZP, 0x10);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_ppu_addr(&a, 0x2280);                 // where drawing goes on
+    if (!mid_frame) scroll_from_counter(&a, 0);   // or from the scroll again
+    ta_poke(&a, 0x2001, 0x1E);
+    ta_op(&a, OP_RTI);
+
+    ta_here(&a, pal_table);
+    ta_bytes(&a, PALETTE, sizeof PALETTE);
+
+    if (!ta_finish(&a, nmi, reset, -1)) return 0;
+    s_image_len = test_rom_image(s_image, sizeof s_image, 0, 0, s_prg, sizeof s_prg, NULL, 0);
+    return s_image_len != 0;
+}
+
+// --- Runs ---
+enum { RUN_TARGET = 1, RUN_HEADLESS = 2 };
+
+#define TARGET_PITCH 300   // pixels, wider than a line on purpose
+
+static uint32_t s_target[NES_H * TARGET_PITCH];
+
+static const char* const OUTPUT_NAME[] = { "argb", "index8", "index16" };
+
+// Hash of every frame of a run in `output` (NES_VIDEO_*); 0 for frames left undrawn
+static int run_scene(int thread, int output, int flags, uint64_t* hashes)
+{
+    if (nes_set_render_thread(thread) != thread) return 0;
+    nes_set_video_output(output);
+    if (!test_rom_boot(s_image, s_image_len)) return 0;
+
+    for (int f = 0; f < FRAMES; ++f) {
+        const int skip = (flags & RUN_HEADLESS) && f % 3 != 2;
+        nes_set_skip_render(skip);
+        if (flags & RUN_TARGET) nes_set_render_target(s_target, TARGET_PITCH * 4);
+        nes_step_frame();
+        hashes[f] = skip ? 0 : test_frame_hash();
+        if (flags & RUN_TARGET) nes_set_render_target(NULL, 0);
+    }
+    nes_set_skip_render(0);
+    return 1;
+}
+
+static int test_render_thread_matches_inline(void)
+{
+    ASSERT_TRUE(build_scene(1), "scene assembles");
+    if (!nes_set_render_thread(1)) {
+        printf("  (no render thread in this build)\n");
+        return 0;
+    }
+
+    for (int output = NES_VIDEO_ARGB8888; output <= NES_VIDEO_INDEX16; ++output) {
+        for (int flags = 0; flags <= (RUN_TARGET | RUN_HEADLESS); ++flags) {
+            uint64_t inline_h[FRAMES], thread_h[FRAMES];
+            ASSERT_TRUE(run_scene(0, output, flags, inline_h), "inline run");
+            ASSERT_TRUE(run_scene(1, output, flags, thread_h), "render thread run");
+            for (int f = 0; f < FRAMES; ++f) {
+                if (inline_h[f] != thread_h[f]) {
+                    fprintf(stderr, "ASSERT FAILED: %s%s%s frame %d: render thread %016llx, inline %016llx\n",
+                            OUTPUT_NAME[output], flags & RUN_TARGET ? " target" : "",
+                            flags & RUN_HEADLESS ? " headless" : "", f,
+                            (unsigned long long)thread_h[f], (unsigned long long)inline_h[f]);
+                    nes_set_render_thread(0);
+                    return 1;
+                }
+            }
+        }
+    }
+    nes_set_render_thread(0);
+    nes_set_video_output(NES_VIDEO_ARGB8888);
+    return 0;
+}
+
+// The same scene in INDEX16, converted, against ARGB frames: the emphasis
+// burst changes it between pixels in dot mode, which INDEX8 cannot hold
+static int test_index16_matches_argb(void)
+{
+    static uint32_t converted[NES_W * NES_H];
+    ASSERT_TRUE(build_scene(1), "scene assembles");
+
+    for (int mode = PPU_MODE_SCANLINE; mode <= PPU_MODE_DOT; ++mode) {
+        uint64_t argb[FRAMES], index16[FRAMES];
+        ppu_set_mode((ppu_mode_t)mode);
+        ASSERT_TRUE(run_scene(0, NES_VIDEO_ARGB8888, 0, argb), "ARGB run");
+
+        nes_set_video_output(NES_VIDEO_INDEX16);
+        ASSERT_TRUE(test_rom_boot(s_image, s_image_len), "INDEX16 run");
+        for (int f = 0; f < FRAMES; ++f) {
+            nes_step_frame();
+            nes_palette_convert16(converted, NES_W * 4, NES_PIXFMT_ARGB8888, nes_framebuffer_index16(), NES_H);
+            index16[f] = test_hash_bytes(1469598103934665603ull, converted, sizeof converted);
+        }
+        for (int f = 0; f < FRAMES; ++f) {
+            if (argb[f] != index16[f]) {
+                fprintf(stderr, "ASSERT FAILED: %s mode frame %d: INDEX16 converts to another frame than ARGB\n",
+                        mode == PPU_MODE_DOT ? "dot" : "scanline", f);
+                ppu_set_mode(PPU_MODE_SCANLINE);
+                return 1;
+            }
+        }
+    }
+    ppu_set_mode(PPU_MODE_SCANLINE);
+    nes_set_video_output(NES_VIDEO_ARGB8888);
+    return 0;
+}
+
+// Dot mode against scanline mode where they have to agree: the scene with
+// every change made in vblank
+static int test_dot_matches_scanline(void)
+{
+    uint64_t hashes[2][FRAMES];
+    ASSERT_TRUE(build_scene(0), "scene assembles");
+
+    for (int mode = PPU_MODE_SCANLINE; mode <= PPU_MODE_DOT; ++mode) {
+        ppu_set_mode((ppu_mode_t)mode);
+        ASSERT_TRUE(run_scene(0, NES_VIDEO_ARGB8888, 0, hashes[mode]), "run");
+    }
+    ppu_set_mode(PPU_MODE_SCANLINE);
+
+    int changes = 0;
+    for (int f = 0; f < FRAMES; ++f) {
+        if (hashes[PPU_MODE_DOT][f] != hashes[PPU_MODE_SCANLINE][f]) {
+            fprintf(stderr, "ASSERT FAILED: frame %d: dot mode %016llx, scanline mode %016llx\n", f,
+                    (unsigned long long)hashes[PPU_MODE_DOT][f], (unsigned long long)hashes[PPU_MODE_SCANLINE][f]);
+            return 1;
+        }
+        changes += f > 0 && hashes[PPU_MODE_SCANLINE][f] != hashes[PPU_MODE_SCANLINE][f - 1];
+    }
+    ASSERT_TRUE(changes >= FRAMES / 2, "the scene moves");
+    return 0;
+}
+
+// --- PPUSTATUS scene ---
+// Solid tiles everywhere, sprite 0 moving down and right one pixel a frame
+// (left-8 clipping toggling with the frame counter) and nine sprites on
+// lines 100-107 for overflow. The main loop polls $2002 and logs each
+// change of bits $60, with a loop counter, to a ring at $0300 (index $02).
+static uint8_t s_status_image[16 + 0x4000];
+static size_t  s_status_image_len;
+
+static int build_status_scene(void)
+{
+    ta_t a;
+    memset(s_prg, 0, sizeof s_prg);
+    ta_init(&a, s_prg, 0xC000, 0xC000);
+
+    const int reset = ta_label(&a);
+    ta_op(&a, OP_SEI);
+    ta_op(&a, OP_CLD);
+    ta_op8(&a, OP_LDX_IMM, 0xFF);
+    ta_op(&a, OP_TXS);
+    ta_poke(&a, 0x2000, 0x00);
+    ta_poke(&a, 0x2001, 0x00);
+    ta_wait_vblank(&a);
+    ta_wait_vblank(&a);
+
+    ta_ppu_addr(&a, 0x0010);                 // tile 1: colour 3 throughout
+    ta_op8(&a, OP_LDX_IMM, 16);
+    ta_op8(&a, OP_LDA_IMM, 0xFF);
+    const int tile = ta_label(&a);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op(&a, OP_DEX);
+    ta_branch(&a, OP_BNE, tile);
+
+    ta_ppu_addr(&a, 0x2000);                 // $2000-$23FF: tile 1
+    ta_op8(&a, OP_LDY_IMM, 4);
+    ta_op8(&a, OP_LDA_IMM, 0x01);
+    const int nt_page = ta_label(&a);
+    const int nt_byte = ta_label(&a);
+    ta_op16(&a, OP_STA_ABS, 0x2007);
+    ta_op(&a, OP_INX);
+    ta_branch(&a, OP_BNE, nt_byte);
+    ta_op(&a, OP_DEY);
+    ta_branch(&a, OP_BNE, nt_page);
+
+    ta_op8(&a, OP_LDA_IMM, 0xFF);            // OAM: all off screen...
+    const int oam_off = ta_label(&a);
+    ta_op16(&a, OP_STA_ABX, 0x0200);
+    ta_op(&a, OP_INX);
+    ta_branch(&a, OP_BNE, oam_off);
+    ta_op8(&a, OP_LDX_IMM, 4);               // ...but sprites 1-9 at Y 100
+    const int oam_row = ta_label(&a);
+    ta_op8(&a, OP_LDA_IMM, 100);
+    ta_op16(&a, OP_STA_ABX, 0x0200);
+    ta_op8(&a, OP_LDA_IMM, 0x01);
+    ta_op16(&a, OP_STA_ABX, 0x0201);
+    ta_op(&a, OP_TXA);
+    ta_op(&a, OP_ASL_A);
+    ta_op(&a, OP_ASL_A);
+    ta_op16(&a, OP_STA_ABX, 0x0203);
+    ta_op(&a, OP_INX);
+    ta_op(&a, OP_INX);
+    ta_op(&a, OP_INX);
+    ta_op(&a, OP_INX);
+    ta_op8(&a, OP_CPX_IMM, 40);
+    ta_branch(&a, OP_BNE, oam_row);
+    ta_poke(&a, 0x0201, 0x01);
+
+    ta_poke(&a, 0x2000, 0x80);
+    const int poll = ta_label(&a);
+    ta_op16(&a, OP_LDA_ABS, 0x2002);
+    ta_op8(&a, OP_AND_IMM, 0x60);
+    ta_op(&a, OP_INY);
+    ta_op8(&a, OP_CMP_ZP, 0x01);
+    ta_branch(&a, OP_BEQ, poll);
+    ta_op8(&a, OP_STA_ZP, 0x01);
+    ta_op8(&a, OP_LDX_ZP, 0x02);
+    ta_op16(&a, OP_STA_ABX, 0x0300);
+    ta_op(&a, OP_INX);
+    ta_op(&a, OP_TYA);
+    ta_op16(&a, OP_STA_ABX, 0x0300);
+    ta_op(&a, OP_INX);
+    ta_op8(&a, OP_STX_ZP, 0x02);
+    ta_jump(&a, OP_JMP, poll);
+
+    const int nmi = ta_label(&a);
+    ta_op(&a, OP_PHA);
+    ta_op8(&a, OP_INC_ZP, 0x10);
+    ta_op8(&a, OP_LDA_ZP, 0x10);
+    ta_op16(&a, OP_STA_ABS, 0x0200);
+    ta_op16(&a, OP_STA_ABS, 0x0203);
+    ta_poke(&a, 0x4014, 0x02);
+    ta_poke(&a, 0x2005, 0x00);
+    ta_poke(&a, 0x2005, 0x00);
+    ta_op8(&a, OP_LDA_ZP, 0x10);
+    ta_op8(&a, OP_AND_IMM, 0x06);
+    ta_op8(&a, OP_ORA_IMM, 0x18);
+    ta_op16(&a, OP_STA_ABS, 0x2001);
+    ta_op8(&a, OP_LDY_IMM, 0);
+    ta_op(&a, OP_PLA);
+    ta_op(&a, OP_RTI);
+
+    if (!ta_finish(&a, nmi, reset, -1)) return 0;
+    s_status_image_len = test_rom_image(s_status_image, sizeof s_status_image, 0, 0,
+                                        s_prg, sizeof s_prg, NULL, 0);
+    return s_status_image_len != 0;
+}
+
+typedef struct
+{
+    uint64_t cycles[FRAMES];   // CPU cycle count at each frame end
+    uint64_t status[FRAMES];   // hash of the $2002 log so far
+    uint64_t frame[FRAMES];    // 0 for frames left undrawn
+} status_run_t;
+
+static int skipped(int f) { return f % 4 == 1 || (f >= 20 && f < 26); }
+
+static int run_status_scene(ppu_mode_t mode, int headless, status_run_t* r)
+{
+    ppu_set_mode(mode);
+    if (!test_rom_boot(s_status_image, s_status_image_len)) return 0;
+
+    for (int f = 0; f < FRAMES; ++f) {
+        const int skip = headless && skipped(f);
+        nes_set_skip_render(skip);
+        nes_step_frame();
+        uint8_t log[258];
+        for (int i = 0; i < 256; ++i) log[i] = cpu_read((uint16_t)(0x0300 + i));
+        log[256] = cpu_read(0x0001);
+        log[257] = cpu_read(0x0002);
+        r->cycles[f] = cpu_get_cycles();
+        r->status[f] = test_hash_bytes(1469598103934665603ull, log, sizeof log);
+        r->frame[f]  = skip ? 0 : test_frame_hash();
+    }
+    nes_set_skip_render(0);
+    return 1;
+}
+
+static int test_headless_frames_match(void)
+{
+    ASSERT_TRUE(build_status_scene(), "status scene assembles");
+    nes_set_video_output(NES_VIDEO_ARGB8888);
+
+    for (int mode = PPU_MODE_SCANLINE; mode <= PPU_MODE_DOT; ++mode) {
+        static status_run_t drawn, headless;
+        ASSERT_TRUE(run_status_scene((ppu_mode_t)mode, 0, &drawn), "run drawing every frame");
+        ASSERT_TRUE(run_status_scene((ppu_mode_t)mode, 1, &headless), "run with headless frames");
+
+        int hits = 0;
+        for (int f = 0; f < FRAMES; ++f) {
+            if (drawn.cycles[f] != headless.cycles[f] || drawn.status[f] != headless.status[f] ||
+                (!skipped(f) && drawn.frame[f] != headless.frame[f])) {
+                fprintf(stderr, "ASSERT FAILED: %s mode frame %d: cycles %llu/%llu status %s frame %s\n",
+                        mode == PPU_MODE_DOT ? "dot" : "scanline", f,
+                        (unsigned long long)drawn.cycles[f], (unsigned long long)headless.cycles[f],
+                        drawn.status[f] == headless.status[f] ? "same" : "differs",
+                        drawn.frame[f] == headless.frame[f] ? "same" : "differs");
+                ppu_set_mode(PPU_MODE_SCANLINE);
+                return 1;
+            }
+            hits += f && drawn.status[f] != drawn.status[f - 1];
+        }
+        ASSERT_TRUE(hits > FRAMES / 2, "the scene logs PPUSTATUS changes");
+    }
+    ppu_set_mode(PPU_MODE_SCANLINE);
+    return 0;
+}
+
+// The JIT core against the reference core on both scenes: same frames, same
+// PPUSTATUS log, same cycle count at every frame end. The scenes run from
+// PRG-ROM, so where blocks can be translated some of that time must be spent
+// in translated code.
+static int test_jit_matches_reference(void)
+{
+    const cpu_core_t core = cpu_get_core();
+    ASSERT_TRUE(build_scene(1), "scene assembles");
+    ASSERT_TRUE(build_status_scene(), "status scene assembles");
+    nes_set_video_output(NES_VIDEO_ARGB8888);
+
+    for (int mode = PPU_MODE_SCANLINE; mode <= PPU_MODE_DOT; ++mode) {
+        static status_run_t ref_status, jit_status;
+        uint64_t ref[FRAMES], jit[FRAMES];
+        cpu_jit_stats_t st;
+
+        ppu_set_mode((ppu_mode_t)mode);
+        cpu_set_core(CPU_CORE_REFERENCE);
+        ASSERT_TRUE(run_scene(0, NES_VIDEO_ARGB8888, 0, ref), "reference run");
+        ASSERT_TRUE(run_status_scene((ppu_mode_t)mode, 0, &ref_status), "reference status run");
+
+        cpu_set_core(CPU_CORE_JIT);
+        cpu_jit_reset_stats();
+        ASSERT_TRUE(run_scene(0, NES_VIDEO_ARGB8888, 0, jit), "JIT run");
+        ASSERT_TRUE(run_status_scene((ppu_mode_t)mode, 0, &jit_status), "JIT status run");
+        cpu_jit_get_stats(&st);
+        cpu_set_core(core);
+        ppu_set_mode(PPU_MODE_SCANLINE);
+
+        const char* name = mode == PPU_MODE_DOT ? "dot" : "scanline";
+        for (int f = 0; f < FRAMES; ++f) {
+            if (ref[f] != jit[f]) {
+                fprintf(stderr, "ASSERT FAILED: %s mode frame %d: JIT %016llx, reference %016llx\n", name, f,
+                        (unsigned long long)jit[f], (unsigned long long)ref[f]);
+                return 1;
+            }
+            if (ref_status.cycles[f] != jit_status.cycles[f] || ref_status.status[f] != jit_status.status[f] ||
+                ref_status.frame[f] != jit_status.frame[f]) {
+                fprintf(stderr, "ASSERT FAILED: %s mode status frame %d: cycles %llu/%llu status %s frame %s\n",
+                        name, f, (unsigned long long)jit_status.cycles[f], (unsigned long long)ref_status.cycles[f],
+                        ref_status.status[f] == jit_status.status[f] ? "same" : "differs",
+                        ref_status.frame[f] == jit_status.frame[f] ? "same" : "differs");
+                return 1;
+            }
+        }
+        ASSERT_TRUE(st.total_cycles > 0, "the JIT core ran");
+        ASSERT_TRUE(!cpu_jit_available() || st.jit_cycles > 0, "translated blocks ran");
+    }
+    return 0;
+}
+
+int main(void)
+{
+    int rc;
+
+    printf("PPU frames: render thread matches inline drawing...\n");
+    rc = test_render_thread_matches_inline();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU frames: INDEX16 converts to the ARGB frame in both PPU modes...\n");
+    rc = test_index16_matches_argb();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU frames: dot mode matches scanline mode without mid-frame writes...\n");
+    rc = test_dot_matches_scanline();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU frames: headless frames keep timing and PPUSTATUS...\n");
+    rc = test_headless_frames_match();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU frames: JIT core matches the reference core...\n");
+    rc = test_jit_matches_reference();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("All PPU frame tests passed.\n");
+    return 0;
+}
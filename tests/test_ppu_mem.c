@@ -0,0 +1,587 @@
+// tests/test_ppu_mem.c
+// PPU memory map (ppu_mem.c) through ppu_mem_read()/ppu_mem_write(), against
+// a model of the hardware's, plus the mappers' side of it and the decoded-tile
+// cache on top (ppu_tile_cache.c), on generated cartridges (test_rom.c).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ppu_mem.h"
+#include "ppu_defer.h"
+#include "ppu_tile_cache.h"
+#include "mapper.h"
+#include "nes_palette.h"
+#include "bus.h"
+#include "test_rom.h"
+
+#define ASSERT_TRUE(cond, msg) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "ASSERT FAILED: %s (line %d)\n", msg, __LINE__); \
+        return 1; \
+    } \
+} while (0)
+
+static uint32_t rng = 0x2545F491u;
+static uint32_t next(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+// --- Nametables ---
+// Physical 1KB page behind $2000/$2400/$2800/$2C00 per mirroring mode
+static const uint8_t NT_PAGE[5][4] = {
+    [MIRROR_HORIZONTAL] = { 0, 0, 1, 1 },
+    [MIRROR_VERTICAL]   = { 0, 1, 0, 1 },
+    [MIRROR_SINGLE_LO]  = { 0, 0, 0, 0 },
+    [MIRROR_SINGLE_HI]  = { 1, 1, 1, 1 },
+    [MIRROR_FOUR]       = { 0, 1, 2, 3 },
+};
+static const char* const MIRROR_NAME[5] = { "horizontal", "vertical", "single-lo", "single-hi", "four-screen" };
+
+static uint8_t s_model[4][0x400];
+
+// Where $2000-$3EFF address `a` lands in the model ($3000-$3EFF mirror $2000-$2EFF)
+static uint8_t* model_byte(mirroring_t m, uint16_t a)
+{
+    const unsigned off = (a - 0x2000u) & 0x0FFFu;
+    return &s_model[NT_PAGE[m][off >> 10]][off & 0x3FF];
+}
+
+static int nametables_match(mirroring_t m)
+{
+    for (uint32_t a = 0x2000; a < 0x3F00; ++a) {
+        if (ppu_mem_read((uint16_t)a) != *model_byte(m, (uint16_t)a)) {
+            fprintf(stderr, "ASSERT FAILED: %s: $%04X reads %02X, expected %02X\n", MIRROR_NAME[m],
+                    (unsigned)a, ppu_mem_read((uint16_t)a), *model_byte(m, (uint16_t)a));
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int test_nametable_mirroring(void)
+{
+    for (int m = MIRROR_HORIZONTAL; m <= MIRROR_FOUR; ++m) {
+        ppu_mem_init((mirroring_t)m);
+        memset(s_model, 0, sizeof s_model);
+        ASSERT_TRUE(ppu_mem_get_mirroring() == (mirroring_t)m, "mirroring set by init");
+        ASSERT_TRUE(nametables_match((mirroring_t)m), "VRAM cleared by init");
+
+        // Writes anywhere in $2000-$3EFF, $3xxx mirrors included
+        for (int i = 0; i < 0x4000; ++i) {
+            const uint16_t a = (uint16_t)(0x2000 + next() % 0x1F00);
+            const uint8_t  v = (uint8_t)next();
+            ppu_mem_write(a, v);
+            *model_byte((mirroring_t)m, a) = v;
+        }
+        ASSERT_TRUE(nametables_match((mirroring_t)m), "writes land on the mirrored page");
+    }
+
+    // A mirroring change re-points the nametables and keeps the VRAM
+    ppu_mem_init(MIRROR_FOUR);
+    memset(s_model, 0, sizeof s_model);
+    for (uint16_t a = 0x2000; a < 0x3000; ++a) {
+        ppu_mem_write(a, (uint8_t)(a ^ a >> 8));
+        *model_byte(MIRROR_FOUR, a) = (uint8_t)(a ^ a >> 8);
+    }
+    for (int m = MIRROR_HORIZONTAL; m <= MIRROR_FOUR; ++m) {
+        ppu_mem_set_mirroring((mirroring_t)m);
+        ASSERT_TRUE(ppu_mem_get_mirroring() == (mirroring_t)m, "mirroring switched");
+        ASSERT_TRUE(nametables_match((mirroring_t)m), "same VRAM seen through the new mirroring");
+    }
+    return 0;
+}
+
+static int test_mapped_nametables(void)
+{
+    static uint8_t rom[0x400], ram[0x400];
+    for (int i = 0; i < 0x400; ++i) { rom[i] = (uint8_t)(i * 3 + 1); ram[i] = (uint8_t)~i; }
+
+    ppu_mem_init(MIRROR_VERTICAL);
+    memset(s_model, 0, sizeof s_model);
+    for (uint16_t a = 0x2000; a < 0x2800; ++a) {
+        ppu_mem_write(a, (uint8_t)(a * 7));
+        *model_byte(MIRROR_VERTICAL, a) = (uint8_t)(a * 7);
+    }
+
+    // $2400 from read-only memory, $2800 from writable memory
+    ppu_mem_map_nametable(1, rom, false);
+    ppu_mem_map_nametable(2, ram, true);
+    ASSERT_TRUE(ppu_mem_nametables()[1] == rom && ppu_mem_nametables()[2] == ram, "pages published");
+    for (uint16_t off = 0; off < 0x400; ++off) {
+        ASSERT_TRUE(ppu_mem_read((uint16_t)(0x2400 + off)) == rom[off], "$2400 reads the mapped page");
+        ASSERT_TRUE(ppu_mem_read((uint16_t)(0x3400 + off)) == rom[off], "$3400 mirrors it");
+        ASSERT_TRUE(ppu_mem_read((uint16_t)(0x2800 + off)) == ram[off], "$2800 reads the mapped page");
+        ASSERT_TRUE(ppu_mem_read((uint16_t)(0x2C00 + off)) == *model_byte(MIRROR_VERTICAL, (uint16_t)(0x2C00 + off)),
+                    "$2C00 still VRAM");
+    }
+
+    ppu_mem_write(0x2405, 0xEE);
+    ppu_mem_write(0x3413, 0xEE);
+    ASSERT_TRUE(rom[0x005] == (uint8_t)(0x005 * 3 + 1) && rom[0x013] == (uint8_t)(0x013 * 3 + 1),
+                "read-only page ignores writes");
+    ppu_mem_write(0x2805, 0x5A);
+    ASSERT_TRUE(ram[0x005] == 0x5A, "writable page takes writes");
+    ASSERT_TRUE(ppu_mem_read(0x2005) == *model_byte(MIRROR_VERTICAL, 0x2005), "VRAM under $2800 untouched");
+
+    // The mapping survives mirroring changes; NULL hands the slot back
+    ppu_mem_set_mirroring(MIRROR_HORIZONTAL);
+    ASSERT_TRUE(ppu_mem_read(0x2410) == rom[0x10], "read-only page kept over a mirroring change");
+    ASSERT_TRUE(ppu_mem_read(0x2810) == ram[0x10], "writable page kept over a mirroring change");
+    ASSERT_TRUE(ppu_mem_read(0x2C10) == *model_byte(MIRROR_HORIZONTAL, 0x2C10), "others follow the mirroring");
+    ppu_mem_map_nametable(1, NULL, false);
+    ppu_mem_map_nametable(2, NULL, false);
+    ASSERT_TRUE(nametables_match(MIRROR_HORIZONTAL), "VRAM back, as it was");
+    return 0;
+}
+
+// MMC3 $A000 picks horizontal/vertical, except on four-screen boards
+static int test_mmc3_four_screen(void)
+{
+    static uint8_t prg[0x8000], chr[0x2000], image[16 + sizeof prg + sizeof chr];
+    size_t len = test_rom_image(image, sizeof image, 4, 0x08, prg, sizeof prg, chr, sizeof chr);
+    ASSERT_TRUE(len && test_rom_boot(image, len), "four-screen MMC3 boots");
+    ASSERT_TRUE(ppu_mem_get_mirroring() == MIRROR_FOUR, "four-screen from the header");
+
+    memset(s_model, 0, sizeof s_model);
+    for (uint16_t a = 0x2000; a < 0x3000; ++a) {
+        ppu_mem_write(a, (uint8_t)(a >> 4));
+        *model_byte(MIRROR_FOUR, a) = (uint8_t)(a >> 4);
+    }
+    cpu_write(0xA000, 0x00);
+    ASSERT_TRUE(ppu_mem_get_mirroring() == MIRROR_FOUR, "$A000 = 0 ignored");
+    cpu_write(0xA000, 0x01);
+    ASSERT_TRUE(ppu_mem_get_mirroring() == MIRROR_FOUR, "$A000 = 1 ignored");
+    ASSERT_TRUE(nametables_match(MIRROR_FOUR), "four distinct nametables");
+
+    len = test_rom_image(image, sizeof image, 4, 0x00, prg, sizeof prg, chr, sizeof chr);
+    ASSERT_TRUE(len && test_rom_boot(image, len), "MMC3 boots");
+    cpu_write(0xA000, 0x00);
+    ASSERT_TRUE(ppu_mem_get_mirroring() == MIRROR_VERTICAL, "$A000 = 0: vertical");
+    cpu_write(0xA000, 0x01);
+    ASSERT_TRUE(ppu_mem_get_mirroring() == MIRROR_HORIZONTAL, "$A000 = 1: horizontal");
+    return 0;
+}
+
+// --- MMC3 CHR ---
+// 24KB of CHR-ROM: 24 1KB pages, so bank numbers wrap at a count that is
+// not a power of two
+#define MMC3_CHR_PAGES 24
+
+static uint8_t s_prg[0x8000], s_chr[MMC3_CHR_PAGES * 0x400];
+static uint8_t s_image[16 + sizeof s_prg + sizeof s_chr];
+static uint8_t s_regs[8];
+
+static int boot_mmc3(size_t chr_len)
+{
+    for (size_t i = 0; i < sizeof s_chr; ++i) s_chr[i] = (uint8_t)((i >> 10) * 0x47u ^ i * 13u);
+    memset(s_regs, 0, sizeof s_regs);
+    const size_t len = test_rom_image(s_image, sizeof s_image, 4, 0x00, s_prg, sizeof s_prg, s_chr, chr_len);
+    return len && test_rom_boot(s_image, len);
+}
+
+static void mmc3_reg(uint8_t select, int r, uint8_t v)
+{
+    cpu_write(0x8000, (uint8_t)(select | r));
+    cpu_write(0x8001, v);
+    s_regs[r] = v;
+}
+
+// The 1KB page behind slot n (nesdev's table): two 2KB banks R0/R1 (low
+// bit ignored) and four 1KB banks R2-R5, the halves swapped by $8000 bit 7
+static int mmc3_page(uint8_t select, int slot)
+{
+    if (select & 0x80) slot ^= 4;
+    const int bank = slot < 4 ? (s_regs[slot >> 1] & ~1) + (slot & 1) : s_regs[slot - 2];
+    return bank % MMC3_CHR_PAGES;
+}
+
+static int chr_slots_match(uint8_t select)
+{
+    for (int slot = 0; slot < 8; ++slot) {
+        const int page = mmc3_page(select, slot);
+        if (ppu_mem_chr_page(slot) != page || ppu_mem_chr_writable(slot)) {
+            fprintf(stderr, "ASSERT FAILED: $8000=%02X slot %d: page %d, expected %d (read-only)\n",
+                    select, slot, ppu_mem_chr_page(slot), page);
+            return 0;
+        }
+        for (uint16_t off = 0; off < 0x400; off += 0x3F) {
+            const uint16_t a = (uint16_t)(slot << 10 | off);
+            const uint8_t want = s_chr[(size_t)page * 0x400 + off];
+            // The mapper's own chr_map_1k() look-up, which the slots replace
+            if (ppu_mem_read(a) != want || ppu_mem_chr_peek(a) != want || mapper_chr_read(a) != want) {
+                fprintf(stderr, "ASSERT FAILED: $8000=%02X $%04X reads %02X/%02X/%02X, expected %02X\n",
+                        select, a, ppu_mem_read(a), ppu_mem_chr_peek(a), mapper_chr_read(a), want);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static int test_mmc3_chr_banks(void)
+{
+    ASSERT_TRUE(boot_mmc3(sizeof s_chr), "MMC3 boots");
+    for (int round = 0; round < 256; ++round) {
+        const uint8_t select = (round & 1) ? 0x80 : 0x00;
+        const int r = (int)(next() % 6);
+        mmc3_reg(select, r, (uint8_t)next());
+        ASSERT_TRUE(chr_slots_match(select), "slots follow R0-R5");
+
+        // Flipping bit 7 alone swaps the halves without touching R0-R5
+        cpu_write(0x8000, (uint8_t)(select ^ 0x80));
+        ASSERT_TRUE(chr_slots_match((uint8_t)(select ^ 0x80)), "slots follow $8000 bit 7");
+    }
+
+    // CHR-ROM drops writes, through every slot
+    for (uint16_t a = 0; a < 0x2000; a += 0x155) {
+        const uint8_t before = ppu_mem_read(a);
+        ppu_mem_write(a, (uint8_t)~before);
+        ASSERT_TRUE(ppu_mem_read(a) == before, "CHR-ROM write dropped");
+    }
+    cpu_write(0x8000, 0x00);
+    ASSERT_TRUE(chr_slots_match(0x00), "CHR-ROM unchanged");
+
+    // CHR-RAM (no CHR in the image) takes them
+    ASSERT_TRUE(boot_mmc3(0), "MMC3 with CHR-RAM boots");
+    for (int slot = 0; slot < 8; ++slot) ASSERT_TRUE(ppu_mem_chr_writable(slot), "CHR-RAM slots writable");
+    ppu_mem_write(0x1234, 0xA5);
+    ASSERT_TRUE(ppu_mem_read(0x1234) == 0xA5 && mapper_chr_read(0x1234) == 0xA5, "CHR-RAM write lands");
+    return 0;
+}
+
+static int s_watch_calls;
+static void count_watch(uint16_t addr)
+{
+    (void)addr;
+    s_watch_calls++;
+}
+
+// Peeks (tile decoding, sprite 0) never reach the watch; ppu_mem_read() does
+static int test_chr_peek_skips_watch(void)
+{
+    ASSERT_TRUE(boot_mmc3(sizeof s_chr), "MMC3 boots");
+    ppu_mem_set_chr_watch(count_watch);
+    s_watch_calls = 0;
+    for (uint16_t a = 0; a < 0x2000; ++a) (void)ppu_mem_chr_peek(a);
+    ASSERT_TRUE(s_watch_calls == 0, "peeks not watched");
+    for (uint16_t a = 0; a < 0x2000; a += 16) (void)ppu_mem_read(a);
+    ASSERT_TRUE(s_watch_calls == 0x200, "every CHR read watched");
+    (void)ppu_mem_read(0x2000);
+    (void)ppu_mem_read(0x3F00);
+    ASSERT_TRUE(s_watch_calls == 0x200, "nametable and palette reads not watched");
+    ppu_mem_set_chr_watch(NULL);
+    return 0;
+}
+
+// A12 rises clock the IRQ counter only from real fetches: ppu_mem_read(),
+// not peeks and not the scanline renderer's own look-ups
+static void a12_fetches(int peek)
+{
+    for (uint16_t a = 0; a < 8; ++a) peek ? (void)ppu_mem_chr_peek(a) : (void)ppu_mem_read(a);
+    peek ? (void)ppu_mem_chr_peek(0x1000) : (void)ppu_mem_read(0x1000);
+}
+
+static int test_mmc3_a12_fetches(void)
+{
+    static const uint8_t SPRITES[] = { 0, 1, 2 };
+
+    ASSERT_TRUE(boot_mmc3(sizeof s_chr), "MMC3 boots");
+    cpu_write(0xC000, 5);                    // latch
+    cpu_write(0xC001, 0);                    // reload on the next clock
+    cpu_write(0xE001, 0);                    // enable
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 6, "armed: reload, then 5 clocks");
+
+    // Off (the scanline renderer's setting): fetches do not clock it
+    mapper_mmc3_set_a12_from_reads(0);
+    a12_fetches(0);
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 6, "no clock with A12 watching off");
+
+    mapper_mmc3_set_a12_from_reads(1);
+    a12_fetches(1);
+    a12_fetches(1);
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 6, "peeks do not clock");
+    for (uint16_t y = 0; y < 4; ++y) {
+        ppu_render_draw_line(ppu_mem_view(), y, (uint16_t)(y << 5), 0, 0x10, 0x1E, SPRITES, 3);
+        ppu_render_draw_line(ppu_mem_view(), y, (uint16_t)(y << 5), 0, 0x28, 0x1E, SPRITES, 3);
+    }
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 6, "scanline renderer does not clock");
+
+    a12_fetches(0);
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 5, "a fetch rise after 8 low reads clocks (reload)");
+    for (uint16_t a = 0; a < 7; ++a) (void)ppu_mem_read(a);
+    (void)ppu_mem_read(0x1000);
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 5, "rise after fewer low reads filtered out");
+    a12_fetches(0);
+    (void)ppu_mem_read(0x1008);
+    ASSERT_TRUE(mapper_mmc3_ticks_until_irq() == 4, "one clock per rise, not per high read");
+
+    mapper_mmc3_set_a12_from_reads(0);
+    return 0;
+}
+
+// --- Tile cache ---
+// A decoded tile against the CHR bytes behind `addr` now: both planes,
+// plain and flipped
+static int tile_matches(const ppu_tile_t* t, uint16_t addr)
+{
+    for (int y = 0; y < 8; ++y) {
+        const uint8_t lo = ppu_mem_chr_peek((uint16_t)(addr + y));
+        const uint8_t hi = ppu_mem_chr_peek((uint16_t)(addr + y + 8));
+        for (int x = 0; x < 8; ++x) {
+            const uint8_t px = (uint8_t)((lo >> (7 - x) & 1) | (hi >> (7 - x) & 1) << 1);
+            if (t->px[0][y][x] != px || t->px[1][y][7 - x] != px) {
+                fprintf(stderr, "ASSERT FAILED: tile $%04X pixel (%d,%d) is %d/%d, CHR says %d\n",
+                        addr, x, y, t->px[0][y][x], t->px[1][y][7 - x], px);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Every tile of the pattern tables through the cache; lookups it served
+// from decoded tiles and ones it decoded come back in hits/misses
+static int all_tiles_match(uint64_t* hits, uint64_t* misses)
+{
+    uint64_t h0, m0, h1, m1;
+    ppu_tile_t spill;
+    ppu_tile_cache_stats(&h0, &m0);
+    ppu_tile_cache_map_banks(ppu_mem_view());
+    for (uint16_t a = 0; a < 0x2000; a += 16) {
+        if (!tile_matches(ppu_tile_get(a, &spill), a)) return 0;
+    }
+    ppu_tile_cache_stats(&h1, &m1);
+    *hits   = h1 - h0;
+    *misses = m1 - m0;
+    return 1;
+}
+
+static int test_tile_cache(void)
+{
+    uint64_t hits, misses;
+
+    // CHR-RAM: a byte written decodes its tile again, and only that one,
+    // also through another slot showing the same page
+    ASSERT_TRUE(boot_mmc3(0), "MMC3 with CHR-RAM boots");
+    for (uint16_t a = 0; a < 0x2000; ++a) ppu_mem_write(a, (uint8_t)next());
+    mmc3_reg(0x00, 0, 0);
+    mmc3_reg(0x00, 1, 2);
+    mmc3_reg(0x00, 2, 5);
+    mmc3_reg(0x00, 3, 5);                    // $1000 and $1400 both show page 5
+    mmc3_reg(0x00, 4, 6);
+    mmc3_reg(0x00, 5, 7);
+    ppu_tile_cache_flush();
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "CHR-RAM tiles decoded");
+    ASSERT_TRUE(misses == 512 - 64 && hits == 64, "each page decoded once");
+    for (int round = 0; round < 32; ++round) {
+        const uint16_t a = (uint16_t)(next() & 0x1FFF);
+        ppu_mem_write(a, (uint8_t)~ppu_mem_read(a));
+        ASSERT_TRUE(all_tiles_match(&hits, &misses), "tiles after a CHR-RAM write");
+        ASSERT_TRUE(misses == 1 && hits == 511, "the written tile alone decoded again");
+    }
+    ppu_mem_write(0x1013, 0x5A);             // page 5 tile 1, through $1000
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "page shown twice, written through one slot");
+    ASSERT_TRUE(misses == 1, "shared page tile decoded again once");
+
+    // CHR-ROM: a bank switch only repoints the slot. A page never shown is
+    // decoded, one shown before or shown elsewhere is not.
+    ASSERT_TRUE(boot_mmc3(sizeof s_chr), "MMC3 boots");
+    mmc3_reg(0x00, 0, 0);
+    mmc3_reg(0x00, 1, 2);
+    for (int r = 2; r < 6; ++r) mmc3_reg(0x00, r, (uint8_t)(r + 2));
+    ppu_tile_cache_flush();
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "pages 0-7 decoded");
+    ASSERT_TRUE(misses == 512, "pages 0-7 each decoded");
+    mmc3_reg(0x00, 2, 20);
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "slot 4 on a new page");
+    ASSERT_TRUE(misses == 64, "the new page decoded");
+    mmc3_reg(0x00, 2, 4);
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "slot 4 back on page 4");
+    ASSERT_TRUE(misses == 0, "a page shown before is still decoded");
+    mmc3_reg(0x00, 5, 1);
+    cpu_write(0x8000, 0x80);                 // halves swapped
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "page 1 in slot 3, halves swapped");
+    ASSERT_TRUE(misses == 0, "pages shown elsewhere before are not decoded again");
+
+    // A slot routed back through mapper_chr_read() is not cached: its tiles
+    // are decoded into the caller's spill, each caller its own
+    ppu_mem_map_chr(2, NULL, -1, false);
+    ppu_tile_cache_map_banks(ppu_mem_view());
+    ppu_tile_t spill_a, spill_b;
+    ppu_tile_cache_stats(&hits, &misses);
+    const ppu_tile_t* a = ppu_tile_get(0x0810, &spill_a);
+    const ppu_tile_t* b = ppu_tile_get(0x0BF0, &spill_b);
+    ASSERT_TRUE(a == &spill_a && b == &spill_b, "uncached tiles in the callers' spills");
+    ASSERT_TRUE(tile_matches(a, 0x0810) && tile_matches(b, 0x0BF0), "spilled tiles decoded from the mapper");
+    uint64_t h, m;
+    ppu_tile_cache_stats(&h, &m);
+    ASSERT_TRUE(h == hits && m == misses, "spills are neither hits nor misses");
+    ASSERT_TRUE(all_tiles_match(&hits, &misses), "cached and spilled tiles side by side");
+    ASSERT_TRUE(misses == 0 && hits == 512 - 64, "only the unmapped slot bypasses the cache");
+
+    cpu_write(0x8000, 0x00);                 // republish the banking
+    ASSERT_TRUE(ppu_mem_chr_page(2) >= 0, "slot mapped again");
+    return 0;
+}
+
+// --- Palette ---
+static uint8_t s_pal_model[32];
+
+// $3F00-$3F1F as written (all 8 bits read back, colours use 6), with $3F10/$14/$18/$1C aliasing $3F00/$04/$08/$0C
+static int pal_slot(uint16_t addr)
+{
+    const int i = addr & 0x1F;
+    return (i & 0x13) == 0x10 ? i & 0x0F : i;
+}
+
+// Emphasis as nes_palette.c approximates it: a channel is dimmed to 13/16
+// when another channel's bit is set (bit 0 red, 1 green, 2 blue)
+static uint32_t emphasized(uint32_t c, int e)
+{
+    unsigned r = c >> 16 & 0xFF, g = c >> 8 & 0xFF, b = c & 0xFF;
+    if (e & ~1 & 7) r = r * 13 / 16;
+    if (e & ~2 & 7) g = g * 13 / 16;
+    if (e & ~4 & 7) b = b * 13 / 16;
+    return 0xFF000000u | r << 16 | g << 8 | b;
+}
+
+// Reads, colour indexes and ARGB of all 32 entries under PPUMASK `mask`
+static int palette_matches(uint8_t mask, const uint32_t* colors)
+{
+    ppu_mem_set_color_mask(mask);
+    const uint32_t* argb = ppu_mem_palette_argb();
+    const uint8_t*  index = ppu_mem_palette_index();
+    for (int i = 0; i < 32; ++i) {
+        const uint8_t c = s_pal_model[pal_slot((uint16_t)i)];
+        const uint8_t shown = (mask & 0x01) ? c & 0x30 : c & 0x3F;
+        const uint32_t want = emphasized(colors[shown], mask >> 5);
+        if (ppu_mem_read((uint16_t)(0x3F00 + i)) != c || index[i] != shown || argb[i] != want) {
+            fprintf(stderr, "ASSERT FAILED: PPUMASK %02X $3F%02X: read %02X index %02X ARGB %08X, expected %02X %02X %08X\n",
+                    mask, i, ppu_mem_read((uint16_t)(0x3F00 + i)), index[i], argb[i], c, shown, want);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int write_file(const char* path, const uint8_t* data, size_t n)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    const int ok = fwrite(data, 1, n, f) == n;
+    return fclose(f) == 0 && ok;
+}
+
+static int test_palette(void)
+{
+    static const uint8_t MASKS[] = { 0x00, 0x01, 0x1E, 0x1F };
+    static const char* const PAL_FILE = "test_ppu_mem.pal";
+    static uint8_t rgb[8 * 64 * 3 + 1];
+    uint32_t colors[64], saved[32];
+
+    nes_palette_use_default();
+    ASSERT_TRUE(boot_mmc3(sizeof s_chr), "MMC3 boots");
+    for (uint16_t a = 0x3F00; a < 0x3F20; ++a) {
+        ppu_mem_write(a, (uint8_t)(a * 5u));
+        s_pal_model[pal_slot(a)] = (uint8_t)(a * 5u);
+    }
+
+    // Aliases both ways, through the mirrors above $3F1F too
+    for (int round = 0; round < 256; ++round) {
+        static const uint16_t ALIASED[] = { 0x3F00, 0x3F04, 0x3F08, 0x3F0C, 0x3F10, 0x3F14, 0x3F18, 0x3F1C };
+        const uint32_t r = next();
+        const uint16_t a = (r & 1) ? (uint16_t)(ALIASED[r >> 1 & 7] + (r >> 4 & 7) * 0x20)
+                                   : (uint16_t)(0x3F00 + (r >> 4 & 0xFF));
+        ppu_mem_write(a, (uint8_t)(r >> 16));
+        s_pal_model[pal_slot(a)] = (uint8_t)(r >> 16);
+        ASSERT_TRUE(palette_matches((uint8_t)(r & 0x01), NES_PAL), "palette after a write");
+    }
+
+    // Grayscale and every emphasis combination, on the built-in colours
+    for (int e = 0; e < 8; ++e) {
+        for (size_t m = 0; m < sizeof MASKS; ++m) {
+            ASSERT_TRUE(palette_matches((uint8_t)(e << 5 | MASKS[m]), NES_PAL), "grayscale and emphasis");
+        }
+    }
+
+    // A 192-byte .pal: emphasis derived from it
+    for (int i = 0; i < 64 * 3; ++i) rgb[i] = (uint8_t)next();
+    for (int i = 0; i < 64; ++i) colors[i] = 0xFF000000u | (uint32_t)rgb[i * 3] << 16 | (uint32_t)rgb[i * 3 + 1] << 8 | rgb[i * 3 + 2];
+    ASSERT_TRUE(write_file(PAL_FILE, rgb, 64 * 3) && nes_palette_load(PAL_FILE), "192-byte palette loads");
+    for (int e = 0; e < 8; ++e) {
+        ASSERT_TRUE(palette_matches((uint8_t)(e << 5), colors), "loaded colours, derived emphasis");
+    }
+
+    // Bad sizes and a missing file leave the colours alone
+    ppu_mem_set_color_mask(0xA1);
+    memcpy(saved, ppu_mem_palette_argb(), sizeof saved);
+    static const size_t BAD[] = { 0, 1, 64 * 3 - 1, 64 * 3 + 1, 2 * 64 * 3, 8 * 64 * 3 - 1, 8 * 64 * 3 + 1 };
+    for (size_t i = 0; i < sizeof BAD / sizeof BAD[0]; ++i) {
+        ASSERT_TRUE(write_file(PAL_FILE, rgb, BAD[i]), "palette file written");
+        ASSERT_TRUE(!nes_palette_load(PAL_FILE), "bad size rejected");
+        ASSERT_TRUE(memcmp(saved, ppu_mem_palette_argb(), sizeof saved) == 0, "bad size leaves the colours");
+    }
+    remove(PAL_FILE);
+    ASSERT_TRUE(!nes_palette_load(PAL_FILE), "missing file rejected");
+    ASSERT_TRUE(!nes_palette_set_rgb(NULL, 64 * 3), "no data rejected");
+    ASSERT_TRUE(memcmp(saved, ppu_mem_palette_argb(), sizeof saved) == 0, "colours unchanged");
+
+    // A 1536-byte .pal: its emphasis blocks used as they are
+    for (int i = 0; i < 8 * 64 * 3; ++i) rgb[i] = (uint8_t)next();
+    ASSERT_TRUE(nes_palette_set_rgb(rgb, 8 * 64 * 3), "1536-byte palette");
+    for (int e = 0; e < 8; ++e) {
+        ppu_mem_set_color_mask((uint8_t)(e << 5));
+        for (int i = 0; i < 32; ++i) {
+            const uint8_t* p = rgb + (e * 64 + (s_pal_model[pal_slot((uint16_t)i)] & 0x3F)) * 3;
+            ASSERT_TRUE(ppu_mem_palette_argb()[i] == (0xFF000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]),
+                        "emphasis block from the file");
+        }
+    }
+
+    nes_palette_use_default();
+    ppu_mem_set_color_mask(0x00);
+    return 0;
+}
+
+int main(void)
+{
+    int rc;
+
+    printf("PPU memory: $2000-$3EFF under each mirroring mode...\n");
+    rc = test_nametable_mirroring();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: mapper nametable pages, read-only and writable...\n");
+    rc = test_mapped_nametables();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: MMC3 mirroring writes on a four-screen board...\n");
+    rc = test_mmc3_four_screen();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: MMC3 CHR slots for both $8000 bit 7 settings...\n");
+    rc = test_mmc3_chr_banks();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: CHR peeks bypass the mapper's fetch watch...\n");
+    rc = test_chr_peek_skips_watch();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: MMC3 A12 clocks from PPU fetches only...\n");
+    rc = test_mmc3_a12_fetches();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: tile cache on CHR-RAM writes, bank switches and unmapped slots...\n");
+    rc = test_tile_cache();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU memory: palette aliases, grayscale, emphasis and .pal sizes...\n");
+    rc = test_palette();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("All PPU memory tests passed.\n");
+    return 0;
+}
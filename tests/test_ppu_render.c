@@ -0,0 +1,625 @@
+// tests/test_ppu_render.c
+// Scanline renderer pieces against their reference paths, on generated
+// cartridges (test_rom.c) driven through PPU memory and mapper registers
+// directly, without running a program.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nes.h"
+#include "ppu.h"
+#include "ppu_mem.h"
+#include "ppu_defer.h"
+#include "ppu_regs.h"
+#include "bus.h"
+#include "cpu_internal.h"
+#include "test_rom.h"
+
+#define ASSERT_TRUE(cond, msg) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "ASSERT FAILED: %s (line %d)\n", msg, __LINE__); \
+        return 1; \
+    } \
+} while (0)
+
+static uint32_t rng = 0x6A09E667u;
+static uint32_t next(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static uint8_t s_prg[0x8000];
+static uint8_t s_chr[0x8000];
+static uint8_t s_image[16 + sizeof s_prg + sizeof s_chr];
+
+// NROM with CHR-RAM, or MMC3 with 32KB of CHR-ROM (32 distinct 1KB pages)
+static int boot_nrom_chr_ram(uint8_t flags6)
+{
+    memset(s_prg, 0, sizeof s_prg);
+    const size_t len = test_rom_image(s_image, sizeof s_image, 0, flags6, s_prg, 0x4000, NULL, 0);
+    return len && test_rom_boot(s_image, len);
+}
+
+static int boot_mmc3(void)
+{
+    memset(s_prg, 0, sizeof s_prg);
+    for (size_t i = 0; i < sizeof s_chr; ++i) s_chr[i] = (uint8_t)((i * 29u) ^ (i >> 7) ^ (i >> 10) * 0x35u);
+    const size_t len = test_rom_image(s_image, sizeof s_image, 4, 0, s_prg, sizeof s_prg, s_chr, sizeof s_chr);
+    return len && test_rom_boot(s_image, len);
+}
+
+// Every nametable byte (through the current mirroring), CHR-RAM byte and
+// palette entry, the palette with distinct colours so index8 lines tell the
+// background pixels apart
+static void fill_vram(int chr_ram)
+{
+    for (uint16_t a = 0; a < 32; ++a) ppu_mem_write((uint16_t)(0x3F00 + a), (uint8_t)(a * 2 + 1));
+    if (chr_ram) {
+        for (uint16_t a = 0; a < 0x2000; ++a) ppu_mem_write(a, (uint8_t)((a * 7u) ^ (a >> 4)));
+    }
+    for (uint16_t a = 0x2000; a < 0x3000; ++a) ppu_mem_write(a, (uint8_t)((a * 13u) ^ (a >> 5)));
+}
+
+// --- Background plane against the tile-by-tile path ---
+// Line 1 drawn from every coarse/fine Y of all four nametables at a few
+// horizontal scrolls, once out of the plane (which also brings it up to
+// date) and once with it bypassed
+static int plane_matches(uint8_t ctrl, const char* after)
+{
+    static const uint8_t COARSE_X[] = { 0, 17, 31 };
+    static const uint8_t FINE_X[]   = { 0, 3, 7 };
+    const uint8_t* idx = ppu_framebuffer_index8(NULL) + NES_W;
+    uint8_t plane[NES_W];
+
+    for (unsigned nt = 0; nt < 4; ++nt)
+    for (unsigned cy = 0; cy < 30; ++cy)
+    for (unsigned fy = 0; fy < 8; ++fy)
+    for (unsigned i = 0; i < sizeof COARSE_X; ++i)
+    for (unsigned j = 0; j < sizeof FINE_X; ++j) {
+        const uint16_t v = (uint16_t)(fy << 12 | nt << 10 | cy << 5 | COARSE_X[i]);
+        ppu_set_bg_plane(true);
+        ppu_render_draw_line(ppu_mem_view(), 1, v, FINE_X[j], ctrl, 0x0A, NULL, 0);
+        memcpy(plane, idx, NES_W);
+        ppu_set_bg_plane(false);
+        ppu_render_draw_line(ppu_mem_view(), 1, v, FINE_X[j], ctrl, 0x0A, NULL, 0);
+        ppu_set_bg_plane(true);
+        if (memcmp(plane, idx, NES_W) != 0) {
+            fprintf(stderr, "ASSERT FAILED: plane line differs after %s (v=%04X fine X %d, PPUCTRL %02X)\n",
+                    after, v, FINE_X[j], ctrl);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int test_bg_plane_invalidation(void)
+{
+    ppu_set_output(PPU_OUTPUT_INDEX8);
+
+    ASSERT_TRUE(boot_nrom_chr_ram(0), "NROM boots");
+    fill_vram(1);
+    ASSERT_TRUE(plane_matches(0x00, "filling VRAM"), "plane after fill");
+
+    // $2400 and $3000-$3EFF alias $2000 under horizontal mirroring
+    ppu_mem_write(0x2405, 0xA1);
+    ppu_mem_write(0x3123, 0xB2);
+    ppu_mem_write(0x37D1, 0xC3);             // attribute byte of NT0 via $3400
+    ASSERT_TRUE(plane_matches(0x00, "nametable writes through mirrors"), "mirror writes");
+
+    for (uint16_t a = 0x23F8; a < 0x2400; ++a) ppu_mem_write(a, (uint8_t)(a * 37u));
+    ppu_mem_write(0x2BFB, 0x1B);             // attribute row 7 of NT2
+    ASSERT_TRUE(plane_matches(0x00, "attribute row 7 writes"), "attribute row 7");
+
+    ppu_mem_set_mirroring(MIRROR_VERTICAL);
+    ASSERT_TRUE(plane_matches(0x00, "switch to vertical"), "vertical mirroring");
+    ppu_mem_set_mirroring(MIRROR_SINGLE_HI);
+    ASSERT_TRUE(plane_matches(0x00, "switch to single-screen"), "single-screen mirroring");
+    ppu_mem_set_mirroring(MIRROR_HORIZONTAL);
+    ASSERT_TRUE(plane_matches(0x00, "switch back to horizontal"), "horizontal mirroring");
+
+    ppu_mem_write(0x0012, 0x5A);             // tile 1, low plane row 2
+    ppu_mem_write(0x001F, 0xC3);             // tile 1, high plane row 7
+    for (uint16_t a = 0x1A30; a < 0x1A40; ++a) ppu_mem_write(a, (uint8_t)~a);
+    ASSERT_TRUE(plane_matches(0x00, "CHR-RAM writes"), "CHR-RAM at $0000");
+    ASSERT_TRUE(plane_matches(0x10, "PPUCTRL BG table to $1000"), "BG table switch");
+    ppu_mem_write(0x1A35, 0x00);
+    ASSERT_TRUE(plane_matches(0x10, "CHR-RAM write in the $1000 table"), "CHR-RAM at $1000");
+    ASSERT_TRUE(plane_matches(0x00, "PPUCTRL BG table back to $0000"), "BG table switch back");
+
+    ASSERT_TRUE(boot_mmc3(), "MMC3 boots");
+    fill_vram(0);
+    ASSERT_TRUE(plane_matches(0x00, "MMC3 fill"), "MMC3 plane");
+    cpu_write(0x8000, 0x00);                 // R0: 2KB at $0000
+    cpu_write(0x8001, 0x06);
+    ASSERT_TRUE(plane_matches(0x00, "MMC3 R0 bank switch"), "R0 switch");
+    cpu_write(0x8000, 0x03);                 // R3: 1KB at $1400
+    cpu_write(0x8001, 0x1D);
+    ASSERT_TRUE(plane_matches(0x10, "MMC3 R3 bank switch"), "R3 switch");
+    cpu_write(0x8000, 0x80);                 // CHR A12 inversion
+    ASSERT_TRUE(plane_matches(0x00, "MMC3 CHR inversion"), "inverted, $0000");
+    ASSERT_TRUE(plane_matches(0x10, "MMC3 CHR inversion"), "inverted, $1000");
+    cpu_write(0xA000, 0x01);                 // horizontal mirroring
+    ASSERT_TRUE(plane_matches(0x10, "MMC3 mirroring write"), "MMC3 mirroring");
+
+    ppu_set_output(PPU_OUTPUT_ARGB8888);
+    return 0;
+}
+
+// --- Sprite evaluation ---
+#define OFF_LINE 0xF0                    // Y of a sprite on no visible line
+
+static void oam_fill(uint8_t v)
+{
+    for (int i = 0; i < 256; ++i) ppu_regs_oam_poke(i, v);
+}
+
+// The evaluation as nesdev describes it: the first 8 entries in range by
+// Y, then the overflow search, whose byte index m steps along with n
+static bool model_overflow(int line, int height)
+{
+    const uint8_t* oam = ppu_oam_data();
+    int n = 0, found = 0;
+    for (; n < 64 && found < 8; ++n) found += (unsigned)(line - oam[n * 4]) < (unsigned)height;
+    if (found < 8) return false;
+    for (int m = 0; n < 64; ++n, m = (m + 1) & 3) {
+        if ((unsigned)(line - oam[n * 4 + m]) < (unsigned)height) return true;
+    }
+    return false;
+}
+
+static int test_sprite_overflow(void)
+{
+    ASSERT_TRUE(boot_nrom_chr_ram(0), "NROM boots");
+
+    // Entries 0-7 on line 51 (evaluated on line 50), then the ninth:
+    // a real one, a false hit and a false miss
+    oam_fill(OFF_LINE);
+    for (int i = 0; i < 8; ++i) ppu_regs_oam_poke(i * 4, 50);
+    ASSERT_TRUE(!ppu_render_sprite_overflow(50), "8 sprites: no overflow");
+    ppu_regs_oam_poke(8 * 4, 50);
+    ASSERT_TRUE(ppu_render_sprite_overflow(50), "9th sprite in range: overflow");
+    ASSERT_TRUE(!ppu_render_sprite_overflow(49) && !ppu_render_sprite_overflow(58), "not on the lines around");
+
+    ppu_regs_oam_poke(8 * 4, OFF_LINE);
+    ppu_regs_oam_poke(9 * 4 + 1, 50);        // entry 9's tile byte, read as Y
+    ASSERT_TRUE(ppu_render_sprite_overflow(50), "false hit: a tile byte in range");
+
+    ppu_regs_oam_poke(9 * 4 + 1, OFF_LINE);
+    ppu_regs_oam_poke(9 * 4, 50);            // entry 9 on the line, its Y never read
+    ASSERT_TRUE(!ppu_render_sprite_overflow(50), "false miss: 9 sprites, no overflow");
+
+    // The 8x16 height, and random OAM packed around a few lines
+    for (int round = 0; round < 400; ++round) {
+        const uint8_t ctrl = (round & 1) ? 0x20 : 0x00;
+        cpu_write(0x2000, ctrl);
+        for (int i = 0; i < 256; ++i) {
+            const uint32_t r = next();
+            ppu_regs_oam_poke(i, (uint8_t)((i & 3) == 0 || (r & 0x100) ? 90 + r % 24 : r));
+        }
+        for (int y = 80; y < 130; ++y) {
+            if (ppu_render_sprite_overflow(y) != model_overflow(y, ctrl ? 16 : 8)) {
+                fprintf(stderr, "ASSERT FAILED: overflow on line %d (round %d, PPUCTRL %02X)\n", y, round, ctrl);
+                return 1;
+            }
+        }
+    }
+    cpu_write(0x2000, 0x00);
+    return 0;
+}
+
+// Line 100 drawn after line 99's evaluation shows the first 8 of the
+// entries on it in OAM order (all of them with the limit off), whatever
+// their X order
+static int test_sprite_limit(void)
+{
+    uint8_t entries[12], xs[12];
+
+    ASSERT_TRUE(boot_nrom_chr_ram(0), "NROM boots");
+    fill_vram(0);                            // palette; nametables show tile 0
+    for (uint16_t a = 0; a < 16; ++a) ppu_mem_write(a, 0x00);          // tile 0 blank
+    for (uint16_t a = 16; a < 24; ++a) ppu_mem_write(a, 0xFF);         // tile 1 solid, pixel 1
+    for (uint16_t a = 0x2000; a < 0x2400; ++a) ppu_mem_write(a, 0x00);
+    ppu_set_output(PPU_OUTPUT_INDEX8);
+    cpu_write(0x2000, 0x00);
+    cpu_write(0x2001, 0x1E);
+    const uint8_t backdrop = ppu_mem_palette_index()[0], sprite = ppu_mem_palette_index()[0x11];
+    const uint8_t* line = ppu_framebuffer_index8(NULL) + 100 * NES_W;
+
+    for (int round = 0; round < 32; ++round) {
+        const int count = 9 + round % 4;
+        oam_fill(OFF_LINE);
+        for (int i = 0; i < count; ++i) {
+            // Ascending OAM entries, X 20 apart in a shuffled order
+            entries[i] = (uint8_t)(i == 0 ? next() % 4 : entries[i - 1] + 1 + next() % 4);
+            xs[i] = (uint8_t)(8 + i * 20);
+        }
+        for (int i = count - 1; i > 0; --i) {
+            const int j = (int)(next() % (unsigned)(i + 1));
+            const uint8_t t = xs[i]; xs[i] = xs[j]; xs[j] = t;
+        }
+        for (int i = 0; i < count; ++i) {
+            ppu_regs_oam_poke(entries[i] * 4 + 0, 99);
+            ppu_regs_oam_poke(entries[i] * 4 + 1, 1);
+            ppu_regs_oam_poke(entries[i] * 4 + 2, 0);
+            ppu_regs_oam_poke(entries[i] * 4 + 3, xs[i]);
+        }
+
+        for (int limit = 1; limit >= 0; --limit) {
+            ppu_set_sprite_limit(limit);
+            ppu_render_scanline(99);
+            ppu_render_scanline(100);
+            for (int i = 0; i < count; ++i) {
+                const bool shown = !limit || i < 8;
+                for (int x = xs[i]; x < xs[i] + 8; ++x) {
+                    ASSERT_TRUE(line[x] == (shown ? sprite : backdrop),
+                                shown ? "sprite among the first 8 drawn" : "sprite past the 8th dropped");
+                }
+            }
+        }
+        ppu_set_sprite_limit(true);
+    }
+    cpu_write(0x2001, 0x00);
+    ppu_set_output(PPU_OUTPUT_ARGB8888);
+    return 0;
+}
+
+// Dots into the frame before the vblank set (241, 1)
+static int frame_pos(void)
+{
+    return 241 * 341 + 1 - (int)ppu_dots_to_vblank_edge();
+}
+
+// Through the pre-render line's flag clear, with rendering on
+static void to_frame_start(void)
+{
+    while (!ppu_in_vblank_lines()) ppu_step(1);
+    while (ppu_in_vblank_lines()) ppu_step(1);
+}
+
+// Stepping the way the scheduler does (nes_sched.c: to the cycle of the
+// predicted dot, rounded up), the flag is never set before a stop and is
+// set on `line`'s evaluation (-1: never this frame)
+static int overflow_stops_on(int line)
+{
+    to_frame_start();
+    const bool dot = ppu_get_mode() == PPU_MODE_DOT;
+    for (int stops = 0; ; ++stops) {
+        const uint32_t d = ppu_dots_to_sprite_overflow();
+        if (!d) break;
+        const int cycles = (int)((d + 2) / 3);
+        ppu_step(cycles - 1);
+        ASSERT_TRUE(!(ppu_regs_status_peek() & 0x20), "overflow not set before the predicted stop");
+        ppu_step(1);
+        if (ppu_regs_status_peek() & 0x20) {
+            const int pos = frame_pos(), sl = pos / 341, dt = pos % 341;
+            ASSERT_TRUE(line >= 0 && sl == line, "overflow set on the evaluating line");
+            ASSERT_TRUE(dot ? dt >= 65 && dt <= 259 : dt >= 256 && dt <= 258, "overflow set within the evaluation");
+            return 0;
+        }
+        ASSERT_TRUE(dot, "scanline mode sets it at the first stop");
+        ASSERT_TRUE(stops < 200, "stops move on");
+    }
+    ASSERT_TRUE(line < 0, "the look-ahead saw the overflow");
+    while (!ppu_in_vblank_lines()) ppu_step(1);
+    ASSERT_TRUE(!(ppu_regs_status_peek() & 0x20), "no overflow this frame");
+    return 0;
+}
+
+static int test_overflow_lookahead(void)
+{
+    ASSERT_TRUE(boot_nrom_chr_ram(0), "NROM boots");
+    cpu_write(0x2001, 0x18);
+    for (int mode = PPU_MODE_SCANLINE; mode <= PPU_MODE_DOT; ++mode) {
+        ppu_set_mode((ppu_mode_t)mode);
+
+        oam_fill(OFF_LINE);
+        for (int i = 0; i < 9; ++i) ppu_regs_oam_poke(i * 4, 100);
+        if (overflow_stops_on(100)) return 1;
+
+        ppu_regs_oam_poke(8 * 4, OFF_LINE);
+        for (int i = 0; i < 8; ++i) ppu_regs_oam_poke(i * 4, 60);
+        ppu_regs_oam_poke(9 * 4 + 1, 60);    // false hit
+        if (overflow_stops_on(60)) return 1;
+
+        ppu_regs_oam_poke(9 * 4 + 1, OFF_LINE);
+        ppu_regs_oam_poke(9 * 4, 60);        // false miss
+        if (overflow_stops_on(-1)) return 1;
+    }
+    ppu_set_mode(PPU_MODE_SCANLINE);
+    cpu_write(0x2001, 0x00);
+    return 0;
+}
+
+// --- Sprite 0 hit look-ahead against the dot pipeline ---
+// One frame stepped the scheduler's way with the hit looked up ahead: the
+// flag is never set before a stop. *lo..*hi: the dots it was set between
+// (the last CPU cycle's), or -1 if it was not this frame.
+static int hit_window(int* lo, int* hi)
+{
+    const bool dot = ppu_get_mode() == PPU_MODE_DOT;
+    *lo = *hi = -1;
+    to_frame_start();
+    for (int stops = 0; ; ++stops) {
+        const uint32_t d = ppu_dots_to_sprite0_hit();
+        if (!d) break;
+        ppu_step((int)((d + 2) / 3) - 1);
+        ASSERT_TRUE(!(ppu_regs_status_peek() & 0x40), "sprite 0 hit not set before the predicted stop");
+        const int before = frame_pos();
+        ppu_step(1);
+        if (ppu_regs_status_peek() & 0x40) {
+            *lo = before + 1;
+            *hi = frame_pos();
+            // Scanline mode stops exactly on the dot
+            ASSERT_TRUE(dot || *hi - *lo < 3, "one cycle");
+            return 0;
+        }
+        ASSERT_TRUE(dot, "scanline mode sets it at the first stop");
+        ASSERT_TRUE(stops < 2000, "stops move on");
+    }
+    while (!ppu_in_vblank_lines()) ppu_step(1);
+    ASSERT_TRUE(!(ppu_regs_status_peek() & 0x40), "no hit the look-ahead missed");
+    return 0;
+}
+
+// Scanline mode's exact dot (the look-ahead from the frame start) against
+// where the dot pipeline sets it
+static int hit_matches(const char* what)
+{
+    int s_lo, s_hi, d_lo, d_hi;
+
+    ppu_set_mode(PPU_MODE_SCANLINE);
+    to_frame_start();
+    const uint32_t d = ppu_dots_to_sprite0_hit();
+    const int predicted = d ? frame_pos() + (int)d : -1;
+    if (hit_window(&s_lo, &s_hi)) return 0;
+    ppu_set_mode(PPU_MODE_DOT);
+    if (hit_window(&d_lo, &d_hi)) return 0;
+    ppu_set_mode(PPU_MODE_SCANLINE);
+
+    const bool ok = predicted < 0 ? s_lo < 0 && d_lo < 0
+                                  : predicted >= s_lo && predicted <= s_hi && predicted >= d_lo && predicted <= d_hi;
+    if (!ok) {
+        fprintf(stderr, "ASSERT FAILED: %s: predicted %d:%d, scanline mode %d..%d, dot mode %d..%d\n", what,
+                predicted / 341, predicted % 341, s_lo, s_hi, d_lo, d_hi);
+    }
+    return ok;
+}
+
+static void sprite0(uint8_t y, uint8_t tile, uint8_t attr, uint8_t x)
+{
+    ppu_regs_oam_poke(0, y);
+    ppu_regs_oam_poke(1, tile);
+    ppu_regs_oam_poke(2, attr);
+    ppu_regs_oam_poke(3, x);
+}
+
+static void scroll(uint8_t ctrl, uint8_t x, uint8_t y)
+{
+    (void)cpu_read(0x2002);
+    cpu_write(0x2000, ctrl);
+    cpu_write(0x2005, x);
+    cpu_write(0x2005, y);
+}
+
+static int test_sprite0_lookahead(void)
+{
+    static const uint8_t XS[]    = { 0, 3, 7, 8, 100, 247, 248, 250, 254, 255 };
+    static const uint8_t MASKS[] = { 0x1E, 0x18, 0x1A, 0x1C };
+
+    ASSERT_TRUE(boot_nrom_chr_ram(0), "NROM boots");
+    fill_vram(1);
+    oam_fill(OFF_LINE);
+
+    // Opaque everywhere: tile 1 solid in both tables, BG all tile 1
+    for (uint16_t t = 0x0000; t < 0x2000; t += 0x1000) {
+        for (uint16_t a = 16; a < 32; ++a) ppu_mem_write((uint16_t)(t + a), 0xFF);
+    }
+    for (uint16_t a = 0x2000; a < 0x23C0; ++a) ppu_mem_write(a, 0x01);
+    scroll(0x00, 0, 0);
+    cpu_write(0x2001, 0x1E);
+
+    sprite0(40, 1, 0x00, 255);
+    ASSERT_TRUE(hit_matches("x = 255"), "x = 255");
+    ASSERT_TRUE(ppu_dots_to_sprite0_hit() == 0 && !(ppu_regs_status_peek() & 0x40), "x = 255 never hits");
+    sprite0(40, 1, 0x00, 250);
+    ASSERT_TRUE(hit_matches("x = 250"), "x = 250");
+    to_frame_start();
+    ASSERT_TRUE(frame_pos() + (int)ppu_dots_to_sprite0_hit() == 41 * 341 + 250 + 2, "solid: first pixel, line Y + 1");
+
+    sprite0(40, 1, 0x00, 2);
+    cpu_write(0x2001, 0x1A);                 // sprites clipped on the left
+    ASSERT_TRUE(hit_matches("left clip"), "left clip");
+    to_frame_start();
+    ASSERT_TRUE(frame_pos() + (int)ppu_dots_to_sprite0_hit() == 41 * 341 + 8 + 2, "left clip: from x = 8");
+
+    // Random CHR, nametables, scroll, sprite 0 and masks, in both heights
+    fill_vram(1);
+    for (int round = 0; round < 160; ++round) {
+        const uint32_t r = next();
+        const uint8_t ctrl = (uint8_t)(r & 0x3B);
+        scroll(ctrl, (uint8_t)next(), (uint8_t)(next() % 240));
+        sprite0((uint8_t)(next() % 236), (uint8_t)next(), (uint8_t)(next() & 0xE3),
+                (r & 0x100) ? XS[(r >> 9) % sizeof XS] : (uint8_t)next());
+        cpu_write(0x2001, MASKS[(r >> 13) & 3]);
+        ASSERT_TRUE(hit_matches("random sprite 0"), "random sprite 0");
+    }
+
+    cpu_write(0x2001, 0x00);
+    scroll(0x00, 0, 0);
+    return 0;
+}
+
+// --- Mid-frame splits, scanline mode against the dot pipeline ---
+// Through the pre-render line with the scroll set in vblank, then to `dot`
+// of `line`
+static void to_dot(int line, int dot)
+{
+    const int cycles = (line * 341 + dot - frame_pos()) / 3;
+    if (cycles > 0) ppu_step(cycles);
+}
+
+static void to_vblank(void)
+{
+    while (!ppu_in_vblank_lines()) ppu_step(1);
+}
+
+// The $2006/$2005/$2005/$2006 split, all four writes in the hblank of
+// `line` (after the X reload at 257, before the fetches at 321)
+static uint64_t split_frame(uint8_t ctrl, uint8_t x, uint8_t y, int line, int dot,
+                            uint8_t nt, uint8_t x2, uint8_t y2)
+{
+    to_vblank();
+    scroll(ctrl, x, y);
+    while (ppu_in_vblank_lines()) ppu_step(1);
+    if (line >= 0) {
+        to_dot(line, dot);
+        cpu_write(0x2006, (uint8_t)(nt << 2));
+        ppu_step(1);
+        cpu_write(0x2005, y2);
+        ppu_step(1);
+        cpu_write(0x2005, x2);
+        ppu_step(1);
+        cpu_write(0x2006, (uint8_t)((y2 & 0xF8) << 2 | x2 >> 3));
+    }
+    to_vblank();
+    return test_hash_bytes(1469598103934665603ull, ppu_framebuffer_index8(NULL), NES_W * NES_H);
+}
+
+static int test_scroll_split(void)
+{
+    int changed = 0;
+
+    ASSERT_TRUE(boot_nrom_chr_ram(0x01), "NROM boots");
+    fill_vram(1);
+    oam_fill(OFF_LINE);
+    ppu_set_output(PPU_OUTPUT_INDEX8);
+    cpu_write(0x2001, 0x0A);
+
+    for (int round = 0; round < 60; ++round) {
+        const uint8_t ctrl = (uint8_t)(next() & 0x13), x = (uint8_t)next(), y = (uint8_t)(next() % 240);
+        const int line = 1 + (int)(next() % 230), dot = 258 + (int)(next() % 50);
+        const uint8_t nt = (uint8_t)(next() & 3), x2 = (uint8_t)next(), y2 = (uint8_t)(next() % 240);
+
+        ppu_set_mode(PPU_MODE_SCANLINE);
+        const uint64_t plain = split_frame(ctrl, x, y, -1, 0, 0, 0, 0);
+        const uint64_t lines = split_frame(ctrl, x, y, line, dot, nt, x2, y2);
+        ppu_set_mode(PPU_MODE_DOT);
+        const uint64_t dots  = split_frame(ctrl, x, y, line, dot, nt, x2, y2);
+        if (lines != dots) {
+            fprintf(stderr, "ASSERT FAILED: split at line %d dot %d to NT %d (%d,%d) from PPUCTRL %02X (%d,%d) differs from the dot pipeline\n",
+                    line, dot, nt, x2, y2, ctrl, x, y);
+            ppu_set_mode(PPU_MODE_SCANLINE);
+            return 1;
+        }
+        changed += lines != plain;
+    }
+    ppu_set_mode(PPU_MODE_SCANLINE);
+    ASSERT_TRUE(changed >= 50, "the splits show");
+
+    cpu_write(0x2001, 0x00);
+    scroll(0x00, 0, 0);
+    ppu_set_output(PPU_OUTPUT_ARGB8888);
+    return 0;
+}
+
+// --- MMC3 IRQ from the scanline tick against A12 from CHR reads ---
+// Lines on which the IRQ line goes up over two frames from vblank, each
+// acknowledged and re-enabled right away
+static int irq_lines(int* out, int max)
+{
+    int n = 0;
+    to_vblank();
+    cpu_write(0xC001, 0x00);                 // reload on the next clock
+    cpu_write(0xE000, 0x00);
+    cpu_write(0xE001, 0x00);
+    for (int frame = 0; frame < 2; ++frame) {
+        while (ppu_in_vblank_lines()) ppu_step(1);
+        while (!ppu_in_vblank_lines()) {
+            ppu_step(1);
+            if (cpu_irq_line_asserted()) {
+                if (n < max) out[n] = frame * 262 + frame_pos() / 341;
+                ++n;
+                cpu_write(0xE000, 0x00);
+                cpu_write(0xE001, 0x00);
+            }
+        }
+    }
+    cpu_write(0xE000, 0x00);
+    return n;
+}
+
+static int test_mmc3_irq_lines(void)
+{
+    static const uint8_t LATCHES[] = { 0, 1, 2, 7, 30, 119, 200, 238, 239, 240, 255 };
+    static const uint8_t CTRLS[]   = { 0x08, 0x28 };     // sprites (8x16: the dummy tile $FF) from $1000
+    int scan[600], dot[600];
+
+    ASSERT_TRUE(boot_mmc3(), "MMC3 boots");
+    fill_vram(0);
+    oam_fill(OFF_LINE);
+    for (int i = 0; i < 8; ++i) {            // a few real sprites, odd tiles for 8x16
+        ppu_regs_oam_poke(i * 4 + 0, (uint8_t)(20 + i * 25));
+        ppu_regs_oam_poke(i * 4 + 1, (uint8_t)(i * 2 + 1));
+        ppu_regs_oam_poke(i * 4 + 3, (uint8_t)(i * 30));
+    }
+    cpu_write(0x2001, 0x18);
+
+    for (size_t c = 0; c < sizeof CTRLS; ++c)
+    for (size_t l = 0; l < sizeof LATCHES; ++l) {
+        scroll(CTRLS[c], 0, 0);
+        cpu_write(0xC000, LATCHES[l]);
+        ppu_set_mode(PPU_MODE_SCANLINE);
+        const int ns = irq_lines(scan, 600);
+        ppu_set_mode(PPU_MODE_DOT);
+        const int nd = irq_lines(dot, 600);
+        ppu_set_mode(PPU_MODE_SCANLINE);
+        ASSERT_TRUE(ns > 0, "the IRQ fires");
+        if (ns != nd || memcmp(scan, dot, (size_t)(ns < 600 ? ns : 600) * sizeof *scan) != 0) {
+            fprintf(stderr, "ASSERT FAILED: latch %d, PPUCTRL %02X: %d IRQs from the scanline tick, %d from A12 (first on lines %d, %d)\n",
+                    LATCHES[l], CTRLS[c], ns, nd, scan[0], nd ? dot[0] : -1);
+            return 1;
+        }
+    }
+
+    cpu_write(0x2001, 0x00);
+    scroll(0x00, 0, 0);
+    return 0;
+}
+
+int main(void)
+{
+    int rc;
+
+    printf("PPU render: background plane follows VRAM, CHR and PPUCTRL changes...\n");
+    rc = test_bg_plane_invalidation();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU render: sprite overflow, with the evaluation's false hits and misses...\n");
+    rc = test_sprite_overflow();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU render: 8 sprites per line, in OAM order...\n");
+    rc = test_sprite_limit();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU render: overflow look-ahead stops on the evaluating line...\n");
+    rc = test_overflow_lookahead();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU render: sprite 0 hit look-ahead against the dot pipeline...\n");
+    rc = test_sprite0_lookahead();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU render: $2005/$2006 splits mid-frame against the dot pipeline...\n");
+    rc = test_scroll_split();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("PPU render: MMC3 IRQ lines from the scanline tick against A12 reads...\n");
+    rc = test_mmc3_irq_lines();
+    if (rc) return rc; else printf("  OK\n");
+
+    printf("All PPU render tests passed.\n");
+    return 0;
+}
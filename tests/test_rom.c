@@ -0,0 +1,191 @@
+// tests/test_rom.c
+#include <stdio.h>
+#include <string.h>
+
+#include "test_rom.h"
+#include "ines.h"
+#include "nes.h"
+#include "ppu.h"
+#include "ppu_mem.h"
+
+void ta_init(ta_t* a, uint8_t* mem, uint16_t base, uint16_t org)
+{
+    memset(a, 0, sizeof *a);
+    a->mem  = mem;
+    a->base = base;
+    a->pc   = org;
+}
+
+int ta_new(ta_t* a)
+{
+    if (a->labels >= TA_LABELS) { a->error = 1; return 0; }
+    return a->labels++;
+}
+
+void ta_here(ta_t* a, int label)
+{
+    a->label[label] = a->pc;
+}
+
+int ta_label(ta_t* a)
+{
+    const int l = ta_new(a);
+    ta_here(a, l);
+    return l;
+}
+
+static void emit(ta_t* a, uint8_t b)
+{
+    a->mem[(uint16_t)(a->pc - a->base)] = b;
+    a->pc++;
+}
+
+void ta_op(ta_t* a, uint8_t op) { emit(a, op); }
+
+void ta_op8(ta_t* a, uint8_t op, uint8_t v)
+{
+    emit(a, op);
+    emit(a, v);
+}
+
+void ta_op16(ta_t* a, uint8_t op, uint16_t v)
+{
+    emit(a, op);
+    emit(a, (uint8_t)v);
+    emit(a, (uint8_t)(v >> 8));
+}
+
+static void fixup(ta_t* a, int label, int rel)
+{
+    if (a->fixups >= TA_FIXUPS) { a->error = 1; return; }
+    a->fix[a->fixups].at    = a->pc;
+    a->fix[a->fixups].label = (uint8_t)label;
+    a->fix[a->fixups].rel   = (uint8_t)rel;
+    a->fixups++;
+}
+
+void ta_branch(ta_t* a, uint8_t op, int label)
+{
+    emit(a, op);
+    fixup(a, label, 1);
+    emit(a, 0);
+}
+
+void ta_jump(ta_t* a, uint8_t op, int label)
+{
+    emit(a, op);
+    fixup(a, label, 0);
+    emit(a, 0);
+    emit(a, 0);
+}
+
+void ta_bytes(ta_t* a, const uint8_t* b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) emit(a, b[i]);
+}
+
+void ta_poke(ta_t* a, uint16_t addr, uint8_t v)
+{
+    ta_op8(a, OP_LDA_IMM, v);
+    ta_op16(a, OP_STA_ABS, addr);
+}
+
+void ta_ppu_addr(ta_t* a, uint16_t ppu_addr)
+{
+    ta_poke(a, 0x2006, (uint8_t)(ppu_addr >> 8));
+    ta_poke(a, 0x2006, (uint8_t)ppu_addr);
+}
+
+void ta_wait_vblank(ta_t* a)
+{
+    const int l = ta_label(a);
+    ta_op16(a, OP_BIT_ABS, 0x2002);
+    ta_branch(a, OP_BPL, l);
+}
+
+void ta_delay(ta_t* a, uint8_t n)
+{
+    ta_op8(a, OP_LDY_IMM, n);
+    const int outer = ta_label(a);
+    ta_op8(a, OP_LDX_IMM, 0);
+    const int inner = ta_label(a);
+    ta_op(a, OP_DEX);
+    ta_branch(a, OP_BNE, inner);
+    ta_op(a, OP_DEY);
+    ta_branch(a, OP_BNE, outer);
+}
+
+int ta_finish(ta_t* a, int nmi, int reset, int irq)
+{
+    for (int i = 0; i < a->fixups; ++i) {
+        const uint16_t at = a->fix[i].at;
+        const uint16_t to = a->label[a->fix[i].label];
+        if (!to) return 0;
+        uint8_t* p = &a->mem[(uint16_t)(at - a->base)];
+        if (a->fix[i].rel) {
+            const int d = (int)to - (int)(at + 1);
+            if (d < -128 || d > 127) return 0;
+            p[0] = (uint8_t)d;
+        } else {
+            p[0] = (uint8_t)to;
+            p[1] = (uint8_t)(to >> 8);
+        }
+    }
+
+    const int vec[3] = { nmi, reset, irq };
+    for (int i = 0; i < 3; ++i) {
+        const uint16_t to = a->label[vec[i] >= 0 ? vec[i] : reset];
+        uint8_t* p = &a->mem[(uint16_t)(0xFFFA + 2 * i - a->base)];
+        p[0] = (uint8_t)to;
+        p[1] = (uint8_t)(to >> 8);
+    }
+    return !a->error;
+}
+
+size_t test_rom_image(uint8_t* out, size_t cap, int mapper, uint8_t flags6,
+                      const uint8_t* prg, size_t prg_len, const uint8_t* chr, size_t chr_len)
+{
+    const size_t len = 16 + prg_len + chr_len;
+    if (len > cap || prg_len % 0x4000 || chr_len % 0x2000) return 0;
+
+    memset(out, 0, 16);
+    memcpy(out, "NES\x1A", 4);
+    out[4] = (uint8_t)(prg_len / 0x4000);
+    out[5] = (uint8_t)(chr_len / 0x2000);
+    out[6] = (uint8_t)((mapper & 0x0F) << 4 | (flags6 & 0x0F));
+    out[7] = (uint8_t)(mapper & 0xF0);
+    memcpy(out + 16, prg, prg_len);
+    if (chr_len) memcpy(out + 16 + prg_len, chr, chr_len);
+    return len;
+}
+
+int test_rom_boot(const uint8_t* image, size_t len)
+{
+    if (!ines_load(image, len)) return 0;
+    ppu_mem_init(ppu_mem_get_mirroring());
+    nes_reset();
+    return 1;
+}
+
+uint64_t test_hash_bytes(uint64_t h, const void* p, size_t n)
+{
+    const uint8_t* b = (const uint8_t*)p;
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * 1099511628211ull;
+    return h;
+}
+
+uint64_t test_frame_hash(void)
+{
+    const uint64_t h = 1469598103934665603ull;
+    if (ppu_get_output() == PPU_OUTPUT_INDEX8) {
+        const uint8_t* emphasis;
+        const uint8_t* idx = nes_framebuffer_index8(&emphasis);
+        return test_hash_bytes(test_hash_bytes(h, idx, NES_W * NES_H), emphasis, NES_H);
+    }
+    if (ppu_get_output() == PPU_OUTPUT_INDEX16) return test_hash_bytes(h, nes_framebuffer_index16(), NES_W * NES_H * 2);
+    int pitch = 0;
+    const uint32_t* fb = nes_framebuffer_argb8888(&pitch);
+    uint64_t r = h;
+    for (int y = 0; y < NES_H; ++y) r = test_hash_bytes(r, (const uint8_t*)fb + (size_t)y * pitch, NES_W * 4);
+    return r;
+}
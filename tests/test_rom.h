@@ -0,0 +1,89 @@
+// tests/test_rom.h
+// Cartridges assembled in memory for the whole-console tests: a tiny 6502
+// assembler with labels, an iNES image around its output, and helpers to
+// load and run it and to hash what comes out.
+#ifndef NES_TEST_ROM_H
+#define NES_TEST_ROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define TA_LABELS 128
+#define TA_FIXUPS 256
+
+// Opcodes the test programs use
+enum
+{
+    OP_ADC_IMM = 0x69, OP_AND_IMM = 0x29, OP_ASL_A   = 0x0A, OP_BCC     = 0x90,
+    OP_BCS     = 0xB0, OP_BEQ     = 0xF0, OP_BIT_ABS = 0x2C, OP_BMI     = 0x30,
+    OP_BNE     = 0xD0, OP_BPL     = 0x10, OP_CLC     = 0x18, OP_CLD     = 0xD8,
+    OP_CLI     = 0x58, OP_CMP_IMM = 0xC9, OP_CMP_ZP  = 0xC5, OP_CPX_IMM = 0xE0,
+    OP_CPY_IMM = 0xC0, OP_DEC_ZP  = 0xC6, OP_DEX     = 0xCA, OP_DEY     = 0x88,
+    OP_EOR_IMM = 0x49, OP_EOR_ZP  = 0x45, OP_INC_ZP  = 0xE6, OP_INX     = 0xE8,
+    OP_INY     = 0xC8, OP_JMP     = 0x4C, OP_JSR     = 0x20, OP_LDA_ABS = 0xAD,
+    OP_LDA_ABX = 0xBD, OP_LDA_IMM = 0xA9, OP_LDA_ZP  = 0xA5, OP_LDX_IMM = 0xA2,
+    OP_LDX_ZP  = 0xA6, OP_LDY_IMM = 0xA0, OP_LSR_A   = 0x4A, OP_NOP     = 0xEA,
+    OP_ORA_IMM = 0x09, OP_PHA     = 0x48, OP_PLA     = 0x68, OP_RTI     = 0x40,
+    OP_RTS     = 0x60, OP_SEI     = 0x78, OP_STA_ABS = 0x8D, OP_STA_ABX = 0x9D,
+    OP_STA_ZP  = 0x85, OP_STX_ABS = 0x8E, OP_STX_ZP  = 0x86, OP_STY_ABS = 0x8C,
+    OP_TAX     = 0xAA, OP_TAY     = 0xA8, OP_TXA     = 0x8A, OP_TXS     = 0x9A,
+    OP_TYA     = 0x98,
+};
+
+typedef struct
+{
+    uint8_t* mem;                // PRG image; CPU address `base` is mem[0]
+    uint16_t base;
+    uint16_t pc;                 // CPU address of the next byte
+    int      labels;
+    uint16_t label[TA_LABELS];   // 0: not placed yet
+    struct { uint16_t at; uint8_t label, rel; } fix[TA_FIXUPS];
+    int      fixups;
+    int      error;
+} ta_t;
+
+// Assemble from CPU address `org` into `mem`, which holds CPU address
+// `base` onwards (the bank the code runs from)
+void ta_init(ta_t* a, uint8_t* mem, uint16_t base, uint16_t org);
+int  ta_new(ta_t* a);                  // label id, placed later with ta_here()
+void ta_here(ta_t* a, int label);
+int  ta_label(ta_t* a);                // new label placed here
+void ta_op(ta_t* a, uint8_t op);
+void ta_op8(ta_t* a, uint8_t op, uint8_t v);
+void ta_op16(ta_t* a, uint8_t op, uint16_t v);
+void ta_branch(ta_t* a, uint8_t op, int label);
+void ta_jump(ta_t* a, uint8_t op, int label);   // JMP/JSR to a label
+void ta_bytes(ta_t* a, const uint8_t* b, size_t n);
+
+// Common sequences
+void ta_poke(ta_t* a, uint16_t addr, uint8_t v);      // LDA #v / STA addr
+void ta_ppu_addr(ta_t* a, uint16_t ppu_addr);         // two $2006 writes
+void ta_wait_vblank(ta_t* a);                         // BIT $2002 / BPL
+void ta_delay(ta_t* a, uint8_t n);                    // about n * 11.3 scanlines; X, Y = 0
+
+// Resolve the labels and set the NMI/RESET/IRQ vectors (label -1: RESET's).
+// Returns 0 if a label was never placed or a branch is out of range.
+int  ta_finish(ta_t* a, int nmi, int reset, int irq);
+
+// iNES image of `prg` and `chr` (chr_len 0: CHR-RAM) into out, size returned
+// (0 if it does not fit). flags6 bit 0: vertical mirroring, bit 3: four-screen.
+size_t test_rom_image(uint8_t* out, size_t cap, int mapper, uint8_t flags6,
+                      const uint8_t* prg, size_t prg_len, const uint8_t* chr, size_t chr_len);
+
+// Load the image and reset the console with cleared VRAM and palette, so
+// runs do not depend on what an earlier one left there. 0 on failure.
+int test_rom_boot(const uint8_t* image, size_t len);
+
+// FNV-1a of the frame in the current output format
+uint64_t test_frame_hash(void);
+uint64_t test_hash_bytes(uint64_t h, const void* p, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NES_TEST_ROM_H
@@ -0,0 +1,50 @@
+// tools/nes_trace_decode.c
+// Prints a binary CPU trace dump (cpu_trace_dump()) as nestest-style lines.
+//
+//   nes-trace-decode cpu_trace.bin [--last N] > trace.log
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace.bin> [--last N]\n", argv[0]);
+        return 2;
+    }
+    long last = -1;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--last") == 0 && i + 1 < argc) last = atol(argv[++i]);
+        else { fprintf(stderr, "Unknown arg: %s\n", argv[i]); return 2; }
+    }
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) { perror(argv[1]); return 1; }
+
+    char magic[8];
+    if (fread(magic, 1, sizeof magic, f) != sizeof magic || memcmp(magic, CPU_TRACE_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s: not a CPU trace dump\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+
+    if (last >= 0) {
+        fseek(f, 0, SEEK_END);
+        const long records = (ftell(f) - 8) / CPU_TRACE_REC_BYTES;
+        const long skip = records > last ? records - last : 0;
+        fseek(f, 8 + skip * CPU_TRACE_REC_BYTES, SEEK_SET);
+    }
+
+    uint8_t b[CPU_TRACE_REC_BYTES];
+    char line[128];
+    while (fread(b, 1, sizeof b, f) == sizeof b) {
+        cpu_trace_rec_t r;
+        cpu_trace_unpack(b, &r);
+        cpu_trace_format(&r, line, sizeof line);
+        puts(line);
+    }
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,197 @@
+// tools/ppu_bench.c
+// Runs the same ROM with the scanline renderer and the dot-accurate PPU and
+// reports the cost of each, plus how many frames came out identical and how
+// often the scanline renderer's background plane could reuse decoded tiles.
+// With --draw-every N only every Nth frame is drawn (nes_set_skip_render());
+// those are also checked against a scanline run that draws every frame.
+// With --index8 or --index16 the core writes indexed frames, which are what
+// gets hashed; --index16 (emphasis per pixel) also matches between the two
+// PPU models on mid-line emphasis changes.
+// With --render-thread the scanline run is repeated with the render thread
+// (nes_set_render_thread()), timed by the wall clock, and checked against it
+// from the second frame on (the first shows the palette RAM the previous run
+// left, which a reset keeps).
+//
+//   nes-ppu-bench game.nes [--frames N] [--core ref|fast|jit] [--draw-every N]
+//                 [--index8|--index16] [--render-thread]
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpu.h"
+#include "ines.h"
+#include "nes.h"
+#include "ppu.h"
+#include "ppu_bg_plane.h"
+
+typedef struct
+{
+    double    seconds;
+    uint64_t* hashes; // one per frame
+    uint64_t  bg_lookups, bg_decoded;
+} run_t;
+
+static uint64_t hash_bytes(uint64_t h, const void* p, size_t n)
+{
+    const uint8_t* b = (const uint8_t*)p;
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * 1099511628211ull;
+    return h;
+}
+
+static uint64_t hash_frame(void)
+{
+    const uint64_t h = 1469598103934665603ull; // FNV-1a
+    if (ppu_get_output() == PPU_OUTPUT_INDEX8) {
+        const uint8_t* emphasis;
+        const uint8_t* idx = nes_framebuffer_index8(&emphasis);
+        return hash_bytes(hash_bytes(h, idx, NES_W * NES_H), emphasis, NES_H);
+    }
+    if (ppu_get_output() == PPU_OUTPUT_INDEX16) {
+        return hash_bytes(h, nes_framebuffer_index16(), NES_W * NES_H * 2);
+    }
+    return hash_bytes(h, nes_framebuffer_argb8888(NULL), NES_W * NES_H * 4);
+}
+
+// Frame f (from 0) is drawn
+static int drawn(int f, int every)
+{
+    return (f + 1) % every == 0;
+}
+
+// Seconds by the wall clock: with the render thread, clock() would add up
+// both threads' time
+static double wall_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static int run(const uint8_t* rom, size_t rom_size, ppu_mode_t mode, int frames, int every, int thread, run_t* out)
+{
+    if (thread && !nes_set_render_thread(1)) return 0;
+    if (!ines_load(rom, rom_size)) return 0;
+    ppu_set_mode(mode);
+    nes_reset();
+
+    double frame_time = 0.0;
+    for (int f = 0; f < frames; ++f) {
+        nes_set_skip_render(!drawn(f, every));
+        if (thread) {
+            // Up to the frame being complete, as a frontend needs it
+            const double t0 = wall_seconds();
+            nes_step_frame();
+            (void)nes_framebuffer_argb8888(NULL);
+            frame_time += wall_seconds() - t0;
+        } else {
+            const clock_t t0 = clock();
+            nes_step_frame();
+            frame_time += (double)(clock() - t0) / CLOCKS_PER_SEC;
+        }
+        out->hashes[f] = hash_frame();
+
+        const ppu_bg_plane_stats_t bg = ppu_bg_plane_frame_stats();   // the frame before
+        out->bg_lookups += bg.lookups;
+        out->bg_decoded += bg.decoded;
+    }
+    nes_set_skip_render(0);
+    nes_set_render_thread(0);
+    out->seconds = frame_time;
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <rom.nes> [--frames N] [--core ref|fast|jit] [--draw-every N] [--index8|--index16]"
+                        " [--render-thread]\n", argv[0]);
+        return 2;
+    }
+    int frames = 600, every = 1, thread = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--draw-every") == 0 && i + 1 < argc) every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--index8") == 0) nes_set_video_output(NES_VIDEO_INDEX8);
+        else if (strcmp(argv[i], "--index16") == 0) nes_set_video_output(NES_VIDEO_INDEX16);
+        else if (strcmp(argv[i], "--render-thread") == 0) thread = 1;
+        else if (strcmp(argv[i], "--core") == 0 && i + 1 < argc) {
+            const char* c = argv[++i];
+            if      (strcmp(c, "ref") == 0)  cpu_set_core(CPU_CORE_REFERENCE);
+            else if (strcmp(c, "fast") == 0) cpu_set_core(CPU_CORE_FAST);
+            else if (strcmp(c, "jit") == 0)  cpu_set_core(CPU_CORE_JIT);
+            else { fprintf(stderr, "Unknown core: %s\n", c); return 2; }
+        }
+        else { fprintf(stderr, "Unknown arg: %s\n", argv[i]); return 2; }
+    }
+    if (frames <= 0) frames = 1;
+    if (every <= 0) every = 1;
+
+    size_t rom_size = 0;
+    uint8_t* rom = ines_read_file(argv[1], &rom_size);
+    if (!rom) { fprintf(stderr, "Failed to read ROM: %s\n", argv[1]); return 1; }
+
+    run_t line = { 0.0, calloc((size_t)frames, sizeof(uint64_t)), 0, 0 };
+    run_t dot  = { 0.0, calloc((size_t)frames, sizeof(uint64_t)), 0, 0 };
+    run_t full = { 0.0, calloc((size_t)frames, sizeof(uint64_t)), 0, 0 };
+    run_t thr  = { 0.0, calloc((size_t)frames, sizeof(uint64_t)), 0, 0 };
+    if (!line.hashes || !dot.hashes || !full.hashes || !thr.hashes) { fprintf(stderr, "Out of memory\n"); return 1; }
+
+    const ppu_mode_t initial = ppu_get_mode();
+    if (!run(rom, rom_size, PPU_MODE_SCANLINE, frames, every, 0, &line) ||
+        !run(rom, rom_size, PPU_MODE_DOT, frames, every, 0, &dot) ||
+        (every > 1 && !run(rom, rom_size, PPU_MODE_SCANLINE, frames, 1, 0, &full))) {
+        fprintf(stderr, "ines_load failed for %s\n", argv[1]);
+        return 1;
+    }
+    if (thread && !run(rom, rom_size, PPU_MODE_SCANLINE, frames, every, 1, &thr)) {
+        fprintf(stderr, "Render thread unavailable (or ines_load failed)\n");
+        return 1;
+    }
+    ppu_set_mode(initial);
+
+    int same = 0, first_diff = -1, shown = 0, full_same = 0, thr_same = 0, thr_shown = 0;
+    for (int f = 0; f < frames; ++f) {
+        if (!drawn(f, every)) continue;
+        shown++;
+        if (line.hashes[f] == dot.hashes[f]) same++;
+        else if (first_diff < 0) first_diff = f;
+        if (every > 1 && line.hashes[f] == full.hashes[f]) full_same++;
+        if (f > 0) {
+            thr_shown++;
+            thr_same += line.hashes[f] == thr.hashes[f];
+        }
+    }
+
+    printf("frames          %d", frames);
+    if (every > 1) printf(" (%d drawn)", shown);
+    printf("\n");
+    printf("scanline        %8.3f ms/frame  (%7.1f fps)\n", 1000.0 * line.seconds / frames, frames / line.seconds);
+    printf("dot             %8.3f ms/frame  (%7.1f fps)\n", 1000.0 * dot.seconds / frames, frames / dot.seconds);
+    printf("dot / scanline  %8.2fx\n", dot.seconds / line.seconds);
+    printf("identical       %d/%d frames", same, shown);
+    if (first_diff >= 0) printf(" (first difference: frame %d)", first_diff + 1);
+    printf("\n");
+    if (every > 1) {
+        printf("headless        %d/%d drawn frames as when drawing all (%8.3f ms/frame)\n",
+               full_same, shown, 1000.0 * full.seconds / frames);
+    }
+    if (thread) {
+        printf("render thread   %8.3f ms/frame  (%7.1f fps, wall), %d/%d frames as inline\n",
+               1000.0 * thr.seconds / frames, frames / thr.seconds, thr_same, thr_shown);
+    }
+    if (line.bg_lookups) {
+        printf("bg tiles        %.1f decoded/frame, %.2f%% of lookups reused\n",
+               (double)line.bg_decoded / frames,
+               100.0 * (double)(line.bg_lookups - line.bg_decoded) / (double)line.bg_lookups);
+    }
+
+    free(line.hashes);
+    free(dot.hashes);
+    free(full.hashes);
+    free(thr.hashes);
+    nes_set_video_output(NES_VIDEO_ARGB8888);
+    free(rom);
+    return 0;
+}
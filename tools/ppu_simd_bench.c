@@ -0,0 +1,204 @@
+// tools/ppu_simd_bench.c
+// Micro-benchmark of the renderer's pixel kernels (ppu_simd.c): each kernel
+// at every level this CPU supports, on random input, checked against the
+// scalar version. --check skips the timing and compares on more inputs
+// (the CTest mode).
+//
+//   nes-ppu-simd-bench [--iters N] [--check]
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "ppu_simd.h"
+
+#define NES_W 256
+
+static uint8_t  g_chr[64][16];
+static uint8_t  g_px[33][8];
+static const uint8_t* g_rows[33];
+static uint8_t  g_pal_bits[33];
+static uint8_t  g_bg[NES_W];
+static uint8_t  g_spr[NES_W + 8];
+static uint32_t g_pal[32];
+static uint8_t  g_pal_index[32];
+static uint8_t  g_index[NES_W * 4];   // colour indexes, 0..63
+static uint32_t g_lut32[64];
+static uint16_t g_lut16[64];
+static int      g_index_len = (int)sizeof g_index;   // --check varies it for partial vectors
+
+static uint32_t rng = 0x12345678u;
+static uint32_t next(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static void fill_inputs(void)
+{
+    for (int i = 0; i < 64; ++i)
+        for (int j = 0; j < 16; ++j) g_chr[i][j] = (uint8_t)next();
+    for (int i = 0; i < 33; ++i) {
+        for (int c = 0; c < 8; ++c) g_px[i][c] = (uint8_t)(next() & 3);
+        g_rows[i]     = g_px[i];
+        g_pal_bits[i] = (uint8_t)((next() & 3) << 2);
+    }
+    for (int x = 0; x < NES_W; ++x) {
+        const uint32_t r = next();
+        g_bg[x]  = (r & 3) ? (uint8_t)((r >> 2) & 0x0F) : 0;
+        g_spr[x] = (r & 0x30) ? (uint8_t)(0x10 | ((r >> 8) & 0x0F) | ((r & 0x40) ? PPU_SPR_BEHIND : 0)) : 0;
+    }
+    for (int i = 0; i < 32; ++i) g_pal[i] = 0xFF000000u | (next() & 0xFFFFFFu);
+    for (int i = 0; i < 32; ++i) g_pal_index[i] = (uint8_t)(next() & 63);
+    for (size_t i = 0; i < sizeof g_index; ++i) g_index[i] = (uint8_t)(next() & 63);
+    for (int i = 0; i < 64; ++i) {
+        g_lut32[i] = next();
+        g_lut16[i] = (uint16_t)next();
+    }
+}
+
+// One pass of a kernel over a frame's worth of work, into g_out; the output
+// is hashed afterwards so the levels can be compared
+static _Alignas(32) uint8_t g_out[64 * 128];
+
+typedef void (*pass_fn)(const ppu_kernels_t* k);
+
+static void pass_tile_decode(const ppu_kernels_t* k)
+{
+    for (int i = 0; i < 64; ++i) k->tile_decode(g_out + i * 128, g_out + i * 128 + 64, g_chr[i]);
+}
+
+static void pass_bg_tiles(const ppu_kernels_t* k)
+{
+    for (int y = 0; y < 16; ++y) k->bg_tiles(g_out + y * 33 * 8, g_rows, g_pal_bits, 33);
+}
+
+static void pass_spr_row(const ppu_kernels_t* k)
+{
+    memset(g_out, 0, NES_W + 8);
+    for (int i = 0; i < 64; ++i) {
+        k->spr_row(g_out + (i * 37) % NES_W, g_px[i % 33], (uint8_t)(0x10 | (i & 3) << 2 | ((i & 4) ? PPU_SPR_BEHIND : 0)));
+    }
+}
+
+static void pass_compose(const ppu_kernels_t* k)
+{
+    for (int clip = 0; clip < 4; ++clip) {
+        k->compose((uint32_t*)(void*)(g_out + clip * NES_W * 4), g_bg, g_spr, g_pal, clip & 1, clip >> 1);
+    }
+}
+
+static void pass_compose_index(const ppu_kernels_t* k)
+{
+    for (int clip = 0; clip < 4; ++clip) {
+        k->compose_index(g_out + clip * NES_W, g_bg, g_spr, g_pal_index, clip & 1, clip >> 1);
+    }
+}
+
+static void pass_expand32(const ppu_kernels_t* k)
+{
+    k->expand32((uint32_t*)(void*)g_out, g_index, g_lut32, g_index_len);
+}
+
+static void pass_expand16(const ppu_kernels_t* k)
+{
+    k->expand16((uint16_t*)(void*)g_out, g_index, g_lut16, g_index_len);
+}
+
+static uint64_t hash_out(void)
+{
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (size_t i = 0; i < sizeof g_out; ++i) h = (h ^ g_out[i]) * 1099511628211ull;
+    return h;
+}
+
+static const struct
+{
+    const char* name;
+    pass_fn     run;
+} KERNELS[] = {
+    { "tile_decode (64 tiles)",   pass_tile_decode },
+    { "bg_tiles (16 lines)",      pass_bg_tiles },
+    { "spr_row (64 sprites)",     pass_spr_row },
+    { "compose (4 lines)",        pass_compose },
+    { "compose_index (4 lines)",  pass_compose_index },
+    { "expand32 (4 lines)",       pass_expand32 },
+    { "expand16 (4 lines)",       pass_expand16 },
+};
+
+// --check: every kernel at every level against scalar on fresh random input
+// and expand lengths each round, no timing
+static int check(int rounds)
+{
+    int failed[PPU_SIMD_AVX2 + 1] = { 0 };
+    for (int r = 0; r < rounds; ++r) {
+        fill_inputs();
+        g_index_len = (int)sizeof g_index - r % 33;
+        for (size_t n = 0; n < sizeof KERNELS / sizeof KERNELS[0]; ++n) {
+            memset(g_out, 0, sizeof g_out);
+            KERNELS[n].run(ppu_simd_kernels(PPU_SIMD_SCALAR));
+            const uint64_t want = hash_out();
+            for (int l = PPU_SIMD_SCALAR + 1; l <= PPU_SIMD_AVX2; ++l) {
+                const ppu_kernels_t* k = ppu_simd_kernels((ppu_simd_t)l);
+                if (!k) continue;
+                memset(g_out, 0, sizeof g_out);
+                KERNELS[n].run(k);
+                if (hash_out() != want && !failed[l]++) {
+                    printf("%s: %s MISMATCH (round %d)\n", ppu_simd_name((ppu_simd_t)l), KERNELS[n].name, r);
+                }
+            }
+        }
+    }
+
+    int any = 0;
+    for (int l = PPU_SIMD_SCALAR + 1; l <= PPU_SIMD_AVX2; ++l) {
+        printf("  %-7s %s\n", ppu_simd_name((ppu_simd_t)l),
+               !ppu_simd_kernels((ppu_simd_t)l) ? "not available here" : failed[l] ? "MISMATCH" : "ok");
+        any |= failed[l] != 0;
+    }
+    return any;
+}
+
+int main(int argc, char** argv)
+{
+    long iters = 200000;
+    int check_only = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) iters = atol(argv[++i]);
+        else if (strcmp(argv[i], "--check") == 0) check_only = 1;
+        else { fprintf(stderr, "Usage: %s [--iters N] [--check]\n", argv[0]); return 2; }
+    }
+    if (iters <= 0) iters = 1;
+
+    printf("best level: %s\n", ppu_simd_name(ppu_simd_best()));
+    if (check_only) return check(256);
+    fill_inputs();
+
+    int failed = 0;
+    for (size_t n = 0; n < sizeof KERNELS / sizeof KERNELS[0]; ++n) {
+        printf("%s\n", KERNELS[n].name);
+        memset(g_out, 0, sizeof g_out);
+        KERNELS[n].run(ppu_simd_kernels(PPU_SIMD_SCALAR));
+        const uint64_t want = hash_out();
+        double scalar_ns = 0.0;
+        for (int l = PPU_SIMD_SCALAR; l <= PPU_SIMD_AVX2; ++l) {
+            const ppu_kernels_t* k = ppu_simd_kernels((ppu_simd_t)l);
+            if (!k) continue;
+
+            memset(g_out, 0, sizeof g_out);
+            KERNELS[n].run(k);
+            const uint64_t got = hash_out();
+
+            const clock_t t0 = clock();
+            for (long i = 0; i < iters; ++i) KERNELS[n].run(k);
+            const double ns = 1e9 * (double)(clock() - t0) / CLOCKS_PER_SEC / (double)iters;
+            if (l == PPU_SIMD_SCALAR) scalar_ns = ns;
+
+            printf("  %-7s %10.1f ns/pass  %5.2fx  %s\n", ppu_simd_name((ppu_simd_t)l), ns,
+                   ns > 0.0 ? scalar_ns / ns : 0.0, got == want ? "ok" : "MISMATCH");
+            failed |= got != want;
+        }
+    }
+    return failed;
+}